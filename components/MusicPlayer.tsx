@@ -3,12 +3,41 @@
  *
  * Features:
  * - Play/pause controls
- * - Waveform visualization
+ * - Waveform visualization (from the worker's precomputed peaks)
+ * - Progressive playback (Opus rendition where the browser supports it)
  * - Download options (mix + stems)
  */
 
 import React, { useRef, useEffect, useState } from 'react';
 import { Play, Pause, Download, Music2 } from 'lucide-react';
+import { fetchPeaks, getStreamUrl, WaveformPeaks } from '../services/musicAPI';
+
+const BAR_COUNT = 60;
+
+// Bar height (fraction of the canvas) while peaks are loading or missing
+const PLACEHOLDER_LEVEL = 0.1;
+
+
+/**
+ * Peak amplitude under each of count bars, from the coarsest level that
+ * still has at least one pixel per bar
+ */
+function barLevels(levels: WaveformPeaks[], count: number): number[] {
+  const usable = levels.filter(level => level.data.length / 2 >= count);
+  const level = usable[usable.length - 1] || levels[0];
+  const pixels = level ? level.data.length / 2 : 0;
+  if (!pixels) return new Array(count).fill(PLACEHOLDER_LEVEL);
+
+  return Array.from({ length: count }, (_, bar) => {
+    const start = Math.floor((bar * pixels) / count);
+    const end = Math.max(start + 1, Math.floor(((bar + 1) * pixels) / count));
+    let peak = 0;
+    for (let i = 2 * start; i < 2 * end && i < level.data.length; i++) {
+      peak = Math.max(peak, Math.abs(level.data[i]));
+    }
+    return peak;
+  });
+}
 
 
 interface MusicPlayerProps {
@@ -24,6 +53,28 @@ export function MusicPlayer({ jobId, audioUrl, stems }: MusicPlayerProps) {
   const [isPlaying, setIsPlaying] = useState(false);
   const [currentTime, setCurrentTime] = useState(0);
   const [duration, setDuration] = useState(0);
+  const [bars, setBars] = useState<number[] | null>(null);
+  const [streamFailed, setStreamFailed] = useState(false);
+
+  // Stream the Opus rendition when the browser can play it, else the WAV
+  // (range requests let either start before the download finishes)
+  const canStream = typeof Audio !== 'undefined'
+    && new Audio().canPlayType('audio/ogg; codecs=opus') !== '';
+  const src = jobId && canStream && !streamFailed ? getStreamUrl(jobId) : audioUrl;
+
+  // Load precomputed waveform peaks
+  useEffect(() => {
+    setBars(null);
+    setStreamFailed(false);
+    if (!jobId || !audioUrl) return;
+
+    let cancelled = false;
+    fetchPeaks(jobId)
+      .then(levels => { if (!cancelled) setBars(barLevels(levels, BAR_COUNT)); })
+      .catch(() => { /* Keep the placeholder bars */ });
+
+    return () => { cancelled = true; };
+  }, [jobId, audioUrl]);
 
   // Handle play/pause
   const togglePlay = () => {
@@ -57,7 +108,7 @@ export function MusicPlayer({ jobId, audioUrl, stems }: MusicPlayerProps) {
     };
   }, [audioUrl]);
 
-  // Draw waveform (simplified visualization)
+  // Draw waveform
   useEffect(() => {
     if (!canvasRef.current || !audioUrl) return;
 
@@ -69,13 +120,14 @@ export function MusicPlayer({ jobId, audioUrl, stems }: MusicPlayerProps) {
     ctx.fillStyle = '#1e293b';
     ctx.fillRect(0, 0, canvas.width, canvas.height);
 
-    // Draw simple waveform bars
-    const barCount = 60;
+    // Draw waveform bars
+    const barCount = BAR_COUNT;
     const barWidth = canvas.width / barCount;
     const progress = duration > 0 ? currentTime / duration : 0;
 
     for (let i = 0; i < barCount; i++) {
-      const barHeight = Math.random() * canvas.height * 0.8;
+      const level = bars ? bars[i] : PLACEHOLDER_LEVEL;
+      const barHeight = Math.max(2, level * canvas.height * 0.8);
       const x = i * barWidth;
       const y = (canvas.height - barHeight) / 2;
 
@@ -88,7 +140,7 @@ export function MusicPlayer({ jobId, audioUrl, stems }: MusicPlayerProps) {
 
       ctx.fillRect(x + 2, y, barWidth - 4, barHeight);
     }
-  }, [audioUrl, currentTime, duration]);
+  }, [audioUrl, bars, currentTime, duration]);
 
   // Format time
   const formatTime = (seconds: number) => {
@@ -110,7 +162,12 @@ export function MusicPlayer({ jobId, audioUrl, stems }: MusicPlayerProps) {
   return (
     <div className="bg-slate-900 border-2 border-slate-800 rounded-xl overflow-hidden">
       {/* Audio element */}
-      <audio ref={audioRef} src={audioUrl} />
+      <audio
+        ref={audioRef}
+        src={src || undefined}
+        preload="metadata"
+        onError={() => setStreamFailed(true)}
+      />
 
       {/* Waveform */}
       <div className="p-4">
@@ -30,6 +30,8 @@ interface DashboardMetrics {
       enabled: boolean;
       cacheSize: number;
       cacheHitRate?: number;
+      cacheEvictions?: number;
+      cacheCoalesced?: number;
     };
   };
 }
@@ -66,7 +68,10 @@ export class MonitoringDashboard {
         },
         printify: {
           enabled: stats.services.printify.enabled,
-          cacheSize: stats.services.printify.metrics?.cache?.size || 0
+          cacheSize: stats.services.printify.metrics?.cache?.size || 0,
+          cacheHitRate: stats.services.printify.metrics?.cache?.hitRate,
+          cacheEvictions: stats.services.printify.metrics?.cache?.evictions,
+          cacheCoalesced: stats.services.printify.metrics?.cache?.coalesced
         }
       }
     };
@@ -123,6 +128,12 @@ export class MonitoringDashboard {
     const printifyIcon = metrics.services.printify.enabled ? '✅' : '⚪';
     console.log(`║  ${printifyIcon} Printify:     ${metrics.services.printify.enabled ? 'ENABLED' : 'DISABLED'.padEnd(35)} ║`);
     console.log(`║     Cache Size:    ${String(metrics.services.printify.cacheSize).padEnd(40)} ║`);
+    if (metrics.services.printify.cacheHitRate !== undefined) {
+      const hitRate = `${(metrics.services.printify.cacheHitRate * 100).toFixed(1)}%`;
+      console.log(`║     Hit Rate:      ${hitRate.padEnd(40)} ║`);
+      console.log(`║     Evictions:     ${String(metrics.services.printify.cacheEvictions ?? 0).padEnd(40)} ║`);
+      console.log(`║     Coalesced:     ${String(metrics.services.printify.cacheCoalesced ?? 0).padEnd(40)} ║`);
+    }
 
     console.log('╚════════════════════════════════════════════════════════════╝');
     console.log(`\n Last updated: ${metrics.timestamp}`);
@@ -0,0 +1,145 @@
+"""
+Catalog Cache
+Two-tier (in-process LRU + on-disk) TTL cache for slow-changing Printify catalog data
+"""
+import os
+import json
+import time
+import logging
+import threading
+from collections import OrderedDict
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+from typing import Any, Callable, Optional, Set, Tuple
+
+logger = logging.getLogger(__name__)
+
+
+class CatalogCache:
+    """
+    TTL cache with stale-while-revalidate
+
+    Fresh entries are served from memory. Expired entries are still served
+    (so callers never wait on the network for data they already have) while
+    a single background refresh replaces them. Entries are also persisted
+    to one small JSON file per key, so restarts start warm.
+    """
+
+    def __init__(
+        self,
+        cache_dir: Optional[str] = None,
+        ttl_seconds: float = 24 * 3600,
+        max_entries: int = 256
+    ):
+        """
+        Initialize catalog cache
+
+        Args:
+            cache_dir: Directory for persisted entries (None = memory only)
+            ttl_seconds: Age after which an entry is refreshed
+            max_entries: In-process LRU capacity
+        """
+        self.cache_dir = Path(cache_dir) if cache_dir else None
+        if self.cache_dir:
+            try:
+                self.cache_dir.mkdir(parents=True, exist_ok=True)
+            except OSError as e:
+                logger.warning(f"Catalog cache dir {cache_dir} unusable, caching in memory only: {e}")
+                self.cache_dir = None
+        self.ttl_seconds = ttl_seconds
+        self.max_entries = max_entries
+        self._entries: "OrderedDict[str, Tuple[float, Any]]" = OrderedDict()
+        self._refreshing: Set[str] = set()
+        self._lock = threading.Lock()
+        self._executor = ThreadPoolExecutor(max_workers=1, thread_name_prefix="catalog-refresh")
+
+    def get(self, key: str, fetch: Callable[[], Any]) -> Any:
+        """
+        Get a cached value, fetching it on a miss
+
+        Args:
+            key: Cache key (e.g. "variants/77/39")
+            fetch: Returns the fresh value (must be JSON serializable)
+
+        Returns:
+            Cached or freshly fetched value
+        """
+        entry = self._lookup(key)
+        if entry is None:
+            return self.put(key, fetch())
+
+        fetched_at, value = entry
+        if time.time() - fetched_at > self.ttl_seconds:
+            self._refresh_later(key, fetch)
+        return value
+
+    def put(self, key: str, value: Any) -> Any:
+        """Store a fresh value in both tiers"""
+        entry = (time.time(), value)
+        self._remember(key, entry)
+        if self.cache_dir:
+            try:
+                self._write(key, entry)
+            except OSError as e:
+                logger.warning(f"Failed to persist catalog cache entry {key}: {e}")
+        return value
+
+    def _lookup(self, key: str) -> Optional[Tuple[float, Any]]:
+        with self._lock:
+            entry = self._entries.get(key)
+            if entry is not None:
+                self._entries.move_to_end(key)
+                return entry
+
+        entry = self._read(key)
+        if entry is not None:
+            self._remember(key, entry)
+        return entry
+
+    def _remember(self, key: str, entry: Tuple[float, Any]) -> None:
+        with self._lock:
+            self._entries[key] = entry
+            self._entries.move_to_end(key)
+            while len(self._entries) > self.max_entries:
+                self._entries.popitem(last=False)
+
+    def _refresh_later(self, key: str, fetch: Callable[[], Any]) -> None:
+        with self._lock:
+            if key in self._refreshing:
+                return
+            self._refreshing.add(key)
+
+        def refresh():
+            try:
+                self.put(key, fetch())
+                logger.debug(f"Refreshed catalog cache entry {key}")
+            except Exception as e:
+                logger.warning(f"Background refresh of {key} failed, keeping stale entry: {e}")
+            finally:
+                with self._lock:
+                    self._refreshing.discard(key)
+
+        self._executor.submit(refresh)
+
+    def _path(self, key: str) -> Path:
+        return self.cache_dir / (key.replace("/", "_") + ".json")
+
+    def _read(self, key: str) -> Optional[Tuple[float, Any]]:
+        if not self.cache_dir:
+            return None
+        try:
+            with open(self._path(key), 'r') as f:
+                data = json.load(f)
+            return data["fetched_at"], data["value"]
+        except FileNotFoundError:
+            return None
+        except (OSError, ValueError, KeyError) as e:
+            logger.warning(f"Ignoring unreadable catalog cache entry {key}: {e}")
+            return None
+
+    def _write(self, key: str, entry: Tuple[float, Any]) -> None:
+        path = self._path(key)
+        temp_file = f"{path}.{threading.get_ident()}.tmp"
+        with open(temp_file, 'w') as f:
+            json.dump({"fetched_at": entry[0], "value": entry[1]}, f, separators=(',', ':'))
+        os.replace(temp_file, path)
@@ -4,7 +4,7 @@ Loads and validates settings from environment variables with type safety
 """
 import os
 from pathlib import Path
-from typing import Optional
+from typing import Optional, Tuple
 from dataclasses import dataclass
 import sys
 
@@ -15,11 +15,25 @@ class FilesystemConfig:
     image_dir: Path
     state_file: Path
     archive_dir: Path
+    thumbnail_dir: Path = Path("/workspace/gateway/thumbnails")
+    thumbnail_widths: Tuple[int, ...] = (256, 512)  # Allowed gallery derivative widths
+    image_cache_max_age: int = 300  # Cache-Control max-age for served images (seconds)
+    state_fsync_interval: float = 1.0  # Max seconds between state log fsyncs
+    state_compact_after: int = 10000  # State log records before snapshot compaction
+    image_poll_interval: float = 2.0  # Image dir rescan interval when inotify is unavailable
+    image_verify_crc: bool = False  # Check PNG chunk CRCs when validating (reads whole file)
 
     def validate(self) -> None:
         """Ensure all directories exist"""
+        if self.state_fsync_interval < 0:
+            raise ValueError("state_fsync_interval must be non-negative")
+        if self.state_compact_after < 1:
+            raise ValueError("state_compact_after must be positive")
         self.image_dir.mkdir(parents=True, exist_ok=True)
         self.archive_dir.mkdir(parents=True, exist_ok=True)
+        self.thumbnail_dir.mkdir(parents=True, exist_ok=True)
+        if not self.thumbnail_widths or min(self.thumbnail_widths) <= 0:
+            raise ValueError("thumbnail_widths must be positive integers")
         self.state_file.parent.mkdir(parents=True, exist_ok=True)
 
 
@@ -46,6 +60,12 @@ class PrintifyConfig:
     blueprint_id: int = 77  # Gildan 18500 Heavy Blend Hoodie (most popular POD product)
     provider_id: int = 39  # SwiftPOD (US-based, reliable, fast shipping)
     default_price_cents: int = 3499  # $34.99 (typical hoodie price)
+    catalog_cache_dir: Optional[str] = None  # Persisted blueprint/variant cache
+    catalog_cache_ttl_seconds: float = 24 * 3600
+    # Background publish queue: concurrent uploads, creates and publishes
+    upload_concurrency: int = 4
+    create_concurrency: int = 2
+    publish_concurrency: int = 2
 
     def validate(self) -> None:
         """Validate Printify configuration"""
@@ -55,6 +75,10 @@ class PrintifyConfig:
             raise ValueError("Invalid Printify Shop ID (must be numeric)")
         if self.default_price_cents < 0:
             raise ValueError("Price must be non-negative")
+        if self.catalog_cache_ttl_seconds <= 0:
+            raise ValueError("Catalog cache TTL must be positive")
+        if min(self.upload_concurrency, self.create_concurrency, self.publish_concurrency) < 1:
+            raise ValueError("Publish stage concurrency must be at least 1")
 
     def is_configured(self) -> bool:
         """Check if Printify is fully configured"""
@@ -110,11 +134,14 @@ class ComfyUIConfig:
     """ComfyUI API configuration"""
     api_url: str
     runpod_api_key: Optional[str] = None
+    max_batch_size: int = 4  # Images per workflow (latent batch x prompts)
 
     def validate(self) -> None:
         """Validate ComfyUI configuration"""
         if not self.api_url:
             raise ValueError("COMFYUI_API_URL must be set")
+        if self.max_batch_size < 1:
+            raise ValueError("COMFYUI_MAX_BATCH_SIZE must be at least 1")
 
     def is_runpod_serverless(self) -> bool:
         """Check if this is a RunPod serverless endpoint"""
@@ -128,7 +155,16 @@ class GatewayConfig:
         self.filesystem = FilesystemConfig(
             image_dir=Path(os.getenv("POD_IMAGE_DIR", "/workspace/comfyui/output")),
             state_file=Path(os.getenv("POD_STATE_FILE", "/workspace/gateway/state.json")),
-            archive_dir=Path(os.getenv("POD_ARCHIVE_DIR", "/workspace/gateway/archive"))
+            archive_dir=Path(os.getenv("POD_ARCHIVE_DIR", "/workspace/gateway/archive")),
+            thumbnail_dir=Path(os.getenv("POD_THUMBNAIL_DIR", "/workspace/gateway/thumbnails")),
+            thumbnail_widths=tuple(
+                int(w) for w in os.getenv("POD_THUMBNAIL_WIDTHS", "256,512").split(",") if w.strip()
+            ),
+            image_cache_max_age=int(os.getenv("POD_IMAGE_CACHE_MAX_AGE", "300")),
+            state_fsync_interval=float(os.getenv("POD_STATE_FSYNC_INTERVAL", "1.0")),
+            state_compact_after=int(os.getenv("POD_STATE_COMPACT_AFTER", "10000")),
+            image_poll_interval=float(os.getenv("POD_IMAGE_POLL_INTERVAL", "2.0")),
+            image_verify_crc=os.getenv("POD_IMAGE_VERIFY_CRC", "false").lower() == "true"
         )
 
         self.flask = FlaskConfig(
@@ -142,7 +178,12 @@ class GatewayConfig:
             shop_id=os.getenv("PRINTIFY_SHOP_ID"),
             blueprint_id=int(os.getenv("PRINTIFY_BLUEPRINT_ID", "77")),  # Gildan 18500 Heavy Blend Hoodie
             provider_id=int(os.getenv("PRINTIFY_PROVIDER_ID", "39")),  # SwiftPOD
-            default_price_cents=int(os.getenv("PRINTIFY_DEFAULT_PRICE_CENTS", "3499"))  # $34.99
+            default_price_cents=int(os.getenv("PRINTIFY_DEFAULT_PRICE_CENTS", "3499")),  # $34.99
+            catalog_cache_dir=os.getenv("PRINTIFY_CATALOG_CACHE_DIR", "/workspace/gateway/catalog_cache"),
+            catalog_cache_ttl_seconds=float(os.getenv("PRINTIFY_CATALOG_CACHE_TTL", str(24 * 3600))),
+            upload_concurrency=int(os.getenv("PRINTIFY_UPLOAD_CONCURRENCY", "4")),
+            create_concurrency=int(os.getenv("PRINTIFY_CREATE_CONCURRENCY", "2")),
+            publish_concurrency=int(os.getenv("PRINTIFY_PUBLISH_CONCURRENCY", "2"))
         )
 
         self.shopify = ShopifyConfig(
@@ -176,7 +217,8 @@ class GatewayConfig:
 
         self.comfyui = ComfyUIConfig(
             api_url=api_url,
-            runpod_api_key=runpod_api_key
+            runpod_api_key=runpod_api_key,
+            max_batch_size=int(os.getenv("COMFYUI_MAX_BATCH_SIZE", "4"))
         )
 
     def validate_all(self) -> None:
@@ -218,7 +260,14 @@ config.validate_all()
 # Legacy compatibility: expose individual config values as module-level variables
 IMAGE_DIR = str(config.filesystem.image_dir)
 STATE_FILE = str(config.filesystem.state_file)
+STATE_FSYNC_INTERVAL = config.filesystem.state_fsync_interval
+STATE_COMPACT_AFTER = config.filesystem.state_compact_after
+IMAGE_POLL_INTERVAL = config.filesystem.image_poll_interval
+IMAGE_VERIFY_CRC = config.filesystem.image_verify_crc
 ARCHIVE_DIR = str(config.filesystem.archive_dir)
+THUMBNAIL_DIR = str(config.filesystem.thumbnail_dir)
+THUMBNAIL_WIDTHS = config.filesystem.thumbnail_widths
+IMAGE_CACHE_MAX_AGE = config.filesystem.image_cache_max_age
 FLASK_HOST = config.flask.host
 FLASK_PORT = config.flask.port
 FLASK_DEBUG = config.flask.debug
@@ -230,4 +279,5 @@ SHOPIFY_STORE_URL = config.shopify.store_url
 SHOPIFY_ACCESS_TOKEN = config.shopify.access_token
 COMFYUI_API_URL = config.comfyui.api_url
 RUNPOD_API_KEY = config.comfyui.runpod_api_key
+COMFYUI_MAX_BATCH_SIZE = config.comfyui.max_batch_size
 RUNPOD_ENDPOINT_ID = os.getenv("RUNPOD_ENDPOINT_ID")
@@ -0,0 +1,193 @@
+"""
+Image Check
+Header-only validation of PNG, JPEG and WebP files
+
+Reads the signature and the header that carries the dimensions instead
+of decoding (or, like Pillow's verify(), walking) the whole file, so a
+20 MB SDXL output costs a few page reads. Optional CRC checking walks
+the PNG chunk list through an mmap, with zlib's CRC32 run directly on
+each chunk's mapped bytes.
+"""
+import mmap
+import os
+import struct
+import zlib
+from dataclasses import dataclass, asdict
+from functools import lru_cache
+from typing import Any, Dict, Optional
+
+PNG_SIGNATURE = b"\x89PNG\r\n\x1a\n"
+
+# Every complete PNG ends with this empty chunk (catches truncated writes)
+PNG_IEND = b"\x00\x00\x00\x00IEND\xae\x42\x60\x82"
+
+# PNG color type -> (name, allowed bit depths)
+PNG_COLOR_TYPES = {
+    0: ("gray", (1, 2, 4, 8, 16)),
+    2: ("rgb", (8, 16)),
+    3: ("palette", (1, 2, 4, 8)),
+    4: ("gray+alpha", (8, 16)),
+    6: ("rgba", (8, 16)),
+}
+
+JPEG_COLOR_TYPES = {1: "gray", 3: "rgb", 4: "cmyk"}
+
+# JPEG start-of-frame markers (everything C0-CF but DHT, JPG and DAC)
+JPEG_SOF_MARKERS = set(range(0xC0, 0xD0)) - {0xC4, 0xC8, 0xCC}
+
+# Largest side accepted (Printify's own limit is far below this)
+MAX_DIMENSION = 30000
+
+
+@dataclass(frozen=True)
+class ImageInfo:
+    """What the header says about an image"""
+    format: str
+    width: int
+    height: int
+    color_type: str
+    bit_depth: int = 8
+
+    def to_dict(self) -> Dict[str, Any]:
+        return asdict(self)
+
+
+def inspect_image(path: str, verify_crc: bool = False) -> ImageInfo:
+    """
+    Parse an image's header
+
+    Args:
+        path: Image file
+        verify_crc: Also check every PNG chunk's CRC (reads the whole file)
+
+    Returns:
+        Parsed header
+
+    Raises:
+        OSError: If the file can't be read
+        ValueError: If it isn't a well-formed PNG, JPEG or WebP
+    """
+    with open(path, "rb") as f:
+        size = os.fstat(f.fileno()).st_size
+        if size < 16:
+            raise ValueError("File too small to be an image")
+        with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as data:
+            try:
+                if data[:8] == PNG_SIGNATURE:
+                    info = _png(data, verify_crc)
+                elif data[:2] == b"\xff\xd8":
+                    info = _jpeg(data)
+                elif data[:4] == b"RIFF" and data[8:12] == b"WEBP":
+                    info = _webp(data)
+                else:
+                    raise ValueError("Unrecognized image format")
+            except (struct.error, IndexError):
+                raise ValueError("Image header is truncated")
+
+    if not (0 < info.width <= MAX_DIMENSION and 0 < info.height <= MAX_DIMENSION):
+        raise ValueError(f"Invalid dimensions {info.width}x{info.height}")
+    return info
+
+
+@lru_cache(maxsize=65536)
+def inspect_cached(path: str, size: int, mtime_ns: int, verify_crc: bool = False) -> ImageInfo:
+    """inspect_image memoized on (path, size, mtime), so each file is parsed once"""
+    return inspect_image(path, verify_crc)
+
+
+def image_info(path: str, verify_crc: bool = False) -> Optional[Dict[str, Any]]:
+    """Header fields for storing with an image, or None if it doesn't parse"""
+    try:
+        stat = os.stat(path)
+        return inspect_cached(path, stat.st_size, stat.st_mtime_ns, verify_crc).to_dict()
+    except (OSError, ValueError):
+        return None
+
+
+def _png(data: mmap.mmap, verify_crc: bool) -> ImageInfo:
+    length, kind = struct.unpack_from(">I4s", data, 8)
+    if kind != b"IHDR" or length != 13:
+        raise ValueError("PNG is missing its IHDR header")
+    width, height, bit_depth, color_type, compression, filtering, interlace = \
+        struct.unpack_from(">IIBBBBB", data, 16)
+
+    if color_type not in PNG_COLOR_TYPES:
+        raise ValueError(f"Invalid PNG color type {color_type}")
+    name, depths = PNG_COLOR_TYPES[color_type]
+    if bit_depth not in depths:
+        raise ValueError(f"Invalid bit depth {bit_depth} for PNG color type {color_type}")
+    if compression or filtering or interlace > 1:
+        raise ValueError("Unsupported PNG compression, filter or interlace method")
+
+    if verify_crc:
+        _png_chunks(data)
+    elif data[-len(PNG_IEND):] != PNG_IEND:
+        raise ValueError("PNG is truncated (no IEND chunk)")
+    return ImageInfo("PNG", width, height, name, bit_depth)
+
+
+def _png_chunks(data: mmap.mmap) -> None:
+    """Check every chunk's CRC through to IEND"""
+    view = memoryview(data)
+    try:
+        offset = 8
+        while offset + 12 <= len(data):
+            length, kind = struct.unpack_from(">I4s", data, offset)
+            end = offset + 12 + length
+            if end > len(data):
+                raise ValueError(f"PNG truncated in {kind!r} chunk")
+            (crc,) = struct.unpack_from(">I", data, end - 4)
+            if zlib.crc32(view[offset + 4:end - 4]) != crc:
+                raise ValueError(f"PNG CRC mismatch in {kind!r} chunk")
+            if kind == b"IEND":
+                return
+            offset = end
+        raise ValueError("PNG is missing its IEND chunk")
+    finally:
+        view.release()
+
+
+def _jpeg(data: mmap.mmap) -> ImageInfo:
+    """Walk marker segments to the first start-of-frame"""
+    offset = 2
+    while offset + 4 <= len(data):
+        if data[offset] != 0xFF:
+            raise ValueError("Malformed JPEG marker")
+        marker = data[offset + 1]
+        if marker == 0xFF:
+            offset += 1  # Fill byte
+            continue
+        if marker in (0x01, *range(0xD0, 0xD8)):
+            offset += 2  # Standalone markers
+            continue
+        if marker in (0xD9, 0xDA):
+            break  # End of image / start of scan before any frame
+        (length,) = struct.unpack_from(">H", data, offset + 2)
+        if marker in JPEG_SOF_MARKERS:
+            if offset + 10 > len(data):
+                break
+            bit_depth, height, width, components = struct.unpack_from(">BHHB", data, offset + 4)
+            return ImageInfo("JPEG", width, height, JPEG_COLOR_TYPES.get(components, "unknown"), bit_depth)
+        offset += 2 + length
+    raise ValueError("JPEG has no frame header")
+
+
+def _webp(data: mmap.mmap) -> ImageInfo:
+    kind = data[12:16]
+    if kind == b"VP8 ":
+        if data[23:26] != b"\x9d\x01\x2a":
+            raise ValueError("Malformed lossy WebP frame")
+        width, height = struct.unpack_from("<HH", data, 26)
+        return ImageInfo("WEBP", width & 0x3FFF, height & 0x3FFF, "rgb")
+    if kind == b"VP8L":
+        if data[20] != 0x2F:
+            raise ValueError("Malformed lossless WebP frame")
+        (bits,) = struct.unpack_from("<I", data, 21)
+        alpha = (bits >> 28) & 1
+        return ImageInfo("WEBP", (bits & 0x3FFF) + 1, ((bits >> 14) & 0x3FFF) + 1, "rgba" if alpha else "rgb")
+    if kind == b"VP8X":
+        flags = data[20]
+        width = int.from_bytes(data[24:27], "little") + 1
+        height = int.from_bytes(data[27:30], "little") + 1
+        return ImageInfo("WEBP", width, height, "rgba" if flags & 0x10 else "rgb")
+    raise ValueError("Unrecognized WebP chunk")
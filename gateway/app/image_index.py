@@ -0,0 +1,242 @@
+"""
+Image Directory Index
+Incrementally maintained, sorted view of the image directory (inotify with polling fallback)
+"""
+import os
+import ctypes
+import ctypes.util
+import errno
+import logging
+import select
+import struct
+import threading
+from bisect import bisect_left, insort
+from typing import Callable, List, Optional, Set, Tuple
+
+logger = logging.getLogger(__name__)
+
+# inotify event masks (linux/inotify.h)
+IN_CLOSE_WRITE = 0x00000008
+IN_CREATE = 0x00000100
+IN_MOVED_FROM = 0x00000040
+IN_MOVED_TO = 0x00000080
+IN_DELETE = 0x00000200
+IN_DELETE_SELF = 0x00000400
+IN_MOVE_SELF = 0x00000800
+IN_Q_OVERFLOW = 0x00004000
+IN_NONBLOCK = 0o4000
+IN_CLOEXEC = 0o2000000
+
+_EVENT_HEADER = struct.Struct("iIII")
+
+
+class _Inotify:
+    """Minimal inotify binding over libc (Linux only)"""
+
+    MASK = IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF
+
+    def __init__(self, path: str):
+        libc = ctypes.CDLL(ctypes.util.find_library("c") or "libc.so.6", use_errno=True)
+        self.fd = libc.inotify_init1(IN_NONBLOCK | IN_CLOEXEC)
+        if self.fd < 0:
+            raise OSError(ctypes.get_errno(), "inotify_init1 failed")
+        if libc.inotify_add_watch(self.fd, os.fsencode(path), self.MASK) < 0:
+            err = ctypes.get_errno()
+            os.close(self.fd)
+            raise OSError(err, f"inotify_add_watch failed for {path}")
+
+    def read(self, timeout: float) -> List[Tuple[int, str]]:
+        """Wait up to timeout seconds and return (mask, name) events"""
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return []
+        try:
+            data = os.read(self.fd, 64 * 1024)
+        except OSError as e:
+            if e.errno == errno.EAGAIN:
+                return []
+            raise
+
+        events = []
+        offset = 0
+        while offset < len(data):
+            _, mask, _, length = _EVENT_HEADER.unpack_from(data, offset)
+            offset += _EVENT_HEADER.size
+            name = data[offset:offset + length].rstrip(b"\0").decode("utf-8", "replace")
+            offset += length
+            events.append((mask, name))
+        return events
+
+    def close(self) -> None:
+        os.close(self.fd)
+
+
+class ImageIndex:
+    """
+    Sorted index of image IDs in a directory, kept up to date in the background
+
+    Listing a page is O(page) and never touches the disk. A version counter
+    bumps on every change so callers can build cheap ETags.
+    """
+
+    def __init__(
+        self,
+        image_dir: str,
+        suffix: str = ".png",
+        accept: Optional[Callable[[str], bool]] = None,
+        on_add: Optional[Callable[[str, str], None]] = None,
+        poll_interval: float = 2.0
+    ):
+        """
+        Build the index and start watching
+
+        Args:
+            image_dir: Directory to index
+            suffix: File suffix to include
+            accept: Predicate on image IDs (file stems); rejected IDs are skipped
+            on_add: Called with (image_id, path) when an image appears
+            poll_interval: Seconds between rescans when inotify is unavailable
+        """
+        self.image_dir = image_dir
+        self.suffix = suffix
+        self.accept = accept or (lambda image_id: True)
+        self.on_add = on_add
+        self.poll_interval = poll_interval
+        self.lock = threading.Lock()
+        self.version = 0
+        self._names: List[str] = []  # filenames, ascending
+        self._id_set: Set[str] = set()
+        self._rejected: Set[str] = set()
+        self._dir_mtime = None
+        self._stopped = threading.Event()
+
+        self._inotify = None
+        try:
+            self._inotify = _Inotify(image_dir)
+        except (OSError, AttributeError) as e:
+            logger.info(f"inotify unavailable ({e}), polling {image_dir} every {poll_interval}s")
+
+        self.rescan()
+
+        self._thread = threading.Thread(target=self._watch, name="image-index", daemon=True)
+        self._thread.start()
+
+    def __len__(self) -> int:
+        return len(self._names)
+
+    def page(self, cursor: Optional[str] = None, limit: Optional[int] = None) -> Tuple[List[str], Optional[str]]:
+        """
+        Get image IDs newest-first (descending filename order)
+
+        Args:
+            cursor: Return IDs sorting strictly before this one (from next_cursor)
+            limit: Max IDs to return (None = all)
+
+        Returns:
+            Tuple of (image IDs, next cursor or None at the end)
+        """
+        with self.lock:
+            end = bisect_left(self._names, cursor + self.suffix) if cursor else len(self._names)
+            start = 0 if limit is None else max(0, end - limit)
+            names = self._names[start:end]
+        cut = len(self.suffix)
+        ids = [name[:-cut] for name in reversed(names)]
+        next_cursor = ids[-1] if ids and start > 0 else None
+        return ids, next_cursor
+
+    def rescan(self) -> None:
+        """Full directory scan, applying the difference to the index"""
+        try:
+            self._dir_mtime = os.stat(self.image_dir).st_mtime_ns
+            with os.scandir(self.image_dir) as entries:
+                found = {
+                    entry.name[:-len(self.suffix)]
+                    for entry in entries
+                    if entry.name.endswith(self.suffix)
+                }
+        except FileNotFoundError:
+            found = set()
+
+        with self.lock:
+            current = set(self._id_set)
+        for image_id in current - found:
+            self._remove(image_id)
+        for image_id in sorted(found - current):
+            self._add(image_id)
+
+    def stop(self) -> None:
+        """Stop the watcher thread"""
+        self._stopped.set()
+        self._thread.join()
+        if self._inotify:
+            self._inotify.close()
+
+    def _add(self, image_id: str) -> None:
+        if not self.accept(image_id):
+            if image_id not in self._rejected:
+                self._rejected.add(image_id)
+                logger.warning(f"Skipping invalid image ID: {image_id}")
+            return
+        with self.lock:
+            if image_id in self._id_set:
+                return
+            self._id_set.add(image_id)
+            insort(self._names, image_id + self.suffix)
+            self.version += 1
+        if self.on_add:
+            try:
+                self.on_add(image_id, os.path.join(self.image_dir, image_id + self.suffix))
+            except Exception as e:
+                logger.error(f"Failed to register image {image_id}: {e}")
+
+    def _remove(self, image_id: str) -> None:
+        with self.lock:
+            if image_id not in self._id_set:
+                return
+            self._id_set.discard(image_id)
+            del self._names[bisect_left(self._names, image_id + self.suffix)]
+            self.version += 1
+
+    def _watch(self) -> None:
+        """Background loop applying inotify events (or polling)"""
+        while not self._stopped.is_set():
+            try:
+                if self._inotify:
+                    self._apply_events(self._inotify.read(timeout=1.0))
+                else:
+                    self._stopped.wait(self.poll_interval)
+                    # Directory mtime changes on create/delete/rename
+                    try:
+                        mtime = os.stat(self.image_dir).st_mtime_ns
+                    except FileNotFoundError:
+                        mtime = None
+                    if mtime != self._dir_mtime:
+                        self.rescan()
+            except Exception as e:
+                logger.error(f"Image index watcher error: {e}")
+                self._stopped.wait(1.0)
+
+    def _apply_events(self, events: List[Tuple[int, str]]) -> None:
+        for mask, name in events:
+            if mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF):
+                # Lost events or directory replaced: fall back to a full scan
+                self.rescan()
+                if mask & (IN_DELETE_SELF | IN_MOVE_SELF):
+                    logger.warning(f"Image directory {self.image_dir} moved or deleted, polling instead")
+                    self._inotify.close()
+                    self._inotify = None
+                return
+            if not name.endswith(self.suffix):
+                continue
+            image_id = name[:-len(self.suffix)]
+            if mask & (IN_CLOSE_WRITE | IN_MOVED_TO):
+                self._add(image_id)
+            elif mask & IN_CREATE:
+                # Hardlinks only produce IN_CREATE; fresh files wait for IN_CLOSE_WRITE
+                try:
+                    if os.stat(os.path.join(self.image_dir, name)).st_nlink > 1:
+                        self._add(image_id)
+                except FileNotFoundError:
+                    pass
+            elif mask & (IN_DELETE | IN_MOVED_FROM):
+                self._remove(image_id)
@@ -2,17 +2,23 @@
 POD Gateway - Main Flask Application
 Human-in-the-loop approval system for POD designs
 """
-from flask import Flask, render_template, jsonify, request, send_from_directory
+from flask import (
+    Flask, Response, render_template, jsonify, request, send_from_directory, send_file,
+    stream_with_context
+)
 from dotenv import load_dotenv
 import os
+import json
+import atexit
 import logging
 from pathlib import Path
-from PIL import Image
 from typing import Dict, Any, Tuple, List
 import re
 import uuid
 import requests
-import base64
+import binascii
+import hashlib
+from concurrent.futures import ThreadPoolExecutor
 
 # Load environment from project root first (contains API keys)
 project_root = Path(__file__).parent.parent.parent
@@ -25,8 +31,17 @@ load_dotenv(override=False)
 # Import modules
 from app import config
 from app.state import StateManager, ImageStatus, StateManagerError
-from app.printify_client import PrintifyClient, RetryConfig, PrintifyError
-from app.runpod_adapter import create_comfyui_client
+from app.image_index import ImageIndex
+from app.image_check import inspect_cached, image_info
+from app.thumbnails import ThumbnailCache
+from app.catalog_cache import CatalogCache
+from app.printify_client import PrintifyClient, RetryConfig, StageLimits
+from app.publish_queue import PublishQueue
+from app.runpod_adapter import create_comfyui_client, RunPodJobPoller
+from app.tracing import (
+    now_ns, spans_since, chrome_trace, otlp_trace,
+    stage_histograms, stage_report
+)
 
 # Configure logging
 logging.basicConfig(
@@ -39,7 +54,13 @@ logger = logging.getLogger(__name__)
 app = Flask(__name__, template_folder='../templates')
 
 # Initialize services
-state_manager = StateManager(config.STATE_FILE)
+state_manager = StateManager(
+    config.STATE_FILE,
+    fsync_interval=config.STATE_FSYNC_INTERVAL,
+    compact_after=config.STATE_COMPACT_AFTER
+)
+atexit.register(state_manager.close)
+thumbnail_cache = ThumbnailCache(config.THUMBNAIL_DIR, widths=config.THUMBNAIL_WIDTHS)
 
 # Initialize Printify client (optional)
 printify_client = None
@@ -54,7 +75,11 @@ if config.config.printify.is_configured():
         printify_client = PrintifyClient(
             config.PRINTIFY_API_KEY,
             config.PRINTIFY_SHOP_ID,
-            retry_config
+            retry_config,
+            catalog_cache=CatalogCache(
+                config.config.printify.catalog_cache_dir,
+                ttl_seconds=config.config.printify.catalog_cache_ttl_seconds
+            )
         )
         logger.info("✓ Printify client initialized")
     except Exception as e:
@@ -76,6 +101,14 @@ try:
 except Exception as e:
     logger.warning(f"⚠ ComfyUI/RunPod client setup: {e}")
 
+# One background poller tracks every outstanding RunPod job
+runpod_poller = None
+if comfyui_client:
+    runpod_poller = RunPodJobPoller(
+        comfyui_client,
+        on_complete=lambda output: save_runpod_output_images(output)
+    )
+
 
 # Input validation helpers
 def validate_image_id(image_id: str) -> Tuple[bool, str]:
@@ -131,27 +164,30 @@ def validate_image_file(image_path: str) -> Tuple[bool, str]:
     """
     Validate image file exists and is a valid image
 
+    Only the header is parsed (plus chunk CRCs with POD_IMAGE_VERIFY_CRC),
+    and the result is memoized on the file's size and mtime, so a file is
+    read once however often it is served or published.
+
     Args:
         image_path: Path to image file
 
     Returns:
         Tuple of (is_valid, error_message)
     """
-    if not os.path.exists(image_path):
+    try:
+        stat = os.stat(image_path)
+    except OSError:
         return False, "Image file not found"
 
     # Check file size (max 20MB)
-    file_size = os.path.getsize(image_path)
     max_size = 20 * 1024 * 1024  # 20MB
-    if file_size > max_size:
+    if stat.st_size > max_size:
         return False, f"Image file too large (max {max_size / 1024 / 1024}MB)"
 
-    # Verify it's a valid image using Pillow
     try:
-        with Image.open(image_path) as img:
-            img.verify()
+        inspect_cached(image_path, stat.st_size, stat.st_mtime_ns, config.IMAGE_VERIFY_CRC)
         return True, ""
-    except Exception as e:
+    except (OSError, ValueError) as e:
         return False, f"Invalid image file: {str(e)}"
 
 
@@ -172,34 +208,39 @@ def build_prompt_text(prompt: str, style: str = "", genre: str = "") -> str:
     return ", ".join(part for part in parts if part)
 
 
+# SaveImage prefix; prompt-list workflows tag each prompt's outputs with
+# _p<index> so they can be told apart again
+SAVE_PREFIX = "ComfyUI"
+PROMPT_TAG = re.compile(rf"^{SAVE_PREFIX}_p(\d+)_")
+
+# Node IDs of each extra prompt's chain start here (one block of 4 per prompt)
+EXTRA_PROMPT_NODE_BASE = 10
+
+
 def build_comfyui_workflow(
-    prompt: str,
+    prompt: str | List[str],
     seed: int | None = None,
     width: int = 1024,
     height: int = 1024,
     steps: int = 20,
-    cfg_scale: float = 7.0
+    cfg_scale: float = 7.0,
+    batch_size: int = 1
 ) -> Dict[str, Any]:
-    """Build a basic SDXL workflow for ComfyUI."""
+    """
+    Build a basic SDXL workflow for ComfyUI.
+
+    batch_size images are sampled per prompt from one batched latent. A
+    list of prompts shares the checkpoint, negative prompt and latent; each
+    prompt gets its own encode/sample/decode/save chain (seeded seed + i),
+    so the model is loaded once for the whole set.
+    """
     if seed is None:
         seed = int.from_bytes(os.urandom(4), byteorder="little")
+    prompts = [prompt] if isinstance(prompt, str) else list(prompt)
+    if not prompts:
+        raise ValueError("At least one prompt is required")
 
-    return {
-        "3": {
-            "inputs": {
-                "seed": seed,
-                "steps": steps,
-                "cfg": cfg_scale,
-                "sampler_name": "euler",
-                "scheduler": "normal",
-                "denoise": 1,
-                "model": ["4", 0],
-                "positive": ["6", 0],
-                "negative": ["7", 0],
-                "latent_image": ["5", 0]
-            },
-            "class_type": "KSampler"
-        },
+    workflow = {
         "4": {
             "inputs": {
                 "ckpt_name": "flux1-dev-fp8.safetensors"
@@ -210,66 +251,162 @@ def build_comfyui_workflow(
             "inputs": {
                 "width": width,
                 "height": height,
-                "batch_size": 1
+                "batch_size": batch_size
             },
             "class_type": "EmptyLatentImage"
         },
-        "6": {
+        "7": {
             "inputs": {
-                "text": prompt,
+                "text": "text, watermark, low quality, worst quality",
                 "clip": ["4", 1]
             },
             "class_type": "CLIPTextEncode"
-        },
-        "7": {
+        }
+    }
+
+    for i, text in enumerate(prompts):
+        # The first prompt keeps the single-prompt graph's node IDs
+        if i == 0:
+            sampler, encode, decode, save = "3", "6", "8", "9"
+        else:
+            base = EXTRA_PROMPT_NODE_BASE + 4 * (i - 1)
+            sampler, encode, decode, save = (str(base + n) for n in range(4))
+
+        workflow[sampler] = {
             "inputs": {
-                "text": "text, watermark, low quality, worst quality",
+                "seed": seed + i,
+                "steps": steps,
+                "cfg": cfg_scale,
+                "sampler_name": "euler",
+                "scheduler": "normal",
+                "denoise": 1,
+                "model": ["4", 0],
+                "positive": [encode, 0],
+                "negative": ["7", 0],
+                "latent_image": ["5", 0]
+            },
+            "class_type": "KSampler"
+        }
+        workflow[encode] = {
+            "inputs": {
+                "text": text,
                 "clip": ["4", 1]
             },
             "class_type": "CLIPTextEncode"
-        },
-        "8": {
+        }
+        workflow[decode] = {
             "inputs": {
-                "samples": ["3", 0],
+                "samples": [sampler, 0],
                 "vae": ["4", 2]
             },
             "class_type": "VAEDecode"
-        },
-        "9": {
+        }
+        workflow[save] = {
             "inputs": {
-                "filename_prefix": "ComfyUI",
-                "images": ["8", 0]
+                "filename_prefix": SAVE_PREFIX if len(prompts) == 1 else f"{SAVE_PREFIX}_p{i}",
+                "images": [decode, 0]
             },
             "class_type": "SaveImage"
         }
-    }
 
+    return workflow
 
-def download_and_save_image(image_data: str, filename: str | None = None) -> Tuple[str, str] | None:
-    """Download and save an image from base64 data or URL."""
-    if not image_data:
-        return None
 
+def prompt_index(filename: str | None) -> int:
+    """Which prompt of a prompt-list workflow produced an output file"""
+    match = PROMPT_TAG.match(Path(filename or "").name)
+    return int(match.group(1)) if match else 0
+
+
+def demultiplex_outputs(images: List[Dict[str, Any]]) -> List[Dict[str, Any]]:
+    """
+    Tag saved outputs with the prompt and batch slot they came from
+
+    Each image record needs a "filename" (the ComfyUI output name). Batch
+    slots follow ComfyUI's counter order within each prompt's prefix.
+    """
+    slots: Dict[int, int] = {}
+    order = sorted(range(len(images)), key=lambda i: (prompt_index(images[i]["filename"]), images[i]["filename"]))
+    for i in order:
+        index = prompt_index(images[i]["filename"])
+        images[i]["prompt_index"] = index
+        images[i]["batch_index"] = slots.get(index, 0)
+        slots[index] = images[i]["batch_index"] + 1
+    return images
+
+
+# Decode/hash/write pool for multi-image outputs (binascii, hashlib and file
+# writes release or barely hold the GIL, so these overlap)
+output_executor = ThreadPoolExecutor(max_workers=4, thread_name_prefix="output-writer")
+
+
+def content_hash(data: bytes) -> str:
+    """BLAKE2b content hash used to deduplicate identical outputs."""
+    return hashlib.blake2b(data, digest_size=16).hexdigest()
+
+
+def load_image_bytes(image_data: str) -> bytes:
+    """Fetch image bytes from a URL, or decode base64 / a data URI."""
+    if image_data.startswith(("http://", "https://")):
+        logger.info("Downloading image from URL: %s", image_data[:80])
+        response = requests.get(image_data, timeout=60)
+        response.raise_for_status()
+        return response.content
+
+    logger.info("Decoding base64 image data")
+    data_to_decode = image_data.split(",", 1)[1] if "," in image_data else image_data
+    return binascii.a2b_base64(data_to_decode)
+
+
+def store_image_bytes(data: bytes, filename: str | None = None, digest: str | None = None) -> Tuple[str, str]:
+    """
+    Write image bytes to the image dir and register them.
+
+    Bytes identical to an already tracked image become a hardlink to it
+    instead of a second copy on disk.
+
+    Raises:
+        OSError: If the file can't be written
+        StateManagerError: If registration fails
+    """
     image_id = f"generated_{uuid.uuid4().hex[:8]}_0"
     if not filename:
         filename = f"{image_id}.png"
 
     file_path = Path(config.IMAGE_DIR) / filename
+    digest = digest or content_hash(data)
 
-    try:
-        if image_data.startswith(("http://", "https://")):
-            logger.info("Downloading image from URL: %s", image_data[:80])
-            response = requests.get(image_data, timeout=60)
-            response.raise_for_status()
-            file_path.write_bytes(response.content)
-        else:
-            logger.info("Decoding base64 image data")
-            data_to_decode = image_data.split(",", 1)[1] if "," in image_data else image_data
-            file_path.write_bytes(base64.b64decode(data_to_decode))
+    linked = False
+    existing = state_manager.find_by_hash(digest)
+    if existing and existing.get("path"):
+        try:
+            os.link(existing["path"], file_path)
+            linked = True
+            logger.info(f"Duplicate output of {existing['id']}, hardlinked as {filename}")
+        except OSError as exc:
+            logger.debug("Hardlink to %s failed, writing a copy: %s", existing["path"], exc)
+
+    if not linked:
+        file_path.write_bytes(data)
+
+    state_manager.add_image(
+        image_id, filename, str(file_path), content_hash=digest,
+        info=image_info(str(file_path), config.IMAGE_VERIFY_CRC)
+    )
+    if not linked:
+        # Thumbnails are content-addressed, so a hardlinked duplicate already has them
+        thumbnail_cache.prewarm(str(file_path))
+    return image_id, str(file_path)
 
-        state_manager.add_image(image_id, filename, str(file_path))
-        return image_id, str(file_path)
-    except (requests.RequestException, ValueError, base64.binascii.Error) as exc:
+
+def download_and_save_image(image_data: str, filename: str | None = None) -> Tuple[str, str] | None:
+    """Download and save an image from base64 data or URL."""
+    if not image_data:
+        return None
+
+    try:
+        return store_image_bytes(load_image_bytes(image_data), filename)
+    except (requests.RequestException, ValueError, binascii.Error, OSError) as exc:
         logger.error("Failed to save image data: %s", exc)
         return None
     except StateManagerError as exc:
@@ -301,13 +438,18 @@ def extract_image_payloads(output: Any) -> List[Dict[str, Any]]:
     return payloads
 
 
-def save_runpod_output_images(output: Dict[str, Any]) -> List[Dict[str, str]]:
-    """Save any images found in a RunPod output payload."""
-    saved_images: List[Dict[str, str]] = []
+def save_runpod_output_images(output: Dict[str, Any]) -> List[Dict[str, Any]]:
+    """
+    Save any images found in a RunPod output payload (decoded and written in parallel).
+
+    Returns one record per image, tagged with its prompt and batch slot.
+    """
     logger.info(f"Processing RunPod output keys: {list(output.keys()) if isinstance(output, dict) else type(output)}")
     payloads = extract_image_payloads(output)
     logger.info(f"Found {len(payloads)} image payloads to process")
 
+    data_items: List[Tuple[int, str]] = []
+    file_items: List[Tuple[int, Dict[str, Any]]] = []
     for i, payload in enumerate(payloads):
         logger.debug(f"Payload {i}: {list(payload.keys())}")
         image_data = (
@@ -317,24 +459,60 @@ def save_runpod_output_images(output: Dict[str, Any]) -> List[Dict[str, str]]:
             or payload.get("base64")
         )
         if image_data:
-            logger.info(f"Found image data (type: {'url' if image_data.startswith('http') else 'base64'}, len: {len(image_data)})")
-            saved = download_and_save_image(image_data)
-            if saved:
-                image_id, file_path = saved
-                logger.info(f"✓ Saved image: {image_id} -> {file_path}")
-                saved_images.append({"id": image_id, "path": file_path})
+            data_items.append((i, image_data))
+        elif payload.get("filename"):
+            file_items.append((i, payload))
+
+    def fetch(image_data: str) -> Tuple[bytes, str] | None:
+        try:
+            data = load_image_bytes(image_data)
+            return data, content_hash(data)
+        except (requests.RequestException, ValueError, binascii.Error) as exc:
+            logger.error("Failed to load image data: %s", exc)
+            return None
+
+    def store(entry: Tuple[int, Tuple[bytes, str]]) -> Tuple[int, Tuple[str, str] | None]:
+        i, (data, digest) = entry
+        try:
+            return i, store_image_bytes(data, digest=digest)
+        except (OSError, StateManagerError) as exc:
+            logger.error("Failed to save image data: %s", exc)
+            return i, None
+
+    loaded = output_executor.map(fetch, [image_data for _, image_data in data_items])
+
+    # First copy of each distinct output is written in parallel; repeats
+    # within the batch run afterwards so they find it and hardlink
+    first, repeats = [], []
+    seen = set()
+    for (i, _), item in zip(data_items, loaded):
+        if item is None:
             continue
+        (repeats if item[1] in seen else first).append((i, item))
+        seen.add(item[1])
+
+    saved: Dict[int, Dict[str, Any]] = {}
+    for batch in (first, repeats):
+        for i, result in output_executor.map(store, batch):
+            if result:
+                image_id, file_path = result
+                logger.info(f"✓ Saved image: {image_id} -> {file_path}")
+                saved[i] = {"id": image_id, "path": file_path, "filename": payloads[i].get("filename") or ""}
 
-        if payload.get("filename"):
-            local_path = download_comfyui_image(payload)
-            if local_path:
-                image_id = Path(local_path).stem
-                try:
-                    state_manager.add_image(image_id, Path(local_path).name, local_path)
-                except StateManagerError:
-                    pass
-                saved_images.append({"id": image_id, "path": local_path})
+    local_paths = output_executor.map(download_comfyui_image, [payload for _, payload in file_items])
+    for (i, _), local_path in zip(file_items, local_paths):
+        if local_path:
+            image_id = Path(local_path).stem
+            try:
+                state_manager.add_image(
+                    image_id, Path(local_path).name, local_path,
+                    info=image_info(local_path, config.IMAGE_VERIFY_CRC)
+                )
+            except StateManagerError:
+                pass
+            saved[i] = {"id": image_id, "path": local_path, "filename": payloads[i]["filename"]}
 
+    saved_images = demultiplex_outputs([saved[i] for i in sorted(saved)])
     logger.info(f"Total images saved: {len(saved_images)}")
     return saved_images
 
@@ -384,26 +562,56 @@ def download_comfyui_image(image_meta: Dict[str, Any]) -> str | None:
         return None
 
 
-def sync_comfyui_outputs(history: Dict[str, Any], prompt_id: str) -> List[str]:
-    """Download ComfyUI outputs for a completed prompt."""
-    downloaded: List[str] = []
+def sync_comfyui_outputs(history: Dict[str, Any], prompt_id: str) -> List[Dict[str, Any]]:
+    """
+    Download ComfyUI outputs for a completed prompt.
+
+    Returns one record per image (id, path, prompt_index, batch_index), so
+    batched and prompt-list workflows map back to the image each slot made.
+    """
     prompt_entry = history.get(prompt_id, {})
     outputs = prompt_entry.get("outputs", {})
-
-    for node_id in outputs:
-        images = outputs[node_id].get("images", [])
-        for image_meta in images:
-            local_path = download_comfyui_image(image_meta)
-            if not local_path:
-                continue
-            image_id = Path(local_path).stem
-            try:
-                state_manager.add_image(image_id, Path(local_path).name, local_path)
-            except StateManagerError:
-                pass
-            downloaded.append(local_path)
-
-    return downloaded
+    image_metas = [
+        image_meta
+        for node_id in outputs
+        for image_meta in outputs[node_id].get("images", [])
+    ]
+
+    downloaded: List[Dict[str, Any]] = []
+    local_paths = output_executor.map(download_comfyui_image, image_metas)
+    for image_meta, local_path in zip(image_metas, local_paths):
+        if not local_path:
+            continue
+        image_id = Path(local_path).stem
+        thumbnail_cache.prewarm(local_path)
+        try:
+            state_manager.add_image(
+                image_id, Path(local_path).name, local_path,
+                info=image_info(local_path, config.IMAGE_VERIFY_CRC)
+            )
+        except StateManagerError:
+            pass
+        downloaded.append({"id": image_id, "path": local_path, "filename": image_meta["filename"]})
+
+    return demultiplex_outputs(downloaded)
+
+
+# Publishing runs in the background; request threads only queue jobs
+PUBLISH_EVENTS_HEARTBEAT = 15.0
+publish_queue = None
+if printify_client:
+    publish_queue = PublishQueue(
+        printify_client,
+        state_manager,
+        image_path=lambda image_id: os.path.join(config.IMAGE_DIR, f"{image_id}.png"),
+        validate_image=validate_image_file,
+        limits=StageLimits(
+            upload=config.config.printify.upload_concurrency,
+            create=config.config.printify.create_concurrency,
+            publish=config.config.printify.publish_concurrency
+        )
+    )
+    publish_queue.start()
 
 
 @app.route('/')
@@ -412,62 +620,86 @@ def index():
     return render_template('gallery.html')
 
 
+def register_image(image_id: str, path: str) -> None:
+    """Add a newly discovered image file to state (no-op if already tracked)"""
+    if state_manager.get_image_metadata(image_id) is None:
+        # Checked again under the state lock: an upload may register it meanwhile
+        state_manager.add_image_if_absent(
+            image_id, Path(path).name, path, info=image_info(path, config.IMAGE_VERIFY_CRC)
+        )
+
+
+# Directory index for the gallery, kept current by a watcher thread
+image_index = ImageIndex(
+    config.IMAGE_DIR,
+    accept=lambda image_id: validate_image_id(image_id)[0],
+    on_add=register_image,
+    poll_interval=config.IMAGE_POLL_INTERVAL
+)
+
+
 @app.route('/api/images')
 def list_images():
     """
-    List all images with their status
+    List images with their status, newest first
+
+    Query params:
+        cursor: Continue after this image ID (next_cursor of the previous page)
+        limit: Max images per page (default: all)
+
+    Supports If-None-Match: unchanged listings return 304.
 
     Returns:
         JSON with list of images
     """
     try:
-        image_dir = Path(config.IMAGE_DIR)
-
-        if not image_dir.exists():
-            logger.warning(f"Image directory does not exist: {image_dir}")
-            return jsonify({"images": []})
-
-        images = []
-        state = state_manager.get_all_images()
-
-        # Scan directory for images
-        for img_file in image_dir.glob("*.png"):
-            img_id = img_file.stem
+        cursor = request.args.get("cursor") or None
+        limit = request.args.get("limit", type=int)
 
-            # Validate image ID format
-            is_valid, error = validate_image_id(img_id)
+        if limit is not None and limit <= 0:
+            return jsonify({"error": "limit must be positive"}), 400
+        if cursor:
+            is_valid, error = validate_image_id(cursor)
             if not is_valid:
-                logger.warning(f"Skipping invalid image ID: {img_id}")
-                continue
+                return jsonify({"error": error}), 400
 
-            # Get status from state
-            img_state = state.get(img_id, {})
-            status = img_state.get("status", ImageStatus.PENDING.value)
+        # Versions are read before the data, so a racing change can only
+        # make the ETag stale (one extra full response), never wrong
+        etag = f"{image_index.version}-{state_manager.version}-{cursor or ''}-{limit or ''}"
+        if etag in request.if_none_match:
+            response = app.response_class(status=304)
+            response.set_etag(etag)
+            return response
 
-            # Register if new
-            if img_id not in state:
-                try:
-                    state_manager.add_image(img_id, img_file.name, str(img_file))
-                except StateManagerError as e:
-                    logger.error(f"Failed to add image {img_id}: {e}")
-                    continue
+        ids, next_cursor = image_index.page(cursor, limit)
+        state = state_manager.get_images(ids)
 
+        images = []
+        for img_id in ids:
+            img_state = state.get(img_id, {})
             images.append({
                 "id": img_id,
-                "filename": img_file.name,
-                "status": status,
+                "filename": f"{img_id}.png",
+                "status": img_state.get("status", ImageStatus.PENDING.value),
                 "path": f"/api/image/{img_id}",
                 "created_at": img_state.get("created_at"),
                 "updated_at": img_state.get("updated_at"),
                 "error_message": img_state.get("error_message"),
+                "publish_stage": img_state.get("publish_stage"),
+                "width": (img_state.get("info") or {}).get("width"),
+                "height": (img_state.get("info") or {}).get("height"),
                 "product_id": img_state.get("product_id"),
                 "title": img_state.get("title")
             })
 
-        # Sort by filename (newest first)
-        images.sort(key=lambda x: x['filename'], reverse=True)
-
-        return jsonify({"images": images, "count": len(images)})
+        response = jsonify({
+            "images": images,
+            "count": len(images),
+            "total": len(image_index),
+            "next_cursor": next_cursor
+        })
+        response.set_etag(etag)
+        return response
 
     except Exception as e:
         logger.error(f"Error listing images: {e}", exc_info=True)
@@ -482,20 +714,39 @@ def generate_image():
     Expected JSON body:
     {
         "prompt": "Base prompt text",
+        "prompts": ["Optional list of prompts", "sharing sampler settings"],
+        "batch_size": 1,
         "style": "Optional style",
         "genre": "Optional genre"
     }
+
+    One workflow renders batch_size images per prompt, up to
+    COMFYUI_MAX_BATCH_SIZE images in all. Outputs are reported per image
+    with the prompt_index and batch_index that produced them.
     """
     data = request.get_json(silent=True) or {}
-    prompt = (data.get("prompt") or "").strip()
+    prompts = data.get("prompts") or [data.get("prompt") or ""]
     style = (data.get("style") or "").strip()
     genre = (data.get("genre") or "").strip()
 
-    if not prompt:
+    if not isinstance(prompts, list) or not all(isinstance(p, str) and p.strip() for p in prompts):
         return jsonify({"error": "Prompt is required"}), 400
 
-    full_prompt = build_prompt_text(prompt, style, genre)
-    logger.info(f"Using {'RunPod Serverless' if comfyui_client else 'direct ComfyUI'} for generation: {prompt[:50]}...")
+    try:
+        batch_size = int(data.get("batch_size", 1))
+    except (TypeError, ValueError):
+        return jsonify({"error": "batch_size must be an integer"}), 400
+    if batch_size < 1 or batch_size * len(prompts) > config.COMFYUI_MAX_BATCH_SIZE:
+        return jsonify({
+            "error": f"batch_size x prompts must be between 1 and {config.COMFYUI_MAX_BATCH_SIZE}"
+        }), 400
+
+    full_prompts = [build_prompt_text(p, style, genre) for p in prompts]
+    full_prompt = full_prompts[0] if len(full_prompts) == 1 else full_prompts
+    logger.info(
+        f"Using {'RunPod Serverless' if comfyui_client else 'direct ComfyUI'} for generation "
+        f"({len(prompts)} prompt(s) x {batch_size}): {prompts[0][:50]}..."
+    )
 
     workflow = build_comfyui_workflow(
         full_prompt,
@@ -503,7 +754,8 @@ def generate_image():
         width=data.get("width", 1024),
         height=data.get("height", 1024),
         steps=data.get("steps", 20),
-        cfg_scale=data.get("cfg_scale", 7)
+        cfg_scale=data.get("cfg_scale", 7),
+        batch_size=batch_size
     )
 
     client_id = data.get("client_id") or f"pod-gateway-{uuid.uuid4().hex[:8]}"
@@ -511,19 +763,15 @@ def generate_image():
     try:
         # Use RunPod serverless client if available, otherwise direct ComfyUI
         if comfyui_client:
-            # RunPod serverless
-            result = comfyui_client.submit_workflow(workflow, client_id, timeout=120)
-            saved_images: List[Dict[str, str]] = []
-            if result.get("status") == "COMPLETED":
-                output = result.get("output", {})
-                saved_images = save_runpod_output_images(output)
+            # RunPod serverless: queue and return; the poller saves outputs
+            job_id = runpod_poller.submit(workflow, client_id)
 
             return jsonify({
-                "prompt_id": result.get("prompt_id"),
-                "job_id": result.get("job_id"),
-                "status": result.get("status"),
+                "prompt_id": job_id,
+                "job_id": job_id,
+                "status": "IN_QUEUE",
                 "prompt": full_prompt,
-                "images": saved_images,
+                "images": [],
                 "source": "runpod"
             })
         else:
@@ -559,11 +807,15 @@ def generate_image():
 
 @app.route('/api/generation_status')
 def generation_status():
-    """Proxy generation status from ComfyUI history endpoint."""
+    """Proxy generation status from ComfyUI history endpoint (RunPod jobs are answered from memory)."""
     prompt_id = request.args.get("prompt_id")
     if not prompt_id:
         return jsonify({"error": "prompt_id is required"}), 400
 
+    job = runpod_poller.get(prompt_id) if runpod_poller else None
+    if job:
+        return jsonify({**job, "source": "runpod"})
+
     try:
         response = requests.get(
             f"{config.COMFYUI_API_URL}/history/{prompt_id}",
@@ -592,37 +844,29 @@ def generation_status():
 
 @app.route('/api/runpod_status')
 def runpod_status():
-    """Check status for RunPod serverless jobs and download outputs when complete."""
+    """Report RunPod job status from the background poller (outputs are saved when complete)."""
     job_id = request.args.get("job_id")
     if not job_id:
         return jsonify({"error": "job_id is required"}), 400
 
-    if not comfyui_client:
+    if not runpod_poller:
         return jsonify({"error": "RunPod client not configured"}), 400
 
-    try:
-        result = comfyui_client.get_job_status(job_id)
-        status = result.get("status")
-        saved_images: List[Dict[str, str]] = []
-
-        if status == "COMPLETED":
-            output = result.get("output", {})
-            saved_images = save_runpod_output_images(output)
-
-        if status == "FAILED":
-            return jsonify({
-                "status": status,
-                "error": result.get("error", "RunPod job failed")
-            }), 500
+    job = runpod_poller.get(job_id)
+    if job is None:
+        # Submitted before a restart (or elsewhere): start tracking it, within limits
+        tracked = runpod_poller.track(job_id, adopted=True)
+        if tracked is None:
+            return jsonify({"error": "Too many untracked RunPod jobs being polled; retry later"}), 429
+        job = tracked.to_dict()
 
+    if job["status"] == "FAILED":
         return jsonify({
-            "status": status,
-            "job_id": job_id,
-            "images": saved_images
-        })
-    except Exception as exc:
-        logger.error("RunPod status check failed: %s", exc)
-        return jsonify({"error": "Failed to check RunPod job"}), 502
+            "status": job["status"],
+            "error": job.get("error", "RunPod job failed")
+        }), 500
+
+    return jsonify(job)
 
 
 @app.route('/api/image/<image_id>')
@@ -630,6 +874,10 @@ def serve_image(image_id):
     """
     Serve individual image
 
+    Query params:
+        w: Optional width; serves a cached downscaled WebP derivative
+           (snapped up to a configured thumbnail width)
+
     Args:
         image_id: Image identifier
 
@@ -648,7 +896,25 @@ def serve_image(image_id):
     if not is_valid:
         return jsonify({"error": error}), 404
 
-    return send_from_directory(config.IMAGE_DIR, f"{image_id}.png")
+    width = request.args.get("w", type=int)
+    if width and width > 0:
+        width = thumbnail_cache.snap_width(width)
+        if width:
+            try:
+                thumb_path, etag = thumbnail_cache.get(image_path, width)
+                return send_file(
+                    thumb_path,
+                    mimetype="image/webp",
+                    etag=etag,
+                    max_age=config.IMAGE_CACHE_MAX_AGE,
+                    conditional=True
+                )
+            except (OSError, ValueError) as e:
+                logger.warning(f"Thumbnail failed for {image_id}, serving original: {e}")
+
+    return send_from_directory(
+        config.IMAGE_DIR, f"{image_id}.png", max_age=config.IMAGE_CACHE_MAX_AGE
+    )
 
 
 @app.route('/api/approve/<image_id>', methods=['POST'])
@@ -701,127 +967,195 @@ def reject_image(image_id):
         return jsonify({"success": False, "error": "Failed to update status"}), 500
 
 
+def publish_options(image_id: str, data: Dict[str, Any]) -> Tuple[Dict[str, Any], str]:
+    """
+    Validated publish options for one image, with config defaults
+
+    Args:
+        image_id: Image identifier (for the default title)
+        data: Request fields (title, description, price_cents, blueprint_id, provider_id)
+
+    Returns:
+        Tuple of (options, error_message)
+    """
+    title = data.get("title") or f"Design {image_id[:8]}"
+    is_valid, error = validate_title(title)
+    if not is_valid:
+        return {}, error
+
+    price_cents = data.get("price_cents", config.config.printify.default_price_cents)
+    blueprint_id = data.get("blueprint_id", config.PRINTIFY_BLUEPRINT_ID)
+    provider_id = data.get("provider_id", config.PRINTIFY_PROVIDER_ID)
+    if not isinstance(price_cents, int) or price_cents < 0:
+        return {}, "Invalid price"
+    if not isinstance(blueprint_id, int) or blueprint_id <= 0:
+        return {}, "Invalid blueprint ID"
+    if not isinstance(provider_id, int) or provider_id <= 0:
+        return {}, "Invalid provider ID"
+
+    return {
+        "title": title,
+        "description": data.get("description"),
+        "price_cents": price_cents,
+        "blueprint_id": blueprint_id,
+        "provider_id": provider_id
+    }, ""
+
+
+def queue_publish(image_id: str, data: Dict[str, Any]) -> Tuple[Dict[str, Any], int]:
+    """
+    Check an image can be published and queue it
+
+    Only cheap checks run here; the worker validates the file contents
+    before uploading.
+
+    Returns:
+        Tuple of (response body, HTTP status)
+    """
+    is_valid, error = validate_image_id(image_id)
+    if not is_valid:
+        return {"success": False, "error": error}, 400
+
+    # Check if approved (publishing images are already queued)
+    status = state_manager.get_image_status(image_id)
+    if status not in [ImageStatus.APPROVED.value, ImageStatus.FAILED.value]:
+        return {
+            "success": False,
+            "error": f"Image must be approved first (current status: {status})"
+        }, 400
+
+    if not os.path.isfile(os.path.join(config.IMAGE_DIR, f"{image_id}.png")):
+        return {"success": False, "error": "Image file not found"}, 404
+
+    options, error = publish_options(image_id, data)
+    if error:
+        return {"success": False, "error": error}, 400
+
+    try:
+        job = publish_queue.submit(image_id, options)
+    except StateManagerError as e:
+        logger.error(f"Failed to queue publish for {image_id}: {e}")
+        return {"success": False, "error": "Failed to update status"}, 500
+
+    return {"success": True, **job}, 202
+
+
 @app.route('/api/publish/<image_id>', methods=['POST'])
 def publish_image(image_id):
     """
-    Publish approved image to Printify
+    Queue an approved image for publishing to Printify
+
+    Returns as soon as the job is recorded; progress is reported through
+    the image's status and /api/publish/events.
 
     Args:
         image_id: Image identifier
 
     Returns:
-        JSON response with product ID or error
+        202 with the queued job, or an error
     """
     # Validate Printify is configured
-    if not printify_client:
+    if not publish_queue:
         return jsonify({
             "success": False,
             "error": "Printify not configured"
         }), 400
 
-    # Validate image ID
-    is_valid, error = validate_image_id(image_id)
-    if not is_valid:
-        return jsonify({"success": False, "error": error}), 400
+    body, status = queue_publish(image_id, request.get_json(silent=True) or {})
+    return jsonify(body), status
 
-    # Check if approved
-    status = state_manager.get_image_status(image_id)
-    if status not in [ImageStatus.APPROVED.value, ImageStatus.FAILED.value]:
+
+@app.route('/api/publish/bulk', methods=['POST'])
+def publish_bulk():
+    """
+    Queue several images for publishing
+
+    Body:
+        image_ids: Images to publish (default: every approved image)
+        titles: Optional {image_id: title}
+        description, price_cents, blueprint_id, provider_id: Shared options
+
+    Returns:
+        202 with the queued jobs and the images that were skipped, or 400
+        (with the skipped images) if none could be queued
+    """
+    if not publish_queue:
         return jsonify({
             "success": False,
-            "error": f"Image must be approved first (current status: {status})"
+            "error": "Printify not configured"
         }), 400
 
-    # Get image path
-    image_path = os.path.join(config.IMAGE_DIR, f"{image_id}.png")
+    request_data = request.get_json(silent=True) or {}
+    image_ids = request_data.get("image_ids")
+    if image_ids is None:
+        image_ids = state_manager.get_images_by_status(ImageStatus.APPROVED.value)
+    if not isinstance(image_ids, list):
+        return jsonify({"success": False, "error": "image_ids must be a list"}), 400
+    titles = request_data.get("titles") or {}
+
+    queued, skipped = [], []
+    for image_id in image_ids:
+        data = {**request_data, "title": titles.get(image_id) if isinstance(titles, dict) else None}
+        body, status = queue_publish(str(image_id), data)
+        if status == 202:
+            queued.append(body)
+        else:
+            skipped.append({"image_id": image_id, "error": body["error"]})
 
-    # Validate image file
-    is_valid, error = validate_image_file(image_path)
-    if not is_valid:
-        return jsonify({"success": False, "error": error}), 404
+    if skipped and not queued:
+        return jsonify({
+            "success": False,
+            "error": "None of the images could be queued",
+            "queued": queued,
+            "skipped": skipped
+        }), 400
 
-    # Get and validate title from request
-    try:
-        request_data = request.get_json() or {}
-    except Exception as e:
-        return jsonify({"success": False, "error": "Invalid JSON"}), 400
+    return jsonify({
+        "success": True,
+        "queued": queued,
+        "skipped": skipped
+    }), 202
 
-    title = request_data.get("title", f"Design {image_id[:8]}")
-    is_valid, error = validate_title(title)
-    if not is_valid:
-        return jsonify({"success": False, "error": error}), 400
 
-    # Update status to publishing
-    try:
-        state_manager.set_image_status(image_id, ImageStatus.PUBLISHING.value)
-    except StateManagerError as e:
-        logger.error(f"Failed to update status to publishing: {e}")
-        return jsonify({"success": False, "error": "Failed to update status"}), 500
+@app.route('/api/publish/queue')
+def publish_queue_status():
+    """Publish queue depth and running jobs per stage"""
+    if not publish_queue:
+        return jsonify({"error": "Printify not configured"}), 400
+    return jsonify(publish_queue.stats())
 
-    # Publish to Printify
-    try:
-        description = request_data.get("description")
-        price_cents = request_data.get("price_cents", config.config.printify.default_price_cents)
-        blueprint_id = request_data.get("blueprint_id", config.PRINTIFY_BLUEPRINT_ID)
-        provider_id = request_data.get("provider_id", config.PRINTIFY_PROVIDER_ID)
-
-        # Validate price
-        if not isinstance(price_cents, int) or price_cents < 0:
-            return jsonify({"success": False, "error": "Invalid price"}), 400
-        if not isinstance(blueprint_id, int) or blueprint_id <= 0:
-            return jsonify({"success": False, "error": "Invalid blueprint ID"}), 400
-        if not isinstance(provider_id, int) or provider_id <= 0:
-            return jsonify({"success": False, "error": "Invalid provider ID"}), 400
-
-        product_id = printify_client.create_and_publish(
-            image_path=image_path,
-            title=title,
-            blueprint_id=blueprint_id,
-            provider_id=provider_id,
-            price_cents=price_cents,
-            description=description
-        )
 
-        if product_id:
-            state_manager.set_image_status(image_id, ImageStatus.PUBLISHED.value, {
-                "product_id": product_id,
-                "title": title
-            })
-            logger.info(f"Image published successfully: {image_id} -> Product {product_id}")
-            return jsonify({
-                "success": True,
-                "product_id": product_id,
-                "status": ImageStatus.PUBLISHED.value
-            })
-        else:
-            error_msg = "Printify API failed to create product"
-            state_manager.set_image_status(image_id, ImageStatus.FAILED.value, {
-                "error_message": error_msg
-            })
-            logger.error(f"Failed to publish image {image_id}: {error_msg}")
-            return jsonify({"success": False, "error": error_msg}), 500
-
-    except PrintifyError as e:
-        error_msg = f"Printify error: {str(e)}"
-        logger.error(f"Printify error for image {image_id}: {e}", exc_info=True)
-        try:
-            state_manager.set_image_status(image_id, ImageStatus.FAILED.value, {
-                "error_message": error_msg
-            })
-        except StateManagerError:
-            pass
-        return jsonify({"success": False, "error": error_msg}), 500
+@app.route('/api/publish/events')
+def publish_events():
+    """
+    Publish progress as server-sent events
 
-    except Exception as e:
-        error_msg = f"Unexpected error: {str(e)}"
-        logger.error(f"Unexpected error publishing image {image_id}: {e}", exc_info=True)
-        try:
-            state_manager.set_image_status(image_id, ImageStatus.FAILED.value, {
-                "error_message": error_msg
-            })
-        except StateManagerError:
-            pass
-        return jsonify({"success": False, "error": "Internal server error"}), 500
+    Each event is one status/stage change of an image. Reconnecting
+    clients resume from Last-Event-ID (or ?since=<seq>); a comment line
+    is sent every PUBLISH_EVENTS_HEARTBEAT seconds to keep the stream open.
+    """
+    if not publish_queue:
+        return jsonify({"error": "Printify not configured"}), 400
+
+    since = request.headers.get("Last-Event-ID", type=int)
+    if since is None:
+        since = request.args.get("since", type=int)
+    if since is None:
+        since = publish_queue.stats()["last_event"]
+
+    def stream(seq: int):
+        while True:
+            events, seq = publish_queue.events_since(seq, timeout=PUBLISH_EVENTS_HEARTBEAT)
+            if not events:
+                yield ": keep-alive\n\n"
+            for event in events:
+                yield f"id: {event['seq']}\ndata: {json.dumps(event)}\n\n"
+
+    return Response(
+        stream_with_context(stream(since)),
+        mimetype="text/event-stream",
+        headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"}
+    )
 
 
 @app.route('/api/reset/<image_id>', methods=['POST'])
@@ -865,6 +1199,29 @@ def get_stats():
         return jsonify({"error": "Internal server error"}), 500
 
 
+@app.route('/api/trace')
+def get_trace():
+    """
+    Recent spans from this process
+
+    Query params:
+        seconds: How far back to look (default 300)
+        format: chrome (default) or otlp
+
+    Returns:
+        Chrome trace or OTLP/JSON document
+    """
+    try:
+        seconds = float(request.args.get("seconds", 300))
+    except ValueError:
+        return jsonify({"error": "Invalid seconds"}), 400
+
+    spans = spans_since(now_ns() - int(seconds * 1e9))
+    if request.args.get("format") == "otlp":
+        return jsonify(otlp_trace(spans))
+    return jsonify(chrome_trace(spans))
+
+
 @app.route('/api/debug/config')
 def debug_config():
     """
@@ -930,7 +1287,8 @@ def health():
         "status": "healthy",
         "printify": printify_client is not None,
         "image_dir": os.path.exists(config.IMAGE_DIR),
-        "state_file": os.path.exists(config.STATE_FILE)
+        "state_file": os.path.exists(config.STATE_FILE),
+        "stages": stage_report(stage_histograms())
     }
 
     # Return 503 if critical components are missing
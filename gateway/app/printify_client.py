@@ -5,15 +5,27 @@ Handles product creation and publishing with dynamic variant fetching and retry
 import requests
 from requests.adapters import HTTPAdapter
 from urllib3.util.retry import Retry
+import os
 import time
 import logging
-from typing import Dict, List, Optional, Tuple
+import threading
+from contextlib import nullcontext
+from concurrent.futures import ThreadPoolExecutor
+from typing import Any, Callable, Dict, List, Optional, Tuple
 from dataclasses import dataclass
 from enum import Enum
 
+from app.catalog_cache import CatalogCache
+from app.tracing import span, bind
+
 logger = logging.getLogger(__name__)
 
-PRINTIFY_API = "https://api.printify.com/v1"
+PRINTIFY_API = os.getenv("PRINTIFY_API_URL", "https://api.printify.com/v1")
+
+# Documented Printify rate limits: (requests, window seconds)
+GLOBAL_RATE_LIMIT = (600, 60)
+CATALOG_RATE_LIMIT = (100, 60)
+PUBLISH_RATE_LIMIT = (200, 30 * 60)
 
 
 class PrintifyError(Exception):
@@ -44,6 +56,71 @@ class Variant:
     is_available: bool
 
 
+class TokenBucket:
+    """
+    Thread-safe token bucket
+
+    Holds up to `capacity` tokens, refilled continuously at `rate` per
+    second. acquire() blocks until a token is available, so callers are
+    paced proactively instead of discovering the limit through 429s.
+    """
+
+    def __init__(self, capacity: float, rate: float):
+        self.capacity = capacity
+        self.rate = rate
+        self.tokens = capacity
+        self.updated = time.monotonic()
+        self.lock = threading.Lock()
+
+    @classmethod
+    def for_limit(cls, limit: Tuple[int, float]) -> "TokenBucket":
+        """Bucket allowing `requests` per `window` seconds"""
+        requests_allowed, window = limit
+        return cls(requests_allowed, requests_allowed / window)
+
+    def acquire(self, tokens: float = 1.0) -> None:
+        """Take tokens, sleeping until they are available"""
+        while True:
+            with self.lock:
+                now = time.monotonic()
+                self.tokens = min(self.capacity, self.tokens + (now - self.updated) * self.rate)
+                self.updated = now
+                if self.tokens >= tokens:
+                    self.tokens -= tokens
+                    return
+                wait = (tokens - self.tokens) / self.rate
+            time.sleep(wait)
+
+    def drain(self) -> None:
+        """Empty the bucket (server said we're over the limit)"""
+        with self.lock:
+            self.tokens = 0
+            self.updated = time.monotonic()
+
+
+@dataclass
+class StageLimits:
+    """Per-stage concurrency caps for create_and_publish_many"""
+    upload: int = 4
+    create: int = 2
+    publish: int = 2
+
+
+class StageGates:
+    """Per-stage semaphores shared by every item of a pipelined publish"""
+
+    def __init__(self, limits: Optional[StageLimits] = None):
+        self.limits = limits or StageLimits()
+        self.upload = threading.BoundedSemaphore(self.limits.upload)
+        self.create = threading.BoundedSemaphore(self.limits.create)
+        self.publish = threading.BoundedSemaphore(self.limits.publish)
+
+    @property
+    def workers(self) -> int:
+        """Threads that keep every stage busy"""
+        return self.limits.upload + self.limits.create + self.limits.publish
+
+
 @dataclass
 class RetryConfig:
     """Configuration for retry logic"""
@@ -58,6 +135,9 @@ class PrintifyClient:
     Enhanced Printify API client with:
     - Dynamic variant fetching
     - Exponential backoff retry logic
+    - Proactive token-bucket rate limiting (global, catalog, publish)
+    - Shared keep-alive connection pool (thread-safe)
+    - Pipelined bulk publishing
     - Comprehensive error handling
     - Type safety
     """
@@ -66,7 +146,9 @@ class PrintifyClient:
         self,
         api_key: str,
         shop_id: str,
-        retry_config: Optional[RetryConfig] = None
+        retry_config: Optional[RetryConfig] = None,
+        pool_size: int = 10,
+        catalog_cache: Optional[CatalogCache] = None
     ):
         if not api_key or not shop_id:
             raise PrintifyAuthError("Printify API key or Shop ID missing")
@@ -78,7 +160,12 @@ class PrintifyClient:
             "Content-Type": "application/json"
         }
         self.retry_config = retry_config or RetryConfig()
-        self._variant_cache: Dict[Tuple[int, int], List[Variant]] = {}
+        self.catalog_cache = catalog_cache or CatalogCache()
+
+        # Client-side rate limits
+        self._global_bucket = TokenBucket.for_limit(GLOBAL_RATE_LIMIT)
+        self._catalog_bucket = TokenBucket.for_limit(CATALOG_RATE_LIMIT)
+        self._publish_bucket = TokenBucket.for_limit(PUBLISH_RATE_LIMIT)
 
         # Configure session with HTTPAdapter and retry logic
         self.session = requests.Session()
@@ -89,12 +176,25 @@ class PrintifyClient:
             allowed_methods=["GET", "POST", "PUT", "DELETE"],
             raise_on_status=False
         )
-        adapter = HTTPAdapter(max_retries=retry_strategy)
+        adapter = HTTPAdapter(
+            pool_connections=pool_size,
+            pool_maxsize=pool_size,
+            max_retries=retry_strategy
+        )
         self.session.mount("http://", adapter)
         self.session.mount("https://", adapter)
 
         logger.info(f"Initialized Printify client for shop {shop_id}")
 
+    def _buckets_for(self, endpoint: str) -> List[TokenBucket]:
+        """Rate limit buckets a request to endpoint must pass through"""
+        buckets = [self._global_bucket]
+        if endpoint.startswith("/catalog/"):
+            buckets.append(self._catalog_bucket)
+        elif endpoint.endswith("/publish.json"):
+            buckets.append(self._publish_bucket)
+        return buckets
+
     def _make_request(
         self,
         method: str,
@@ -123,6 +223,10 @@ class PrintifyClient:
             try:
                 logger.debug(f"{method} {endpoint} (attempt {retries + 1}/{self.retry_config.max_retries + 1})")
 
+                buckets = self._buckets_for(endpoint)
+                for bucket in buckets:
+                    bucket.acquire()
+
                 # For file uploads, don't set Content-Type (let requests handle multipart)
                 headers = self.headers.copy()
                 if 'files' in kwargs:
@@ -141,6 +245,12 @@ class PrintifyClient:
                     raise PrintifyAuthError("Invalid API key or authentication failed")
                 elif response.status_code == 429:
                     logger.warning("Rate limit exceeded, retrying...")
+                    # Pause every caller sharing these limits, not just this one
+                    for bucket in buckets:
+                        bucket.drain()
+                    retry_after = response.headers.get("Retry-After")
+                    if retry_after and retry_after.isdigit():
+                        backoff = max(backoff, float(retry_after))
                     raise PrintifyRateLimitError("Rate limit exceeded")
                 elif response.status_code >= 500:
                     logger.warning(f"Server error {response.status_code}, retrying...")
@@ -181,39 +291,38 @@ class PrintifyClient:
         Args:
             blueprint_id: Printify blueprint ID (e.g., 3 for t-shirt)
             provider_id: Print provider ID (e.g., 99 for SwiftPOD)
-            use_cache: Whether to use cached variants
+            use_cache: Whether to use cached variants (stale entries are served
+                while refreshing in the background); False forces a fetch
 
         Returns:
             List of Variant objects
         """
-        cache_key = (blueprint_id, provider_id)
+        cache_key = f"variants/{blueprint_id}/{provider_id}"
 
-        if use_cache and cache_key in self._variant_cache:
-            logger.debug(f"Using cached variants for blueprint {blueprint_id}, provider {provider_id}")
-            return self._variant_cache[cache_key]
-
-        try:
+        def fetch() -> List[Dict]:
             logger.info(f"Fetching variants for blueprint {blueprint_id}, provider {provider_id}")
             response = self._make_request(
                 "GET",
                 f"/catalog/blueprints/{blueprint_id}/print_providers/{provider_id}/variants.json"
             )
-
-            variants_data = response.json().get("variants", [])
-            variants = [
-                Variant(
-                    id=v["id"],
-                    title=v.get("title", f"Variant {v['id']}"),
-                    is_available=v.get("is_available", True)
-                )
-                for v in variants_data
+            variants_data = [
+                {
+                    "id": v["id"],
+                    "title": v.get("title", f"Variant {v['id']}"),
+                    "is_available": v.get("is_available", True)
+                }
+                for v in response.json().get("variants", [])
             ]
+            logger.info(f"Fetched {len(variants_data)} variants")
+            return variants_data
 
-            # Cache the results
-            self._variant_cache[cache_key] = variants
-            logger.info(f"Fetched {len(variants)} variants")
+        try:
+            if use_cache:
+                variants_data = self.catalog_cache.get(cache_key, fetch)
+            else:
+                variants_data = self.catalog_cache.put(cache_key, fetch())
 
-            return variants
+            return [Variant(**v) for v in variants_data]
 
         except Exception as e:
             logger.error(f"Failed to fetch variants: {e}")
@@ -380,20 +489,44 @@ class PrintifyClient:
             Product ID if successful, None otherwise
         """
         # Upload image
-        image_id = self.upload_image(image_path, title)
+        with span("printify.upload"):
+            image_id = self.upload_image(image_path, title)
         if not image_id:
             logger.error("Failed to upload image")
             return None
 
-        # Create product
-        product = self.create_product(
-            title=title,
-            image_id=image_id,
-            blueprint_id=blueprint_id,
-            provider_id=provider_id,
-            price_cents=price_cents,
-            description=description
+        return self._create_and_publish_uploaded(
+            image_id, title, blueprint_id, provider_id, price_cents, description
         )
+
+    def _create_and_publish_uploaded(
+        self,
+        image_id: str,
+        title: str,
+        blueprint_id: int,
+        provider_id: int,
+        price_cents: int,
+        description: Optional[str],
+        create_gate: Optional[threading.Semaphore] = None,
+        publish_gate: Optional[threading.Semaphore] = None,
+        on_stage: Optional[Callable[[str], None]] = None
+    ) -> Optional[str]:
+        """Create and publish a product from an uploaded image (optionally gated per stage)"""
+        create_gate = create_gate or nullcontext()
+        publish_gate = publish_gate or nullcontext()
+        on_stage = on_stage or (lambda stage: None)
+
+        # Create product
+        with create_gate, span("printify.create"):
+            on_stage("creating")
+            product = self.create_product(
+                title=title,
+                image_id=image_id,
+                blueprint_id=blueprint_id,
+                provider_id=provider_id,
+                price_cents=price_cents,
+                description=description
+            )
         if not product:
             logger.error("Failed to create product")
             return None
@@ -404,13 +537,101 @@ class PrintifyClient:
             return None
 
         # Publish
-        if not self.publish_product(product_id):
+        with publish_gate, span("printify.publish"):
+            on_stage("publishing")
+            published = self.publish_product(product_id)
+        if not published:
             logger.warning(f"Product {product_id} created but failed to publish")
             # Still return product_id as it was created successfully
             return product_id
 
         return product_id
 
+    def create_and_publish_many(
+        self,
+        items: List[Dict[str, Any]],
+        blueprint_id: int,
+        provider_id: int,
+        price_cents: int = 1999,
+        limits: Optional[StageLimits] = None
+    ) -> List[Optional[str]]:
+        """
+        Bulk upload, create and publish, pipelined across items
+
+        Each item runs upload -> create -> publish in order, but stages are
+        capped independently, so item n+1 uploads while item n is still
+        being created or published. All requests share the client's rate
+        limits and connection pool.
+
+        Args:
+            items: Dicts with image_path, title and optional description
+            blueprint_id: Blueprint ID (e.g., 3 for t-shirt)
+            provider_id: Print provider ID (e.g., 99 for SwiftPOD)
+            price_cents: Price in cents
+            limits: Per-stage concurrency caps
+
+        Returns:
+            Product IDs (None for failures), in input order
+        """
+        if not items:
+            return []
+
+        gates = StageGates(limits)
+
+        # Warm the variant cache once instead of once per concurrent create
+        try:
+            self.get_blueprint_variants(blueprint_id, provider_id)
+        except PrintifyError as e:
+            logger.error(f"Bulk publish aborted, no variants: {e}")
+            return [None] * len(items)
+
+        def run(item: Dict[str, Any]) -> Optional[str]:
+            return self.create_and_publish_gated(
+                item["image_path"], item["title"], blueprint_id, provider_id,
+                price_cents, item.get("description"), gates
+            )
+
+        workers = gates.workers
+        logger.info(f"Bulk publishing {len(items)} products ({workers} workers)")
+        with ThreadPoolExecutor(max_workers=workers, thread_name_prefix="printify") as executor:
+            results = list(executor.map(bind(run), items))
+
+        logger.info(f"Bulk publish finished: {sum(1 for r in results if r)}/{len(items)} created")
+        return results
+
+    def create_and_publish_gated(
+        self,
+        image_path: str,
+        title: str,
+        blueprint_id: int,
+        provider_id: int,
+        price_cents: int,
+        description: Optional[str],
+        gates: StageGates,
+        on_stage: Optional[Callable[[str], None]] = None
+    ) -> Optional[str]:
+        """
+        One item of a pipelined publish: each stage waits for its gate
+
+        Callers sharing gates (across calls and threads) get the same
+        stage overlap as create_and_publish_many. on_stage is called with
+        "uploading", "creating" and "publishing" as each stage starts.
+
+        Returns:
+            Product ID if successful, None otherwise
+        """
+        with gates.upload, span("printify.upload"):
+            if on_stage:
+                on_stage("uploading")
+            image_id = self.upload_image(image_path, title)
+        if not image_id:
+            logger.error(f"Failed to upload image for {title}")
+            return None
+        return self._create_and_publish_uploaded(
+            image_id, title, blueprint_id, provider_id, price_cents,
+            description, gates.create, gates.publish, on_stage
+        )
+
     def get_product(self, product_id: str) -> Optional[Dict]:
         """
         Get product details
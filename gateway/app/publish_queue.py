@@ -0,0 +1,216 @@
+"""
+Publish Queue
+Background Printify publishing, persisted through the state manager
+"""
+import logging
+import queue
+import threading
+import time
+from collections import deque
+from typing import Any, Callable, Deque, Dict, List, Optional, Tuple
+
+from app.printify_client import PrintifyClient, PrintifyError, StageGates, StageLimits
+from app.state import ImageStatus, StateManager, StateManagerError
+from app.tracing import span, trace_spans, export_spans
+
+logger = logging.getLogger(__name__)
+
+# Stage of a publishing image before a worker picks it up
+QUEUED = "queued"
+
+# Stages a restart can safely run again (nothing exists on Printify yet)
+RESUMABLE_STAGES = (QUEUED, "uploading")
+
+# Progress events kept for the feed; clients further behind reload state
+EVENT_HISTORY = 1000
+
+
+class PublishQueue:
+    """
+    Publish jobs run by a pool of worker threads
+
+    submit() only records the job: the image moves to publishing (stage
+    "queued") with its publish options stored in its state record, and the
+    request returns. Workers run jobs through the client's pipelined stages
+    (upload, create and publish each capped by a shared gate, so one job
+    uploads while another is being created) and record every stage in
+    state. Images still publishing at startup are queued again, unless they
+    were interrupted after a product may already have been created.
+
+    Every transition is also appended to an in-memory event feed
+    (events_since) for progress streams.
+    """
+
+    def __init__(
+        self,
+        client: PrintifyClient,
+        state_manager: StateManager,
+        image_path: Callable[[str], str],
+        validate_image: Callable[[str], Tuple[bool, str]],
+        limits: Optional[StageLimits] = None
+    ):
+        """
+        Initialize queue (workers start with start())
+
+        Args:
+            client: Printify client shared by every worker
+            state_manager: Where jobs and their transitions are recorded
+            image_path: Image ID -> local file path
+            validate_image: Full file check run by the worker before upload
+            limits: Per-stage concurrency caps
+        """
+        self.client = client
+        self.state_manager = state_manager
+        self.image_path = image_path
+        self.validate_image = validate_image
+        self.gates = StageGates(limits)
+        self._queue: "queue.Queue[str]" = queue.Queue()
+        self._running: Dict[str, str] = {}  # image ID -> stage
+        self._events: Deque[Dict[str, Any]] = deque(maxlen=EVENT_HISTORY)
+        self._seq = 0
+        self._changed = threading.Condition()
+        self._started = False
+
+    def start(self) -> int:
+        """Re-queue jobs left from a previous run and start the workers"""
+        recovered = 0
+        publishing = self.state_manager.get_images_by_status(ImageStatus.PUBLISHING.value)
+        for image_id, record in self.state_manager.get_images(publishing).items():
+            stage = record.get("publish_stage")
+            if record.get("publish_options") and stage in RESUMABLE_STAGES:
+                self._queue.put(image_id)
+                recovered += 1
+            else:
+                self._fail(image_id, f"Publish interrupted while {stage or 'publishing'}; "
+                                     "check Printify before retrying")
+        if recovered:
+            logger.info(f"Re-queued {recovered} interrupted publish job(s)")
+
+        for i in range(self.gates.workers):
+            threading.Thread(target=self._work_loop, name=f"publish-{i}", daemon=True).start()
+        self._started = True
+        return recovered
+
+    def submit(self, image_id: str, options: Dict[str, Any]) -> Dict[str, Any]:
+        """
+        Queue an image for publishing
+
+        Raises:
+            StateManagerError: If the job can't be recorded
+        """
+        self._transition(image_id, ImageStatus.PUBLISHING.value, QUEUED, {
+            "publish_options": options,
+            "error_message": None
+        })
+        self._queue.put(image_id)
+        return {"image_id": image_id, "status": ImageStatus.PUBLISHING.value, "stage": QUEUED}
+
+    def stats(self) -> Dict[str, Any]:
+        """Queue depth and running jobs per stage"""
+        with self._changed:
+            stages: Dict[str, int] = {}
+            for stage in self._running.values():
+                stages[stage] = stages.get(stage, 0) + 1
+            return {
+                "queued": self._queue.qsize(),
+                "running": len(self._running),
+                "stages": stages,
+                "workers": self.gates.workers,
+                "last_event": self._seq
+            }
+
+    def events_since(self, seq: int, timeout: float = 0) -> Tuple[List[Dict[str, Any]], int]:
+        """
+        Events after seq, waiting up to timeout seconds for one to arrive
+
+        Returns:
+            (events, latest seq); events is empty on timeout
+        """
+        with self._changed:
+            if self._seq <= seq and timeout > 0:
+                self._changed.wait_for(lambda: self._seq > seq, timeout)
+            return [event for event in self._events if event["seq"] > seq], self._seq
+
+    def _work_loop(self) -> None:
+        while True:
+            image_id = self._queue.get()
+            try:
+                self._run(image_id)
+            except Exception as e:
+                logger.error(f"Publish worker failed on {image_id}: {e}", exc_info=True)
+                self._fail(image_id, f"Unexpected error: {e}")
+            finally:
+                with self._changed:
+                    self._running.pop(image_id, None)
+
+    def _run(self, image_id: str) -> None:
+        record = self.state_manager.get_images([image_id]).get(image_id, {})
+        options = record.get("publish_options")
+        if record.get("status") != ImageStatus.PUBLISHING.value or not options:
+            return  # Reset or deleted while queued
+
+        image_path = self.image_path(image_id)
+        is_valid, error = self.validate_image(image_path)
+        if not is_valid:
+            self._fail(image_id, error)
+            return
+
+        root = span("publish", image_id=image_id, blueprint_id=options["blueprint_id"])
+        try:
+            with root:
+                product_id = self.client.create_and_publish_gated(
+                    image_path=image_path,
+                    title=options["title"],
+                    blueprint_id=options["blueprint_id"],
+                    provider_id=options["provider_id"],
+                    price_cents=options["price_cents"],
+                    description=options.get("description"),
+                    gates=self.gates,
+                    on_stage=lambda stage: self._transition(image_id, ImageStatus.PUBLISHING.value, stage)
+                )
+        except PrintifyError as e:
+            logger.error(f"Printify error for image {image_id}: {e}", exc_info=True)
+            self._fail(image_id, f"Printify error: {str(e)}")
+            return
+        finally:
+            export_spans(f"publish-{image_id}", trace_spans(root.trace_id))
+
+        if product_id:
+            self._transition(image_id, ImageStatus.PUBLISHED.value, None, {
+                "product_id": product_id,
+                "title": options["title"]
+            })
+            logger.info(f"Image published successfully: {image_id} -> Product {product_id}")
+        else:
+            self._fail(image_id, "Printify API failed to create product")
+
+    def _fail(self, image_id: str, error: str) -> None:
+        logger.error(f"Failed to publish image {image_id}: {error}")
+        try:
+            self._transition(image_id, ImageStatus.FAILED.value, None, {"error_message": error})
+        except StateManagerError:
+            pass
+
+    def _transition(
+        self,
+        image_id: str,
+        status: str,
+        stage: Optional[str],
+        metadata: Optional[Dict[str, Any]] = None
+    ) -> None:
+        """Record a status/stage change in state and on the event feed"""
+        self.state_manager.set_image_status(image_id, status, {**(metadata or {}), "publish_stage": stage})
+
+        event = {"image_id": image_id, "status": status, "stage": stage, "at": time.time()}
+        if metadata and metadata.get("product_id"):
+            event["product_id"] = metadata["product_id"]
+        if metadata and metadata.get("error_message"):
+            event["error"] = metadata["error_message"]
+
+        with self._changed:
+            if status == ImageStatus.PUBLISHING.value and stage != QUEUED:
+                self._running[image_id] = stage
+            self._seq += 1
+            event["seq"] = self._seq
+            self._events.append(event)
+            self._changed.notify_all()
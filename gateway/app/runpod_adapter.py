@@ -3,8 +3,14 @@ RunPod Serverless Adapter
 Handles API calls to RunPod serverless endpoints with proper authentication and format
 """
 import requests
+from requests.adapters import HTTPAdapter
 import logging
-from typing import Dict, Any, Optional
+import queue
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass, field
+from typing import Callable, Dict, Any, List, Optional
 
 logger = logging.getLogger(__name__)
 
@@ -26,8 +32,51 @@ class RunPodServerlessClient:
             "Authorization": f"Bearer {api_key}",
             "Content-Type": "application/json"
         }
+        # Shared keep-alive pool for the poller's concurrent status calls
+        self.session = requests.Session()
+        self.session.mount("https://", HTTPAdapter(pool_maxsize=16))
         logger.info(f"RunPod serverless client initialized for: {endpoint_url}")
 
+    @property
+    def base_url(self) -> str:
+        """Endpoint base URL (without /runsync or /run)"""
+        return self.endpoint_url.replace("/runsync", "").replace("/run", "")
+
+    def submit_async(self, workflow: Dict[str, Any], client_id: str, timeout: int = 30) -> str:
+        """
+        Queue a ComfyUI workflow on the async /run endpoint
+
+        Args:
+            workflow: ComfyUI workflow dict
+            client_id: Client identifier
+            timeout: Request timeout in seconds
+
+        Returns:
+            RunPod job ID
+
+        Raises:
+            requests.RequestException: If request fails
+        """
+        payload = {
+            "input": {
+                "workflow": workflow,
+                "client_id": client_id
+            }
+        }
+
+        response = self.session.post(
+            f"{self.base_url}/run",
+            json=payload,
+            headers=self.headers,
+            timeout=timeout
+        )
+        response.raise_for_status()
+        job_id = response.json().get("id")
+        if not job_id:
+            raise Exception("RunPod /run response missing job id")
+        logger.info(f"RunPod job queued: {job_id}")
+        return job_id
+
     def submit_workflow(self, workflow: Dict[str, Any], client_id: str, timeout: int = 120) -> Dict[str, Any]:
         """
         Submit a ComfyUI workflow to RunPod serverless endpoint
@@ -117,14 +166,12 @@ class RunPodServerlessClient:
         Returns:
             Job status dict
         """
-        # Extract endpoint base URL (remove /runsync or /run)
-        base_url = self.endpoint_url.replace("/runsync", "").replace("/run", "")
-        status_url = f"{base_url}/status/{job_id}"
+        status_url = f"{self.base_url}/status/{job_id}"
 
-        logger.info(f"Checking RunPod job status: {status_url}")
+        logger.debug(f"Checking RunPod job status: {status_url}")
 
         try:
-            response = requests.get(
+            response = self.session.get(
                 status_url,
                 headers=self.headers,
                 timeout=timeout
@@ -139,6 +186,219 @@ class RunPodServerlessClient:
             raise
 
 
+TERMINAL_STATUSES = ("COMPLETED", "FAILED", "CANCELLED", "TIMED_OUT")
+
+
+@dataclass
+class TrackedJob:
+    """In-memory state of one RunPod job"""
+    job_id: str
+    status: str = "IN_QUEUE"
+    images: List[Dict[str, Any]] = field(default_factory=list)
+    error: Optional[str] = None
+    submitted_at: float = field(default_factory=time.time)
+    finished_at: Optional[float] = None
+    next_poll_at: float = 0.0
+    interval: float = 0.0
+    deadline: float = float("inf")  # monotonic time polling gives up
+    failures: int = 0  # consecutive failed status checks
+    adopted: bool = False  # tracked by ID from a client, not submitted here
+
+    @property
+    def done(self) -> bool:
+        """Terminal and outputs handled"""
+        return self.finished_at is not None
+
+    def to_dict(self) -> Dict[str, Any]:
+        # Report terminal status only once outputs are saved
+        status = self.status
+        if status in TERMINAL_STATUSES and not self.done:
+            status = "IN_PROGRESS"
+        result = {"job_id": self.job_id, "status": status, "images": self.images}
+        if self.error:
+            result["error"] = self.error
+        return result
+
+
+class RunPodJobPoller:
+    """
+    Single background poller for all outstanding RunPod jobs
+
+    Each tick issues the status calls for every job that is due concurrently
+    over the client's pooled session. Per-job intervals back off while a job
+    sits unchanged and reset when its status moves. Finished jobs go through
+    a completion queue to `on_complete` (which saves outputs), so request
+    handlers only ever read in-memory state.
+
+    No job is polled forever: each gives up (TIMED_OUT) after
+    poll_timeout_seconds, or FAILED after max_status_failures status
+    checks in a row fail (an ID RunPod doesn't know). IDs a client asks
+    about without this process having submitted them are capped at
+    max_adopted outstanding.
+    """
+
+    def __init__(
+        self,
+        client: RunPodServerlessClient,
+        on_complete: Callable[[Dict[str, Any]], List[Dict[str, Any]]],
+        min_interval: float = 1.0,
+        max_interval: float = 10.0,
+        backoff: float = 1.5,
+        max_concurrency: int = 8,
+        retention_seconds: float = 3600,
+        poll_timeout_seconds: float = 3600,
+        max_status_failures: int = 10,
+        max_adopted: int = 32
+    ):
+        """
+        Initialize poller (the thread starts on first submit)
+
+        Args:
+            client: RunPod serverless client
+            on_complete: Called with a job's output; returns saved images
+            min_interval: Poll interval after submit or a status change
+            max_interval: Poll interval cap for unchanged jobs
+            backoff: Interval multiplier per unchanged poll
+            max_concurrency: Concurrent status calls per tick
+            retention_seconds: How long finished jobs stay queryable
+            poll_timeout_seconds: How long a job is polled before giving up
+            max_status_failures: Consecutive failed status checks before giving up
+            max_adopted: Outstanding client-supplied IDs polled at once
+        """
+        self.client = client
+        self.on_complete = on_complete
+        self.min_interval = min_interval
+        self.max_interval = max_interval
+        self.backoff = backoff
+        self.retention_seconds = retention_seconds
+        self.poll_timeout_seconds = poll_timeout_seconds
+        self.max_status_failures = max_status_failures
+        self.max_adopted = max_adopted
+        self.jobs: Dict[str, TrackedJob] = {}
+        self.lock = threading.Lock()
+        self._wake = threading.Event()
+        self._completions: "queue.Queue[tuple]" = queue.Queue()
+        self._executor = ThreadPoolExecutor(max_workers=max_concurrency, thread_name_prefix="runpod-status")
+        self._started = False
+
+    def submit(self, workflow: Dict[str, Any], client_id: str) -> str:
+        """Queue a workflow and start tracking it; returns the job ID immediately"""
+        job_id = self.client.submit_async(workflow, client_id)
+        self.track(job_id)
+        return job_id
+
+    def track(self, job_id: str, adopted: bool = False) -> Optional[TrackedJob]:
+        """
+        Start tracking an already submitted job
+
+        Args:
+            job_id: RunPod job ID
+            adopted: The ID came from a client rather than submit()
+
+        Returns:
+            The tracked job, or None if too many adopted jobs are outstanding
+        """
+        with self.lock:
+            job = self.jobs.get(job_id)
+            if job is None:
+                if adopted and sum(
+                    1 for j in self.jobs.values() if j.adopted and j.status not in TERMINAL_STATUSES
+                ) >= self.max_adopted:
+                    return None
+                now = time.monotonic()
+                job = self.jobs[job_id] = TrackedJob(
+                    job_id, next_poll_at=now + self.min_interval, interval=self.min_interval,
+                    deadline=now + self.poll_timeout_seconds, adopted=adopted
+                )
+            if not self._started:
+                self._started = True
+                threading.Thread(target=self._poll_loop, name="runpod-poller", daemon=True).start()
+                threading.Thread(target=self._completion_loop, name="runpod-completions", daemon=True).start()
+        self._wake.set()
+        return job
+
+    def get(self, job_id: str) -> Optional[Dict[str, Any]]:
+        """Current in-memory status of a job (None if unknown)"""
+        with self.lock:
+            job = self.jobs.get(job_id)
+            return job.to_dict() if job else None
+
+    def _poll_loop(self) -> None:
+        while True:
+            now = time.monotonic()
+            with self.lock:
+                due = [
+                    job for job in self.jobs.values()
+                    if job.status not in TERMINAL_STATUSES and job.next_poll_at <= now
+                ]
+                self._prune()
+
+            for job, result in zip(due, self._executor.map(self._fetch, due)):
+                self._apply(job, result)
+
+            with self.lock:
+                pending = [
+                    job.next_poll_at for job in self.jobs.values()
+                    if job.status not in TERMINAL_STATUSES
+                ]
+            timeout = max(0.05, min(pending) - time.monotonic()) if pending else None
+            self._wake.wait(timeout)
+            self._wake.clear()
+
+    def _fetch(self, job: TrackedJob) -> Optional[Dict[str, Any]]:
+        try:
+            return self.client.get_job_status(job.job_id)
+        except Exception as e:
+            logger.warning(f"RunPod status check for {job.job_id} failed: {e}")
+            return None
+
+    def _apply(self, job: TrackedJob, result: Optional[Dict[str, Any]]) -> None:
+        with self.lock:
+            status = result.get("status", job.status) if result else job.status
+            job.failures = 0 if result else job.failures + 1
+
+            if status not in TERMINAL_STATUSES:
+                if job.failures >= self.max_status_failures:
+                    status, result = "FAILED", {"error": f"RunPod status unavailable after {job.failures} checks"}
+                elif time.monotonic() >= job.deadline:
+                    status, result = "TIMED_OUT", {"error": f"Stopped polling after {self.poll_timeout_seconds:.0f}s"}
+
+            if status != job.status:
+                job.interval = self.min_interval
+            else:
+                job.interval = min(self.max_interval, job.interval * self.backoff)
+            job.status = status
+            job.next_poll_at = time.monotonic() + job.interval
+
+            if status in TERMINAL_STATUSES:
+                if status != "COMPLETED":
+                    job.error = result.get("error", f"RunPod job {status.lower()}")
+                self._completions.put((job, result.get("output", {})))
+
+    def _completion_loop(self) -> None:
+        while True:
+            job, output = self._completions.get()
+            images: List[Dict[str, Any]] = []
+            if job.status == "COMPLETED":
+                try:
+                    images = self.on_complete(output)
+                    logger.info(f"✓ RunPod job {job.job_id} completed with {len(images)} image(s)")
+                except Exception as e:
+                    logger.error(f"Saving outputs for RunPod job {job.job_id} failed: {e}")
+                    job.error = str(e)
+            else:
+                logger.error(f"RunPod job {job.job_id} {job.status}: {job.error}")
+            with self.lock:
+                job.images = images
+                job.finished_at = time.time()
+
+    def _prune(self) -> None:
+        """Forget finished jobs past retention (lock held)"""
+        cutoff = time.time() - self.retention_seconds
+        for job_id in [j.job_id for j in self.jobs.values() if j.done and j.finished_at < cutoff]:
+            del self.jobs[job_id]
+
+
 def create_comfyui_client(api_url: str, runpod_api_key: Optional[str] = None):
     """
     Factory function to create appropriate client based on URL
@@ -1,6 +1,7 @@
 """
 State Management
-Thread-safe image approval and publish status tracking with atomic writes
+Thread-safe image approval and publish status tracking with an append-only
+record log compacted into atomic snapshot writes
 """
 import json
 import os
@@ -8,10 +9,13 @@ import logging
 from typing import Dict, List, Optional, Any
 from pathlib import Path
 import threading
+from bisect import insort
 from datetime import datetime
 from dataclasses import dataclass, asdict
 from enum import Enum
 
+from app.record_log import RecordLog
+
 logger = logging.getLogger(__name__)
 
 
@@ -46,6 +50,8 @@ class ImageMetadata:
     product_id: Optional[str] = None
     title: Optional[str] = None
     error_message: Optional[str] = None
+    content_hash: Optional[str] = None
+    info: Optional[Dict[str, Any]] = None  # Parsed header: format, width, height, color_type, bit_depth
 
     def to_dict(self) -> Dict[str, Any]:
         """Convert to dictionary, excluding None values"""
@@ -63,10 +69,16 @@ class ImageMetadata:
             updated_at=data.get("updated_at", now),
             product_id=data.get("product_id"),
             title=data.get("title"),
-            error_message=data.get("error_message")
+            error_message=data.get("error_message"),
+            content_hash=data.get("content_hash"),
+            info=data.get("info")
         )
 
 
+# Marks "image did not exist" for index updates (None is a valid status key)
+_ABSENT = object()
+
+
 class StateManagerError(Exception):
     """Base exception for state manager errors"""
     pass
@@ -77,24 +89,45 @@ class StateManager:
     Thread-safe state manager for tracking image status
 
     Features:
-    - Atomic file writes with temp files
+    - O(record) mutations appended to a write-ahead log ({state_file}.log)
+    - Periodic compaction into an atomic snapshot (temp file + rename)
     - Thread-safe operations with locks
+    - Incremental indexes: per-status sets, published counters, created_at order,
+      content hash -> image ID (for deduplicating identical outputs)
     - Structured metadata with validation
     - Automatic timestamp tracking
     - Comprehensive error handling
     """
 
-    def __init__(self, state_file: str):
+    def __init__(
+        self,
+        state_file: str,
+        fsync_interval: float = 1.0,
+        compact_after: int = 10000
+    ):
         """
         Initialize state manager
 
         Args:
-            state_file: Path to JSON state file
+            state_file: Path to JSON state file (snapshot)
+            fsync_interval: Max seconds between log fsyncs (0 = every write)
+            compact_after: Log records before compacting into the snapshot
         """
         self.state_file = state_file
+        self.log_file = f"{state_file}.log"
+        self.compact_after = compact_after
         self.lock = threading.Lock()
         self.state: Dict[str, Dict[str, Any]] = {"images": {}}
+        self._log_records = 0
+        self._by_status: Dict[Optional[str], Dict[str, None]] = {}
+        self._by_created: List[tuple] = []
+        self._by_hash: Dict[str, str] = {}
+        self._stats: Dict[str, int] = {}
+        self.version = 0
         self._load()
+        self._replay_log()
+        self._rebuild_indexes()
+        self.log = RecordLog(self.log_file, fsync_interval)
 
         logger.info(f"State manager initialized with file: {state_file}")
 
@@ -136,18 +169,131 @@ class StateManager:
             logger.error(f"Error loading state: {e}")
             self.state = {"images": {}}
 
+    def _replay_log(self) -> None:
+        """Apply log records written since the last snapshot"""
+        images = self.state["images"]
+        for record in RecordLog.replay(self.log_file):
+            image_id = record.get("id")
+            if record.get("op") == "put":
+                images[image_id] = record["image"]
+            elif record.get("op") == "delete":
+                images.pop(image_id, None)
+            self._log_records += 1
+
+        if self._log_records:
+            logger.info(f"Replayed {self._log_records} log records ({len(images)} images)")
+
+    @staticmethod
+    def _created_ts(image_data: Dict[str, Any]) -> Optional[float]:
+        """Parse created_at into a sortable timestamp (None if invalid)"""
+        try:
+            return datetime.fromisoformat(image_data.get("created_at", "")).timestamp()
+        except (ValueError, TypeError):
+            return None
+
+    def _rebuild_indexes(self) -> None:
+        """Build all secondary indexes from scratch (on load)"""
+        self._by_status = {}
+        self._by_created = []
+        self._by_hash = {}
+        for img_id, data in self.state["images"].items():
+            self._by_status.setdefault(data.get("status"), {})[img_id] = None
+            if data.get("content_hash"):
+                self._by_hash.setdefault(data["content_hash"], img_id)
+            ts = self._created_ts(data)
+            if ts is None:
+                logger.warning(f"Invalid timestamp for {img_id}: {data.get('created_at')!r}")
+            else:
+                self._by_created.append((ts, img_id))
+        self._by_created.sort()
+        self._publish_stats()
+
+    def _index(
+        self,
+        image_id: str,
+        old_status: Optional[str],
+        new_data: Optional[Dict[str, Any]],
+        created: bool = False
+    ) -> None:
+        """
+        Update indexes after one image changed
+
+        Must be called with self.lock held. new_data is None for deletions;
+        created marks a (re)registered image needing a created_at entry.
+        Stale created_at and content hash entries are dropped lazily.
+        """
+        if old_status is not _ABSENT:
+            bucket = self._by_status.get(old_status)
+            if bucket is not None:
+                bucket.pop(image_id, None)
+
+        if new_data is not None:
+            self._by_status.setdefault(new_data.get("status"), {})[image_id] = None
+            if created:
+                ts = self._created_ts(new_data)
+                if ts is not None:
+                    insort(self._by_created, (ts, image_id))
+                if new_data.get("content_hash"):
+                    self._by_hash.setdefault(new_data["content_hash"], image_id)
+
+        self._publish_stats()
+
+    def _publish_stats(self) -> None:
+        """
+        Publish a fresh counters dict
+
+        The dict is replaced, never mutated, so get_statistics can read it
+        without taking the lock.
+        """
+        stats = {"total": len(self.state["images"])}
+        for status in ImageStatus:
+            stats[status.value] = len(self._by_status.get(status.value, ()))
+        self._stats = stats
+        self.version += 1
+
+    def _append(self, image_id: str) -> None:
+        """
+        Persist one image's current record (or its deletion) to the log
+
+        Must be called with self.lock held. Compacts into the snapshot once
+        the log grows past compact_after records.
+        """
+        image_data = self.state["images"].get(image_id)
+        if image_data is None:
+            record = {"op": "delete", "id": image_id}
+        else:
+            record = {"op": "put", "id": image_id, "image": image_data}
+
+        try:
+            self.log.append(record)
+        except Exception as e:
+            logger.error(f"Error appending to state log: {e}")
+            raise StateManagerError(f"Failed to save state: {e}")
+
+        self._log_records += 1
+        if self._log_records >= self.compact_after:
+            self._save()
+
     def _save(self) -> None:
-        """Atomically save state to disk"""
+        """Atomically snapshot state to disk and truncate the log"""
         temp_file = f"{self.state_file}.tmp"
 
         try:
             # Write to temp file first
             with open(temp_file, 'w') as f:
                 json.dump(self.state, f, indent=2)
+                f.flush()
+                os.fsync(f.fileno())
 
             # Atomic rename (on POSIX systems)
             os.replace(temp_file, self.state_file)
-            logger.debug("State saved successfully")
+
+            # Snapshot now holds everything the log did; replaying a stale
+            # log over it after a crash here is harmless (records are idempotent)
+            if hasattr(self, "log"):
+                self.log.truncate()
+            self._log_records = 0
+            logger.debug("State snapshot saved successfully")
 
         except Exception as e:
             logger.error(f"Error saving state: {e}")
@@ -206,6 +352,9 @@ class StateManager:
             )
 
         with self.lock:
+            previous = self.state["images"].get(image_id)
+            old_status = previous.get("status") if previous is not None else _ABSENT
+
             # Initialize image data if not exists
             if image_id not in self.state["images"]:
                 now = datetime.now().isoformat()
@@ -223,11 +372,15 @@ class StateManager:
                 self.state["images"][image_id].update(metadata)
                 self._update_timestamp(self.state["images"][image_id])
 
+            self._index(
+                image_id, old_status, self.state["images"][image_id],
+                created=previous is None
+            )
             logger.info(f"Set status for {image_id}: {status}")
 
             # Save state
             try:
-                self._save()
+                self._append(image_id)
             except StateManagerError as e:
                 logger.error(f"Failed to save state after status update: {e}")
                 # State is updated in memory but not persisted
@@ -244,12 +397,9 @@ class StateManager:
             List of image IDs
         """
         with self.lock:
-            images = [
-                img_id for img_id, data in self.state["images"].items()
-                if data.get("status") == status
-            ]
-            logger.debug(f"Found {len(images)} images with status '{status}'")
-            return images
+            images = list(self._by_status.get(status, ()))
+        logger.debug(f"Found {len(images)} images with status '{status}'")
+        return images
 
     def get_all_images(self) -> Dict[str, Dict[str, Any]]:
         """
@@ -261,6 +411,45 @@ class StateManager:
         with self.lock:
             return self.state["images"].copy()
 
+    def get_images(self, image_ids: List[str]) -> Dict[str, Dict[str, Any]]:
+        """
+        Get data for specific images (thread-safe copy)
+
+        Args:
+            image_ids: Image identifiers
+
+        Returns:
+            Dict of image ID to a copy of its data (missing IDs omitted)
+        """
+        images = self.state["images"]
+        with self.lock:
+            return {
+                img_id: dict(images[img_id])
+                for img_id in image_ids
+                if img_id in images
+            }
+
+    def find_by_hash(self, content_hash: str) -> Optional[Dict[str, Any]]:
+        """
+        Find a tracked image with the given content hash
+
+        Args:
+            content_hash: Hash of the file bytes
+
+        Returns:
+            Copy of the image data (with "id") or None
+        """
+        with self.lock:
+            image_id = self._by_hash.get(content_hash)
+            if image_id is None:
+                return None
+            data = self.state["images"].get(image_id)
+            if data is None or data.get("content_hash") != content_hash:
+                # Deleted or replaced since it was indexed
+                del self._by_hash[content_hash]
+                return None
+            return {"id": image_id, **data}
+
     def get_image_metadata(self, image_id: str) -> Optional[ImageMetadata]:
         """
         Get full metadata for an image
@@ -282,7 +471,9 @@ class StateManager:
         image_id: str,
         filename: str,
         path: str,
-        status: str = ImageStatus.PENDING.value
+        status: str = ImageStatus.PENDING.value,
+        content_hash: Optional[str] = None,
+        info: Optional[Dict[str, Any]] = None
     ) -> None:
         """
         Register a new image
@@ -292,16 +483,59 @@ class StateManager:
             filename: Original filename
             path: Path to image file
             status: Initial status (default: pending)
+            content_hash: Optional hash of the file bytes (indexed for dedup)
+            info: Optional parsed image header (see app.image_check)
 
         Raises:
             ValueError: If status is invalid
             StateManagerError: If save fails
         """
+        self._add(image_id, filename, path, status, content_hash, info, if_absent=False)
+
+    def add_image_if_absent(
+        self,
+        image_id: str,
+        filename: str,
+        path: str,
+        status: str = ImageStatus.PENDING.value,
+        content_hash: Optional[str] = None,
+        info: Optional[Dict[str, Any]] = None
+    ) -> bool:
+        """
+        Register a new image unless it is already tracked
+
+        The check and the insert happen under one lock hold, so a record
+        added concurrently (with its content hash) is never replaced.
+
+        Returns:
+            True if the image was added
+
+        Raises:
+            ValueError: If status is invalid
+            StateManagerError: If save fails
+        """
+        return self._add(image_id, filename, path, status, content_hash, info, if_absent=True)
+
+    def _add(
+        self,
+        image_id: str,
+        filename: str,
+        path: str,
+        status: str,
+        content_hash: Optional[str],
+        info: Optional[Dict[str, Any]],
+        if_absent: bool
+    ) -> bool:
         # Validate status
         if not ImageStatus.is_valid(status):
             raise ValueError(f"Invalid status: {status}")
 
         with self.lock:
+            previous = self.state["images"].get(image_id)
+            if previous is not None and if_absent:
+                return False
+            old_status = previous.get("status") if previous is not None else _ABSENT
+
             now = datetime.now().isoformat()
             self.state["images"][image_id] = {
                 "filename": filename,
@@ -310,14 +544,20 @@ class StateManager:
                 "created_at": now,
                 "updated_at": now
             }
+            if content_hash:
+                self.state["images"][image_id]["content_hash"] = content_hash
+            if info:
+                self.state["images"][image_id]["info"] = info
 
+            self._index(image_id, old_status, self.state["images"][image_id], created=True)
             logger.info(f"Added new image: {image_id} ({filename})")
 
             try:
-                self._save()
+                self._append(image_id)
             except StateManagerError as e:
                 logger.error(f"Failed to save state after adding image: {e}")
                 raise
+            return True
 
     def delete_image(self, image_id: str) -> bool:
         """
@@ -331,11 +571,12 @@ class StateManager:
         """
         with self.lock:
             if image_id in self.state["images"]:
-                del self.state["images"][image_id]
+                removed = self.state["images"].pop(image_id)
+                self._index(image_id, removed.get("status"), None)
                 logger.info(f"Deleted image: {image_id}")
 
                 try:
-                    self._save()
+                    self._append(image_id)
                     return True
                 except StateManagerError as e:
                     logger.error(f"Failed to save state after deleting image: {e}")
@@ -348,28 +589,20 @@ class StateManager:
         """
         Get statistics about images
 
+        Reads the published counters without taking the lock.
+
         Returns:
             Dict with counts per status
         """
-        with self.lock:
-            stats = {
-                "total": len(self.state["images"])
-            }
-
-            # Count by status
-            for status in ImageStatus:
-                count = len([
-                    img for img in self.state["images"].values()
-                    if img.get("status") == status.value
-                ])
-                stats[status.value] = count
-
-            return stats
+        return dict(self._stats)
 
     def clear_old_images(self, days: int = 30) -> int:
         """
         Remove images older than specified days
 
+        Walks the created_at index from the oldest entry, so the cost is
+        proportional to the number of images evicted.
+
         Args:
             days: Age threshold in days
 
@@ -378,30 +611,46 @@ class StateManager:
         """
         from datetime import timedelta
 
-        cutoff = datetime.now() - timedelta(days=days)
+        cutoff = (datetime.now() - timedelta(days=days)).timestamp()
         removed_count = 0
 
         with self.lock:
             images_to_remove = []
 
-            for img_id, data in self.state["images"].items():
-                try:
-                    created_at = datetime.fromisoformat(data.get("created_at", ""))
-                    if created_at < cutoff:
-                        images_to_remove.append(img_id)
-                except (ValueError, TypeError) as e:
-                    logger.warning(f"Invalid timestamp for {img_id}: {e}")
+            expired = 0
+            for ts, img_id in self._by_created:
+                if ts >= cutoff:
+                    break
+                expired += 1
+                # Skip entries left behind by deleted or re-added images
+                data = self.state["images"].get(img_id)
+                if data is not None and self._created_ts(data) == ts:
+                    images_to_remove.append(img_id)
+            del self._by_created[:expired]
 
             for img_id in images_to_remove:
-                del self.state["images"][img_id]
+                removed = self.state["images"].pop(img_id)
+                self._index(img_id, removed.get("status"), None)
                 removed_count += 1
 
             if removed_count > 0:
                 logger.info(f"Cleared {removed_count} images older than {days} days")
                 try:
-                    self._save()
+                    for img_id in images_to_remove:
+                        self._append(img_id)
                 except StateManagerError as e:
                     logger.error(f"Failed to save state after clearing old images: {e}")
                     raise
 
         return removed_count
+
+    def compact(self) -> None:
+        """Fold the log into a fresh snapshot now"""
+        with self.lock:
+            self._save()
+
+    def close(self) -> None:
+        """Compact and close the log (call on shutdown)"""
+        with self.lock:
+            self._save()
+            self.log.close()
@@ -0,0 +1,131 @@
+"""
+Thumbnail Cache
+Lazily generated, content-addressed image derivatives for the gallery
+"""
+import os
+import hashlib
+import logging
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from functools import lru_cache
+from pathlib import Path
+from typing import Dict, Optional, Sequence, Tuple
+
+from PIL import Image
+
+logger = logging.getLogger(__name__)
+
+HASH_CHUNK = 1024 * 1024
+
+
+@lru_cache(maxsize=65536)
+def _content_digest(path: str, size: int, mtime_ns: int) -> str:
+    """SHA-256 of a file, memoized on (path, size, mtime) so it is read once"""
+    digest = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(HASH_CHUNK), b''):
+            digest.update(chunk)
+    return digest.hexdigest()[:32]
+
+
+class ThumbnailCache:
+    """
+    On-disk cache of downscaled images
+
+    Derivatives are keyed by the source content hash and width, so an edited
+    source never serves a stale thumbnail and identical sources share one.
+    """
+
+    def __init__(
+        self,
+        cache_dir: str,
+        widths: Sequence[int] = (256, 512),
+        quality: int = 85,
+        prewarm_workers: int = 2
+    ):
+        """
+        Initialize thumbnail cache
+
+        Args:
+            cache_dir: Directory for derivatives
+            widths: Allowed derivative widths (requests snap up to one of these)
+            quality: WebP quality
+            prewarm_workers: Background threads for pre-warming
+        """
+        self.cache_dir = Path(cache_dir)
+        self.cache_dir.mkdir(parents=True, exist_ok=True)
+        self.widths = sorted(widths)
+        self.quality = quality
+        self._locks: Dict[str, threading.Lock] = {}
+        self._locks_guard = threading.Lock()
+        self._executor = ThreadPoolExecutor(
+            max_workers=prewarm_workers, thread_name_prefix="thumbnail"
+        )
+
+    def snap_width(self, width: int) -> Optional[int]:
+        """Smallest allowed width >= width (None = use the original)"""
+        for allowed in self.widths:
+            if allowed >= width:
+                return allowed
+        return None
+
+    def get(self, source: str, width: int) -> Tuple[str, str]:
+        """
+        Get (generating if needed) a derivative of source
+
+        Args:
+            source: Path to the original image
+            width: Target width (must be one of self.widths)
+
+        Returns:
+            Tuple of (derivative path, ETag)
+        """
+        st = os.stat(source)
+        digest = _content_digest(source, st.st_size, st.st_mtime_ns)
+        etag = f"{digest}-{width}"
+        path = self.cache_dir / digest[:2] / f"{etag}.webp"
+
+        if not path.exists():
+            with self._lock_for(etag):
+                if not path.exists():
+                    self._render(source, path, width)
+
+        return str(path), etag
+
+    def prewarm(self, source: str) -> None:
+        """Generate all derivatives of source in the background"""
+        def warm():
+            for width in self.widths:
+                try:
+                    self.get(source, width)
+                except Exception as e:
+                    logger.warning(f"Thumbnail pre-warm failed for {source}: {e}")
+                    return
+
+        self._executor.submit(warm)
+
+    def _lock_for(self, key: str) -> threading.Lock:
+        with self._locks_guard:
+            lock = self._locks.get(key)
+            if lock is None:
+                lock = self._locks[key] = threading.Lock()
+            return lock
+
+    def _render(self, source: str, path: Path, width: int) -> None:
+        """Downscale source into path atomically"""
+        path.parent.mkdir(parents=True, exist_ok=True)
+        temp_file = path.with_suffix(f".{threading.get_ident()}.tmp")
+
+        with Image.open(source) as img:
+            # draft() lets JPEG decoders skip straight to a reduced scale;
+            # reducing_gap does a fast integer box reduction before Lanczos
+            img.draft(img.mode, (width, width))
+            img.thumbnail((width, width), Image.Resampling.LANCZOS, reducing_gap=2.0)
+            if img.mode not in ("RGB", "RGBA"):
+                img = img.convert("RGBA" if "transparency" in img.info or "A" in img.mode else "RGB")
+            img.save(temp_file, "WEBP", quality=self.quality, method=4)
+
+        os.replace(temp_file, path)
+        with self._locks_guard:
+            self._locks.pop(path.stem, None)
+        logger.debug(f"Rendered {width}px thumbnail for {source}")
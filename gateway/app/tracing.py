@@ -0,0 +1,382 @@
+"""
+Low-overhead stage tracing for the publish path
+
+Same span recorder as music-engine/shared/tracing.py (the gateway image
+ships only gateway/, so it keeps its own copy; change both together).
+Spans are kept in per-thread ring buffers; /health reports per-stage
+latency histograms and /api/trace returns recent spans as Chrome trace
+or OTLP/JSON.
+"""
+
+import atexit
+import contextvars
+import json
+import logging
+import os
+import queue
+import random
+import threading
+import time
+import urllib.request
+from collections import deque
+from typing import Dict, List, Optional
+
+logger = logging.getLogger(__name__)
+
+TRACING_ENABLED = os.getenv("TRACING", "true").lower() == "true"
+
+# Spans kept per thread (oldest dropped first)
+TRACE_BUFFER_SPANS = int(os.getenv("TRACE_BUFFER_SPANS", "4096"))
+
+# Where finished jobs write their traces (unset = don't write), in
+# TRACE_FORMAT (chrome or otlp), and an OTLP/HTTP collector to post to
+TRACE_DIR = os.getenv("TRACE_DIR", "")
+TRACE_FORMAT = os.getenv("TRACE_FORMAT", "chrome")
+OTLP_ENDPOINT = os.getenv("OTLP_ENDPOINT", "")
+
+# Traces waiting for the background exporter (newest dropped when full)
+TRACE_EXPORT_QUEUE = int(os.getenv("TRACE_EXPORT_QUEUE", "256"))
+
+# Histogram bucket upper bounds in milliseconds (last bucket is +Inf)
+BUCKETS_MS = (1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000,
+              10000, 30000, 60000, 120000, 300000)
+
+
+class Span:
+    """One timed stage; times are perf_counter_ns, offset to epoch on export"""
+    __slots__ = ("name", "start", "end", "thread", "trace_id", "span_id", "parent_id", "attrs")
+
+    def __init__(self, name, start, end, thread, trace_id, span_id, parent_id, attrs):
+        self.name = name
+        self.start = start
+        self.end = end
+        self.thread = thread
+        self.trace_id = trace_id
+        self.span_id = span_id
+        self.parent_id = parent_id
+        self.attrs = attrs
+
+    @property
+    def duration_ms(self) -> float:
+        return (self.end - self.start) / 1e6
+
+
+class _ThreadState:
+    """Per-thread span ring and histograms"""
+
+    def __init__(self):
+        self.thread = threading.get_ident()
+        self.thread_name = threading.current_thread().name
+        self.spans = deque(maxlen=TRACE_BUFFER_SPANS)
+        self.histograms: Dict[str, list] = {}  # name -> [bucket counts..., sum_ms]
+
+
+_local = threading.local()
+_states: List[_ThreadState] = []
+_states_lock = threading.Lock()  # Taken once per thread, on its first span
+
+# Innermost open span of the current thread or task (the parent of the
+# next one). New threads start with none: pool tasks get their
+# submitter's through bind(), so unrelated work never joins a trace.
+_current: "contextvars.ContextVar[Optional[Span]]" = contextvars.ContextVar("trace_span", default=None)
+
+# perf_counter_ns -> unix epoch ns
+_EPOCH_OFFSET = time.time_ns() - time.perf_counter_ns()
+
+
+def _state() -> _ThreadState:
+    state = getattr(_local, "state", None)
+    if state is None:
+        state = _local.state = _ThreadState()
+        with _states_lock:
+            _states.append(state)
+    return state
+
+
+def _observe(state: _ThreadState, name: str, ms: float):
+    histogram = state.histograms.get(name)
+    if histogram is None:
+        histogram = state.histograms[name] = [0] * (len(BUCKETS_MS) + 2)
+    i = 0
+    while i < len(BUCKETS_MS) and ms > BUCKETS_MS[i]:
+        i += 1
+    histogram[i] += 1
+    histogram[-1] += ms
+
+
+class span:
+    """
+    Context manager (or decorator) timing one stage
+
+    Its parent is the innermost span open in the same thread (or asyncio
+    task); with none open it starts a new trace, whose trace_id stays
+    readable after exit for trace_spans().
+    """
+    __slots__ = ("name", "attrs", "trace_id", "_span", "_token")
+
+    def __init__(self, name: str, **attrs):
+        self.name = name
+        self.attrs = attrs
+        self.trace_id = None
+        self._span = None
+        self._token = None
+
+    def __enter__(self):
+        if not TRACING_ENABLED:
+            return self
+
+        state = _state()
+        parent = _current.get()
+        current = Span(
+            self.name, 0, 0, state.thread,
+            parent.trace_id if parent else random.getrandbits(128),
+            random.getrandbits(64),
+            parent.span_id if parent else None,
+            self.attrs
+        )
+        self.trace_id = current.trace_id
+        self._token = _current.set(current)
+        self._span = current
+        current.start = time.perf_counter_ns()
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        current = self._span
+        if current is None:
+            return False
+        current.end = time.perf_counter_ns()
+        if exc_type is not None:
+            current.attrs = {**current.attrs, "error": exc_type.__name__}
+
+        _current.reset(self._token)
+        state = _state()
+        state.spans.append(current)
+        _observe(state, current.name, current.duration_ms)
+        self._span = None
+        return False
+
+    def set(self, **attrs):
+        """Add attributes to the open span"""
+        if self._span is not None:
+            self._span.attrs = {**self._span.attrs, **attrs}
+
+    def __call__(self, fn):
+        def wrapper(*args, **kwargs):
+            with span(self.name, **self.attrs):
+                return fn(*args, **kwargs)
+        wrapper.__name__ = fn.__name__
+        wrapper.__doc__ = fn.__doc__
+        return wrapper
+
+
+def bind(fn):
+    """fn wrapped to run under the caller's open span (pass to thread pools)"""
+    parent = _current.get()
+
+    def run(*args, **kwargs):
+        token = _current.set(parent)
+        try:
+            return fn(*args, **kwargs)
+        finally:
+            _current.reset(token)
+    return run
+
+
+def now_ns() -> int:
+    """Clock spans are timed on, for spans_since"""
+    return time.perf_counter_ns()
+
+
+def spans_since(start_ns: int = 0) -> List[Span]:
+    """Finished spans (all threads) that started at or after start_ns, by start"""
+    with _states_lock:
+        states = list(_states)
+    found = [s for state in states for s in list(state.spans) if s.start >= start_ns]
+    return sorted(found, key=lambda s: s.start)
+
+
+def trace_spans(trace_id: Optional[int]) -> List[Span]:
+    """Finished spans (all threads) of one trace, by start"""
+    if trace_id is None:
+        return []
+    with _states_lock:
+        states = list(_states)
+    found = [s for state in states for s in list(state.spans) if s.trace_id == trace_id]
+    return sorted(found, key=lambda s: s.start)
+
+
+def stage_histograms() -> Dict[str, list]:
+    """Per-stage histograms merged across threads: name -> [counts..., sum_ms]"""
+    with _states_lock:
+        states = list(_states)
+    merged = {}
+    for state in states:
+        for name, histogram in list(state.histograms.items()):
+            total = merged.setdefault(name, [0] * len(histogram))
+            for i, value in enumerate(histogram):
+                total[i] += value
+    return merged
+
+
+def stage_report(histograms: Dict[str, list]) -> Dict[str, Dict]:
+    """count, mean and p50/p95/p99 (bucket upper bounds, ms) per stage"""
+    report = {}
+    for name, histogram in sorted(histograms.items()):
+        counts, sum_ms = histogram[:-1], histogram[-1]
+        count = sum(counts)
+        if not count:
+            continue
+
+        def quantile(q):
+            rank, seen = q * count, 0
+            for i, n in enumerate(counts):
+                seen += n
+                if seen >= rank:
+                    return BUCKETS_MS[i] if i < len(BUCKETS_MS) else None
+            return None
+
+        report[name] = {
+            "count": count,
+            "mean_ms": round(sum_ms / count, 2),
+            "p50_ms": quantile(0.5),
+            "p95_ms": quantile(0.95),
+            "p99_ms": quantile(0.99)
+        }
+    return report
+
+
+# ===== Export =====
+
+def chrome_trace(spans: List[Span], process_name: str = "pod-gateway") -> Dict:
+    """Chrome trace event JSON (complete events, microseconds)"""
+    pid = os.getpid()
+    with _states_lock:
+        thread_names = {state.thread: state.thread_name for state in _states}
+
+    events = [{"ph": "M", "name": "process_name", "pid": pid, "args": {"name": process_name}}]
+    events += [
+        {"ph": "M", "name": "thread_name", "pid": pid, "tid": tid, "args": {"name": name}}
+        for tid, name in thread_names.items()
+        if any(s.thread == tid for s in spans)
+    ]
+    events += [
+        {
+            "ph": "X",
+            "name": s.name,
+            "pid": pid,
+            "tid": s.thread,
+            "ts": (s.start + _EPOCH_OFFSET) / 1000,
+            "dur": (s.end - s.start) / 1000,
+            "args": {k: str(v) for k, v in s.attrs.items()}
+        }
+        for s in spans
+    ]
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def _otlp_value(value) -> Dict:
+    if isinstance(value, bool):
+        return {"boolValue": value}
+    if isinstance(value, int):
+        return {"intValue": str(value)}
+    if isinstance(value, float):
+        return {"doubleValue": value}
+    return {"stringValue": str(value)}
+
+
+def otlp_trace(spans: List[Span], service_name: str = "pod-gateway") -> Dict:
+    """OTLP/JSON ExportTraceServiceRequest"""
+    def otlp_span(s):
+        encoded = {
+            "traceId": f"{s.trace_id:032x}",
+            "spanId": f"{s.span_id:016x}",
+            "name": s.name,
+            "kind": 1,  # INTERNAL
+            "startTimeUnixNano": str(s.start + _EPOCH_OFFSET),
+            "endTimeUnixNano": str(s.end + _EPOCH_OFFSET),
+            "attributes": [
+                {"key": k, "value": _otlp_value(v)}
+                for k, v in {**s.attrs, "thread.id": s.thread}.items()
+            ]
+        }
+        if s.parent_id is not None:
+            encoded["parentSpanId"] = f"{s.parent_id:016x}"
+        if "error" in s.attrs:
+            encoded["status"] = {"code": 2, "message": str(s.attrs["error"])}
+        return encoded
+
+    return {
+        "resourceSpans": [{
+            "resource": {"attributes": [{"key": "service.name", "value": {"stringValue": service_name}}]},
+            "scopeSpans": [{"scope": {"name": "pod-gateway.tracing"}, "spans": [otlp_span(s) for s in spans]}]
+        }]
+    }
+
+
+def write_trace(path: str, spans: List[Span], fmt: str = TRACE_FORMAT, service_name: str = "pod-gateway") -> str:
+    """Write spans as a Chrome or OTLP JSON file"""
+    trace = otlp_trace(spans, service_name) if fmt == "otlp" else chrome_trace(spans, service_name)
+    os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+    with open(path, "w") as f:
+        json.dump(trace, f)
+    return path
+
+
+_exports: "queue.Queue" = queue.Queue(maxsize=TRACE_EXPORT_QUEUE)
+_exporter_lock = threading.Lock()
+_exporter: Optional[threading.Thread] = None
+
+
+def export_spans(name: str, spans: List[Span], service_name: str = "pod-gateway"):
+    """
+    Queue spans to be written under TRACE_DIR and/or posted to
+    OTLP_ENDPOINT, if set, by a background thread (the caller never waits
+    on the collector)
+    """
+    global _exporter
+    if not spans or not (TRACE_DIR or OTLP_ENDPOINT):
+        return
+
+    with _exporter_lock:
+        if _exporter is None:
+            _exporter = threading.Thread(target=_export_loop, name="trace-export", daemon=True)
+            _exporter.start()
+    try:
+        _exports.put_nowait((name, spans, service_name))
+    except queue.Full:
+        logger.warning(f"Trace export queue full, dropped {name}")
+
+
+def flush_exports(timeout: float = 5.0) -> bool:
+    """Wait for queued exports to finish (run at exit); False on timeout"""
+    with _exports.all_tasks_done:
+        return _exports.all_tasks_done.wait_for(lambda: not _exports.unfinished_tasks, timeout)
+
+
+atexit.register(flush_exports)
+
+
+def _export_loop():
+    while True:
+        name, spans, service_name = _exports.get()
+        try:
+            _export(name, spans, service_name)
+        except Exception as e:
+            logger.warning(f"Trace export failed: {e}")
+        finally:
+            _exports.task_done()
+
+
+def _export(name: str, spans: List[Span], service_name: str):
+    if TRACE_DIR:
+        write_trace(os.path.join(TRACE_DIR, f"{name}.json"), spans, service_name=service_name)
+    if OTLP_ENDPOINT:
+        request = urllib.request.Request(
+            OTLP_ENDPOINT.rstrip("/") + "/v1/traces",
+            data=json.dumps(otlp_trace(spans, service_name)).encode(),
+            headers={"Content-Type": "application/json"}
+        )
+        try:
+            urllib.request.urlopen(request, timeout=5).close()
+        except OSError as e:
+            logger.warning(f"OTLP export failed: {e}")
\ No newline at end of file
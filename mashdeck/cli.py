@@ -27,7 +27,10 @@ def cmd_generate(args):
         key=args.key,
         title=args.title,
         out_dir=args.output,
-        create_variants=args.variants
+        create_variants=args.variants,
+        gpu_slots=args.gpu_slots,
+        vary_repeats=args.vary_repeats,
+        sample_rate=args.sample_rate
     )
 
     print(f"\n✓ Song generated successfully!")
@@ -158,6 +161,9 @@ def main():
     gen_parser.add_argument("--title", help="Song title")
     gen_parser.add_argument("--output", default="output", help="Output directory")
     gen_parser.add_argument("--variants", action="store_true", help="Create platform variants")
+    gen_parser.add_argument("--gpu-slots", type=int, default=2, help="Distinct sections generated at once")
+    gen_parser.add_argument("--vary-repeats", action="store_true", help="Vary repeated sections with light DSP")
+    gen_parser.add_argument("--sample-rate", type=int, help="Master delivery rate in Hz (e.g. 44100, 48000)")
     gen_parser.set_defaults(func=cmd_generate)
 
     # Vocal command
@@ -0,0 +1,24 @@
+"""
+MashDeck DSP - numpy audio processing shared by the song and vocal engines
+"""
+
+from .buffers import segment_to_array, array_to_segment
+from .pitch import PitchAnalysis, pitch_shift_samples
+from .bus import Voice, render_bus
+from .timeline import Timeline
+from .loudness import integrated_loudness, true_peak_db
+from .dynamics import compress, limit
+
+__all__ = [
+    'segment_to_array',
+    'array_to_segment',
+    'PitchAnalysis',
+    'pitch_shift_samples',
+    'Voice',
+    'render_bus',
+    'Timeline',
+    'integrated_loudness',
+    'true_peak_db',
+    'compress',
+    'limit'
+]
@@ -0,0 +1,62 @@
+"""
+Conversion between pydub AudioSegments and numpy sample buffers
+
+Buffers are float64, shape (frames, channels), scaled to [-1.0, 1.0).
+"""
+
+from typing import Optional
+
+import numpy as np
+
+
+# numpy sample type per pydub sample width (24-bit is widened on load)
+SAMPLE_TYPES = {
+    1: np.int8,
+    2: np.int16,
+    4: np.int32
+}
+
+
+def _full_scale(sample_width: int) -> float:
+    return float(1 << (8 * sample_width - 1))
+
+
+def segment_to_array(segment) -> np.ndarray:
+    """
+    Decode an AudioSegment into a float sample buffer
+
+    Args:
+        segment: pydub AudioSegment
+
+    Returns:
+        Array of shape (frames, channels)
+    """
+    samples = np.frombuffer(segment.raw_data, dtype=SAMPLE_TYPES[segment.sample_width])
+    samples = samples.astype(np.float64) / _full_scale(segment.sample_width)
+    return samples.reshape(-1, segment.channels)
+
+
+def array_to_segment(samples: np.ndarray, like, frame_rate: Optional[int] = None):
+    """
+    Encode a float sample buffer as an AudioSegment
+
+    Args:
+        samples: Array of shape (frames, channels) or (frames,) for mono
+        like: AudioSegment whose frame rate and sample width are kept
+        frame_rate: Rate of samples, if not like's
+
+    Returns:
+        pydub AudioSegment
+    """
+    if samples.ndim == 1:
+        samples = samples[:, np.newaxis]
+
+    scale = _full_scale(like.sample_width)
+    encoded = np.clip(np.round(samples * scale), -scale, scale - 1)
+    encoded = encoded.astype(SAMPLE_TYPES[like.sample_width])
+
+    overrides = {"channels": samples.shape[1]}
+    if frame_rate is not None:
+        overrides["frame_rate"] = frame_rate
+
+    return like._spawn(encoded.tobytes(), overrides=overrides)
@@ -0,0 +1,104 @@
+"""
+Dynamics processing - RMS compressor and look-ahead true-peak limiter
+
+Both are vectorized over whole buffers: detector levels come from
+moving-window filters rather than a per-sample loop.
+"""
+
+from typing import Optional
+
+import numpy as np
+from scipy import signal
+from scipy.ndimage import minimum_filter1d, uniform_filter1d
+
+from .loudness import true_peak_envelope
+
+
+def _odd_frames(ms: float, sample_rate: int) -> int:
+    frames = max(1, int(round(ms * sample_rate / 1000)))
+    return frames if frames % 2 else frames + 1
+
+
+def compress(
+    samples: np.ndarray,
+    sample_rate: int,
+    threshold_db: float = -20.0,
+    ratio: float = 2.0,
+    attack_ms: float = 5.0,
+    release_ms: float = 50.0
+) -> np.ndarray:
+    """
+    Downward RMS compressor, applied in place
+
+    The detector is the channel-averaged RMS over a window of
+    attack + release, and the gain is smoothed with a one-pole release
+    filter.
+
+    Args:
+        samples: Array of shape (frames, channels), modified in place
+
+    Returns:
+        The compressed samples
+    """
+    if not len(samples):
+        return samples
+
+    window = _odd_frames(attack_ms + release_ms, sample_rate)
+    power = uniform_filter1d(np.square(samples).mean(axis=1), window, mode="nearest")
+
+    with np.errstate(divide="ignore"):
+        level_db = 10 * np.log10(power)
+    gain_db = -np.maximum(level_db - threshold_db, 0.0) * (1 - 1 / ratio)
+
+    release = np.exp(-1000 / (release_ms * sample_rate))
+    gain_db = signal.lfilter([1 - release], [1, -release], gain_db, zi=[gain_db[0] * release])[0]
+
+    samples *= (10 ** (gain_db / 20))[:, np.newaxis]
+    return samples
+
+
+def limit(
+    samples: np.ndarray,
+    sample_rate: int,
+    ceiling_db: float = -1.0,
+    gain: float = 1.0,
+    lookahead_ms: float = 5.0,
+    release_ms: float = 50.0,
+    peaks: Optional[np.ndarray] = None
+) -> np.ndarray:
+    """
+    Apply gain, then a look-ahead limiter keeping true peaks under the ceiling
+
+    The required gain reduction is held for the look-ahead before each
+    peak and the release after it, then averaged over the look-ahead so
+    the gain ramps down in time instead of stepping.
+
+    Args:
+        samples: Array of shape (frames, channels)
+        gain: Linear make-up gain applied before limiting
+        peaks: Precomputed true_peak_envelope(samples); pass it in when
+            limiting the same audio at several gains
+
+    Returns:
+        New limited array
+    """
+    if not len(samples):
+        return samples.copy()
+
+    if peaks is None:
+        peaks = true_peak_envelope(samples)
+
+    ceiling = 10 ** (ceiling_db / 20)
+    with np.errstate(divide="ignore"):
+        required = np.minimum(1.0, ceiling / (gain * peaks))
+
+    lookahead = _odd_frames(lookahead_ms, sample_rate)
+    hold = lookahead + _odd_frames(release_ms, sample_rate) - 1
+
+    # Minimum over [n - release, n + lookahead), then a causal average over lookahead
+    reduction = minimum_filter1d(
+        required, hold, mode="nearest", origin=(hold - lookahead) - hold // 2
+    )
+    reduction = uniform_filter1d(reduction, lookahead, mode="nearest", origin=lookahead // 2)
+
+    return samples * (gain * reduction)[:, np.newaxis]
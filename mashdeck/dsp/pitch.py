@@ -0,0 +1,97 @@
+"""
+Duration-preserving pitch shifting (phase vocoder)
+
+The STFT is time-stretched by the pitch ratio and the result resampled
+back to the original length. The STFT analysis is kept on a
+PitchAnalysis, so any number of semitone offsets share one analysis
+pass and cost one synthesis pass each.
+"""
+
+from typing import List, Sequence
+
+import numpy as np
+from scipy import signal
+
+
+N_FFT = 2048
+HOP = 512
+
+
+class PitchAnalysis:
+    """STFT of a mono signal, reusable for any number of pitch shifts"""
+
+    def __init__(self, samples: np.ndarray, n_fft: int = N_FFT, hop: int = HOP):
+        self.samples = samples
+        self.n_fft = n_fft
+        self.hop = hop
+
+        # Clips shorter than one frame are analysed zero-padded
+        padded = np.pad(samples, (0, max(0, n_fft - len(samples))))
+        _, _, stft = signal.stft(padded, nperseg=n_fft, noverlap=n_fft - hop)
+
+        # One trailing silent frame so interpolation can read frame t + 1
+        self.magnitude = np.pad(np.abs(stft), ((0, 0), (0, 1)))
+        self.phase = np.pad(np.angle(stft), ((0, 0), (0, 1)))
+
+        # Expected phase advance per hop for each bin
+        self.advance = 2 * np.pi * hop * np.arange(stft.shape[0]) / n_fft
+
+    def shift(self, semitones: float) -> np.ndarray:
+        """
+        Pitch shift by semitones (fractional for detune)
+
+        Returns:
+            Shifted samples, same length as the analysed signal
+        """
+        n_samples = len(self.samples)
+        if semitones == 0 or n_samples == 0:
+            return self.samples.copy()
+
+        ratio = 2 ** (semitones / 12)
+        n_frames = self.magnitude.shape[1] - 1
+
+        # Stretch by ratio: read the analysis frames at a 1/ratio step
+        steps = np.arange(0, n_frames, 1 / ratio)
+        frame = steps.astype(int)
+        alpha = steps - frame
+
+        magnitude = (1 - alpha) * self.magnitude[:, frame] + alpha * self.magnitude[:, frame + 1]
+
+        # Instantaneous phase increments, wrapped around the expected advance
+        delta = self.phase[:, frame + 1] - self.phase[:, frame] - self.advance[:, np.newaxis]
+        delta -= 2 * np.pi * np.round(delta / (2 * np.pi))
+        delta += self.advance[:, np.newaxis]
+
+        phase = np.empty_like(delta)
+        phase[:, 0] = self.phase[:, 0]
+        np.cumsum(delta[:, :-1], axis=1, out=phase[:, 1:])
+        phase[:, 1:] += self.phase[:, :1]
+
+        _, stretched = signal.istft(
+            magnitude * np.exp(1j * phase),
+            nperseg=self.n_fft,
+            noverlap=self.n_fft - self.hop
+        )
+
+        # Resample the stretched signal back to the original duration
+        stretched_length = int(round(n_samples * ratio))
+        stretched = np.pad(stretched, (0, max(0, stretched_length - len(stretched))))
+        return signal.resample(stretched[:stretched_length], n_samples)
+
+
+def pitch_shift_samples(samples: np.ndarray, semitones: Sequence[float]) -> List[np.ndarray]:
+    """
+    Pitch shift a sample buffer to several offsets with one analysis per channel
+
+    Args:
+        samples: Array of shape (frames, channels)
+        semitones: Offsets to render
+
+    Returns:
+        One array of shape (frames, channels) per offset
+    """
+    analyses = [PitchAnalysis(samples[:, c]) for c in range(samples.shape[1])]
+    return [
+        np.stack([analysis.shift(offset) for analysis in analyses], axis=1)
+        for offset in semitones
+    ]
@@ -0,0 +1,169 @@
+"""
+Song timeline - sections, silence and fades rendered with one allocation
+
+Clip lengths come from the WAV headers, so the final length is known
+before any audio is decoded. Rendering allocates the output once and
+reads each section straight into its slice, applying equal-power
+crossfades in place. Silence and fades are timeline operations rather
+than new audio buffers.
+"""
+
+import math
+from dataclasses import dataclass
+from typing import List, Optional
+
+import numpy as np
+import soundfile as sf
+
+from .resample import Resampler
+
+
+# Source frames read per block when a clip is converted to the timeline rate
+RESAMPLE_BLOCK = 65536
+
+
+@dataclass
+class Clip:
+    """A section file (or silence when path is None) placed on the timeline"""
+    path: Optional[str]
+    frames: int
+    crossfade: int = 0  # Frames overlapping the previous clip
+
+
+class Timeline:
+    """Ordered clips plus fades, rendered in a single pass"""
+
+    def __init__(self, sample_rate: Optional[int] = None, subtype: str = "PCM_16"):
+        self.sample_rate = sample_rate
+        self.subtype = subtype
+        self.channels = 1
+        self.clips: List[Clip] = []
+        self.fade_in = 0
+        self.fade_out = 0
+
+    @property
+    def length(self) -> int:
+        """Total timeline length in frames"""
+        return sum(clip.frames - clip.crossfade for clip in self.clips)
+
+    def _frames(self, ms: float) -> int:
+        return int(round(ms * self.sample_rate / 1000))
+
+    def append(self, path: str, crossfade_ms: int = 0) -> "Timeline":
+        """
+        Append a section, crossfading into the previous clip
+
+        The crossfade is shortened if either clip is shorter than it.
+        """
+        info = sf.info(path)
+
+        if self.sample_rate is None:
+            self.sample_rate = info.samplerate
+            self.subtype = info.subtype
+        self.channels = max(self.channels, info.channels)
+
+        frames = int(math.ceil(info.frames * self.sample_rate / info.samplerate))
+        crossfade = 0
+        if self.clips:
+            crossfade = min(self._frames(crossfade_ms), frames, self.clips[-1].frames)
+
+        self.clips.append(Clip(path, frames, crossfade))
+        return self
+
+    def add_silence(self, duration_ms: int, position: str = "end") -> "Timeline":
+        """Add silence at the start or end of the timeline"""
+        clip = Clip(None, self._frames(duration_ms))
+
+        if position == "start":
+            self.clips.insert(0, clip)
+            if len(self.clips) > 1:
+                self.clips[1].crossfade = 0
+        else:
+            self.clips.append(clip)
+        return self
+
+    def apply_fade(self, fade_in_ms: int = 0, fade_out_ms: int = 0) -> "Timeline":
+        """Fade the rendered timeline in and/or out (linear amplitude)"""
+        if fade_in_ms > 0:
+            self.fade_in = self._frames(fade_in_ms)
+        if fade_out_ms > 0:
+            self.fade_out = self._frames(fade_out_ms)
+        return self
+
+    def _read(self, clip: Clip, start: int = 0, frames: int = -1) -> np.ndarray:
+        """Read clip frames from start at the timeline's rate, shape (n, file channels)"""
+        with sf.SoundFile(clip.path) as f:
+            if f.samplerate == self.sample_rate:
+                f.seek(start)
+                return f.read(frames, dtype="float32", always_2d=True)
+
+            # Convert block by block, stopping once the requested frames exist
+            end = clip.frames if frames < 0 else start + frames
+            resampler = Resampler(f.samplerate, self.sample_rate, f.channels)
+            parts, produced = [], 0
+            for block in f.blocks(RESAMPLE_BLOCK, dtype="float32", always_2d=True):
+                parts.append(resampler.process(block))
+                produced += len(parts[-1])
+                if produced >= end:
+                    break
+            else:
+                parts.append(resampler.flush())
+
+        return np.concatenate(parts)[start:end]
+
+    def _read_into(self, clip: Clip, out: np.ndarray, start: int = 0):
+        """Read clip frames from start into out, without a temporary when formats match"""
+        with sf.SoundFile(clip.path) as f:
+            if f.samplerate == self.sample_rate and f.channels == out.shape[1]:
+                f.seek(start)
+                f.read(dtype="float32", out=out)
+                return
+
+        audio = self._read(clip, start, len(out))
+        out[:len(audio)] = audio
+
+    def render(self) -> np.ndarray:
+        """
+        Render the timeline
+
+        Returns:
+            float32 array of shape (length, channels)
+        """
+        song = np.zeros((self.length, self.channels), dtype=np.float32)
+        cursor = 0
+
+        for clip in self.clips:
+            start = cursor - clip.crossfade
+            end = start + clip.frames
+
+            if clip.path is not None:
+                overlap = clip.crossfade
+
+                if overlap:
+                    # Equal-power crossfade: fade the previous tail out in place,
+                    # then add this clip's faded-in head on top
+                    t = (np.arange(overlap, dtype=np.float32) + 0.5) * (np.pi / 2 / overlap)
+                    song[start:start + overlap] *= np.cos(t)[:, np.newaxis]
+                    head = self._read(clip, frames=overlap)
+                    song[start:start + len(head)] += head * np.sin(t[:len(head)])[:, np.newaxis]
+
+                # Body is read straight into the output buffer
+                self._read_into(clip, song[start + overlap:end], start=overlap)
+
+            cursor = end
+
+        if self.fade_in:
+            n = min(self.fade_in, len(song))
+            song[:n] *= np.linspace(0, 1, n, dtype=np.float32)[:, np.newaxis]
+        if self.fade_out:
+            n = min(self.fade_out, len(song))
+            song[len(song) - n:] *= np.linspace(1, 0, n, dtype=np.float32)[:, np.newaxis]
+
+        return song
+
+    def export(self, out_path: str) -> str:
+        """Render and write the timeline as WAV"""
+        song = self.render()
+        np.clip(song, -1.0, 1.0, out=song)
+        sf.write(out_path, song, self.sample_rate, subtype=self.subtype)
+        return out_path
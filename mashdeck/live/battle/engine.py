@@ -7,14 +7,18 @@ import os
 import sys
 import time
 import json
-from typing import Dict, List, Optional
+import threading
+import uuid
+from bisect import bisect_left
+from concurrent.futures import Future, ThreadPoolExecutor
+from typing import Callable, Dict, List, Optional, Tuple
 from dataclasses import dataclass, asdict
 
 sys.path.insert(0, os.path.join(os.path.dirname(__file__), '../..'))
 
 from vocals.rap.generator import generate_freestyle
 from vocals.synthesis import rap_synthesize
-from live.chat.ingest import ChatIngestor, extract_topics, calculate_chat_rate
+from live.chat.ingest import ChatIngestor
 
 
 @dataclass
@@ -39,6 +43,67 @@ class BattleRound:
     timestamp: float
 
 
+@dataclass
+class _SideJob:
+    """Lyrics + TTS for one side of one round, running in the background"""
+    topics: List[str]
+    future: Future
+
+
+class LatencyHistogram:
+    """Bucketed latency histogram (thread-safe)"""
+
+    BOUNDS_MS = (50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000)
+
+    def __init__(self):
+        self.buckets = [0] * (len(self.BOUNDS_MS) + 1)
+        self.count = 0
+        self.total_ms = 0.0
+        self.max_ms = 0.0
+        self._lock = threading.Lock()
+
+    def record(self, seconds: float):
+        """Record one observation"""
+        ms = seconds * 1000.0
+        with self._lock:
+            self.buckets[bisect_left(self.BOUNDS_MS, ms)] += 1
+            self.count += 1
+            self.total_ms += ms
+            self.max_ms = max(self.max_ms, ms)
+
+    def percentile(self, q: float) -> float:
+        """Upper bucket bound (ms) containing the q-th quantile"""
+        with self._lock:
+            if not self.count:
+                return 0.0
+            rank = q * self.count
+            seen = 0
+            for i, n in enumerate(self.buckets):
+                seen += n
+                if seen >= rank:
+                    return float(self.BOUNDS_MS[i]) if i < len(self.BOUNDS_MS) else self.max_ms
+            return self.max_ms
+
+    def summary(self) -> Dict:
+        """Count, mean, p50/p95, max and raw buckets"""
+        return {
+            "count": self.count,
+            "mean_ms": round(self.total_ms / self.count, 1) if self.count else 0.0,
+            "p50_ms": self.percentile(0.5),
+            "p95_ms": self.percentile(0.95),
+            "max_ms": round(self.max_ms, 1),
+            "buckets": dict(zip([f"<={b}" for b in self.BOUNDS_MS] + ["inf"], self.buckets))
+        }
+
+
+def _topic_overlap(a: List[str], b: List[str]) -> float:
+    """Jaccard similarity of two topic lists"""
+    a, b = set(a), set(b)
+    if not a and not b:
+        return 1.0
+    return len(a & b) / len(a | b)
+
+
 class BattleScorer:
     """Scores battle performance"""
 
@@ -68,13 +133,39 @@ class BattleEngine:
     """
     Main battle engine
 
-    Manages two-sided rap battles with chat as fuel
+    Manages two-sided rap battles with chat as fuel. Both sides of a round
+    are generated concurrently, and once a round is done the next one is
+    started speculatively from the chat topics at that moment, so it
+    renders while the current clips play. A speculative side is dropped
+    and regenerated if its topics no longer overlap the live topics enough.
     """
 
-    def __init__(self, output_dir: str = "battles"):
+    def __init__(
+        self,
+        output_dir: str = "battles",
+        speculate: bool = True,
+        min_topic_overlap: float = 0.5
+    ):
+        """
+        Args:
+            output_dir: Directory for round audio and battle logs
+            speculate: Pre-render the next round while the current one plays
+            min_topic_overlap: Jaccard overlap below which speculation is stale
+        """
         self.output_dir = output_dir
         os.makedirs(output_dir, exist_ok=True)
 
+        self.speculate = speculate
+        self.min_topic_overlap = min_topic_overlap
+        self._executor = ThreadPoolExecutor(max_workers=2, thread_name_prefix="battle")
+        self._speculative: Optional[Dict] = None
+        self.latency = {
+            "lyrics": LatencyHistogram(),
+            "tts": LatencyHistogram(),
+            "round_ready": LatencyHistogram()
+        }
+        self.speculation = {"hits": 0, "stale": 0}
+
         self.chat_a = ChatIngestor()
         self.chat_b = ChatIngestor()
 
@@ -87,6 +178,7 @@ class BattleEngine:
 
     def start_battle(self):
         """Start a new battle"""
+        self._drop_speculative()
         self.battle_active = True
         self.current_round = 0
         self.rounds = []
@@ -105,6 +197,7 @@ class BattleEngine:
             Winner ("A" or "B")
         """
         self.battle_active = False
+        self._drop_speculative()
 
         # Calculate total scores
         total_a = sum(r.side_a_score for r in self.rounds)
@@ -128,7 +221,8 @@ class BattleEngine:
     def execute_round(
         self,
         bars: int = 4,
-        duration: int = 30
+        duration: int = 30,
+        on_clip: Optional[Callable[[str, str], None]] = None
     ) -> BattleRound:
         """
         Execute one round of the battle
@@ -136,10 +230,13 @@ class BattleEngine:
         Args:
             bars: Bars per rapper
             duration: Round duration in seconds
+            on_clip: Called with (side, audio path) as soon as each side is
+                ready, so side A can start playing while side B renders
 
         Returns:
             BattleRound result
         """
+        started = time.perf_counter()
         self.current_round += 1
 
         print(f"\n--- ROUND {self.current_round} ---")
@@ -148,23 +245,26 @@ class BattleEngine:
         self._update_stats()
 
         # Generate topics from each chat
-        topics_a = extract_topics(self.chat_a.get_recent_messages(50))
-        topics_b = extract_topics(self.chat_b.get_recent_messages(50))
+        topics_a = self.chat_a.top_topics(5)
+        topics_b = self.chat_b.top_topics(5)
+
+        # Lyrics + audio for both sides (reusing speculation when still fresh)
+        jobs = self._claim_jobs(self.current_round, bars, {"A": topics_a, "B": topics_b})
 
-        print(f"Side A Topics: {', '.join(topics_a)}")
-        print(f"Side B Topics: {', '.join(topics_b)}")
+        print(f"Side A Topics: {', '.join(jobs['A'].topics)}")
+        print(f"Side B Topics: {', '.join(jobs['B'].topics)}")
 
-        # Generate lyrics
-        lyrics_a = generate_freestyle(topics_a, bars, style="aggressive")
-        lyrics_b = generate_freestyle(topics_b, bars, style="aggressive")
+        lyrics_a, audio_a = self._finish_side(jobs["A"], "A", self.current_round)
+        if on_clip:
+            on_clip("A", audio_a)
+        lyrics_b, audio_b = self._finish_side(jobs["B"], "B", self.current_round)
+        if on_clip:
+            on_clip("B", audio_b)
+        self.latency["round_ready"].record(time.perf_counter() - started)
 
         print(f"\nSide A:\n{lyrics_a}\n")
         print(f"Side B:\n{lyrics_b}\n")
 
-        # Synthesize audio
-        audio_a = self._synthesize_round_audio("A", self.current_round, lyrics_a)
-        audio_b = self._synthesize_round_audio("B", self.current_round, lyrics_b)
-
         # Score round
         score_a = BattleScorer.compute_score(self.stats_a)
         score_b = BattleScorer.compute_score(self.stats_b)
@@ -188,8 +288,23 @@ class BattleEngine:
 
         self.rounds.append(round_result)
 
+        # Start rendering the next round while this one plays
+        if self.speculate and self.battle_active:
+            self._speculative = {
+                "round": self.current_round + 1,
+                "bars": bars,
+                "A": self._start_side(self.current_round + 1, bars, self.chat_a.top_topics(5)),
+                "B": self._start_side(self.current_round + 1, bars, self.chat_b.top_topics(5))
+            }
+
         return round_result
 
+    def get_latency_stats(self) -> Dict:
+        """Per-stage latency histograms and speculation hit counts"""
+        stats = {stage: hist.summary() for stage, hist in self.latency.items()}
+        stats["speculation"] = dict(self.speculation)
+        return stats
+
     def add_message_a(self, username: str, message: str):
         """Add message to Side A chat"""
         self.chat_a.add_message(username, message, time.time())
@@ -208,32 +323,89 @@ class BattleEngine:
 
     def _update_stats(self):
         """Update battle statistics from chat"""
+        now = time.time()
+
         # Side A
-        msgs_a = self.chat_a.get_recent_messages(100)
-        self.stats_a.msg_rate = calculate_chat_rate(msgs_a, window_seconds=10)
-        self.stats_a.unique_users = len(set(m.get("username") for m in msgs_a))
+        self.stats_a.msg_rate = self.chat_a.chat_rate(now)
+        self.stats_a.unique_users = self.chat_a.unique_users(now)
 
-        topics_a = extract_topics(msgs_a, top_n=10)
+        topics_a = self.chat_a.top_topics(10)
         self.stats_a.keyword_entropy = len(set(topics_a)) / max(1, len(topics_a))
 
         # Side B
-        msgs_b = self.chat_b.get_recent_messages(100)
-        self.stats_b.msg_rate = calculate_chat_rate(msgs_b, window_seconds=10)
-        self.stats_b.unique_users = len(set(m.get("username") for m in msgs_b))
+        self.stats_b.msg_rate = self.chat_b.chat_rate(now)
+        self.stats_b.unique_users = self.chat_b.unique_users(now)
 
-        topics_b = extract_topics(msgs_b, top_n=10)
+        topics_b = self.chat_b.top_topics(10)
         self.stats_b.keyword_entropy = len(set(topics_b)) / max(1, len(topics_b))
 
-    def _synthesize_round_audio(self, side: str, round_num: int, lyrics: str) -> str:
-        """Synthesize audio for a round"""
+    def _start_side(self, round_num: int, bars: int, topics: List[str]) -> _SideJob:
+        """Generate lyrics and audio for one side in the background"""
+        def run() -> Tuple[str, str]:
+            t0 = time.perf_counter()
+            lyrics = generate_freestyle(topics, bars, style="aggressive")
+            t1 = time.perf_counter()
+            self.latency["lyrics"].record(t1 - t0)
+
+            # Unique name so a dropped speculative render can't clobber a live one
+            path = os.path.join(self.output_dir, f"round_{round_num}.{uuid.uuid4().hex[:8]}.tmp.wav")
+            rap_synthesize(lyrics, path)
+            self.latency["tts"].record(time.perf_counter() - t1)
+            return lyrics, path
+
+        return _SideJob(topics=topics, future=self._executor.submit(run))
+
+    def _claim_jobs(self, round_num: int, bars: int, topics: Dict[str, List[str]]) -> Dict[str, _SideJob]:
+        """Take speculative jobs that are still on-topic, start the rest"""
+        spec, self._speculative = self._speculative, None
+        usable = spec is not None and spec["round"] == round_num and spec["bars"] == bars
+
+        jobs = {}
+        for side, live_topics in topics.items():
+            job = spec[side] if usable else None
+            if job and _topic_overlap(job.topics, live_topics) >= self.min_topic_overlap:
+                self.speculation["hits"] += 1
+            else:
+                if job:
+                    self.speculation["stale"] += 1
+                    self._discard(job)
+                job = self._start_side(round_num, bars, live_topics)
+            jobs[side] = job
+
+        if spec and not usable:
+            for side in ("A", "B"):
+                self._discard(spec[side])
+        return jobs
+
+    def _finish_side(self, job: _SideJob, side: str, round_num: int) -> Tuple[str, str]:
+        """Wait for a side and move its audio to the round's path"""
+        lyrics, temp_path = job.future.result()
         output_path = os.path.join(
             self.output_dir,
             f"round_{round_num}_side_{side}.wav"
         )
-
-        rap_synthesize(lyrics, output_path)
-
-        return output_path
+        os.replace(temp_path, output_path)
+        return lyrics, output_path
+
+    def _discard(self, job: _SideJob):
+        """Cancel a job, or delete its output once it finishes"""
+        if job.future.cancel():
+            return
+
+        def cleanup(future: Future):
+            try:
+                _, temp_path = future.result()
+                os.remove(temp_path)
+            except Exception:
+                pass
+
+        job.future.add_done_callback(cleanup)
+
+    def _drop_speculative(self):
+        spec, self._speculative = self._speculative, None
+        if spec:
+            for side in ("A", "B"):
+                self._discard(spec[side])
 
     def _save_battle_log(self, winner: str, score_a: float, score_b: float):
         """Save battle results to JSON"""
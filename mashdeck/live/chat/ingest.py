@@ -3,34 +3,172 @@ Chat Ingestion System
 Connects to YouTube/TikTok chat and extracts topics for live generation
 """
 
-from typing import List, Dict
-from collections import Counter
+from typing import List, Dict, Optional
+from collections import Counter, deque
+from itertools import islice
 import re
+import threading
+import time
+
+from .sketches import HyperLogLog, DecayingTopK
+
+STOPWORDS = frozenset({"the", "a", "an", "and", "or", "but", "in", "on", "at", "to", "for"})
+DEFAULT_TOPICS = ["energy", "vibe", "music"]
+_WORD_RE = re.compile(r'\b\w+\b')
+
+# Common emoji patterns
+POSITIVE_EMOJIS = ['🔥', '💯', '🎵', '🎶', '💪', '👏', '🎉', '✨']
+NEGATIVE_EMOJIS = ['😴', '👎', '💤']
+_EMOJI_RE = re.compile("|".join(re.escape(e) for e in POSITIVE_EMOJIS + NEGATIVE_EMOJIS))
+
+
+def tokenize(text: str) -> List[str]:
+    """Topic words in a message (lowercased, stopwords and short words dropped)"""
+    return [w for w in _WORD_RE.findall(text.lower()) if len(w) > 2 and w not in STOPWORDS]
 
 
 class ChatIngestor:
-    """Ingests and analyzes chat messages"""
+    """
+    Ingests and analyzes chat messages
+
+    Messages live in a fixed-capacity ring buffer, so memory stays bounded
+    on busy streams. Message rate, unique users, the rate baseline, trending
+    topics and emoji counts are updated as messages arrive, so reading them
+    never rescans history.
+    """
 
-    def __init__(self):
-        self.messages = []
+    def __init__(
+        self,
+        capacity: int = 10000,
+        window_seconds: float = 10.0,
+        baseline_alpha: float = 0.05,
+        topic_half_life: float = 30.0
+    ):
+        """
+        Args:
+            capacity: Messages kept for get_recent_messages
+            window_seconds: Sliding window for chat_rate/unique_users
+            baseline_alpha: EWMA weight of each second in the baseline rate
+            topic_half_life: Seconds for a topic mention to lose half its weight
+        """
+        self.capacity = capacity
+        self.window_seconds = window_seconds
+        self.baseline_alpha = baseline_alpha
+        self.topic_half_life = topic_half_life
+        self.messages = deque(maxlen=capacity)
         self.topic_history = []
+        self._lock = threading.Lock()
+        self._reset_stats()
+
+    def _reset_stats(self):
+        self._window = deque()            # (timestamp, username) inside the window
+        self._window_users = Counter()    # username -> messages inside the window
+        self._all_users = HyperLogLog()
+        self._latest = 0.0
+        self._second = None               # current whole second being counted
+        self._second_count = 0
+        self.baseline_rate = 0.0          # EWMA of messages per second
+        self._topics = DecayingTopK(half_life=self.topic_half_life)
+        self._emoji_counts = Counter()
 
     def add_message(self, username: str, message: str, timestamp: float = None):
-        """Add a chat message"""
-        self.messages.append({
-            "username": username,
-            "message": message,
-            "timestamp": timestamp or 0
-        })
+        """Add a chat message (safe to call from an ingest thread)"""
+        if timestamp is None:
+            timestamp = time.time()
+
+        words = tokenize(message)
+        emojis = _EMOJI_RE.findall(message)
+
+        with self._lock:
+            self.messages.append({
+                "username": username,
+                "message": message,
+                "timestamp": timestamp
+            })
+            self._advance(timestamp)
+            self._second_count += 1
+            self._window.append((timestamp, username))
+            self._window_users[username] += 1
+            self._all_users.add(username)
+            for word in words:
+                self._topics.add(word, timestamp)
+            self._emoji_counts.update(emojis)
 
     def get_recent_messages(self, count: int = 50) -> List[Dict]:
         """Get recent messages"""
-        return self.messages[-count:]
+        with self._lock:
+            recent = list(islice(reversed(self.messages), count))
+        recent.reverse()
+        return recent
+
+    def chat_rate(self, now: Optional[float] = None) -> float:
+        """
+        Messages per second over the sliding window
+
+        Args:
+            now: Window end (default: latest message timestamp)
+        """
+        with self._lock:
+            self._advance(now)
+            return len(self._window) / self.window_seconds
+
+    def unique_users(self, now: Optional[float] = None) -> int:
+        """Distinct chatters in the sliding window"""
+        with self._lock:
+            self._advance(now)
+            return len(self._window_users)
+
+    def unique_users_total(self) -> int:
+        """Approximate distinct chatters since the last clear"""
+        with self._lock:
+            return self._all_users.count()
+
+    def top_topics(self, top_n: int = 5) -> List[str]:
+        """Trending topic keywords, weighted toward recent messages"""
+        with self._lock:
+            topics = self._topics.top(top_n)
+        return topics if topics else list(DEFAULT_TOPICS)
+
+    def emoji_counts(self) -> Dict[str, int]:
+        """Emoji counts since the last clear (same keys as extract_emoji_sentiment)"""
+        with self._lock:
+            return {emoji: self._emoji_counts[emoji] for emoji in POSITIVE_EMOJIS + NEGATIVE_EMOJIS}
+
+    def is_hype_spike(self, threshold_multiplier: float = 2.0, now: Optional[float] = None) -> bool:
+        """Check if the current rate spikes above the baseline rate"""
+        rate = self.chat_rate(now)
+        return detect_hype_spike(rate, self.baseline_rate, threshold_multiplier)
 
     def clear_history(self):
         """Clear message history"""
-        self.messages = []
-        self.topic_history = []
+        with self._lock:
+            self.messages.clear()
+            self.topic_history = []
+            self._reset_stats()
+
+    def _advance(self, now: Optional[float]):
+        """Move the window end and fold finished seconds into the baseline"""
+        if now is None or now < self._latest:
+            now = self._latest
+        self._latest = now
+
+        second = int(now)
+        if self._second is None:
+            self._second = second
+        elif second > self._second:
+            # Fold the finished second, then decay once per silent second
+            a = self.baseline_alpha
+            self.baseline_rate += a * (self._second_count - self.baseline_rate)
+            self.baseline_rate *= (1 - a) ** (second - self._second - 1)
+            self._second = second
+            self._second_count = 0
+
+        start = now - self.window_seconds
+        while self._window and self._window[0][0] < start:
+            _, username = self._window.popleft()
+            self._window_users[username] -= 1
+            if not self._window_users[username]:
+                del self._window_users[username]
 
 
 def extract_topics(chat_msgs: List[Dict], top_n: int = 5) -> List[str]:
@@ -48,21 +186,12 @@ def extract_topics(chat_msgs: List[Dict], top_n: int = 5) -> List[str]:
     word_counts = Counter()
 
     for msg in chat_msgs:
-        text = msg.get("message", "")
-
-        # Clean and split
-        words = re.findall(r'\b\w+\b', text.lower())
-
-        # Filter out common words
-        stopwords = {"the", "a", "an", "and", "or", "but", "in", "on", "at", "to", "for"}
-        words = [w for w in words if w not in stopwords and len(w) > 2]
-
-        word_counts.update(words)
+        word_counts.update(tokenize(msg.get("message", "")))
 
     # Get top topics
     top_topics = [word for word, count in word_counts.most_common(top_n)]
 
-    return top_topics if top_topics else ["energy", "vibe", "music"]
+    return top_topics if top_topics else list(DEFAULT_TOPICS)
 
 
 def calculate_chat_rate(
@@ -122,16 +251,10 @@ def extract_emoji_sentiment(chat_msgs: List[Dict]) -> Dict[str, int]:
     Returns:
         Dict with emoji counts
     """
-    emoji_counts = Counter()
-
-    # Common emoji patterns
-    positive_emojis = ['🔥', '💯', '🎵', '🎶', '💪', '👏', '🎉', '✨']
-    negative_emojis = ['😴', '👎', '💤']
+    emoji_counts = Counter({emoji: 0 for emoji in POSITIVE_EMOJIS + NEGATIVE_EMOJIS})
 
+    # One pass per message finds every pattern
     for msg in chat_msgs:
-        text = msg.get("message", "")
-
-        for emoji in positive_emojis + negative_emojis:
-            emoji_counts[emoji] += text.count(emoji)
+        emoji_counts.update(_EMOJI_RE.findall(msg.get("message", "")))
 
     return dict(emoji_counts)
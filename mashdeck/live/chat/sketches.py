@@ -0,0 +1,141 @@
+"""
+Streaming Sketches
+Fixed-memory summaries of unbounded chat streams
+"""
+
+import hashlib
+import heapq
+import math
+from operator import itemgetter
+from typing import List
+
+
+def _hash64(item: str) -> int:
+    return int.from_bytes(hashlib.blake2b(item.encode("utf-8"), digest_size=8).digest(), "big")
+
+
+class HyperLogLog:
+    """
+    Approximate distinct counter
+
+    Uses 2**precision one-byte registers (4 KB at the default precision)
+    with a standard error of about 1.04 / sqrt(2**precision), ~1.6%.
+    """
+
+    def __init__(self, precision: int = 12):
+        """
+        Args:
+            precision: Register index bits (4-16)
+        """
+        if not 4 <= precision <= 16:
+            raise ValueError("precision must be between 4 and 16")
+
+        self.precision = precision
+        self.size = 1 << precision
+        self.registers = bytearray(self.size)
+        self._alpha = 0.7213 / (1 + 1.079 / self.size)
+        self._estimate = 0
+
+    def add(self, item: str):
+        """Add an item"""
+        x = _hash64(item)
+        index = x >> (64 - self.precision)
+        rest = x & ((1 << (64 - self.precision)) - 1)
+        rank = (64 - self.precision) - rest.bit_length() + 1
+
+        if rank > self.registers[index]:
+            self.registers[index] = rank
+            self._estimate = None
+
+    def count(self) -> int:
+        """Estimated number of distinct items added"""
+        if self._estimate is None:
+            raw = self._alpha * self.size * self.size / sum(2.0 ** -r for r in self.registers)
+            zeros = self.registers.count(0)
+
+            # Small-range correction (linear counting)
+            if raw <= 2.5 * self.size and zeros:
+                raw = self.size * math.log(self.size / zeros)
+
+            self._estimate = int(round(raw))
+
+        return self._estimate
+
+    def clear(self):
+        """Forget all items"""
+        self.registers = bytearray(self.size)
+        self._estimate = 0
+
+
+class DecayingTopK:
+    """
+    Space-Saving heavy hitters with exponential time decay
+
+    Tracks at most `capacity` items. When full, a new item replaces the
+    current minimum and inherits its count, so frequent items are never
+    lost. Each hit weighs exp(t / tau) relative to a landmark time (forward
+    decay), which ages old hits without touching every counter per update.
+    """
+
+    def __init__(self, capacity: int = 256, half_life: float = 30.0):
+        """
+        Args:
+            capacity: Items tracked (keep well above the largest top-N queried)
+            half_life: Seconds for a hit's weight to halve
+        """
+        self.capacity = capacity
+        self.half_life = half_life
+        self.counts = {}
+        self._rate = math.log(2) / half_life
+        self._landmark = None
+        self._heap = []  # (count, item), may hold stale entries
+
+    def add(self, item: str, timestamp: float):
+        """Count one hit of item at timestamp"""
+        if self._landmark is None:
+            self._landmark = timestamp
+
+        exponent = self._rate * (timestamp - self._landmark)
+        if exponent > 40:
+            self._rescale(timestamp)
+            exponent = 0.0
+        weight = math.exp(exponent)
+
+        count = self.counts.get(item)
+        if count is None:
+            count = self._evict_min() if len(self.counts) >= self.capacity else 0.0
+
+        count += weight
+        self.counts[item] = count
+        heapq.heappush(self._heap, (count, item))
+
+        if len(self._heap) > 4 * self.capacity:
+            self._rebuild_heap()
+
+    def top(self, n: int) -> List[str]:
+        """The n heaviest items, heaviest first"""
+        return [item for item, _ in heapq.nlargest(n, self.counts.items(), key=itemgetter(1))]
+
+    def clear(self):
+        """Forget all items"""
+        self.counts = {}
+        self._landmark = None
+        self._heap = []
+
+    def _evict_min(self) -> float:
+        while True:
+            count, item = heapq.heappop(self._heap)
+            if self.counts.get(item) == count:
+                del self.counts[item]
+                return count
+
+    def _rescale(self, timestamp: float):
+        """Move the landmark forward before weights overflow"""
+        factor = math.exp(-self._rate * (timestamp - self._landmark))
+        self.counts = {item: count * factor for item, count in self.counts.items()}
+        self._landmark = timestamp
+        self._rebuild_heap()
+
+    def _rebuild_heap(self):
+        self._heap = [(count, item) for item, count in self.counts.items()]
+        heapq.heapify(self._heap)
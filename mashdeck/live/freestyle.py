@@ -12,7 +12,7 @@ sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
 
 from vocals.rap.generator import generate_freestyle
 from vocals.synthesis import rap_synthesize
-from .chat.ingest import extract_topics, ChatIngestor
+from .chat.ingest import ChatIngestor
 
 
 class LiveFreestyleEngine:
@@ -52,13 +52,8 @@ class LiveFreestyleEngine:
         if not self.can_generate():
             return None
 
-        # Get recent messages
-        recent = self.chat_ingestor.get_recent_messages(50)
-
-        if not recent:
-            topics = ["energy", "vibe", "music"]
-        else:
-            topics = extract_topics(recent)
+        # Trending topics from chat (defaults when chat is quiet)
+        topics = self.chat_ingestor.top_topics()
 
         print(f"\n🎤 Live Freestyle - Topics: {', '.join(topics)}")
 
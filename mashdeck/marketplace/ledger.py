@@ -0,0 +1,253 @@
+"""
+Purchase Ledger
+Append-only binary record of sales with running revenue aggregates
+"""
+
+import os
+import json
+import struct
+import threading
+import zlib
+from collections import defaultdict
+from typing import Dict, Iterator, Optional
+
+try:
+    import fcntl
+except ImportError:  # Windows: appends are serialized per process only
+    fcntl = None
+
+# Each record: header (payload length, crc32) + payload
+HEADER = struct.Struct("<II")
+# Payload: timestamp, price, then user/asset/creator ids (u16 length + utf-8)
+FIXED = struct.Struct("<dq")
+TEXT_LENGTH = struct.Struct("<H")
+
+LEDGER_FILE = "purchases.ledger"
+
+
+def _encode(record: Dict) -> bytes:
+    payload = bytearray(FIXED.pack(record["timestamp"], record["price_paid"]))
+    for field in ("user_id", "asset_id", "creator_id"):
+        text = record[field].encode("utf-8")
+        payload += TEXT_LENGTH.pack(len(text)) + text
+    return HEADER.pack(len(payload), zlib.crc32(payload)) + payload
+
+
+def _decode(payload: bytes) -> Dict:
+    timestamp, price = FIXED.unpack_from(payload)
+    offset = FIXED.size
+    fields = []
+    for _ in range(3):
+        (length,) = TEXT_LENGTH.unpack_from(payload, offset)
+        offset += TEXT_LENGTH.size
+        fields.append(payload[offset:offset + length].decode("utf-8"))
+        offset += length
+    user_id, asset_id, creator_id = fields
+    return {
+        "user_id": user_id,
+        "asset_id": asset_id,
+        "creator_id": creator_id,
+        "price_paid": price,
+        "timestamp": timestamp
+    }
+
+
+class PurchaseLedger:
+    """
+    Append-only purchase log
+
+    A sale is one write to the end of the file, and the per-creator and
+    per-asset totals are updated as it is written. Other processes sharing
+    the file catch up by reading only the bytes appended since they last
+    looked. A torn final record (crash mid-write) is ignored on read and
+    cut off before the next append.
+    """
+
+    def __init__(self, data_dir: str = "marketplace_data", fsync: bool = True):
+        self.path = os.path.join(data_dir, LEDGER_FILE)
+        self.fsync = fsync
+        self._lock = threading.Lock()
+        self._offset = 0
+        self.sales_count = 0
+        self.creator_totals = defaultdict(lambda: [0, 0])  # creator_id -> [revenue, sales]
+        self.asset_totals = defaultdict(lambda: [0, 0])    # asset_id -> [revenue, sales]
+
+        os.makedirs(data_dir, exist_ok=True)
+        self.refresh()
+
+    def append(self, record: Dict):
+        """Record a sale (needs user_id, asset_id, creator_id, price_paid, timestamp)"""
+        data = _encode(record)
+
+        with self._lock:
+            f = self._open_locked()
+            try:
+                self._refresh_locked()
+
+                # Drop a torn tail so the new record starts on a boundary
+                if f.seek(0, os.SEEK_END) != self._offset:
+                    f.truncate(self._offset)
+                    f.seek(self._offset)
+                f.write(data)
+                f.flush()
+                if self.fsync:
+                    os.fsync(f.fileno())
+            finally:
+                if fcntl:
+                    fcntl.flock(f, fcntl.LOCK_UN)
+                f.close()
+
+            self._offset += len(data)
+            self._apply(record)
+
+    def _open_locked(self):
+        """The ledger opened for append, exclusive across processes from catch-up to write"""
+        while True:
+            f = open(self.path, "ab")
+            if not fcntl:
+                return f
+            fcntl.flock(f, fcntl.LOCK_EX)
+            # A migration may have replaced the file while we waited
+            if os.path.exists(self.path) and os.stat(self.path).st_ino == os.fstat(f.fileno()).st_ino:
+                return f
+            fcntl.flock(f, fcntl.LOCK_UN)
+            f.close()
+
+    def creator_earnings(self, creator_id: str) -> Dict:
+        """Total revenue and sales for a creator"""
+        self.refresh()
+        revenue, sales = self.creator_totals.get(creator_id, (0, 0))
+        return {"total_revenue": revenue, "sales_count": sales}
+
+    def asset_sales(self, asset_id: str) -> int:
+        """Number of sales of an asset"""
+        self.refresh()
+        return self.asset_totals.get(asset_id, (0, 0))[1]
+
+    def records(self) -> Iterator[Dict]:
+        """Every complete record, oldest first"""
+        for _, payload in self._scan(0):
+            yield _decode(payload)
+
+    def refresh(self):
+        """Apply records appended by other processes"""
+        with self._lock:
+            self._refresh_locked()
+
+    def _refresh_locked(self):
+        for end, payload in self._scan(self._offset):
+            self._apply(_decode(payload))
+            self._offset = end
+
+    def _scan(self, offset: int):
+        """(end offset, payload) for each complete record from offset"""
+        if not os.path.exists(self.path):
+            return
+
+        with open(self.path, "rb") as f:
+            f.seek(offset)
+            while True:
+                header = f.read(HEADER.size)
+                if len(header) < HEADER.size:
+                    return
+                length, crc = HEADER.unpack(header)
+                payload = f.read(length)
+                if len(payload) < length or zlib.crc32(payload) != crc:
+                    return
+                offset += HEADER.size + length
+                yield offset, payload
+
+    def _apply(self, record: Dict):
+        price = record["price_paid"]
+        for totals in (self.creator_totals[record["creator_id"]], self.asset_totals[record["asset_id"]]):
+            totals[0] += price
+            totals[1] += 1
+        self.sales_count += 1
+
+
+def migrate_json_purchases(data_dir: str, ledger: PurchaseLedger, asset_creators: Optional[Dict[str, str]] = None):
+    """
+    Move a legacy purchases.json into the ledger (no-op once done)
+
+    Legacy purchases were also counted into each asset's downloads in
+    assets.json, so those counts are reduced by the sales moved to the
+    ledger. The new ledger and catalog are written beside the originals,
+    then renaming purchases.json to purchases.json.migrating commits the
+    migration and both are renamed into place. A crash before the commit
+    leaves the originals untouched; one after it is finished on the next
+    start. Either way no purchase is counted twice.
+
+    Args:
+        data_dir: Marketplace data directory
+        ledger: Ledger to append to
+        asset_creators: asset_id -> creator_id (read from assets.json if None)
+    """
+    purchases_file = os.path.join(data_dir, "purchases.json")
+    journal = purchases_file + ".migrating"
+    if not os.path.exists(purchases_file) and not os.path.exists(journal):
+        return
+
+    assets_file = os.path.join(data_dir, "assets.json")
+    pending = [(ledger.path + ".migrating", ledger.path), (assets_file + ".migrating", assets_file)]
+
+    with ledger._lock:
+        # Appends from other processes wait until the new ledger is in place
+        lock_file = ledger._open_locked()
+        try:
+            if not os.path.exists(journal):
+                count = _prepare_migration(purchases_file, assets_file, ledger, asset_creators)
+                os.replace(purchases_file, journal)
+                print(f"✓ Migrated {count} purchases to {ledger.path}")
+
+            for tmp, path in pending:
+                if os.path.exists(tmp):
+                    os.replace(tmp, path)
+            os.replace(journal, purchases_file + ".migrated")
+        finally:
+            if fcntl:
+                fcntl.flock(lock_file, fcntl.LOCK_UN)
+            lock_file.close()
+
+        # The new file repeats the old one's records, so catching up from
+        # the current offset reads just the migrated ones
+        ledger._refresh_locked()
+
+
+def _prepare_migration(purchases_file: str, assets_file: str, ledger: PurchaseLedger,
+                       asset_creators: Optional[Dict[str, str]]) -> int:
+    """Write the migrated ledger and catalog to .migrating files"""
+    with open(purchases_file, 'r') as f:
+        purchases = json.load(f)
+
+    assets = []
+    if os.path.exists(assets_file):
+        with open(assets_file, 'r') as f:
+            assets = json.load(f)
+    if asset_creators is None:
+        asset_creators = {a["id"]: a["creator_id"] for a in assets}
+
+    # Complete records already in the ledger, then the legacy ones
+    ledger._refresh_locked()
+    ledger_tmp = ledger.path + ".migrating"
+    with open(ledger_tmp, "wb") as out:
+        if os.path.exists(ledger.path):
+            with open(ledger.path, "rb") as f:
+                out.write(f.read(ledger._offset))
+        for purchase in purchases:
+            out.write(_encode({**purchase, "creator_id": asset_creators.get(purchase["asset_id"], "")}))
+        out.flush()
+        os.fsync(out.fileno())
+
+    if assets:
+        sales = defaultdict(int)
+        for purchase in purchases:
+            sales[purchase["asset_id"]] += 1
+        for asset in assets:
+            asset["downloads"] = max(0, asset.get("downloads", 0) - sales[asset["id"]])
+
+        with open(assets_file + ".migrating", 'w') as f:
+            json.dump(assets, f, indent=2)
+            f.flush()
+            os.fsync(f.fileno())
+
+    return len(purchases)
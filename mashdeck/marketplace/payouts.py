@@ -8,6 +8,8 @@ import json
 from typing import Dict, List
 from collections import defaultdict
 
+from .ledger import PurchaseLedger, migrate_json_purchases
+
 
 class PayoutEngine:
     """Manages creator payouts"""
@@ -16,6 +18,10 @@ class PayoutEngine:
         self.data_dir = data_dir
         self.revenue_share = 0.60  # 60% to creator, 40% to platform
 
+        # Totals per creator are kept by the ledger as sales are appended
+        self.ledger = PurchaseLedger(data_dir)
+        migrate_json_purchases(data_dir, self.ledger)
+
     def calculate_earnings(self, creator_id: str) -> Dict:
         """
         Calculate creator earnings
@@ -26,37 +32,8 @@ class PayoutEngine:
         Returns:
             Earnings breakdown
         """
-        purchases_file = os.path.join(self.data_dir, "purchases.json")
-
-        if not os.path.exists(purchases_file):
-            return {
-                "creator_id": creator_id,
-                "total_revenue": 0,
-                "creator_share": 0,
-                "platform_share": 0,
-                "sales_count": 0
-            }
-
-        with open(purchases_file, 'r') as f:
-            purchases = json.load(f)
-
-        # Load assets to get creator info
-        assets_file = os.path.join(self.data_dir, "assets.json")
-        with open(assets_file, 'r') as f:
-            assets_data = json.load(f)
-
-        # Map asset_id -> creator_id
-        asset_creators = {a["id"]: a["creator_id"] for a in assets_data}
-
-        # Calculate earnings for this creator
-        total_revenue = 0
-        sales_count = 0
-
-        for purchase in purchases:
-            asset_id = purchase["asset_id"]
-            if asset_creators.get(asset_id) == creator_id:
-                total_revenue += purchase["price_paid"]
-                sales_count += 1
+        totals = self.ledger.creator_earnings(creator_id)
+        total_revenue = totals["total_revenue"]
 
         creator_share = int(total_revenue * self.revenue_share)
         platform_share = total_revenue - creator_share
@@ -66,7 +43,7 @@ class PayoutEngine:
             "total_revenue": total_revenue,
             "creator_share": creator_share,
             "platform_share": platform_share,
-            "sales_count": sales_count
+            "sales_count": totals["sales_count"]
         }
 
     def process_payout(
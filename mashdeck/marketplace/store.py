@@ -5,9 +5,12 @@ Browse and purchase presets, voices, and other assets
 
 import os
 import json
+from collections import defaultdict
 from typing import Dict, List, Optional
 from dataclasses import dataclass, asdict
 
+from .ledger import PurchaseLedger, migrate_json_purchases
+
 
 @dataclass
 class Asset:
@@ -32,7 +35,25 @@ class MarketplaceStore:
         os.makedirs(data_dir, exist_ok=True)
 
         self.assets_file = os.path.join(data_dir, "assets.json")
-        self.assets = self._load_assets()
+        self.assets = []
+
+        # Indexes over self.assets: id -> asset, type/creator -> assets
+        self._by_id: Dict[str, Asset] = {}
+        self._by_type: Dict[str, List[Asset]] = defaultdict(list)
+        self._by_creator: Dict[str, List[Asset]] = defaultdict(list)
+
+        self.ledger = PurchaseLedger(data_dir)
+        # Before loading: migration takes legacy sales out of the catalog's downloads
+        migrate_json_purchases(data_dir, self.ledger)
+
+        # Downloads saved in the catalog; ledger sales are added on top
+        self._base_downloads: Dict[str, int] = {}
+
+        for asset in self._load_assets():
+            self._add(asset, base_downloads=asset.downloads)
+
+        for asset in self.assets:
+            asset.downloads = self._base_downloads[asset.id] + self.ledger.asset_sales(asset.id)
 
     def list_assets(
         self,
@@ -49,22 +70,25 @@ class MarketplaceStore:
         Returns:
             List of assets
         """
-        results = self.assets
+        if asset_type and creator_id:
+            # Scan the smaller index
+            by_type = self._by_type.get(asset_type, [])
+            by_creator = self._by_creator.get(creator_id, [])
+            if len(by_type) <= len(by_creator):
+                return [a for a in by_type if a.creator_id == creator_id]
+            return [a for a in by_creator if a.type == asset_type]
 
         if asset_type:
-            results = [a for a in results if a.type == asset_type]
+            return list(self._by_type.get(asset_type, []))
 
         if creator_id:
-            results = [a for a in results if a.creator_id == creator_id]
+            return list(self._by_creator.get(creator_id, []))
 
-        return results
+        return self.assets
 
     def get_asset(self, asset_id: str) -> Optional[Asset]:
         """Get specific asset"""
-        for asset in self.assets:
-            if asset.id == asset_id:
-                return asset
-        return None
+        return self._by_id.get(asset_id)
 
     def upload_asset(self, asset: Asset) -> str:
         """
@@ -77,7 +101,7 @@ class MarketplaceStore:
             Asset ID
         """
         # Add to store
-        self.assets.append(asset)
+        self._add(asset)
         self._save_assets()
 
         print(f"✓ Asset uploaded: {asset.name} by {asset.creator_name}")
@@ -109,19 +133,19 @@ class MarketplaceStore:
         if balance < asset.price_tokens:
             return {"success": False, "error": "Insufficient tokens"}
 
-        # Record purchase
+        # Record purchase (one ledger append; the catalog file is untouched)
         purchase_record = {
             "user_id": user_id,
             "asset_id": asset_id,
+            "creator_id": asset.creator_id,
             "price_paid": asset.price_tokens,
             "timestamp": self._timestamp()
         }
 
-        self._record_purchase(purchase_record)
+        self.ledger.append(purchase_record)
 
-        # Update asset stats
-        asset.downloads += 1
-        self._save_assets()
+        # Update asset stats (includes sales made by other processes)
+        asset.downloads = self._base_downloads[asset.id] + self.ledger.asset_sales(asset.id)
 
         print(f"✓ Purchase complete: {asset.name}")
 
@@ -142,27 +166,27 @@ class MarketplaceStore:
 
         return [Asset(**item) for item in data]
 
+    def _add(self, asset: Asset, base_downloads: Optional[int] = None):
+        """Add an asset to the list and its indexes"""
+        self.assets.append(asset)
+        self._by_id.setdefault(asset.id, asset)
+        self._by_type[asset.type].append(asset)
+        self._by_creator[asset.creator_id].append(asset)
+        if base_downloads is None:
+            base_downloads = asset.downloads - self.ledger.asset_sales(asset.id)
+        self._base_downloads.setdefault(asset.id, base_downloads)
+
     def _save_assets(self):
-        """Save assets to disk"""
-        data = [asdict(a) for a in self.assets]
+        """Save assets to disk (downloads exclude sales kept in the ledger)"""
+        data = []
+        for asset in self.assets:
+            item = asdict(asset)
+            item["downloads"] = self._base_downloads[asset.id]
+            data.append(item)
 
         with open(self.assets_file, 'w') as f:
             json.dump(data, f, indent=2)
 
-    def _record_purchase(self, record: Dict):
-        """Record purchase transaction"""
-        purchases_file = os.path.join(self.data_dir, "purchases.json")
-
-        purchases = []
-        if os.path.exists(purchases_file):
-            with open(purchases_file, 'r') as f:
-                purchases = json.load(f)
-
-        purchases.append(record)
-
-        with open(purchases_file, 'w') as f:
-            json.dump(purchases, f, indent=2)
-
     def _timestamp(self) -> float:
         """Get current timestamp"""
         import time
@@ -7,10 +7,12 @@ from .spotify import SpotifyReleaser
 from .tiktok import TikTokSoundPublisher
 from .youtube import YouTubeMusicPublisher
 from .pipeline import AutoReleaser
+from .transcode import TranscodeCache
 
 __all__ = [
     'SpotifyReleaser',
     'TikTokSoundPublisher',
     'YouTubeMusicPublisher',
-    'AutoReleaser'
+    'AutoReleaser',
+    'TranscodeCache'
 ]
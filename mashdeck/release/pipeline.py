@@ -1,14 +1,29 @@
 """
 Auto-Release Pipeline
 Orchestrates multi-platform release
+
+Platforms release concurrently, so a release takes as long as the
+slowest platform rather than the sum of all of them. Audio for each
+platform comes from a shared rendition cache (see transcode.py).
 """
 
 import os
-from typing import Dict, List
+from concurrent.futures import ThreadPoolExecutor
+from typing import Callable, Dict, List, Optional
 
 from .spotify import SpotifyReleaser
 from .tiktok import TikTokSoundPublisher
 from .youtube import YouTubeMusicPublisher
+from .transcode import TranscodeCache
+
+
+# Lossless 16-bit master for the streaming distributor and YouTube
+MASTER_RENDITION = {"format": "FLAC", "subtype": "PCM_16"}
+
+# TikTok hook clip: 30s from the assumed chorus, with short fades
+# TODO: Intelligently find best 30s section
+HOOK_RENDITION = {"format": "WAV", "subtype": "PCM_16", "start": 60, "duration": 30,
+                  "fade_in": 0.5, "fade_out": 1.0}
 
 
 class AutoReleaser:
@@ -16,10 +31,11 @@ class AutoReleaser:
     Automated multi-platform release system
     """
 
-    def __init__(self):
+    def __init__(self, cache: Optional[TranscodeCache] = None):
         self.spotify = SpotifyReleaser()
         self.tiktok = TikTokSoundPublisher()
         self.youtube = YouTubeMusicPublisher()
+        self.cache = cache or TranscodeCache()
 
     def release_everywhere(
         self,
@@ -45,51 +61,30 @@ class AutoReleaser:
         print("🚀 AUTO-RELEASE PIPELINE")
         print("=" * 60)
 
-        results = {}
-
-        # Spotify/Streaming
-        if "spotify" in platforms:
-            try:
-                result = self.spotify.release_track(audio_path, metadata)
-                results["spotify"] = result
-            except Exception as e:
-                print(f"Spotify release error: {e}")
-                results["spotify"] = {"status": "error", "error": str(e)}
-
-        # TikTok
-        if "tiktok" in platforms:
+        releases: Dict[str, Callable[[], Dict]] = {
+            "spotify": lambda: self.spotify.release_track(
+                self.cache.get(audio_path, **MASTER_RENDITION), metadata
+            ),
+            "tiktok": lambda: self.tiktok.upload_sound(
+                self.cache.get(audio_path, **HOOK_RENDITION),
+                title=metadata.get("title", "MashDeck Track"),
+                tags=["#mashdeck", "#aimusic", "#edm"]
+            ),
+            "youtube": lambda: self.youtube.upload_track(
+                self.cache.get(audio_path, **MASTER_RENDITION), metadata
+            )
+        }
+        selected = [platform for platform in platforms if platform in releases]
+
+        def release(platform: str) -> Dict:
             try:
-                # Create 30s clip from best part (chorus)
-                clip_path = audio_path.replace(".wav", "_tiktok_clip.wav")
-
-                # TODO: Intelligently find best 30s section
-                self.tiktok.create_hook_clip(
-                    audio_path,
-                    clip_path,
-                    start_time=60,  # Assume chorus at 60s
-                    duration=30
-                )
-
-                result = self.tiktok.upload_sound(
-                    clip_path,
-                    title=metadata.get("title", "MashDeck Track"),
-                    tags=["#mashdeck", "#aimusic", "#edm"]
-                )
-
-                results["tiktok"] = result
-
+                return releases[platform]()
             except Exception as e:
-                print(f"TikTok upload error: {e}")
-                results["tiktok"] = {"status": "error", "error": str(e)}
+                print(f"{platform.capitalize()} release error: {e}")
+                return {"status": "error", "error": str(e)}
 
-        # YouTube
-        if "youtube" in platforms:
-            try:
-                result = self.youtube.upload_track(audio_path, metadata)
-                results["youtube"] = result
-            except Exception as e:
-                print(f"YouTube upload error: {e}")
-                results["youtube"] = {"status": "error", "error": str(e)}
+        with ThreadPoolExecutor(max_workers=max(1, len(selected)), thread_name_prefix="release") as executor:
+            results = dict(zip(selected, executor.map(release, selected)))
 
         print("\n" + "=" * 60)
         print("✓ RELEASE PIPELINE COMPLETE")
@@ -1,18 +1,37 @@
 """
 TikTok Sound Publisher
 Upload sounds to TikTok sound library
+
+Uploads use the chunked FILE_UPLOAD flow of TikTok's content posting
+API: the chunk layout is fixed when the upload is initialized, and
+chunks are sent in order from the last one TikTok acknowledged.
 """
 
 import os
 import json
+import mimetypes
 from typing import Dict, Optional
 
+import requests
+
+from .uploads import UPLOAD_CHUNK_BYTES, FileChunks, SessionExpired, UploadSession, upload_chunks
+
+
+INIT_URL = "https://open.tiktokapis.com/v2/post/publish/inbox/video/init/"
+REQUEST_TIMEOUT = 60
+
+# TikTok accepts 5-64 MB chunks; smaller files go as one chunk, and the
+# last chunk absorbs the remainder
+MIN_CHUNK_BYTES = 5 * 1024 * 1024
+MAX_CHUNK_BYTES = 64 * 1024 * 1024
+
 
 class TikTokSoundPublisher:
     """Publish sounds to TikTok"""
 
     def __init__(self, api_key: Optional[str] = None):
         self.api_key = api_key or os.getenv("TIKTOK_API_KEY")
+        self.output_dir = "tiktok_uploads"
 
     def upload_sound(
         self,
@@ -37,6 +56,8 @@ class TikTokSoundPublisher:
 
         if not os.path.exists(audio_path):
             raise FileNotFoundError(f"Audio not found: {audio_path}")
+        if os.path.getsize(audio_path) == 0:
+            raise ValueError(f"Audio is empty: {audio_path}")
 
         # Prepare sound data
         sound_data = {
@@ -46,21 +67,85 @@ class TikTokSoundPublisher:
             "description": description
         }
 
-        # TODO: Actual TikTok API integration
-        # For now, save upload data
-        upload_id = self._save_upload_data(sound_data)
-
-        print(f"✓ Sound upload prepared: {upload_id}")
+        if not self.api_key:
+            # No credentials: keep the upload for a later run
+            upload_id = self._save_upload_data(sound_data)
+            print(f"✓ Sound upload prepared: {upload_id}")
+            status = "pending"
+        else:
+            upload_id = self._upload(audio_path)
+            print(f"✓ Sound uploaded to TikTok: {upload_id}")
+            status = "uploaded"
         print(f"  Title: {title}")
         print(f"  Tags: {', '.join(sound_data['tags'])}")
 
         return {
             "upload_id": upload_id,
-            "status": "pending",
+            "status": status,
             "platform": "tiktok",
             "sound_data": sound_data
         }
 
+    def _upload(self, audio_path: str) -> str:
+        """Chunked upload; returns TikTok's publish ID"""
+        try:
+            return self._upload_session(audio_path)
+        except SessionExpired as e:
+            print(f"  {e}; starting a new TikTok upload")
+            return self._upload_session(audio_path)
+
+    def _upload_session(self, audio_path: str) -> str:
+        """One upload session, resumed from saved state when there is one"""
+        session = UploadSession(self.output_dir, "tiktok", audio_path)
+
+        with FileChunks(audio_path) as chunks:
+            total = chunks.size
+            chunk_size = total if total < MIN_CHUNK_BYTES else min(max(UPLOAD_CHUNK_BYTES, MIN_CHUNK_BYTES), MAX_CHUNK_BYTES)
+            chunk_count = max(1, total // chunk_size)
+
+            if session.resumed:
+                print(f"  Resuming TikTok upload at {session.offset}/{total} bytes")
+            else:
+                response = requests.post(
+                    INIT_URL,
+                    headers={"Authorization": f"Bearer {self.api_key}"},
+                    json={"source_info": {
+                        "source": "FILE_UPLOAD",
+                        "video_size": total,
+                        "chunk_size": chunk_size,
+                        "total_chunk_count": chunk_count
+                    }},
+                    timeout=REQUEST_TIMEOUT
+                )
+                response.raise_for_status()
+                data = response.json()["data"]
+                session.url = data["upload_url"]
+                session.data["publish_id"] = data["publish_id"]
+                session.save()
+
+            def chunk_end(start: int) -> int:
+                # The last of chunk_count chunks runs to the end of the file
+                index = start // chunk_size
+                return total if index >= chunk_count - 1 else start + chunk_size
+
+            def send_chunk(start: int, data: memoryview, total: int) -> int:
+                response = requests.put(
+                    session.url,
+                    data=data,
+                    headers={
+                        "Content-Type": mimetypes.guess_type(audio_path)[0] or "application/octet-stream",
+                        "Content-Range": f"bytes {start}-{start + len(data) - 1}/{total}"
+                    },
+                    timeout=REQUEST_TIMEOUT
+                )
+                response.raise_for_status()
+                return start + len(data)
+
+            upload_chunks(chunks, session, send_chunk, chunk_end=chunk_end)
+
+        session.finish()
+        return session.data["publish_id"]
+
     def create_hook_clip(
         self,
         full_audio: str,
@@ -109,10 +194,9 @@ class TikTokSoundPublisher:
         import time
 
         upload_id = f"tiktok_{int(time.time())}"
-        output_dir = "tiktok_uploads"
-        os.makedirs(output_dir, exist_ok=True)
+        os.makedirs(self.output_dir, exist_ok=True)
 
-        filepath = os.path.join(output_dir, f"{upload_id}.json")
+        filepath = os.path.join(self.output_dir, f"{upload_id}.json")
 
         with open(filepath, 'w') as f:
             json.dump(data, f, indent=2)
@@ -0,0 +1,109 @@
+"""
+Release Renditions
+Each platform's audio transcoded once into a shared cache
+
+Publishers ask for a rendition (format, bit depth, excerpt) instead of
+converting the master themselves. Platforms that want the same
+rendition share one file, concurrent requests for it wait on a single
+transcode, and re-releasing an unchanged master reuses the cache.
+"""
+
+import os
+import json
+import hashlib
+import threading
+from typing import Dict, Optional
+
+import numpy as np
+import soundfile as sf
+
+
+RELEASE_CACHE_DIR = os.getenv("RELEASE_CACHE_DIR", "release_cache")
+
+# Frames converted per block (the master is never loaded whole)
+TRANSCODE_BLOCK = 65536
+
+EXTENSIONS = {"FLAC": "flac", "WAV": "wav", "OGG": "ogg"}
+
+
+class TranscodeCache:
+    """Renditions of release masters, keyed by source file and settings"""
+
+    def __init__(self, cache_dir: str = RELEASE_CACHE_DIR):
+        self.cache_dir = cache_dir
+        self._locks: Dict[str, threading.Lock] = {}
+        self._locks_lock = threading.Lock()
+
+    def get(
+        self,
+        source: str,
+        format: str = "FLAC",
+        subtype: str = "PCM_16",
+        start: float = 0.0,
+        duration: Optional[float] = None,
+        fade_in: float = 0.0,
+        fade_out: float = 0.0
+    ) -> str:
+        """
+        Path of source rendered with these settings, transcoding on first use
+
+        Args:
+            source: Master audio file
+            format: soundfile container (FLAC, WAV, OGG)
+            subtype: soundfile sample format
+            start: Excerpt start in seconds (clamped so the excerpt fits)
+            duration: Excerpt length in seconds (default: to the end)
+            fade_in: Fade-in seconds at the excerpt start
+            fade_out: Fade-out seconds at the excerpt end
+
+        Returns:
+            Path to the cached rendition
+        """
+        if not os.path.exists(source):
+            raise FileNotFoundError(f"Audio file not found: {source}")
+
+        stat = os.stat(source)
+        settings = [os.path.abspath(source), stat.st_size, stat.st_mtime_ns,
+                    format, subtype, start, duration, fade_in, fade_out]
+        key = hashlib.sha1(json.dumps(settings).encode()).hexdigest()[:16]
+        name = os.path.splitext(os.path.basename(source))[0]
+        path = os.path.join(self.cache_dir, f"{name}_{key}.{EXTENSIONS[format]}")
+
+        with self._lock(key):
+            if not os.path.exists(path):
+                os.makedirs(self.cache_dir, exist_ok=True)
+                self._transcode(source, path, format, subtype, start, duration, fade_in, fade_out)
+                print(f"✓ Transcoded {os.path.basename(source)} -> {path}")
+        return path
+
+    def _lock(self, key: str) -> threading.Lock:
+        with self._locks_lock:
+            return self._locks.setdefault(key, threading.Lock())
+
+    def _transcode(self, source, path, format, subtype, start, duration, fade_in, fade_out):
+        """Blockwise conversion into a temp file, renamed into place when complete"""
+        tmp = f"{path}.tmp"
+        with sf.SoundFile(source) as src:
+            rate = src.samplerate
+            frames = src.frames if duration is None else min(int(duration * rate), src.frames)
+            first = min(int(start * rate), src.frames - frames)
+            fade_in_frames = int(fade_in * rate)
+            fade_out_frames = int(fade_out * rate)
+            src.seek(first)
+
+            with sf.SoundFile(tmp, "w", rate, src.channels, subtype=subtype, format=format) as out:
+                done = 0
+                while done < frames:
+                    block = src.read(min(TRANSCODE_BLOCK, frames - done), dtype="float32", always_2d=True)
+                    if not len(block):
+                        break
+                    index = done + np.arange(len(block))
+                    gain = np.ones(len(block), dtype=np.float32)
+                    if fade_in_frames:
+                        gain = np.minimum(gain, index / fade_in_frames)
+                    if fade_out_frames:
+                        gain = np.minimum(gain, (frames - index) / fade_out_frames)
+                    out.write(block * gain[:, np.newaxis])
+                    done += len(block)
+
+        os.replace(tmp, path)
@@ -0,0 +1,170 @@
+"""
+Resumable Chunked Uploads
+Shared by the platform publishers
+
+Files are read through one mmap and each chunk is handed to the HTTP
+client as a memoryview slice of it, so upload data is never copied in
+Python. Progress (the platform's upload session and the bytes it has
+acknowledged) is saved after every chunk: a dropped connection resumes
+from the last acknowledged byte, and a re-run of the same release picks
+up the same session instead of starting over, unless the platform has
+expired it (404/410), in which case the saved state is dropped.
+"""
+
+import os
+import json
+import mmap
+import time
+import hashlib
+from typing import Callable, Dict, Iterator, Optional, Tuple
+
+
+UPLOAD_CHUNK_BYTES = int(os.getenv("RELEASE_UPLOAD_CHUNK_MB", "8")) * 1024 * 1024
+UPLOAD_RETRIES = int(os.getenv("RELEASE_UPLOAD_RETRIES", "5"))
+RETRY_BACKOFF_SECONDS = 1.0
+
+# Responses meaning the upload session no longer exists on the platform
+SESSION_GONE = (404, 410)
+
+
+class SessionExpired(Exception):
+    """The platform dropped the upload session; start a new one"""
+
+
+class FileChunks:
+    """Read-only zero-copy view of a file"""
+
+    def __init__(self, path: str):
+        self.path = path
+        self._file = open(path, "rb")
+        self.size = os.fstat(self._file.fileno()).st_size
+        # Empty files can't be mapped
+        self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ) if self.size else None
+        self._view = memoryview(self._map) if self._map else memoryview(b"")
+
+    def view(self, start: int, end: int) -> memoryview:
+        """Bytes [start, end) without copying"""
+        return self._view[start:end]
+
+    def chunks(self, start: int, chunk_end: Callable[[int], int]) -> Iterator[Tuple[int, memoryview]]:
+        """(offset, data) for each chunk from start to the end of the file"""
+        while start < self.size:
+            end = min(chunk_end(start), self.size)
+            yield start, self.view(start, end)
+            start = end
+
+    def close(self):
+        self._view.release()
+        if self._map:
+            try:
+                self._map.close()
+            except BufferError:
+                pass  # A chunk view is still referenced (say, by a traceback); unmapped when it is freed
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class UploadSession:
+    """
+    One file's upload to one platform, persisted beside the upload data
+
+    Keyed by the file's path, size and modification time, so a changed
+    file starts a fresh session.
+    """
+
+    def __init__(self, state_dir: str, platform: str, path: str):
+        stat = os.stat(path)
+        identity = f"{os.path.abspath(path)}:{stat.st_size}:{stat.st_mtime_ns}"
+        key = hashlib.sha1(identity.encode()).hexdigest()[:16]
+
+        os.makedirs(state_dir, exist_ok=True)
+        self.state_path = os.path.join(state_dir, f"{platform}_{key}.upload.json")
+        self.url: Optional[str] = None
+        self.offset = 0
+        self.data: Dict = {}
+
+        if os.path.exists(self.state_path):
+            with open(self.state_path, 'r') as f:
+                state = json.load(f)
+            self.url = state.get("url")
+            self.offset = state.get("offset", 0)
+            self.data = state.get("data", {})
+
+    @property
+    def resumed(self) -> bool:
+        return self.url is not None
+
+    def save(self):
+        tmp = self.state_path + ".tmp"
+        with open(tmp, 'w') as f:
+            json.dump({"url": self.url, "offset": self.offset, "data": self.data}, f)
+        os.replace(tmp, self.state_path)
+
+    def finish(self):
+        """Forget the session once the platform has the whole file"""
+        if os.path.exists(self.state_path):
+            os.remove(self.state_path)
+
+    def reset(self):
+        """Forget a session the platform no longer has"""
+        self.url = None
+        self.offset = 0
+        self.data = {}
+        self.finish()
+
+
+def upload_chunks(
+    chunks: FileChunks,
+    session: UploadSession,
+    send_chunk: Callable[[int, memoryview, int], int],
+    chunk_end: Optional[Callable[[int], int]] = None,
+    resync: Optional[Callable[[], int]] = None,
+    retries: int = UPLOAD_RETRIES
+):
+    """
+    Send a file from session.offset until the platform holds all of it
+
+    send_chunk(offset, data, total) uploads one chunk and returns the
+    bytes the platform now holds. After a failed chunk, resync() (when
+    given) asks the platform how much it kept; otherwise the chunk is
+    sent again. Transport errors and 5xx responses are retried with
+    backoff; other HTTP errors are raised. A 404/410 resets the session
+    and raises SessionExpired.
+    """
+    chunk_end = chunk_end or (lambda start: start + UPLOAD_CHUNK_BYTES)
+    failures = 0
+
+    while session.offset < chunks.size:
+        try:
+            for start, data in chunks.chunks(session.offset, chunk_end):
+                session.offset = send_chunk(start, data, chunks.size)
+                session.save()
+                if session.offset <= start:
+                    raise OSError(f"platform kept no bytes of the chunk at {start}")
+                failures = 0
+                if session.offset != start + len(data):
+                    break  # Platform kept less (or more) than sent: restart from its offset
+        except OSError as e:
+            # requests' exceptions are OSErrors; client errors won't succeed on retry
+            status = getattr(getattr(e, "response", None), "status_code", None)
+            if status in SESSION_GONE:
+                session.reset()
+                raise SessionExpired(f"Upload session expired ({status})") from e
+            failures += 1
+            if (status is not None and status < 500) or failures > retries:
+                raise
+
+            delay = RETRY_BACKOFF_SECONDS * 2 ** (failures - 1)
+            print(f"  Upload interrupted at {session.offset}/{chunks.size} bytes ({e}); retrying in {delay:.0f}s")
+            time.sleep(delay)
+            if resync:
+                try:
+                    session.offset = resync()
+                    session.save()
+                except OSError:
+                    pass  # Keep the last acknowledged offset and try again
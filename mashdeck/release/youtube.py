@@ -1,18 +1,31 @@
 """
 YouTube Music Publisher
 Upload to YouTube Music / YouTube Audio Library
+
+Uploads use the YouTube Data API resumable protocol: one session per
+file, sent in chunks, resumed from the byte count YouTube reports.
 """
 
 import os
 import json
+import mimetypes
 from typing import Dict, Optional
 
+import requests
+
+from .uploads import FileChunks, SessionExpired, UploadSession, upload_chunks
+
+
+UPLOAD_URL = "https://www.googleapis.com/upload/youtube/v3/videos"
+REQUEST_TIMEOUT = 60
+
 
 class YouTubeMusicPublisher:
     """Publish to YouTube Music"""
 
     def __init__(self, api_key: Optional[str] = None):
         self.api_key = api_key or os.getenv("YOUTUBE_API_KEY")
+        self.output_dir = "youtube_uploads"
 
     def upload_track(
         self,
@@ -45,27 +58,106 @@ class YouTubeMusicPublisher:
             "category": "Music"
         }
 
-        # TODO: Actual YouTube API integration
-        upload_id = self._save_upload_data(upload_data)
-
-        print(f"✓ YouTube upload prepared: {upload_id}")
+        if not self.api_key:
+            # No credentials: keep the upload for a later run
+            upload_id = self._save_upload_data(upload_data)
+            print(f"✓ YouTube upload prepared: {upload_id}")
+            status = "pending"
+        else:
+            upload_id = self._upload(audio_path, upload_data)
+            print(f"✓ Uploaded to YouTube: {upload_id}")
+            status = "uploaded"
 
         return {
             "upload_id": upload_id,
-            "status": "pending",
+            "status": status,
             "platform": "youtube_music",
             "upload_data": upload_data
         }
 
+    def _upload(self, audio_path: str, upload_data: Dict) -> str:
+        """Resumable upload; returns the video ID"""
+        try:
+            return self._upload_session(audio_path, upload_data)
+        except SessionExpired as e:
+            print(f"  {e}; starting a new YouTube upload")
+            return self._upload_session(audio_path, upload_data)
+
+    def _upload_session(self, audio_path: str, upload_data: Dict) -> str:
+        """One upload session, resumed from saved state when there is one"""
+        auth = {"Authorization": f"Bearer {self.api_key}"}
+        session = UploadSession(self.output_dir, "youtube", audio_path)
+
+        with FileChunks(audio_path) as chunks:
+            total = chunks.size
+            if session.resumed:
+                print(f"  Resuming YouTube upload at {session.offset}/{total} bytes")
+            else:
+                response = requests.post(
+                    UPLOAD_URL,
+                    params={"uploadType": "resumable", "part": "snippet,status"},
+                    headers={
+                        **auth,
+                        "X-Upload-Content-Length": str(total),
+                        "X-Upload-Content-Type": mimetypes.guess_type(audio_path)[0] or "application/octet-stream"
+                    },
+                    json={
+                        "snippet": {
+                            "title": upload_data["title"],
+                            "description": upload_data["description"],
+                            "categoryId": "10"  # Music
+                        },
+                        "status": {"privacyStatus": upload_data["visibility"]}
+                    },
+                    timeout=REQUEST_TIMEOUT
+                )
+                response.raise_for_status()
+                session.url = response.headers["Location"]
+                session.save()
+
+            def send_chunk(start: int, data: memoryview, total: int) -> int:
+                response = requests.put(
+                    session.url,
+                    data=data,
+                    headers={**auth, "Content-Range": f"bytes {start}-{start + len(data) - 1}/{total}"},
+                    timeout=REQUEST_TIMEOUT
+                )
+                return self._received(response, session, total)
+
+            def resync() -> int:
+                response = requests.put(
+                    session.url,
+                    headers={**auth, "Content-Range": f"bytes */{total}"},
+                    timeout=REQUEST_TIMEOUT
+                )
+                return self._received(response, session, total)
+
+            upload_chunks(chunks, session, send_chunk, resync=resync)
+
+        session.finish()
+        return session.data["video_id"]
+
+    @staticmethod
+    def _received(response: requests.Response, session: UploadSession, total: int) -> int:
+        """Bytes YouTube holds after a chunk or status request"""
+        if response.status_code in (200, 201):
+            session.data["video_id"] = response.json()["id"]
+            return total
+        if response.status_code == 308:
+            # "Range: bytes=0-<last>", absent when nothing has arrived yet
+            received = response.headers.get("Range")
+            return int(received.rsplit("-", 1)[1]) + 1 if received else 0
+        response.raise_for_status()
+        raise requests.HTTPError(f"Unexpected upload response {response.status_code}", response=response)
+
     def _save_upload_data(self, data: Dict) -> str:
         """Save upload data"""
         import time
 
         upload_id = f"youtube_{int(time.time())}"
-        output_dir = "youtube_uploads"
-        os.makedirs(output_dir, exist_ok=True)
+        os.makedirs(self.output_dir, exist_ok=True)
 
-        filepath = os.path.join(output_dir, f"{upload_id}.json")
+        filepath = os.path.join(self.output_dir, f"{upload_id}.json")
 
         with open(filepath, 'w') as f:
             json.dump(data, f, indent=2)
@@ -4,6 +4,7 @@ Creates final timeline from individual song sections
 """
 
 import os
+import sys
 from typing import List, Optional
 
 try:
@@ -13,6 +14,10 @@ except ImportError:
     PYDUB_AVAILABLE = False
     print("Warning: pydub not available, arrangement will be limited")
 
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+
+from dsp.timeline import Timeline
+
 
 def crossfade(a: AudioSegment, b: AudioSegment, ms: int = 4000) -> AudioSegment:
     """
@@ -32,24 +37,27 @@ def crossfade(a: AudioSegment, b: AudioSegment, ms: int = 4000) -> AudioSegment:
 def arrange(
     section_files: List[str],
     out_path: str,
-    crossfade_ms: int = 4000
+    crossfade_ms: int = 4000,
+    fade_in_ms: int = 0,
+    fade_out_ms: int = 0
 ) -> str:
     """
     Arrange song sections into final timeline
 
+    The song length is computed from the section headers and the song
+    is rendered into a single buffer, with equal-power crossfades.
+
     Args:
         section_files: List of paths to section WAV files
         out_path: Output path for arranged song
         crossfade_ms: Crossfade duration between sections
+        fade_in_ms: Fade in at the start of the song
+        fade_out_ms: Fade out at the end of the song
 
     Returns:
         Path to final arranged WAV
     """
-    if not PYDUB_AVAILABLE:
-        print("Error: pydub not available for arrangement")
-        return ""
-
-    song = None
+    timeline = Timeline()
 
     print(f"Arranging {len(section_files)} sections...")
 
@@ -58,21 +66,18 @@ def arrange(
             print(f"Warning: Section file not found: {path}")
             continue
 
-        audio = AudioSegment.from_wav(path)
-
-        if song is None:
-            song = audio
-        else:
-            song = crossfade(song, audio, crossfade_ms)
+        timeline.append(path, crossfade_ms)
 
         print(f"  Added section {i+1}/{len(section_files)}: {os.path.basename(path)}")
 
-    if song is None:
+    if not timeline.clips:
         print("Error: No valid audio sections found")
         return ""
 
+    timeline.apply_fade(fade_in_ms, fade_out_ms)
+
     # Export final arrangement
-    song.export(out_path, format="wav")
+    timeline.export(out_path)
     print(f"✓ Arranged song saved: {out_path}")
 
     return out_path
@@ -113,13 +118,16 @@ def add_silence(audio: AudioSegment, duration_ms: int, position: str = "end") ->
     Add silence to audio segment
 
     Args:
-        audio: Audio segment
+        audio: Audio segment, or a Timeline (recorded as a timeline op)
         duration_ms: Silence duration in milliseconds
         position: "start" or "end"
 
     Returns:
         Audio with added silence
     """
+    if isinstance(audio, Timeline):
+        return audio.add_silence(duration_ms, position)
+
     if not PYDUB_AVAILABLE:
         return audio
 
@@ -140,13 +148,16 @@ def apply_fade(
     Apply fade in/out to audio segment
 
     Args:
-        audio: Audio segment
+        audio: Audio segment, or a Timeline (recorded as a timeline op)
         fade_in_ms: Fade in duration
         fade_out_ms: Fade out duration
 
     Returns:
         Audio with fades applied
     """
+    if isinstance(audio, Timeline):
+        return audio.apply_fade(fade_in_ms, fade_out_ms)
+
     if not PYDUB_AVAILABLE:
         return audio
 
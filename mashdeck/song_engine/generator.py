@@ -33,11 +33,39 @@ def bars_to_seconds(bars: int, bpm: int) -> float:
     return (60 / bpm) * 4 * bars
 
 
+def section_prompt(section: Dict, plan: Dict) -> str:
+    """Text prompt for a section (energy is described in coarse bands)"""
+    energy = section["energy"]
+
+    energy_descriptors = {
+        (0.0, 0.3): "minimal, sparse, atmospheric",
+        (0.3, 0.5): "gentle, smooth, flowing",
+        (0.5, 0.7): "driving, energetic, engaging",
+        (0.7, 0.9): "powerful, intense, dynamic",
+        (0.9, 1.1): "explosive, maximum energy, peak intensity"
+    }
+
+    energy_desc = "moderate"
+    for (low, high), desc in energy_descriptors.items():
+        if low <= energy < high:
+            energy_desc = desc
+            break
+
+    prompt = (
+        f"{plan['style']} music, {section['section']} section, "
+        f"{energy_desc}, {plan['bpm']} bpm, "
+        f"key {plan['key']}, instrumental"
+    )
+
+    return prompt
+
+
 def generate_section(
     section: Dict,
     plan: Dict,
     out_dir: str,
-    model_name: str = "facebook/musicgen-medium"
+    model_name: str = "facebook/musicgen-medium",
+    name: Optional[str] = None
 ) -> str:
     """
     Generate a single song section using MusicGen
@@ -47,6 +75,7 @@ def generate_section(
         plan: Full song plan with 'style', 'bpm', 'key'
         out_dir: Output directory for WAV file
         model_name: MusicGen model to use
+        name: File name without extension (default: the section name)
 
     Returns:
         Path to generated WAV file
@@ -55,33 +84,14 @@ def generate_section(
 
     # Calculate duration
     seconds = math.ceil(bars_to_seconds(section["bars"], plan["bpm"]))
-    energy = section["energy"]
 
     # Build descriptive prompt for this section
-    energy_descriptors = {
-        (0.0, 0.3): "minimal, sparse, atmospheric",
-        (0.3, 0.5): "gentle, smooth, flowing",
-        (0.5, 0.7): "driving, energetic, engaging",
-        (0.7, 0.9): "powerful, intense, dynamic",
-        (0.9, 1.1): "explosive, maximum energy, peak intensity"
-    }
-
-    energy_desc = "moderate"
-    for (low, high), desc in energy_descriptors.items():
-        if low <= energy < high:
-            energy_desc = desc
-            break
-
-    prompt = (
-        f"{plan['style']} music, {section['section']} section, "
-        f"{energy_desc}, {plan['bpm']} bpm, "
-        f"key {plan['key']}, instrumental"
-    )
+    prompt = section_prompt(section, plan)
 
     print(f"Generating {section['section']}: {prompt}")
 
     # Generate audio
-    path = f"{out_dir}/{section['section']}.wav"
+    path = f"{out_dir}/{name or section['section']}.wav"
 
     if MUSICGEN_AVAILABLE:
         try:
@@ -1,79 +1,164 @@
 """
 Mastering Engine - Auto-mastering for broadcast-ready output
 Handles normalization, limiting, and basic EQ
+
+The level-independent part of the chain (EQ, compression, loudness and
+true-peak measurement) runs once per song in analyze_master; each
+loudness target is then just a gain plus the look-ahead limiter.
 """
 
 import os
+import sys
+from dataclasses import dataclass
+from typing import Optional
 
-try:
-    from pydub import AudioSegment
-    from pydub.effects import normalize, compress_dynamic_range
-    PYDUB_AVAILABLE = True
-except ImportError:
-    PYDUB_AVAILABLE = False
-    print("Warning: pydub not available, mastering will be skipped")
+import numpy as np
+import soundfile as sf
+from scipy import signal
 
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
 
-def master(
+from dsp.loudness import integrated_loudness, true_peak_envelope
+from dsp.dynamics import compress, limit
+from dsp.resample import resample
+
+
+# True-peak ceiling for every master
+CEILING_DBTP = -1.0
+
+
+@dataclass
+class MasterAnalysis:
+    """Pre-limiter audio plus its measurements, shared across loudness targets"""
+    audio: np.ndarray        # (frames, channels)
+    sample_rate: int
+    subtype: str
+    loudness: float          # Integrated LUFS
+    peaks: np.ndarray        # Per-frame true peak envelope
+
+
+def analyze_master(
     input_wav: str,
-    output_wav: str,
-    target_lufs: float = -14.0,
     normalize_peaks: bool = True,
-    high_pass_hz: int = 30
-) -> str:
+    high_pass_hz: int = 30,
+    sample_rate: Optional[int] = None
+) -> MasterAnalysis:
     """
-    Auto-master audio for streaming/broadcast
+    Run the level-independent mastering stages and measure the result
 
     Args:
         input_wav: Input WAV file path
-        output_wav: Output WAV file path
-        target_lufs: Target loudness (streaming standard is -14 LUFS)
-        normalize_peaks: Apply peak normalization
+        normalize_peaks: Apply peak normalization before compression
         high_pass_hz: High-pass filter frequency
+        sample_rate: Delivery rate (None keeps the input's)
 
     Returns:
-        Path to mastered file
+        MasterAnalysis ready for render_master
     """
-    if not PYDUB_AVAILABLE:
-        print("Warning: Mastering skipped (pydub not available)")
-        # Just copy file
-        import shutil
-        shutil.copy(input_wav, output_wav)
-        return output_wav
-
     print(f"Mastering: {input_wav}")
 
     # Load audio
-    audio = AudioSegment.from_wav(input_wav)
+    audio, source_rate = sf.read(input_wav, dtype="float64", always_2d=True)
+    subtype = sf.info(input_wav).subtype
+
+    # Convert first, so loudness and true peaks are measured at delivery rate
+    sample_rate = sample_rate or source_rate
+    if sample_rate != source_rate:
+        audio = resample(audio, source_rate, sample_rate)
+        print(f"  ✓ Resampled {source_rate}Hz -> {sample_rate}Hz")
 
     # High-pass filter (remove sub-bass rumble)
     if high_pass_hz > 0:
-        audio = audio.high_pass_filter(high_pass_hz)
+        sos = signal.butter(2, high_pass_hz, btype="high", fs=sample_rate, output="sos")
+        audio = signal.sosfilt(sos, audio, axis=0)
         print(f"  ✓ High-pass filter: {high_pass_hz}Hz")
 
-    # Peak normalization
+    # Peak normalization to -1 dBFS, so the compressor threshold is relative
     if normalize_peaks:
-        audio = normalize(audio, headroom=1.0)
+        peak = np.abs(audio).max() if len(audio) else 0.0
+        if peak > 0:
+            audio *= 10 ** (-1.0 / 20) / peak
         print("  ✓ Peak normalization")
 
     # Dynamic range compression (gentle)
     # This helps even out the loudness
-    audio = compress_dynamic_range(audio, threshold=-20.0, ratio=2.0)
+    compress(audio, sample_rate, threshold_db=-20.0, ratio=2.0)
     print("  ✓ Dynamic compression")
 
-    # Final normalization to target level
-    # Note: Proper LUFS metering requires additional library (pyloudnorm)
-    # For now, we use peak normalization as proxy
-    audio = normalize(audio, headroom=0.5)
-    print("  ✓ Final normalization")
+    loudness = integrated_loudness(audio, sample_rate)
+    print(f"  ✓ Integrated loudness: {loudness:.1f} LUFS")
+
+    return MasterAnalysis(
+        audio=audio,
+        sample_rate=sample_rate,
+        subtype=subtype,
+        loudness=loudness,
+        peaks=true_peak_envelope(audio)
+    )
+
+
+def render_master(
+    analysis: MasterAnalysis,
+    output_wav: str,
+    target_lufs: float = -14.0,
+    ceiling_dbtp: float = CEILING_DBTP
+) -> str:
+    """
+    Gain an analysed song to a loudness target and limit its true peaks
+
+    Args:
+        analysis: Result of analyze_master
+        output_wav: Output WAV file path
+        target_lufs: Target integrated loudness
+        ceiling_dbtp: True-peak ceiling
+
+    Returns:
+        Path to mastered file
+    """
+    gain_db = target_lufs - analysis.loudness if np.isfinite(analysis.loudness) else 0.0
+
+    audio = limit(
+        analysis.audio,
+        analysis.sample_rate,
+        ceiling_db=ceiling_dbtp,
+        gain=10 ** (gain_db / 20),
+        peaks=analysis.peaks
+    )
+    print(f"  ✓ Gain {gain_db:+.1f} dB to {target_lufs} LUFS, limited at {ceiling_dbtp} dBTP")
 
     # Export
-    audio.export(output_wav, format="wav")
+    sf.write(output_wav, audio, analysis.sample_rate, subtype=analysis.subtype)
     print(f"✓ Mastered audio saved: {output_wav}")
 
     return output_wav
 
 
+def master(
+    input_wav: str,
+    output_wav: str,
+    target_lufs: float = -14.0,
+    normalize_peaks: bool = True,
+    high_pass_hz: int = 30,
+    sample_rate: Optional[int] = None
+) -> str:
+    """
+    Auto-master audio for streaming/broadcast
+
+    Args:
+        input_wav: Input WAV file path
+        output_wav: Output WAV file path
+        target_lufs: Target loudness (streaming standard is -14 LUFS)
+        normalize_peaks: Apply peak normalization
+        high_pass_hz: High-pass filter frequency
+        sample_rate: Delivery rate (None keeps the input's)
+
+    Returns:
+        Path to mastered file
+    """
+    analysis = analyze_master(input_wav, normalize_peaks, high_pass_hz, sample_rate)
+    return render_master(analysis, output_wav, target_lufs)
+
+
 def create_stems_master(
     stem_files: dict,
     output_dir: str
@@ -107,6 +192,9 @@ def create_loudness_variants(
     """
     Create multiple loudness variants for different platforms
 
+    The song is analysed once; each variant only re-applies gain and
+    the limiter.
+
     Args:
         input_wav: Input audio file
         output_dir: Output directory
@@ -124,11 +212,12 @@ def create_loudness_variants(
         "broadcast": -16.0     # Radio/podcast
     }
 
+    analysis = analyze_master(input_wav)
     outputs = {}
 
     for platform, target_lufs in variants.items():
         output_path = os.path.join(output_dir, f"master_{platform}.wav")
-        master(input_wav, output_path, target_lufs=target_lufs)
+        render_master(analysis, output_path, target_lufs=target_lufs)
         outputs[platform] = output_path
 
     return outputs
@@ -5,48 +5,41 @@ Combines planning, generation, arrangement, and mastering
 
 import json
 import os
+import sys
+import threading
+from collections import Counter
+from concurrent.futures import ThreadPoolExecutor
 from typing import Dict, List, Optional
 
+import numpy as np
+from scipy import signal
+
 from .planner import plan_song, export_song_plan
-from .generator import generate_section
+from .generator import generate_section, section_prompt, bars_to_seconds
 from .arranger import arrange
 from .master import master, create_loudness_variants
 
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..', 'music-engine'))
+from shared.tracing import span, bind, trace_spans, export_spans
 
-def generate_full_song(
-    style: str = "edm",
-    bpm: Optional[int] = None,
-    key: Optional[str] = None,
-    title: Optional[str] = None,
-    out_dir: str = "output",
-    create_variants: bool = False
-) -> Dict[str, str]:
-    """
-    Generate a complete full-length song from scratch
 
-    Args:
-        style: Music style (edm, lofi, trap, hiphop, ambient, rock)
-        bpm: BPM (auto-selected if None)
-        key: Musical key (auto-selected if None)
-        title: Song title (auto-generated if None)
-        out_dir: Output directory
-        create_variants: Create platform-specific loudness variants
+# Working memory per second of song during arrangement and mastering:
+# float64 frames at 32 kHz times the buffers alive at once
+POST_BYTES_PER_SECOND = 32000 * 8 * 8
+
+# Distinct sections generated at once (each call holds a MusicGen instance)
+DEFAULT_GPU_SLOTS = 2
 
-    Returns:
-        Dict with paths to generated files
-    """
-    print("=" * 60)
-    print("MashDeck Full Song Generation Pipeline")
-    print("=" * 60)
 
-    # Create output directories
+def _plan(style, bpm, key, title, out_dir) -> Dict:
+    """Step 1: plan the song and create its output directories"""
     os.makedirs(out_dir, exist_ok=True)
     sections_dir = os.path.join(out_dir, "sections")
     os.makedirs(sections_dir, exist_ok=True)
 
-    # Step 1: Plan the song
     print("\n[1/5] Planning song structure...")
-    plan = plan_song(style=style, bpm=bpm, key=key, title=title)
+    with span("song.plan", style=style):
+        plan = plan_song(style=style, bpm=bpm, key=key, title=title)
 
     print(f"  Title: {plan['title']}")
     print(f"  Style: {plan['style']}")
@@ -58,46 +51,134 @@ def generate_full_song(
     plan_path = os.path.join(out_dir, "song_plan.json")
     export_song_plan(plan, plan_path)
 
-    # Step 2: Generate sections
+    return {
+        "plan": plan,
+        "plan_path": plan_path,
+        "out_dir": out_dir,
+        "sections_dir": sections_dir
+    }
+
+
+def section_key(section: Dict, plan: Dict) -> tuple:
+    """
+    Sections with equal keys render identical audio: same prompt (which
+    bands energy coarsely), same length and same seed
+    """
+    return (section_prompt(section, plan), section["bars"], plan["bpm"], plan.get("seed"))
+
+
+def vary_section(path: str, repeat: int, energy_delta: float = 0.0) -> str:
+    """
+    Cheap DSP variant of a rendered section for its repeat-th reuse
+
+    Applies the energy difference from the rendered occurrence as gain
+    (6 dB per unit of energy) and alternates a ±1 dB high shelf above
+    ~2 kHz so repeats don't sound copy-pasted.
+    """
+    import soundfile as sf
+
+    audio, sample_rate = sf.read(path)
+    direction = 1 if repeat % 2 else -1
+
+    pole = np.exp(-2 * np.pi * 2000 / sample_rate)
+    low = signal.lfilter([1 - pole], [1, -pole], audio, axis=0)
+    shelf = 10 ** (direction / 20) - 1
+    varied = (audio + shelf * (audio - low)) * 10 ** (6.0 * energy_delta / 20)
+
+    root, ext = os.path.splitext(path)
+    varied_path = f"{root}_v{repeat}{ext}"
+    sf.write(varied_path, np.clip(varied, -1.0, 1.0), sample_rate)
+    return varied_path
+
+
+def _generate_sections(
+    song: Dict,
+    gpu_slots: int = DEFAULT_GPU_SLOTS,
+    vary_repeats: bool = False
+) -> Dict:
+    """
+    Step 2: generate every section (the GPU stage)
+
+    Repeated sections (same section_key) are rendered once and reused, so
+    generation time scales with unique sections. Distinct sections are
+    generated concurrently on up to gpu_slots threads.
+    """
+    plan = song["plan"]
+    structure = plan["structure"]
+
     print("\n[2/5] Generating song sections...")
-    section_files = []
 
-    for i, section in enumerate(plan["structure"]):
-        print(f"  Section {i+1}/{len(plan['structure'])}: {section['section']} "
+    # First occurrence of each distinct section
+    unique = {}
+    for i, section in enumerate(structure):
+        unique.setdefault(section_key(section, plan), i)
+    print(f"  {len(unique)} unique of {len(structure)} sections")
+
+    def render(i):
+        section = structure[i]
+        print(f"  Section {i+1}/{len(structure)}: {section['section']} "
               f"({section['bars']} bars, energy={section['energy']})")
+        with span("song.section", section=section["section"], bars=section["bars"]):
+            return generate_section(section, plan, song["sections_dir"], name=f"{i+1:02d}_{section['section']}")
 
-        path = generate_section(section, plan, sections_dir)
+    with ThreadPoolExecutor(max_workers=max(1, gpu_slots)) as pool:
+        rendered = dict(zip(unique, pool.map(bind(render), unique.values())))
+
+    section_files = []
+    uses = Counter()
+
+    for section in structure:
+        key = section_key(section, plan)
+        path = rendered[key]
+        if uses[key] and vary_repeats:
+            energy_delta = section["energy"] - structure[unique[key]]["energy"]
+            path = vary_section(path, uses[key], energy_delta)
+        uses[key] += 1
         section_files.append(path)
 
+    song["section_files"] = section_files
+    song["unique_sections"] = len(unique)
+    return song
+
+
+def _finish_song(song: Dict, create_variants: bool, sample_rate: Optional[int] = None) -> Dict[str, str]:
+    """Steps 3-5: arrange, master and export (the CPU stage)"""
+    plan = song["plan"]
+    out_dir = song["out_dir"]
+
     # Step 3: Arrange sections
     print("\n[3/5] Arranging sections with crossfades...")
     raw_path = os.path.join(out_dir, "song_raw.wav")
-    arranged_path = arrange(section_files, raw_path, crossfade_ms=4000)
+    with span("song.arrange", sections=len(song["section_files"])):
+        arranged_path = arrange(song["section_files"], raw_path, crossfade_ms=4000)
 
     # Step 4: Master the track
     print("\n[4/5] Mastering...")
     final_path = os.path.join(out_dir, "song_final.wav")
-    master(arranged_path, final_path)
+    with span("song.master"):
+        master(arranged_path, final_path, sample_rate=sample_rate)
 
     # Step 5: Create variants (optional)
     variant_paths = {}
     if create_variants:
         print("\n[5/5] Creating platform variants...")
         variants_dir = os.path.join(out_dir, "variants")
-        variant_paths = create_loudness_variants(final_path, variants_dir)
+        with span("song.variants"):
+            variant_paths = create_loudness_variants(final_path, variants_dir)
 
     # Prepare output
     output = {
         "song_final": final_path,
         "song_raw": arranged_path,
-        "song_plan": plan_path,
-        "sections_dir": sections_dir,
+        "song_plan": song["plan_path"],
+        "sections_dir": song["sections_dir"],
         "metadata": {
             "title": plan["title"],
             "style": plan["style"],
             "bpm": plan["bpm"],
             "key": plan["key"],
-            "sections": len(plan["structure"])
+            "sections": len(plan["structure"]),
+            "unique_sections": song["unique_sections"]
         }
     }
 
@@ -119,18 +200,115 @@ def generate_full_song(
     return output
 
 
+def generate_full_song(
+    style: str = "edm",
+    bpm: Optional[int] = None,
+    key: Optional[str] = None,
+    title: Optional[str] = None,
+    out_dir: str = "output",
+    create_variants: bool = False,
+    gpu_slots: int = DEFAULT_GPU_SLOTS,
+    vary_repeats: bool = False,
+    sample_rate: Optional[int] = None
+) -> Dict[str, str]:
+    """
+    Generate a complete full-length song from scratch
+
+    Args:
+        style: Music style (edm, lofi, trap, hiphop, ambient, rock)
+        bpm: BPM (auto-selected if None)
+        key: Musical key (auto-selected if None)
+        title: Song title (auto-generated if None)
+        out_dir: Output directory
+        create_variants: Create platform-specific loudness variants
+        gpu_slots: Distinct sections generated concurrently
+        vary_repeats: Apply light DSP variation to repeated sections
+        sample_rate: Delivery rate of the master (None keeps the generation rate)
+
+    Returns:
+        Dict with paths to generated files
+    """
+    print("=" * 60)
+    print("MashDeck Full Song Generation Pipeline")
+    print("=" * 60)
+
+    root = span("song", style=style)
+    try:
+        with root:
+            song = _plan(style, bpm, key, title, out_dir)
+            _generate_sections(song, gpu_slots, vary_repeats)
+            return _finish_song(song, create_variants, sample_rate)
+    finally:
+        export_spans(f"song-{os.path.basename(os.path.abspath(out_dir))}", trace_spans(root.trace_id), "mashdeck")
+
+
+def estimate_post_bytes(plan: Dict) -> int:
+    """Estimated peak memory to arrange and master a planned song"""
+    seconds = sum(bars_to_seconds(section["bars"], plan["bpm"]) for section in plan["structure"])
+    return int(seconds * POST_BYTES_PER_SECOND)
+
+
+class MemoryBudget:
+    """Admits work only while the in-flight byte estimate fits the budget"""
+
+    def __init__(self, limit_bytes: int):
+        self.limit = limit_bytes
+        self.used = 0
+        self.condition = threading.Condition()
+
+    def acquire(self, size: int):
+        with self.condition:
+            # Always admit into an empty budget, so one large song cannot stall
+            self.condition.wait_for(lambda: self.used == 0 or self.used + size <= self.limit)
+            self.used += size
+
+    def release(self, size: int):
+        with self.condition:
+            self.used -= size
+            self.condition.notify_all()
+
+
+class StageDepths:
+    """Thread-safe per-stage song counts for batch progress reporting"""
+
+    STAGES = ("generating", "waiting", "post_processing", "done")
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.counts = {stage: 0 for stage in self.STAGES}
+
+    def move(self, from_stage: Optional[str], to_stage: str):
+        with self.lock:
+            if from_stage:
+                self.counts[from_stage] -= 1
+            self.counts[to_stage] += 1
+            depths = " ".join(f"{stage}={self.counts[stage]}" for stage in self.STAGES)
+        print(f"[batch] {depths}")
+
+
 def generate_song_batch(
     count: int = 5,
     style: Optional[str] = None,
-    base_dir: str = "batch_output"
+    base_dir: str = "batch_output",
+    post_workers: int = 2,
+    memory_budget_mb: int = 2048,
+    sample_rate: Optional[int] = None
 ) -> List[Dict]:
     """
     Generate multiple songs in batch
 
+    Section generation for song i+1 runs while earlier songs are
+    arranged and mastered on a worker pool. A generated song waits for
+    post-processing until its estimated memory fits the budget, which
+    also holds back further generation.
+
     Args:
         count: Number of songs to generate
         style: Style (random if None)
         base_dir: Base output directory
+        post_workers: Songs arranged/mastered concurrently
+        memory_budget_mb: Memory budget for songs in post-processing
+        sample_rate: Delivery rate of each master (None keeps the generation rate)
 
     Returns:
         List of output dicts from each generation
@@ -139,22 +317,38 @@ def generate_song_batch(
 
     styles = ["edm", "lofi", "trap", "hiphop", "ambient", "rock"]
 
-    outputs = []
+    budget = MemoryBudget(memory_budget_mb * 1024 * 1024)
+    depths = StageDepths()
+
+    def finish(song, size):
+        try:
+            return _finish_song(song, create_variants=False, sample_rate=sample_rate)
+        finally:
+            depths.move("post_processing", "done")
+            budget.release(size)
+
+    futures = []
+
+    with ThreadPoolExecutor(max_workers=post_workers) as pool:
+        for i in range(count):
+            selected_style = style or random.choice(styles)
+            song_dir = os.path.join(base_dir, f"song_{i+1:02d}")
+
+            print(f"\n{'=' * 60}")
+            print(f"Generating Song {i+1}/{count}")
+            print(f"{'=' * 60}\n")
 
-    for i in range(count):
-        selected_style = style or random.choice(styles)
-        song_dir = os.path.join(base_dir, f"song_{i+1:02d}")
+            depths.move(None, "generating")
+            song = _generate_sections(_plan(selected_style, None, None, None, song_dir))
 
-        print(f"\n{'=' * 60}")
-        print(f"Generating Song {i+1}/{count}")
-        print(f"{'=' * 60}\n")
+            depths.move("generating", "waiting")
+            size = estimate_post_bytes(song["plan"])
+            budget.acquire(size)
 
-        output = generate_full_song(
-            style=selected_style,
-            out_dir=song_dir
-        )
+            depths.move("waiting", "post_processing")
+            futures.append(pool.submit(finish, song, size))
 
-        outputs.append(output)
+        outputs = [future.result() for future in futures]
 
     return outputs
 
@@ -4,6 +4,7 @@ Auto-generates harmonies, doubles, and stacked vocals
 """
 
 import os
+import sys
 import random
 from typing import List, Optional
 
@@ -14,6 +15,13 @@ except ImportError:
     PYDUB_AVAILABLE = False
     print("Warning: pydub not available, harmony features limited")
 
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '../..'))
+
+from dsp.buffers import segment_to_array, array_to_segment
+from dsp.pitch import pitch_shift_samples
+from dsp.bus import Voice, render_bus
+from dsp.resample import resample
+
 
 # Harmony interval rules (music theory-based)
 HARMONY_INTERVALS = {
@@ -44,9 +52,9 @@ def get_harmony_intervals(key: str, intensity: str = "medium") -> List[int]:
         return intervals[:2]  # 3rd and 5th
 
 
-def pitch_shift(audio: AudioSegment, semitones: int) -> AudioSegment:
+def pitch_shift(audio: AudioSegment, semitones: float) -> AudioSegment:
     """
-    Pitch shift audio by semitones
+    Pitch shift audio by semitones, preserving duration
 
     Args:
         audio: Input audio
@@ -55,23 +63,93 @@ def pitch_shift(audio: AudioSegment, semitones: int) -> AudioSegment:
     Returns:
         Pitch-shifted audio
     """
+    return pitch_shift_many(audio, [semitones])[0]
+
+
+def pitch_shift_many(audio: AudioSegment, semitones: List[float]) -> List[AudioSegment]:
+    """
+    Pitch shift audio to several offsets with a single analysis pass
+
+    Args:
+        audio: Input audio
+        semitones: Semitone offsets (fractional values detune)
+
+    Returns:
+        One pitch-shifted segment per offset, all the input's duration
+    """
     if not PYDUB_AVAILABLE:
-        return audio
+        return [audio for _ in semitones]
+
+    shifted = pitch_shift_samples(segment_to_array(audio), semitones)
+    return [array_to_segment(samples, audio) for samples in shifted]
 
-    # Calculate new frame rate
-    new_frame_rate = int(audio.frame_rate * (2 ** (semitones / 12)))
 
-    # Pitch shift by changing frame rate then resampling
-    shifted = audio._spawn(
-        audio.raw_data,
-        overrides={"frame_rate": new_frame_rate}
-    ).set_frame_rate(audio.frame_rate)
+def _as_segment(audio) -> "AudioSegment":
+    """Load a WAV path, or pass an in-memory AudioSegment through"""
+    return AudioSegment.from_wav(audio) if isinstance(audio, str) else audio
+
+
+def harmony_parts(lead: AudioSegment, intervals: List[int]) -> List[AudioSegment]:
+    """Harmony segments at each interval, 6 dB under the lead"""
+    # Pitch shift for all harmonies from one analysis of the lead
+    return [harmony.apply_gain(-6) for harmony in pitch_shift_many(lead, intervals)]
+
+
+def double_part(lead: AudioSegment, detune_cents: float = 10.0) -> AudioSegment:
+    """Backing double: slightly detuned and 9 dB under the lead"""
+    # Slight detune for width
+    detune_semitones = random.choice([-detune_cents, detune_cents]) / 100.0
+    return pitch_shift(lead, detune_semitones).apply_gain(-9)
+
+
+def chant_part(
+    lead: AudioSegment,
+    count: int = 4,
+    spread_ms: int = 20,
+    detune_cents: float = 0.0
+) -> AudioSegment:
+    """Stacked chant: count offset (and optionally detuned) layers"""
+    samples = segment_to_array(lead)
+    spread = int(spread_ms * lead.frame_rate / 1000)
+
+    if detune_cents and count > 1:
+        detunes = [-detune_cents + 2 * detune_cents * i / (count - 1) for i in range(count)]
+    else:
+        detunes = [0.0] * count
+
+    # Base layer plus count - 1 slightly offset layers
+    offsets = [0] + [i * spread for i in range(count - 1)]
+
+    # Reduce volume per layer
+    voices = [
+        Voice(samples, offset=offset, gain_db=-10, detune_cents=detune)
+        for offset, detune in zip(offsets, detunes)
+    ]
+    return array_to_segment(render_bus(voices, length=len(samples)), lead)
+
+
+def mix_parts(segments: List[AudioSegment], pan_tracks: bool = True) -> AudioSegment:
+    """Mix segments into one bus for the length of the first"""
+    # Render at the highest frame rate and sample width among the tracks
+    frame_rate = max(segment.frame_rate for segment in segments)
+    like = max(segments, key=lambda segment: segment.sample_width)
+
+    # Pan alternating tracks
+    voices = [
+        Voice(
+            resample(segment_to_array(segment), segment.frame_rate, frame_rate),
+            pan=(-0.5 if i % 2 == 0 else 0.5) if pan_tracks else None
+        )
+        for i, segment in enumerate(segments)
+    ]
 
-    return shifted
+    # Bus runs for the length of the first track, as overlay did
+    bus = render_bus(voices, length=len(voices[0].samples))
+    return array_to_segment(bus, like, frame_rate=frame_rate)
 
 
 def generate_harmonies(
-    lead_wav: str,
+    lead_wav,
     intervals: List[int],
     out_dir: str,
     base_name: str
@@ -80,7 +158,7 @@ def generate_harmonies(
     Generate harmony parts from lead vocal
 
     Args:
-        lead_wav: Lead vocal WAV file
+        lead_wav: Lead vocal WAV path or AudioSegment
         intervals: List of semitone intervals
         out_dir: Output directory
         base_name: Base filename
@@ -94,16 +172,9 @@ def generate_harmonies(
 
     os.makedirs(out_dir, exist_ok=True)
 
-    lead = AudioSegment.from_wav(lead_wav)
     outputs = []
 
-    for i, semitone in enumerate(intervals):
-        # Pitch shift for harmony
-        harmony = pitch_shift(lead, semitone)
-
-        # Reduce volume slightly
-        harmony = harmony.apply_gain(-6)
-
+    for i, (semitone, harmony) in enumerate(zip(intervals, harmony_parts(_as_segment(lead_wav), intervals))):
         # Export
         path = os.path.join(out_dir, f"{base_name}_harmony_{i+1}.wav")
         harmony.export(path, format="wav")
@@ -135,16 +206,7 @@ def backing_double(
         shutil.copy(lead_wav, out_path)
         return out_path
 
-    audio = AudioSegment.from_wav(lead_wav)
-
-    # Slight detune for width
-    detune_semitones = random.choice([-detune_cents, detune_cents]) / 100.0
-    shifted = pitch_shift(audio, detune_semitones)
-
-    # Reduce volume
-    shifted = shifted.apply_gain(-9)
-
-    shifted.export(out_path, format="wav")
+    double_part(_as_segment(lead_wav), detune_cents).export(out_path, format="wav")
     print(f"  ✓ Generated backing double: {out_path}")
 
     return out_path
@@ -154,7 +216,8 @@ def chant_stack(
     lead_wav: str,
     out_path: str,
     count: int = 4,
-    spread_ms: int = 20
+    spread_ms: int = 20,
+    detune_cents: float = 0.0
 ) -> str:
     """
     Create stacked chant effect (EDM-style)
@@ -164,6 +227,7 @@ def chant_stack(
         out_path: Output path
         count: Number of layers
         spread_ms: Timing spread between layers
+        detune_cents: Spread layers' pitch evenly across +/- this amount
 
     Returns:
         Path to stacked chant
@@ -173,16 +237,7 @@ def chant_stack(
         shutil.copy(lead_wav, out_path)
         return out_path
 
-    lead = AudioSegment.from_wav(lead_wav)
-    lead = lead.apply_gain(-10)  # Reduce volume per layer
-
-    stack = lead
-
-    for i in range(count - 1):
-        # Slightly offset each layer
-        stack = stack.overlay(lead, position=i * spread_ms)
-
-    stack.export(out_path, format="wav")
+    chant_part(_as_segment(lead_wav), count, spread_ms, detune_cents).export(out_path, format="wav")
     print(f"  ✓ Generated chant stack: {out_path}")
 
     return out_path
@@ -207,36 +262,23 @@ def mix_vocal_bus(
     if not PYDUB_AVAILABLE or not tracks:
         return ""
 
-    bus = None
-
-    for i, track_path in enumerate(tracks):
-        if not os.path.exists(track_path):
-            continue
+    segments = [
+        AudioSegment.from_wav(track_path)
+        for track_path in tracks
+        if os.path.exists(track_path)
+    ]
 
-        audio = AudioSegment.from_wav(track_path)
-
-        # Pan alternating tracks
-        if pan_tracks:
-            pan_value = -0.5 if i % 2 == 0 else 0.5
-            audio = audio.pan(pan_value)
-
-        # Mix
-        if bus is None:
-            bus = audio
-        else:
-            bus = bus.overlay(audio)
-
-    if bus is None:
+    if not segments:
         return ""
 
-    bus.export(out_path, format="wav")
+    mix_parts(segments, pan_tracks).export(out_path, format="wav")
     print(f"✓ Mixed vocal bus: {out_path}")
 
     return out_path
 
 
 def enhance_vocals(
-    lead_vocal: str,
+    lead_vocal,
     key: str,
     section: str,
     out_dir: str
@@ -244,8 +286,10 @@ def enhance_vocals(
     """
     Full vocal enhancement: harmonies + backing + mix
 
+    Every part is built in memory from the lead; only the bus is written.
+
     Args:
-        lead_vocal: Lead vocal path
+        lead_vocal: Lead vocal WAV path or AudioSegment
         key: Musical key
         section: Section name
         out_dir: Output directory
@@ -254,8 +298,14 @@ def enhance_vocals(
         Path to enhanced vocal bus
     """
     os.makedirs(out_dir, exist_ok=True)
+    bus_path = os.path.join(out_dir, f"{section}_vocal_bus.wav")
+
+    if not PYDUB_AVAILABLE:
+        print("Warning: Cannot enhance vocals without pydub")
+        return bus_path
 
     print(f"Enhancing vocals for {section}...")
+    lead = _as_segment(lead_vocal)
 
     # Determine intensity
     intensity = "high" if "chorus" in section else "medium"
@@ -263,33 +313,15 @@ def enhance_vocals(
     # Get harmony intervals
     intervals = get_harmony_intervals(key, intensity)
 
-    # Generate harmonies
-    harmonies = generate_harmonies(
-        lead_vocal,
-        intervals,
-        out_dir,
-        section
-    )
-
-    # Generate backing double
-    backing = backing_double(
-        lead_vocal,
-        os.path.join(out_dir, f"{section}_double.wav")
-    )
-
-    # Collect all tracks
-    tracks = [lead_vocal] + harmonies + [backing]
+    # Lead, harmonies and backing double
+    parts = [lead] + harmony_parts(lead, intervals) + [double_part(lead)]
 
     # Add chant stack for choruses
     if "chorus" in section or "drop" in section:
-        chant = chant_stack(
-            lead_vocal,
-            os.path.join(out_dir, f"{section}_chant.wav")
-        )
-        tracks.append(chant)
+        parts.append(chant_part(lead))
 
     # Mix to bus
-    bus_path = os.path.join(out_dir, f"{section}_vocal_bus.wav")
-    mix_vocal_bus(tracks, bus_path)
+    mix_parts(parts).export(bus_path, format="wav")
+    print(f"✓ Mixed vocal bus: {bus_path}")
 
     return bus_path
@@ -4,15 +4,118 @@ Export vocal melodies and harmonies as MIDI files for DAW integration
 """
 
 import os
-from typing import List, Dict, Optional
+import struct
+from concurrent.futures import ThreadPoolExecutor
+from typing import List, Dict, Optional, Sequence, Tuple
 
 try:
     import mido
-    from mido import MidiFile, MidiTrack, Message, MetaMessage, bpm2tempo
+    from mido import MidiFile
     MIDO_AVAILABLE = True
 except ImportError:
     MIDO_AVAILABLE = False
-    print("Warning: mido not available, MIDI export disabled")
+    print("Warning: mido not available, MIDI import disabled")
+
+
+TICKS_PER_QUARTER = 480
+NOTE_DURATION = TICKS_PER_QUARTER  # Quarter note
+
+NOTE_ON = 0x90
+END_OF_TRACK = b'\x00\xff\x2f\x00'
+
+
+def _vlq(value: int) -> bytes:
+    """Encode a MIDI variable-length quantity"""
+    out = bytearray([value & 0x7F])
+    value >>= 7
+    while value:
+        out.insert(0, 0x80 | (value & 0x7F))
+        value >>= 7
+    return bytes(out)
+
+
+_NOTE_DELTA = _vlq(NOTE_DURATION)
+
+
+def _meta(kind: int, data: bytes) -> bytes:
+    return b'\x00\xff' + bytes([kind]) + _vlq(len(data)) + data
+
+
+def _tempo_event(bpm: float) -> bytes:
+    return _meta(0x51, struct.pack('>I', int(round(60_000_000 / bpm)))[1:])
+
+
+def _name_event(name: str) -> bytes:
+    return _meta(0x03, name.encode('utf-8'))
+
+
+def _melody_events(notes: Sequence[int], velocity: int) -> bytes:
+    """
+    Encode a melody as note on/off events
+
+    Each note lasts NOTE_DURATION and is followed by a rest of the same
+    length. Note-offs are note-ons with velocity 0, so the whole melody is
+    one running-status run: 4 bytes per event after the first.
+    """
+    if not notes:
+        return b''
+    for note in notes:
+        if not 0 <= note <= 127:
+            raise ValueError(f"MIDI note out of range: {note}")
+    if not 0 <= velocity <= 127:
+        raise ValueError(f"MIDI velocity out of range: {velocity}")
+
+    first = notes[0]
+    head = bytes([0, NOTE_ON, first, velocity]) + _NOTE_DELTA + bytes([first, 0])
+    rest = b''.join(
+        _NOTE_DELTA + bytes([note, velocity]) + _NOTE_DELTA + bytes([note, 0])
+        for note in notes[1:]
+    )
+    return head + rest
+
+
+def _track_chunk(*events: bytes) -> bytes:
+    body = b''.join(events) + END_OF_TRACK
+    return b'MTrk' + struct.pack('>I', len(body)) + body
+
+
+def encode_smf(
+    bpm: float,
+    tracks: Sequence[Tuple[str, Sequence[int], int]],
+    tempo_track: bool = True
+) -> bytes:
+    """
+    Encode a type 1 Standard MIDI File
+
+    Args:
+        bpm: Tempo
+        tracks: (track name, absolute MIDI notes, velocity) per track
+        tempo_track: Put the tempo in its own first track (otherwise it
+            goes at the start of the first note track)
+
+    Returns:
+        SMF bytes
+    """
+    chunks = []
+    if tempo_track:
+        chunks.append(_track_chunk(_tempo_event(bpm)))
+
+    for i, (name, notes, velocity) in enumerate(tracks):
+        prefix = b'' if tempo_track or i else _tempo_event(bpm)
+        chunks.append(_track_chunk(prefix, _name_event(name), _melody_events(notes, velocity)))
+
+    header = b'MThd' + struct.pack('>IHHH', 6, 1, len(chunks), TICKS_PER_QUARTER)
+    return header + b''.join(chunks)
+
+
+def _write(out_path: str, data: bytes) -> str:
+    with open(out_path, 'wb') as f:
+        f.write(data)
+    return out_path
+
+
+def _transpose(melody: Sequence[int], root_note: int) -> List[int]:
+    return [root_note + offset for offset in melody]
 
 
 def export_melody_midi(
@@ -35,49 +138,32 @@ def export_melody_midi(
     Returns:
         Path to MIDI file
     """
-    if not MIDO_AVAILABLE:
-        print("Warning: MIDI export unavailable (mido not installed)")
-        return ""
-
-    # Create MIDI file
-    mid = MidiFile()
-    track = MidiTrack()
-    mid.tracks.append(track)
-
-    # Set tempo
-    track.append(MetaMessage('set_tempo', tempo=bpm2tempo(bpm)))
-    track.append(MetaMessage('track_name', name='Vocal Melody'))
-
-    # Add notes
-    ticks_per_quarter = 480
-    note_duration = ticks_per_quarter  # Quarter note
-
-    for i, offset in enumerate(melody):
-        note = root_note + offset
-
-        # Note on
-        track.append(Message(
-            'note_on',
-            note=note,
-            velocity=velocity,
-            time=0 if i == 0 else note_duration
-        ))
-
-        # Note off (after duration)
-        track.append(Message(
-            'note_off',
-            note=note,
-            velocity=0,
-            time=note_duration
-        ))
-
-    # Save
-    mid.save(out_path)
+    data = encode_smf(
+        bpm,
+        [('Vocal Melody', _transpose(melody, root_note), velocity)],
+        tempo_track=False
+    )
+    _write(out_path, data)
     print(f"✓ Exported melody MIDI: {out_path}")
 
     return out_path
 
 
+def _harmony_tracks(
+    melody: Sequence[int],
+    harmony_intervals: Sequence[int],
+    root_note: int
+) -> List[Tuple[str, List[int], int]]:
+    lead = _transpose(melody, root_note)
+    tracks = [('Lead Vocal', lead, 80)]
+
+    # Harmony tracks: melody transposed by each interval
+    for interval in harmony_intervals:
+        tracks.append((f'Harmony +{interval}', [note + interval for note in lead], 70))
+
+    return tracks
+
+
 def export_harmony_midi(
     melody: List[int],
     harmony_intervals: List[int],
@@ -98,67 +184,12 @@ def export_harmony_midi(
     Returns:
         Path to MIDI file
     """
-    if not MIDO_AVAILABLE:
-        return ""
-
-    mid = MidiFile()
-
-    # Tempo track
-    tempo_track = MidiTrack()
-    mid.tracks.append(tempo_track)
-    tempo_track.append(MetaMessage('set_tempo', tempo=bpm2tempo(bpm)))
-
-    # Lead melody track
-    lead_track = MidiTrack()
-    mid.tracks.append(lead_track)
-    lead_track.append(MetaMessage('track_name', name='Lead Vocal'))
-
-    _add_melody_to_track(lead_track, melody, root_note)
-
-    # Harmony tracks
-    for i, interval in enumerate(harmony_intervals):
-        harmony_track = MidiTrack()
-        mid.tracks.append(harmony_track)
-        harmony_track.append(MetaMessage('track_name', name=f'Harmony +{interval}'))
-
-        # Transpose melody by interval
-        harmony_melody = [note + interval for note in melody]
-        _add_melody_to_track(harmony_track, harmony_melody, root_note, velocity=70)
-
-    mid.save(out_path)
+    _write(out_path, encode_smf(bpm, _harmony_tracks(melody, harmony_intervals, root_note)))
     print(f"✓ Exported harmony MIDI: {out_path}")
 
     return out_path
 
 
-def _add_melody_to_track(
-    track: 'MidiTrack',
-    melody: List[int],
-    root_note: int,
-    velocity: int = 80
-):
-    """Add melody notes to MIDI track"""
-    ticks_per_quarter = 480
-    note_duration = ticks_per_quarter
-
-    for i, offset in enumerate(melody):
-        note = root_note + offset
-
-        track.append(Message(
-            'note_on',
-            note=note,
-            velocity=velocity,
-            time=0 if i == 0 else note_duration
-        ))
-
-        track.append(Message(
-            'note_off',
-            note=note,
-            velocity=0,
-            time=note_duration
-        ))
-
-
 def export_full_song_midi(
     song_plan: Dict,
     vocal_melodies: Dict[str, List[int]],
@@ -175,31 +206,53 @@ def export_full_song_midi(
     Returns:
         Path to MIDI file
     """
-    if not MIDO_AVAILABLE:
-        return ""
-
-    mid = MidiFile()
     bpm = song_plan.get("bpm", 120)
 
-    # Tempo track
-    tempo_track = MidiTrack()
-    mid.tracks.append(tempo_track)
-    tempo_track.append(MetaMessage('set_tempo', tempo=bpm2tempo(bpm)))
-
     # Track for each section
-    for section_name, melody in vocal_melodies.items():
-        track = MidiTrack()
-        mid.tracks.append(track)
-        track.append(MetaMessage('track_name', name=section_name))
+    tracks = [
+        (section_name, _transpose(melody, 60), 80)
+        for section_name, melody in vocal_melodies.items()
+    ]
 
-        _add_melody_to_track(track, melody, root_note=60)
-
-    mid.save(out_path)
+    _write(out_path, encode_smf(bpm, tracks))
     print(f"✓ Exported full song MIDI: {out_path}")
 
     return out_path
 
 
+def export_many(items: List[Dict], max_workers: int = 8) -> List[str]:
+    """
+    Export many MIDI files at once (e.g. a marketplace asset pack)
+
+    Files are encoded in memory and written on a thread pool, so the pack
+    is bound by file I/O rather than per-file Python overhead.
+
+    Args:
+        items: Dicts with "out_path", "melody" and "bpm", plus optional
+            "root_note", "velocity" and "harmony_intervals" (multi-track
+            lead + harmony file when present)
+        max_workers: Concurrent file writes
+
+    Returns:
+        Output paths, in input order
+    """
+    def render(item: Dict) -> bytes:
+        root_note = item.get("root_note", 60)
+        if item.get("harmony_intervals"):
+            return encode_smf(item["bpm"], _harmony_tracks(item["melody"], item["harmony_intervals"], root_note))
+        return encode_smf(
+            item["bpm"],
+            [('Vocal Melody', _transpose(item["melody"], root_note), item.get("velocity", 80))],
+            tempo_track=False
+        )
+
+    with ThreadPoolExecutor(max_workers=max_workers, thread_name_prefix="midi-export") as pool:
+        paths = list(pool.map(lambda item: _write(item["out_path"], render(item)), items))
+
+    print(f"✓ Exported {len(paths)} MIDI files")
+    return paths
+
+
 def import_midi_as_melody(midi_path: str) -> List[int]:
     """
     Import MIDI file and extract melody as note offsets
@@ -5,12 +5,13 @@ Orchestrates rap, singing, harmonies, and mixing
 
 import os
 import json
+from concurrent.futures import ThreadPoolExecutor
 from typing import Dict, List, Optional
 
 from .roles.planner import assign_roles
 from .rap.generator import generate_rap
 from .sing.generator import generate_hook, generate_melody
-from .synthesis import rap_synthesize, sing_synthesize, synthesize
+from .synthesis import VocalLine, get_synthesizer
 from .harmony.engine import enhance_vocals, pitch_shift
 from .midi_export import export_melody_midi, export_harmony_midi
 
@@ -18,6 +19,19 @@ from .midi_export import export_melody_midi, export_harmony_midi
 import sys
 sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
 from song_engine.generator import bars_to_seconds
+from dsp.buffers import array_to_segment
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..', 'music-engine'))
+from shared.tracing import span, bind, trace_spans, export_spans
+
+try:
+    from pydub import AudioSegment
+    PYDUB_AVAILABLE = True
+except ImportError:
+    PYDUB_AVAILABLE = False
+
+# Sections enhanced with harmonies at once
+HARMONY_WORKERS = 4
 
 
 def generate_vocals(
@@ -42,6 +56,18 @@ def generate_vocals(
     Returns:
         Dict with paths to vocal files and metadata
     """
+    root = span("vocals", sections=len(song_plan.get("structure", [])))
+    try:
+        with root:
+            return _generate_vocals(
+                song_plan, section_files, out_dir, enable_harmonies, enable_rap, enable_midi_export
+            )
+    finally:
+        export_spans(f"vocals-{os.path.basename(os.path.abspath(out_dir))}", trace_spans(root.trace_id), "mashdeck")
+
+
+def _generate_vocals(song_plan, section_files, out_dir, enable_harmonies, enable_rap, enable_midi_export):
+    """generate_vocals' stages, inside its trace span"""
     print("\n" + "=" * 60)
     print("MashDeck Vocal Generation Pipeline")
     print("=" * 60)
@@ -52,12 +78,13 @@ def generate_vocals(
 
     # Assign vocal roles
     print("\n[1/4] Assigning vocal roles...")
-    roles = assign_roles(song_plan)
+    with span("vocals.roles"):
+        roles = assign_roles(song_plan)
     print(f"  ✓ Assigned {len(roles)} vocal parts")
 
-    # Generate vocals for each role
+    # Write lyrics for each role, then synthesize them in one batch
     print("\n[2/4] Generating vocal performances...")
-    vocal_files = {}
+    lines = {}
     melodies = {}
 
     for role in roles:
@@ -68,24 +95,23 @@ def generate_vocals(
 
         print(f"\n  Section: {section} ({role_type})")
 
-        vocal_path = os.path.join(vocals_dir, f"{section}_{role_type}.wav")
-
         if role_type == "rap" and enable_rap:
             # Generate rap
-            lyrics = generate_rap(
-                bars=bars,
-                bpm=song_plan["bpm"],
-                energy=energy
-            )
+            with span("vocals.lyrics", section=section, role=role_type):
+                lyrics = generate_rap(
+                    bars=bars,
+                    bpm=song_plan["bpm"],
+                    energy=energy
+                )
             print(f"    Lyrics: {lyrics[:50]}...")
 
-            rap_synthesize(lyrics, vocal_path)
-            vocal_files[section] = vocal_path
+            lines[section] = (role_type, lyrics)
 
         elif role_type == "sing":
             # Generate sung hook
             mood = "energetic" if energy > 0.6 else "chill"
-            lyrics = generate_hook(bars=bars, mood=mood)
+            with span("vocals.lyrics", section=section, role=role_type):
+                lyrics = generate_hook(bars=bars, mood=mood)
             print(f"    Hook: {lyrics[:50]}...")
 
             # Generate melody
@@ -96,9 +122,8 @@ def generate_vocals(
             )
             melodies[section] = melody
 
-            # Synthesize with melody
-            sing_synthesize(lyrics, vocal_path, melody)
-            vocal_files[section] = vocal_path
+            # TODO: Apply melody (pitch shifting) to the synthesized line
+            lines[section] = (role_type, lyrics)
 
             # Export MIDI if enabled
             if enable_midi_export:
@@ -111,34 +136,45 @@ def generate_vocals(
 
         elif role_type == "chant":
             # Simple chant
-            lyrics = "Yeah! Let's go!"
-            synthesize(lyrics, vocal_path)
-            vocal_files[section] = vocal_path
+            lines[section] = (role_type, "Yeah! Let's go!")
 
         elif role_type == "adlib":
             # Ad-libs
-            lyrics = "Ooh... yeah"
-            synthesize(lyrics, vocal_path)
-            vocal_files[section] = vocal_path
+            lines[section] = (role_type, "Ooh... yeah")
+
+    synth = get_synthesizer()
+    with span("vocals.synthesize", lines=len(lines)):
+        audios = synth.synthesize_batch([VocalLine(lyrics) for _, lyrics in lines.values()])
+
+    # Lead vocals stay in memory for the harmony engine; the WAVs are outputs
+    vocal_files = {}
+    leads = {}
+
+    for (section, (role_type, _)), audio in zip(lines.items(), audios):
+        vocal_path = os.path.join(vocals_dir, f"{section}_{role_type}.wav")
+        vocal_files[section] = vocal_path
+
+        if PYDUB_AVAILABLE:
+            like = AudioSegment.silent(duration=0, frame_rate=synth.sample_rate)
+            leads[section] = array_to_segment(audio, like)
+            leads[section].export(vocal_path, format="wav")
+        else:
+            import soundfile as sf
+            sf.write(vocal_path, audio, synth.sample_rate)
 
     # Enhance with harmonies
     enhanced_files = {}
 
-    if enable_harmonies:
+    if enable_harmonies and leads:
         print("\n[3/4] Adding harmonies and backing vocals...")
 
-        for section, vocal_path in vocal_files.items():
-            if os.path.exists(vocal_path):
-                print(f"  Enhancing {section}...")
-
-                enhanced_path = enhance_vocals(
-                    vocal_path,
-                    song_plan["key"],
-                    section,
-                    vocals_dir
-                )
+        def enhance(section):
+            print(f"  Enhancing {section}...")
+            with span("vocals.harmony", section=section):
+                return enhance_vocals(leads[section], song_plan["key"], section, vocals_dir)
 
-                enhanced_files[section] = enhanced_path
+        with ThreadPoolExecutor(max_workers=HARMONY_WORKERS) as pool:
+            enhanced_files = dict(zip(leads, pool.map(bind(enhance), leads)))
     else:
         enhanced_files = vocal_files
 
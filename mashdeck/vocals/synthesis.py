@@ -5,7 +5,10 @@ Supports voice cloning and multilingual output
 """
 
 import os
-from typing import Optional
+import threading
+from typing import List, NamedTuple, Optional
+
+import numpy as np
 
 try:
     from TTS.api import TTS
@@ -15,21 +18,93 @@ except ImportError:
     print("Warning: TTS library not available, vocal synthesis will be mocked")
 
 
+class VocalLine(NamedTuple):
+    """One line to synthesize"""
+    text: str
+    speaker_wav: Optional[str] = None
+    language: str = "en"
+
+
 class VocalSynthesizer:
     """Main vocal synthesis class"""
 
     def __init__(self, model_name: str = "tts_models/multilingual/multi-dataset/xtts_v2"):
         self.model_name = model_name
         self.tts = None
+        self.sample_rate = 22050
+        # One model instance; concurrent callers take turns
+        self._lock = threading.Lock()
+        # Speaker conditioning per voice (speaker_wav, None = built-in voice)
+        self._latents = {}
 
         if TTS_AVAILABLE:
             try:
                 self.tts = TTS(model_name)
+                self.sample_rate = self.tts.synthesizer.output_sample_rate
                 print(f"✓ Loaded TTS model: {model_name}")
             except Exception as e:
                 print(f"Warning: Could not load TTS model: {e}")
                 self.tts = None
 
+    def synthesize_batch(self, lines: List[VocalLine]) -> List[np.ndarray]:
+        """
+        Synthesize several lines into in-memory buffers
+
+        The whole batch runs under one hold of the model, and each voice's
+        speaker latents are computed once and cached for later calls.
+        XTTS has no multi-text inference, so lines still decode one after
+        another, skipping the per-call conditioning and WAV writes.
+
+        Args:
+            lines: Lines to synthesize
+
+        Returns:
+            Mono float32 sample arrays at self.sample_rate, one per line
+        """
+        if self.tts is None:
+            for line in lines:
+                print(f"Mock synthesis: {line.text[:50]}...")
+            return [self._mock_samples(len(line.text) * 0.1) for line in lines]
+
+        audios = []
+
+        with self._lock:
+            model = self._xtts_model()
+
+            for line in lines:
+                try:
+                    if model is not None:
+                        gpt_cond_latent, speaker_embedding = self._conditioning(model, line.speaker_wav)
+                        # Split like tts() does, so long verses stay under XTTS's input limit
+                        wav = model.inference(
+                            line.text, line.language, gpt_cond_latent, speaker_embedding,
+                            enable_text_splitting=True
+                        )["wav"]
+                    else:
+                        wav = self.tts.tts(text=line.text, speaker_wav=line.speaker_wav, language=line.language)
+                    audios.append(_to_samples(wav))
+                except Exception as e:
+                    print(f"Synthesis error: {e}, creating mock audio")
+                    audios.append(self._mock_samples(len(line.text) * 0.1))
+
+        print(f"✓ Synthesized {len(lines)} vocal lines")
+        return audios
+
+    def _xtts_model(self):
+        """The loaded XTTS model, or None for TTS models without latents"""
+        model = getattr(self.tts.synthesizer, "tts_model", None)
+        return model if hasattr(model, "get_conditioning_latents") else None
+
+    def _conditioning(self, model, speaker_wav: Optional[str]):
+        """Cached (gpt_cond_latent, speaker_embedding) for a voice (lock held)"""
+        if speaker_wav not in self._latents:
+            if speaker_wav:
+                self._latents[speaker_wav] = model.get_conditioning_latents(audio_path=[speaker_wav])
+            else:
+                speaker = next(iter(model.speaker_manager.speakers.values()))
+                self._latents[None] = (speaker["gpt_cond_latent"], speaker["speaker_embedding"])
+        return self._latents[speaker_wav]
+
     def synthesize(
         self,
         text: str,
@@ -49,48 +124,38 @@ class VocalSynthesizer:
         Returns:
             Path to generated audio
         """
-        if self.tts is None:
-            print(f"Mock synthesis: {text[:50]}...")
-            self._create_mock_audio(out_path, len(text) * 0.1)
-            return out_path
-
-        try:
-            self.tts.tts_to_file(
-                text=text,
-                file_path=out_path,
-                speaker_wav=speaker_wav,
-                language=language
-            )
-            print(f"✓ Generated vocal: {out_path}")
-
-        except Exception as e:
-            print(f"Synthesis error: {e}, creating mock audio")
-            self._create_mock_audio(out_path, len(text) * 0.1)
+        import soundfile as sf
+
+        audio = self.synthesize_batch([VocalLine(text, speaker_wav, language)])[0]
+        sf.write(out_path, audio, self.sample_rate)
+        print(f"✓ Generated vocal: {out_path}")
 
         return out_path
 
-    def _create_mock_audio(self, path: str, duration: float):
-        """Create mock audio for testing"""
-        import numpy as np
-        import soundfile as sf
+    def _mock_samples(self, duration: float) -> np.ndarray:
+        """Silent mock audio for testing"""
+        return np.zeros(int(self.sample_rate * duration), dtype=np.float32)
 
-        sample_rate = 22050
-        samples = int(sample_rate * duration)
-        audio = np.zeros(samples, dtype=np.float32)
 
-        sf.write(path, audio, sample_rate)
+def _to_samples(wav) -> np.ndarray:
+    """Model output (tensor, array or list) as a mono float32 array"""
+    if hasattr(wav, "cpu"):
+        wav = wav.squeeze().cpu().numpy()
+    return np.asarray(wav, dtype=np.float32).reshape(-1)
 
 
 # Global synthesizer instance
 _global_synthesizer = None
+_global_synthesizer_lock = threading.Lock()
 
 
 def get_synthesizer() -> VocalSynthesizer:
     """Get or create global synthesizer instance"""
     global _global_synthesizer
 
-    if _global_synthesizer is None:
-        _global_synthesizer = VocalSynthesizer()
+    with _global_synthesizer_lock:
+        if _global_synthesizer is None:
+            _global_synthesizer = VocalSynthesizer()
 
     return _global_synthesizer
 
@@ -117,6 +182,16 @@ def synthesize(
     return synth.synthesize(text, out_path, speaker_wav, language)
 
 
+def synthesize_lines(lines: List[VocalLine]) -> List[np.ndarray]:
+    """
+    Convenience function for batched in-memory synthesis
+
+    Returns:
+        Mono float32 arrays at get_synthesizer().sample_rate
+    """
+    return get_synthesizer().synthesize_batch(lines)
+
+
 def rap_synthesize(
     text: str,
     out_path: str,
@@ -3,14 +3,16 @@ StaticWaves Music API - FastAPI Backend
 Main API endpoints for music generation
 """
 
-from fastapi import FastAPI, HTTPException, WebSocket, WebSocketDisconnect, Query
+from fastapi import FastAPI, HTTPException, WebSocket, WebSocketDisconnect, Query, Request
 from fastapi.middleware.cors import CORSMiddleware
-from fastapi.responses import FileResponse
+from fastapi.responses import FileResponse, StreamingResponse
 import redis.asyncio as redis
+import asyncio
+import time
 import uuid
 import json
 import os
-from typing import Dict, List, Optional
+from typing import Any, Dict, List, Optional, Tuple
 import sys
 
 sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -25,6 +27,21 @@ from shared.auto_generator import (
     get_smart_preset
 )
 from shared.lyrics_generator import generate_lyrics_with_claude
+from shared.live import LIVE_QUEUE, SESSION_TTL, live_keys, stream_format
+from shared.jobs import TERMINAL_STATUSES, job_key, job_channel, status_payload
+from shared.job_queue import (
+    LANES, REMIX_LANE, STEM_CACHE_FILE, WORKER_STATES_KEY, job_lane, worker_state_key
+)
+from shared.tracing import STAGES_KEY, stage_key, pushed_histogram, stage_report
+from shared.render_cache import (
+    RENDER_CACHE_ENABLED,
+    LRU_KEY,
+    BYTES_KEY,
+    STATS_KEY,
+    entry_key,
+    render_key,
+    cache_stats
+)
 
 
 app = FastAPI(
@@ -45,6 +62,21 @@ app.add_middleware(
 # Redis connection
 REDIS_HOST = os.getenv("REDIS_HOST", "localhost")
 REDIS_PORT = int(os.getenv("REDIS_PORT", "6379"))
+OUTPUT_DIR = os.getenv("OUTPUT_DIR", "/data/output")
+
+# Seconds between SSE keep-alive comments on /status/{job_id}/stream
+STATUS_HEARTBEAT_SECONDS = float(os.getenv("STATUS_HEARTBEAT_SECONDS", "15"))
+
+# Download renditions: format -> (file extension, media type). The worker
+# writes an Opus rendition of the mix and a .peaks file beside every WAV.
+RENDITIONS = {
+    "wav": (".wav", "audio/wav"),
+    "opus": (".opus", "audio/ogg; codecs=opus")
+}
+PEAKS_SUFFIX = ".peaks"
+
+# Bytes read per chunk when serving a byte range
+RANGE_CHUNK_SIZE = 64 * 1024
 
 
 async def get_redis():
@@ -56,6 +88,78 @@ async def get_redis():
     )
 
 
+async def claim_render(r: redis.Redis, key: str, job_id: str) -> Optional[Tuple[str, str]]:
+    """
+    Claim a render key for job_id, or find the job that already holds it
+
+    Returns:
+        None if job_id now owns the key and must be queued, otherwise
+        (owner_job_id, "cached" | "coalesced")
+    """
+    entry = entry_key(key)
+
+    while True:
+        if await r.hsetnx(entry, "job_id", job_id):
+            await r.hincrby(STATS_KEY, "misses", 1)
+            return None
+
+        async with r.pipeline() as pipe:
+            try:
+                await pipe.watch(entry)
+                current = await pipe.hgetall(entry)
+                owner = current.get("job_id")
+                if not owner:
+                    continue
+
+                ready = current.get("state") == "ready"
+                if ready and os.path.isdir(os.path.join(OUTPUT_DIR, owner)):
+                    await r.zadd(LRU_KEY, {key: time.time()})
+                    await r.hincrby(STATS_KEY, "hits", 1)
+                    return owner, "cached"
+
+                owner_status = await pipe.hget(job_key(owner), "status")
+                if not ready and owner_status not in ("failed", "evicted"):
+                    await r.hincrby(STATS_KEY, "coalesced", 1)
+                    return owner, "coalesced"
+
+                # Owner failed or its outputs are gone: take the key over
+                pipe.multi()
+                pipe.delete(entry)
+                pipe.hset(entry, "job_id", job_id)
+                if ready:
+                    pipe.zrem(LRU_KEY, key)
+                    pipe.decrby(BYTES_KEY, int(current.get("bytes") or 0))
+                pipe.hincrby(STATS_KEY, "misses", 1)
+                await pipe.execute()
+                return None
+            except redis.WatchError:
+                continue
+
+
+async def enqueue_job(r: redis.Redis, job_data: Dict) -> Tuple[str, str]:
+    """
+    Queue a job and create its state hash in one round trip, unless an
+    identical render is already finished or in flight
+
+    Returns:
+        (job_id to follow, "queued" | "coalesced" | "cached")
+    """
+    if RENDER_CACHE_ENABLED:
+        # retain_stems callers need a render that kept its stems
+        key = render_key(job_data["spec"], job_data.get("remix_of"), bool(job_data.get("retain_stems")))
+        existing = await claim_render(r, key, job_data["job_id"])
+        if existing:
+            return existing
+        job_data["render_key"] = key
+
+    encoded = json.dumps(job_data)
+    pipe = r.pipeline()
+    pipe.xadd(job_lane(job_data), {"job": encoded})
+    pipe.hset(job_key(job_data["job_id"]), mapping={"data": encoded, "status": "pending"})
+    await pipe.execute()
+    return job_data["job_id"], "queued"
+
+
 @app.get("/")
 async def root():
     """Health check"""
@@ -67,7 +171,10 @@ async def root():
 
 
 @app.post("/generate", response_model=Dict[str, str])
-async def generate_music(spec: MusicSpec):
+async def generate_music(
+    spec: MusicSpec,
+    retain_stems: bool = Query(False, description="Keep stems so variations can re-mix them without the GPU")
+):
     """
     Generate music from MusicSpec
 
@@ -97,18 +204,18 @@ async def generate_music(spec: MusicSpec):
         "credits": credits_needed,
         "status": "pending"
     }
+    if retain_stems:
+        job_data["retain_stems"] = True
 
     # Add to Redis queue
-    await r.lpush("music_jobs", json.dumps(job_data))
-    await r.set(f"job:{job_id}:status", "pending")
-    await r.set(f"job:{job_id}:data", json.dumps(job_data))
+    job_id, status = await enqueue_job(r, job_data)
 
     # TODO: Charge credits
     # await charge_credits(user["id"], credits_needed)
 
     return {
         "job_id": job_id,
-        "status": "queued",
+        "status": status,
         "credits_charged": str(credits_needed),
         "estimated_time": f"{spec.duration}s"
     }
@@ -123,83 +230,233 @@ async def get_status(job_id: str):
     """
     r = await get_redis()
 
-    # Get job data
-    job_data_str = await r.get(f"job:{job_id}:data")
-    if not job_data_str:
+    fields = await r.hgetall(job_key(job_id))
+    if not fields.get("data"):
         raise HTTPException(status_code=404, detail="Job not found")
 
-    job_data = json.loads(job_data_str)
+    return JobStatus(**status_payload(job_id, fields))
 
-    # Get current status
-    status = await r.get(f"job:{job_id}:status") or "pending"
-    progress = float(await r.get(f"job:{job_id}:progress") or 0.0)
 
-    # Get output URLs if completed
-    output_urls = None
-    if status == "completed":
-        output_str = await r.get(f"job:{job_id}:outputs")
-        if output_str:
-            output_urls = json.loads(output_str)
+@app.get("/status/{job_id}/stream")
+async def stream_status(job_id: str):
+    """
+    Follow a job with Server-Sent Events
 
-    return JobStatus(
-        job_id=job_id,
-        status=status,
-        progress=progress,
-        output_urls=output_urls
+    Sends a `status` event with the current state, then one per update,
+    and ends once the job completes, fails or has its outputs evicted.
+    """
+    r = await get_redis()
+    if not await r.hexists(job_key(job_id), "data"):
+        await r.aclose()
+        raise HTTPException(status_code=404, detail="Job not found")
+
+    async def events():
+        pubsub = r.pubsub()
+        try:
+            # Subscribe before the snapshot so no update falls in between
+            await pubsub.subscribe(job_channel(job_id))
+            fields = await r.hgetall(job_key(job_id))
+
+            while True:
+                payload = status_payload(job_id, fields)
+                yield f"event: status\ndata: {json.dumps(payload)}\n\n"
+                if payload["status"] in TERMINAL_STATUSES:
+                    break
+
+                message = None
+                while message is None:
+                    message = await pubsub.get_message(
+                        ignore_subscribe_messages=True,
+                        timeout=STATUS_HEARTBEAT_SECONDS
+                    )
+                    if message is None:
+                        yield ": keep-alive\n\n"
+                fields.update(json.loads(message["data"]))
+        finally:
+            await pubsub.unsubscribe()
+            await pubsub.aclose()
+            await r.aclose()
+
+    return StreamingResponse(
+        events(),
+        media_type="text/event-stream",
+        headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"}
+    )
+
+
+def parse_range(header: str, size: int) -> Optional[Tuple[int, int]]:
+    """
+    Inclusive (start, end) of a single-range "bytes=" header
+
+    Returns None when the header should be ignored (malformed or
+    multi-range; the whole file is sent). Raises 416 when the range
+    lies outside the file.
+    """
+    unit, _, spec = header.partition("=")
+    if unit.strip() != "bytes" or "," in spec:
+        return None
+
+    first, _, last = spec.strip().partition("-")
+    try:
+        if not first:
+            # Suffix range: the last N bytes
+            start, end = max(size - int(last), 0), size - 1
+        else:
+            start = int(first)
+            end = min(int(last), size - 1) if last else size - 1
+    except ValueError:
+        return None
+
+    if start >= size or start > end:
+        raise HTTPException(
+            status_code=416,
+            detail="Range not satisfiable",
+            headers={"Content-Range": f"bytes */{size}"}
+        )
+    return start, end
+
+
+def file_response(path: str, media_type: str, filename: str, range_header: Optional[str]):
+    """The whole file, or 206 Partial Content for a Range request"""
+    size = os.path.getsize(path)
+    byte_range = parse_range(range_header, size) if range_header else None
+
+    if byte_range is None:
+        return FileResponse(path, media_type=media_type, filename=filename, headers={"Accept-Ranges": "bytes"})
+
+    start, end = byte_range
+
+    def chunks():
+        with open(path, "rb") as f:
+            f.seek(start)
+            remaining = end - start + 1
+            while remaining > 0:
+                chunk = f.read(min(RANGE_CHUNK_SIZE, remaining))
+                if not chunk:
+                    break
+                remaining -= len(chunk)
+                yield chunk
+
+    return StreamingResponse(
+        chunks(),
+        status_code=206,
+        media_type=media_type,
+        headers={
+            "Accept-Ranges": "bytes",
+            "Content-Range": f"bytes {start}-{end}/{size}",
+            "Content-Length": str(end - start + 1),
+            "Content-Disposition": f'attachment; filename="{filename}"'
+        }
     )
 
 
 @app.get("/download/{job_id}/{file_type}")
-async def download_file(job_id: str, file_type: str):
+async def download_file(job_id: str, file_type: str, request: Request, format: str = "wav"):
     """
     Download generated music or stems
 
     file_type: mix, bass, lead, pad, drums, etc.
+    format: wav, or opus (the mix's compact rendition, for streaming playback)
+
+    Range requests get 206 Partial Content, so players can start
+    playback and seek without the whole file.
     """
+    if format not in RENDITIONS:
+        raise HTTPException(status_code=400, detail=f"Unknown format: {format}")
+    extension, media_type = RENDITIONS[format]
+
     # Construct file path
-    output_dir = os.getenv("OUTPUT_DIR", "/data/output")
-    file_path = f"{output_dir}/{job_id}/{file_type}.wav"
+    file_path = f"{OUTPUT_DIR}/{job_id}/{file_type}{extension}"
 
     if not os.path.exists(file_path):
         raise HTTPException(status_code=404, detail="File not found")
 
-    return FileResponse(
+    return file_response(
         file_path,
-        media_type="audio/wav",
-        filename=f"{job_id}_{file_type}.wav"
+        media_type,
+        f"{job_id}_{file_type}{extension}",
+        request.headers.get("range")
     )
 
 
+@app.get("/peaks/{job_id}/{file_type}")
+async def download_peaks(job_id: str, file_type: str):
+    """
+    Waveform peaks for a mix or stem
+
+    Min/max per pixel at several zoom levels, one audiowaveform v1 block
+    per level (see worker/peaks.py).
+    """
+    file_path = f"{OUTPUT_DIR}/{job_id}/{file_type}{PEAKS_SUFFIX}"
+
+    if not os.path.exists(file_path):
+        raise HTTPException(status_code=404, detail="Peaks not found")
+
+    return FileResponse(file_path, media_type="application/octet-stream")
+
+
+def merge_spec(spec: Dict, update: Dict) -> None:
+    """Merge a live spec update in place (nested dicts like vibe merge key by key)"""
+    for key, value in update.items():
+        if isinstance(value, dict) and isinstance(spec.get(key), dict):
+            spec[key].update(value)
+        else:
+            spec[key] = value
+
+
 @app.websocket("/live")
 async def live_mode(websocket: WebSocket):
     """
     WebSocket endpoint for live/streaming music generation
 
-    This is the Magenta RT streaming mode - music evolves in real-time
-    based on user vibe adjustments
+    The client sends JSON spec updates (usually just {"vibe": {...}}); the
+    first one starts the session. The live worker reads the latest spec
+    before every chunk, so music evolves with the sliders. The server sends
+    one JSON "stream_start" message describing the format, then binary PCM
+    frames of chunk_seconds each.
     """
     await websocket.accept()
 
-    try:
-        while True:
-            # Receive vibe update from client
-            data = await websocket.receive_json()
+    session_id = str(uuid.uuid4())
+    keys = live_keys(session_id)
+    spec: Dict = {}
 
-            # TODO: Generate audio chunk based on vibe
-            # For now, echo back the vibe
-            # In production, this would call Magenta RT or streaming MusicGen
+    # Binary-safe connection: frames are raw PCM
+    r = redis.Redis(host=REDIS_HOST, port=REDIS_PORT)
 
-            response = {
-                "type": "audio_chunk",
-                "vibe": data,
-                "message": "Live mode - audio chunk would be sent here"
-            }
+    async def receive_updates():
+        while True:
+            merge_spec(spec, await websocket.receive_json())
+            await r.set(keys["spec"], json.dumps(spec), ex=SESSION_TTL)
 
-            await websocket.send_json(response)
+    async def relay_frames():
+        while True:
+            item = await r.blpop(keys["frames"], timeout=1)
+            if item:
+                await websocket.send_bytes(item[1])
+
+    try:
+        merge_spec(spec, await websocket.receive_json())
+        await r.set(keys["spec"], json.dumps(spec), ex=SESSION_TTL)
+        await r.lpush(LIVE_QUEUE, session_id)
+        await websocket.send_json({"type": "stream_start", "session_id": session_id, **stream_format()})
+
+        tasks = [asyncio.create_task(receive_updates()), asyncio.create_task(relay_frames())]
+        done, pending = await asyncio.wait(tasks, return_when=asyncio.FIRST_COMPLETED)
+        for task in pending:
+            task.cancel()
+        for task in done:
+            task.result()
 
     except WebSocketDisconnect:
         print("WebSocket disconnected")
 
+    finally:
+        # Tell the live worker to stop and drop undelivered frames
+        await r.set(keys["stop"], 1, ex=60)
+        await r.delete(keys["spec"], keys["frames"])
+        await r.aclose()
+
 
 @app.get("/health")
 async def health():
@@ -212,9 +469,54 @@ async def health():
     except:
         redis_status = "unhealthy"
 
+    render_cache = None
+    queue = None
+    stages = None
+    workers = None
+    if redis_status == "healthy":
+        pipe = r.pipeline(transaction=False)
+        pipe.hgetall(STATS_KEY)
+        pipe.zcard(LRU_KEY)
+        pipe.get(BYTES_KEY)
+        for lane in LANES + (REMIX_LANE,):
+            pipe.xlen(lane)
+        pipe.smembers(STAGES_KEY)
+        pipe.smembers(WORKER_STATES_KEY)
+        results = await pipe.execute()
+        render_cache = cache_stats(*results[:3])
+        # Unacknowledged entries: queued plus running
+        queue = dict(zip(LANES + (REMIX_LANE,), results[3:4 + len(LANES)]))
+
+        # Worker stage latencies, summed over every worker, and each
+        # worker's readiness (expired hashes are workers that went away)
+        names = sorted(results[-2])
+        worker_names = sorted(results[-1])
+        pipe = r.pipeline(transaction=False)
+        for name in names:
+            pipe.hgetall(stage_key(name))
+        for name in worker_names:
+            pipe.hgetall(worker_state_key(name))
+        fetched = await pipe.execute()
+        histograms = fetched[:len(names)]
+        stages = stage_report({name: pushed_histogram(fields) for name, fields in zip(names, histograms)})
+
+        states = {name: fields for name, fields in zip(worker_names, fetched[len(names):]) if fields}
+        gone = [name for name in worker_names if name not in states]
+        if gone:
+            await r.srem(WORKER_STATES_KEY, *gone)
+        workers = {
+            "ready": sum(1 for fields in states.values() if fields.get("state") == "ready"),
+            "warming": sum(1 for fields in states.values() if fields.get("state") != "ready"),
+            "workers": states
+        }
+
     return {
         "api": "healthy",
-        "redis": redis_status
+        "redis": redis_status,
+        "render_cache": render_cache,
+        "queue": queue,
+        "stages": stages,
+        "workers": workers
     }
 
 
@@ -269,6 +571,21 @@ async def list_presets():
     return {"presets": presets}
 
 
+async def add_lyrics(spec: Dict[str, Any]):
+    """Attach Claude lyrics to a song spec (None if generation fails)"""
+    try:
+        structure_types = [s["type"] for s in spec.get("structure", {}).get("sections", [])]
+        spec["lyrics"] = await generate_lyrics_with_claude(
+            genre=spec.get("genre", "electronic"),
+            mood=spec.get("mood", "chill"),
+            theme=spec.get("theme"),
+            structure=structure_types
+        )
+    except Exception as e:
+        print(f"Error generating lyrics: {e}")
+        spec["lyrics"] = None
+
+
 @app.post("/generate/auto")
 async def generate_automatic(
     genre: Optional[str] = Query(None, description="Genre (optional, random if not specified)"),
@@ -292,18 +609,7 @@ async def generate_automatic(
 
     # Generate lyrics if requested
     if include_lyrics:
-        try:
-            structure_types = [s["type"] for s in spec.get("structure", {}).get("sections", [])]
-            lyrics = await generate_lyrics_with_claude(
-                genre=spec.get("genre", "electronic"),
-                mood=spec.get("mood", "chill"),
-                theme=spec.get("theme"),
-                structure=structure_types
-            )
-            spec["lyrics"] = lyrics
-        except Exception as e:
-            print(f"Error generating lyrics: {e}")
-            spec["lyrics"] = None
+        await add_lyrics(spec)
 
     # Queue generation
     job_id = str(uuid.uuid4())
@@ -318,13 +624,11 @@ async def generate_automatic(
         "status": "pending"
     }
 
-    await r.lpush("music_jobs", json.dumps(job_data))
-    await r.set(f"job:{job_id}:status", "pending")
-    await r.set(f"job:{job_id}:data", json.dumps(job_data))
+    job_id, status = await enqueue_job(r, job_data)
 
     return {
         "job_id": job_id,
-        "status": "queued",
+        "status": status,
         "song_info": {
             "title": spec.get("title"),
             "genre": spec.get("genre"),
@@ -369,13 +673,11 @@ async def generate_from_preset(preset_name: str):
         "status": "pending"
     }
 
-    await r.lpush("music_jobs", json.dumps(job_data))
-    await r.set(f"job:{job_id}:status", "pending")
-    await r.set(f"job:{job_id}:data", json.dumps(job_data))
+    job_id, status = await enqueue_job(r, job_data)
 
     return {
         "job_id": job_id,
-        "status": "queued",
+        "status": status,
         "preset": preset_name,
         "song_info": {
             "title": spec.get("title"),
@@ -388,7 +690,8 @@ async def generate_from_preset(preset_name: str):
 async def generate_playlist_endpoint(
     mood: str = Query(..., description="Playlist mood (energetic, chill, dark, etc.)"),
     count: int = Query(5, ge=1, le=20, description="Number of songs"),
-    duration_per_song: int = Query(120, ge=30, le=300, description="Duration per song")
+    duration_per_song: int = Query(120, ge=30, le=300, description="Duration per song"),
+    include_lyrics: bool = Query(False, description="Generate AI lyrics with Claude")
 ):
     """
     🎶 Generate a complete playlist!
@@ -399,6 +702,10 @@ async def generate_playlist_endpoint(
     # Generate playlist
     playlist_songs = generate_playlist(mood, count)
 
+    # Requested together, so the lyrics service batches them into few calls
+    if include_lyrics:
+        await asyncio.gather(*(add_lyrics(spec) for spec in playlist_songs))
+
     # Queue all songs
     job_ids = []
 
@@ -422,9 +729,7 @@ async def generate_playlist_endpoint(
             "playlist_mood": mood
         }
 
-        await r.lpush("music_jobs", json.dumps(job_data))
-        await r.set(f"job:{job_id}:status", "pending")
-        await r.set(f"job:{job_id}:data", json.dumps(job_data))
+        job_id, _ = await enqueue_job(r, job_data)
 
         job_ids.append(job_id)
 
@@ -437,26 +742,44 @@ async def generate_playlist_endpoint(
     }
 
 
+def stems_cached(job_id: str) -> bool:
+    """Whether a job's stems are in the stem cache (see worker/stem_cache.py)"""
+    return os.path.exists(os.path.join(OUTPUT_DIR, job_id, STEM_CACHE_FILE))
+
+
 @app.post("/generate/variations")
 async def generate_variations(
     base_job_id: str = Query(..., description="Base job ID to create variations from"),
-    count: int = Query(3, ge=1, le=10, description="Number of variations")
+    count: int = Query(3, ge=1, le=10, description="Number of variations"),
+    mode: str = Query("auto", pattern="^(auto|remix|full)$",
+                      description="remix: re-mix cached stems (CPU only); full: regenerate; auto: remix when stems are cached")
 ):
     """
     Create variations of an existing song
 
-    Takes a generated song and creates similar but unique versions
+    Takes a generated song and creates similar but unique versions.
+    Only the vibe changes, so when the base job's stems are cached each
+    variation is a CPU re-mix of them rather than a new generation.
     """
     r = await get_redis()
 
     # Get original spec
-    job_data_str = await r.get(f"job:{base_job_id}:data")
+    job_data_str = await r.hget(job_key(base_job_id), "data")
     if not job_data_str:
         raise HTTPException(status_code=404, detail="Base job not found")
 
     base_job_data = json.loads(job_data_str)
     base_spec = base_job_data["spec"]
 
+    # A variation of a re-mix re-mixes the same stems
+    stems_job_id = base_job_data.get("remix_of", base_job_id)
+    remix = mode != "full" and stems_cached(stems_job_id)
+    if mode == "remix" and not remix:
+        raise HTTPException(
+            status_code=409,
+            detail="Base job's stems aren't cached; generate it with retain_stems=true or use mode=full"
+        )
+
     # Generate variations
     variation_ids = []
 
@@ -472,8 +795,9 @@ async def generate_variations(
                 var_spec["vibe"][key] + random.uniform(-0.15, 0.15)
             ))
 
-        # New seed
-        var_spec["seed"] = base_spec.get("seed", 12345) + i + 1
+        # New seed (a re-mix keeps the stems' generation as it was)
+        if not remix:
+            var_spec["seed"] = base_spec.get("seed", 12345) + i + 1
         var_spec["title"] = f"{base_spec.get('title', 'Track')} - Variation {i+1}"
 
         # Queue
@@ -489,17 +813,18 @@ async def generate_variations(
             "variation_of": base_job_id,
             "variation_index": i
         }
+        if remix:
+            job_data["remix_of"] = stems_job_id
 
-        await r.lpush("music_jobs", json.dumps(job_data))
-        await r.set(f"job:{job_id}:status", "pending")
-        await r.set(f"job:{job_id}:data", json.dumps(job_data))
+        job_id, _ = await enqueue_job(r, job_data)
 
         variation_ids.append(job_id)
 
     return {
         "base_job_id": base_job_id,
         "variation_count": count,
-        "variation_ids": variation_ids
+        "variation_ids": variation_ids,
+        "mode": "remix" if remix else "full"
     }
 
 
@@ -0,0 +1,58 @@
+"""
+Job queue protocol shared by the API and the worker
+
+Jobs are entries on Redis Streams read through one consumer group. A job
+stays pending, and can be claimed by another worker, until the worker
+that read it acknowledges it. Short, cheap jobs go to a priority lane
+that workers always drain first. Re-mixes of cached stems need no GPU
+and have their own lane, read only by re-mix workers.
+"""
+
+import os
+from typing import Dict
+
+GROUP = "music_workers"
+
+# Lanes in the order workers read them
+PRIORITY_LANE = "music_jobs:priority"
+STANDARD_LANE = "music_jobs:standard"
+LANES = (PRIORITY_LANE, STANDARD_LANE)
+
+# Vibe-only re-mixes of a finished job's cached stems (worker/remix.py)
+REMIX_LANE = "music_jobs:remix"
+REMIX_LANES = (REMIX_LANE,)
+
+# Stems a re-mix reads, in its source job's output directory
+STEM_CACHE_FILE = "stems.f16.npz"
+
+# Worker readiness: names of workers that have published a state, and
+# one expiring hash per worker (see worker/readiness.py). GPU workers join
+# the consumer group only once their state is "ready"
+WORKER_STATES_KEY = "worker:states"
+WORKER_STATE_TTL = int(os.getenv("WORKER_STATE_TTL", "60"))
+
+
+def worker_state_key(name: str) -> str:
+    return f"worker:state:{name}"
+
+
+# Jobs delivered too many times without an ack end up here
+DEAD_LETTER = "music_jobs:dead"
+
+# Pre-Streams list queue, drained into the lanes by workers on startup
+LEGACY_QUEUE = "music_jobs"
+
+# Jobs within both bounds take the priority lane
+PRIORITY_MAX_SECONDS = int(os.getenv("PRIORITY_MAX_SECONDS", "60"))
+PRIORITY_MAX_CREDITS = int(os.getenv("PRIORITY_MAX_CREDITS", "8"))
+
+
+def job_lane(job_data: Dict) -> str:
+    """Stream a job is queued on"""
+    if job_data.get("remix_of"):
+        return REMIX_LANE
+    duration = job_data["spec"].get("duration", 30)
+    credits = job_data.get("credits", 0)
+    if duration <= PRIORITY_MAX_SECONDS and credits <= PRIORITY_MAX_CREDITS:
+        return PRIORITY_LANE
+    return STANDARD_LANE
@@ -0,0 +1,48 @@
+"""
+Job state protocol shared by the API and the worker
+
+Each job lives in one Redis hash (job:{id}) with the fields data, status,
+progress, outputs and error. Every update is written in a MULTI pipeline
+together with a PUBLISH on job:{id}:events, so a status read is a single
+HGETALL and clients can follow a job without polling.
+"""
+
+import json
+from typing import Dict, Optional
+
+TERMINAL_STATUSES = ("completed", "failed", "evicted")
+
+
+def job_key(job_id: str) -> str:
+    """Hash holding a job's state"""
+    return f"job:{job_id}"
+
+
+def job_channel(job_id: str) -> str:
+    """Pub/sub channel announcing a job's status changes"""
+    return f"job:{job_id}:events"
+
+
+def status_fields(status: str, progress: Optional[float] = None, **extra) -> Dict[str, str]:
+    """Hash fields for a status update (extra values are stored as given)"""
+    fields = {"status": status}
+    if progress is not None:
+        fields["progress"] = str(progress)
+    fields.update(extra)
+    return fields
+
+
+def status_payload(job_id: str, fields: Dict[str, str]) -> Dict:
+    """Client-facing status from a job hash (or a published update)"""
+    status = fields.get("status") or "pending"
+    payload = {
+        "job_id": job_id,
+        "status": status,
+        "progress": float(fields.get("progress") or 0.0),
+        "output_urls": None
+    }
+    if status == "completed" and fields.get("outputs"):
+        payload["output_urls"] = json.loads(fields["outputs"])
+    if fields.get("error"):
+        payload["message"] = fields["error"]
+    return payload
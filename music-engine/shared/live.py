@@ -0,0 +1,41 @@
+"""
+Live mode protocol shared by the API and the live worker
+
+The API queues a session ID on LIVE_QUEUE and keeps the session spec in
+Redis; the live worker generates audio for it and pushes raw PCM frames
+to a per-session list that the API relays to the websocket.
+"""
+
+import os
+from typing import Dict
+
+LIVE_QUEUE = "live_sessions"
+
+SAMPLE_RATE = 32000
+CHANNELS = 1
+SAMPLE_FORMAT = "pcm_s16le"
+
+# Seconds of audio per frame
+CHUNK_SECONDS = float(os.getenv("LIVE_CHUNK_SECONDS", "2"))
+
+# Session keys expire if the API dies without cleaning up
+SESSION_TTL = 3600
+
+
+def live_keys(session_id: str) -> Dict[str, str]:
+    """Redis keys for a live session"""
+    return {
+        "spec": f"live:{session_id}:spec",
+        "frames": f"live:{session_id}:frames",
+        "stop": f"live:{session_id}:stop"
+    }
+
+
+def stream_format() -> Dict:
+    """Format description sent to the client before the first frame"""
+    return {
+        "format": SAMPLE_FORMAT,
+        "sample_rate": SAMPLE_RATE,
+        "channels": CHANNELS,
+        "chunk_seconds": CHUNK_SECONDS
+    }
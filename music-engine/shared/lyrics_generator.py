@@ -2,13 +2,50 @@
 AI Lyrics Generation using Claude
 
 Generates song lyrics based on genre, mood, and theme
+
+Requests go through one LyricsService per process: identical requests
+(after normalizing case and whitespace) are answered from a TTL cache or
+share the call already in flight, requests arriving together are sent as
+one multi-song call, and at most LYRICS_MAX_CONCURRENCY calls run at
+once, so a playlist's songs are written in parallel instead of one
+round trip after another.
+
+The cache key is genre, mood, theme, structure and style only, so any two
+songs with the same combination inside LYRICS_CACHE_TTL get the same
+lyrics; that includes /generate/auto songs whose random draws coincide.
+Set LYRICS_CACHE_TTL=0 where every song must get fresh lyrics.
 """
 
 import os
-from typing import Dict, Optional, List
+import re
+import copy
+import time
+import asyncio
+import hashlib
+from collections import OrderedDict
+from typing import Any, Dict, Optional, List, Tuple
 import json
 
 
+LYRICS_MODEL = "claude-3-5-sonnet-20241022"
+
+# Normalized requests answered from memory for this long (0 disables)
+LYRICS_CACHE_TTL = float(os.getenv("LYRICS_CACHE_TTL", "3600"))
+LYRICS_CACHE_MAX_ENTRIES = int(os.getenv("LYRICS_CACHE_MAX_ENTRIES", "1000"))
+
+# Requests arriving within LYRICS_BATCH_WAIT_MS share one call of up to
+# LYRICS_BATCH_SIZE songs
+LYRICS_BATCH_SIZE = int(os.getenv("LYRICS_BATCH_SIZE", "4"))
+LYRICS_BATCH_WAIT_MS = int(os.getenv("LYRICS_BATCH_WAIT_MS", "50"))
+
+# Upstream calls in flight at once
+LYRICS_MAX_CONCURRENCY = int(os.getenv("LYRICS_MAX_CONCURRENCY", "4"))
+
+# Output tokens per song (a batch asks for this many per song)
+LYRICS_MAX_TOKENS = 2000
+LYRICS_BATCH_MAX_TOKENS = 8000
+
+
 def generate_lyrics_prompt(
     genre: str,
     mood: str,
@@ -59,19 +96,86 @@ Generate the lyrics now:"""
     return prompt
 
 
-def parse_lyrics_response(response: str) -> Dict:
-    """Parse Claude's response into structured lyrics"""
+def generate_batch_lyrics_prompt(requests: List[Dict[str, Any]]) -> str:
+    """
+    One prompt asking for several songs' lyrics
+
+    Args:
+        requests: generate_lyrics_prompt keyword arguments, one per song
+    """
+    songs = []
+    for i, request in enumerate(requests):
+        structure = request.get("song_structure") or ["verse", "chorus", "verse", "chorus", "bridge", "chorus"]
+        theme = f", theme: {request['theme']}" if request.get("theme") else ""
+        songs.append(
+            f"{i}. A {request['genre']} track with a {request['mood']} mood{theme}; "
+            f"style: {request.get('style', 'catchy')}; structure: {', '.join(structure)}"
+        )
+    listing = "\n".join(songs)
+
+    return f"""Generate song lyrics for each of these {len(requests)} songs. Every song is separate: give each its own title and lyrics.
+
+{listing}
+
+Requirements for every song:
+- Write complete lyrics for each section of its structure
+- Make the chorus catchy and memorable
+- Match the emotional tone to its mood and fit its genre conventions
+- Be creative and original
+- Use vivid imagery
+
+Format the output as JSON with this structure, one entry per song in the order listed:
+{{
+  "songs": [
+    {{
+      "index": 0,
+      "title": "Song Title",
+      "sections": [
+        {{"type": "verse", "lyrics": ["line 1", "line 2", ...]}},
+        {{"type": "chorus", "lyrics": ["line 1", "line 2", ...]}}
+      ],
+      "theme": "brief theme description",
+      "mood_tags": ["tag1", "tag2", "tag3"]
+    }}
+  ]
+}}
+
+Generate the lyrics now:"""
+
+
+def extract_json(response: str) -> Optional[Dict]:
+    """The outermost JSON object in a response, or None"""
+    start = response.find("{")
+    end = response.rfind("}") + 1
+    if start < 0 or end <= start:
+        return None
     try:
-        # Try to extract JSON from response
-        start = response.find("{")
-        end = response.rfind("}") + 1
+        data = json.loads(response[start:end])
+    except ValueError:
+        return None
+    return data if isinstance(data, dict) else None
+
 
-        if start >= 0 and end > start:
-            json_str = response[start:end]
-            lyrics_data = json.loads(json_str)
-            return lyrics_data
-    except:
-        pass
+def parse_batch_lyrics_response(response: str, count: int) -> List[Optional[Dict]]:
+    """Songs from a batch response in request order (None where one is missing)"""
+    data = extract_json(response) or {}
+    songs = data.get("songs") if isinstance(data.get("songs"), list) else []
+
+    results: List[Optional[Dict]] = [None] * count
+    for position, song in enumerate(songs):
+        if not isinstance(song, dict) or not song.get("sections"):
+            continue
+        index = song.pop("index", position)
+        if isinstance(index, int) and 0 <= index < count and results[index] is None:
+            results[index] = song
+    return results
+
+
+def parse_lyrics_response(response: str) -> Dict:
+    """Parse Claude's response into structured lyrics"""
+    lyrics_data = extract_json(response)
+    if lyrics_data is not None:
+        return lyrics_data
 
     # Fallback: simple parsing
     return {
@@ -85,6 +189,166 @@ def parse_lyrics_response(response: str) -> Dict:
     }
 
 
+def lyrics_request_key(
+    genre: str,
+    mood: str,
+    theme: Optional[str] = None,
+    structure: Optional[List[str]] = None,
+    style: str = "catchy"
+) -> str:
+    """Cache key of a request: case and whitespace don't make prompts different"""
+    def norm(value: Optional[str]) -> str:
+        return re.sub(r"\s+", " ", (value or "").strip().lower())
+
+    fields = [norm(genre), norm(mood), norm(theme), [norm(s) for s in structure or []], norm(style)]
+    return hashlib.sha1(json.dumps(fields).encode()).hexdigest()
+
+
+class LyricsService:
+    """Cached, deduplicated, batched and rate-bounded Claude lyrics calls"""
+
+    def __init__(
+        self,
+        cache_ttl: float = LYRICS_CACHE_TTL,
+        max_entries: int = LYRICS_CACHE_MAX_ENTRIES,
+        batch_size: int = LYRICS_BATCH_SIZE,
+        batch_wait_ms: int = LYRICS_BATCH_WAIT_MS,
+        max_concurrency: int = LYRICS_MAX_CONCURRENCY
+    ):
+        self.cache_ttl = cache_ttl
+        self.max_entries = max_entries
+        self.batch_size = max(1, batch_size)
+        self.batch_wait = batch_wait_ms / 1000
+        self.max_concurrency = max(1, max_concurrency)
+        self._cache: "OrderedDict[str, Tuple[float, Dict]]" = OrderedDict()  # key -> (expires, lyrics)
+        self._inflight: Dict[str, asyncio.Future] = {}
+        self._pending: List[Tuple[str, Dict[str, Any], asyncio.Future]] = []
+        self._flush_handle: Optional[asyncio.TimerHandle] = None
+        self._slots: Optional[asyncio.Semaphore] = None
+        self._client = None
+        self._client_key = None
+        self.stats = {"hits": 0, "coalesced": 0, "calls": 0, "batched": 0, "failures": 0}
+
+    async def generate(
+        self,
+        api_key: str,
+        genre: str,
+        mood: str,
+        theme: Optional[str] = None,
+        structure: Optional[List[str]] = None,
+        style: str = "catchy"
+    ) -> Dict:
+        """Lyrics for one song (placeholder lyrics if the call fails)"""
+        key = lyrics_request_key(genre, mood, theme, structure, style)
+
+        cached = self._cache_get(key)
+        if cached is not None:
+            self.stats["hits"] += 1
+            return cached
+
+        future = self._inflight.get(key)
+        if future is not None:
+            self.stats["coalesced"] += 1
+        else:
+            future = asyncio.get_running_loop().create_future()
+            self._inflight[key] = future
+            request = {"genre": genre, "mood": mood, "theme": theme, "song_structure": structure, "style": style}
+            self._pending.append((key, request, future))
+            self._schedule_flush(api_key)
+
+        # Shielded: one caller going away doesn't cancel the shared call
+        return copy.deepcopy(await asyncio.shield(future))
+
+    def _schedule_flush(self, api_key: str):
+        loop = asyncio.get_running_loop()
+        if len(self._pending) >= self.batch_size:
+            if self._flush_handle:
+                self._flush_handle.cancel()
+                self._flush_handle = None
+            self._flush(api_key)
+        elif self._flush_handle is None:
+            self._flush_handle = loop.call_later(self.batch_wait, self._flush, api_key)
+
+    def _flush(self, api_key: str):
+        self._flush_handle = None
+        while self._pending:
+            batch, self._pending = self._pending[:self.batch_size], self._pending[self.batch_size:]
+            asyncio.get_running_loop().create_task(self._send(api_key, batch))
+
+    async def _send(self, api_key: str, batch: List[Tuple[str, Dict[str, Any], asyncio.Future]]):
+        if self._slots is None:
+            self._slots = asyncio.Semaphore(self.max_concurrency)
+
+        results: List[Optional[Dict]] = [None] * len(batch)
+        fallback = set()  # indexes holding parse_lyrics_response's stand-in, never cached
+        try:
+            async with self._slots:
+                if len(batch) > 1:
+                    self.stats["batched"] += len(batch)
+                    prompt = generate_batch_lyrics_prompt([request for _, request, _ in batch])
+                    text = await self._call(api_key, prompt, min(LYRICS_MAX_TOKENS * len(batch), LYRICS_BATCH_MAX_TOKENS))
+                    results = parse_batch_lyrics_response(text, len(batch))
+
+                # Singles, and songs a batch response left out, get their own call
+                for i, (_, request, _) in enumerate(batch):
+                    if results[i] is None:
+                        text = await self._call(api_key, generate_lyrics_prompt(**request))
+                        if extract_json(text) is None:
+                            fallback.add(i)
+                        results[i] = parse_lyrics_response(text)
+        except Exception as e:
+            print(f"Error generating lyrics with Claude: {e}")
+
+        for i, ((key, request, future), lyrics) in enumerate(zip(batch, results)):
+            self._inflight.pop(key, None)
+            if lyrics is None:
+                self.stats["failures"] += 1
+                lyrics = generate_placeholder_lyrics(request["genre"], request["mood"], request["song_structure"])
+            elif i not in fallback:
+                self._cache_put(key, lyrics)
+            if not future.done():
+                future.set_result(lyrics)
+
+    async def _call(self, api_key: str, prompt: str, max_tokens: int = LYRICS_MAX_TOKENS) -> str:
+        from anthropic import AsyncAnthropic
+
+        # One client (and connection pool) for every call
+        if self._client is None or self._client_key != api_key:
+            self._client = AsyncAnthropic(api_key=api_key)
+            self._client_key = api_key
+
+        self.stats["calls"] += 1
+        response = await self._client.messages.create(
+            model=LYRICS_MODEL,
+            max_tokens=max_tokens,
+            messages=[
+                {"role": "user", "content": prompt}
+            ]
+        )
+        return response.content[0].text
+
+    def _cache_get(self, key: str) -> Optional[Dict]:
+        entry = self._cache.get(key)
+        if entry is None:
+            return None
+        if time.monotonic() > entry[0]:
+            del self._cache[key]
+            return None
+        self._cache.move_to_end(key)
+        return copy.deepcopy(entry[1])
+
+    def _cache_put(self, key: str, lyrics: Dict):
+        if self.cache_ttl <= 0:
+            return
+        self._cache[key] = (time.monotonic() + self.cache_ttl, lyrics)
+        self._cache.move_to_end(key)
+        while len(self._cache) > self.max_entries:
+            self._cache.popitem(last=False)
+
+
+lyrics_service = LyricsService()
+
+
 async def generate_lyrics_with_claude(
     genre: str,
     mood: str,
@@ -104,34 +368,13 @@ async def generate_lyrics_with_claude(
         return generate_placeholder_lyrics(genre, mood, structure)
 
     try:
-        # Try to use Anthropic API
-        try:
-            from anthropic import AsyncAnthropic
-        except ImportError:
-            print("⚠️  anthropic package not installed, using placeholder lyrics")
-            return generate_placeholder_lyrics(genre, mood, structure)
-
-        client = AsyncAnthropic(api_key=api_key)
-
-        prompt = generate_lyrics_prompt(genre, mood, theme, structure)
-
-        response = await client.messages.create(
-            model="claude-3-5-sonnet-20241022",
-            max_tokens=2000,
-            messages=[
-                {"role": "user", "content": prompt}
-            ]
-        )
-
-        lyrics_text = response.content[0].text
-        lyrics_data = parse_lyrics_response(lyrics_text)
-
-        return lyrics_data
-
-    except Exception as e:
-        print(f"Error generating lyrics with Claude: {e}")
+        import anthropic  # noqa: F401
+    except ImportError:
+        print("⚠️  anthropic package not installed, using placeholder lyrics")
         return generate_placeholder_lyrics(genre, mood, structure)
 
+    return await lyrics_service.generate(api_key, genre, mood, theme, structure)
+
 
 def generate_placeholder_lyrics(
     genre: str,
@@ -0,0 +1,167 @@
+"""
+Content-addressed render cache shared by the API and the worker
+
+Specs that would render identical audio map to one render key. The API
+claims the key for the first job (render:{key} -> job_id) and later
+requests for the same key reuse that job, whether it is still running or
+already finished. The worker records finished renders in an LRU index and
+deletes the oldest outputs once the cache grows past its size bounds.
+"""
+
+import hashlib
+import json
+import os
+import shutil
+import time
+from typing import Dict, Optional
+
+from shared.jobs import job_key
+
+RENDER_CACHE_ENABLED = os.getenv("RENDER_CACHE", "true").lower() == "true"
+
+# Bounds on finished renders kept in OUTPUT_DIR
+RENDER_CACHE_MAX_BYTES = int(os.getenv("RENDER_CACHE_MAX_BYTES", str(20 * 1024**3)))
+RENDER_CACHE_MAX_ENTRIES = int(os.getenv("RENDER_CACHE_MAX_ENTRIES", "2000"))
+
+# Part of every key: bump when the DDSP/mixing chain changes its output
+RENDER_VERSION = "1"
+RENDER_MODEL = os.getenv("MUSICGEN_MODEL", "facebook/musicgen-medium")
+
+# Spec fields the worker reads, with the defaults it applies
+RENDER_FIELDS = {
+    "bpm": 120,
+    "key": "C minor",
+    "duration": 30,
+    "vibe": {},
+    "genre_mix": {},
+    "instruments": {},
+    "stems": True,
+    "seed": None,
+    "temperature": 1.0,
+    "cfg_coef": 3.0
+}
+
+LRU_KEY = "render:lru"
+BYTES_KEY = "render:bytes"
+STATS_KEY = "render:stats"
+
+
+def entry_key(key: str) -> str:
+    """Hash mapping a render key to the job that rendered it"""
+    return f"render:{key}"
+
+
+def _normalize(value):
+    if isinstance(value, float):
+        return round(value, 6)
+    if isinstance(value, dict):
+        # Zero weights and missing weights render the same
+        return {k: _normalize(v) for k, v in value.items() if v not in (0, 0.0, None)}
+    return value
+
+
+def normalize_spec(spec: Dict) -> Dict:
+    """The parts of a spec that affect the rendered audio"""
+    return {
+        field: _normalize(spec.get(field, default))
+        for field, default in RENDER_FIELDS.items()
+    }
+
+
+def render_key(spec: Dict, remix_of: Optional[str] = None, retain_stems: bool = False) -> str:
+    """
+    Cache key for a spec under the current model and render version
+
+    Re-mixes are keyed by the job whose stems they mix, and jobs that keep
+    their stems only match others that did.
+    """
+    keyed = {
+        "spec": normalize_spec(spec),
+        "model": RENDER_MODEL,
+        "version": RENDER_VERSION
+    }
+    if remix_of:
+        keyed["remix_of"] = remix_of
+    if retain_stems:
+        keyed["stems"] = True
+    return hashlib.sha256(json.dumps(keyed, sort_keys=True).encode()).hexdigest()[:32]
+
+
+def _dir_size(path: str) -> int:
+    total = 0
+    for root, _, files in os.walk(path):
+        for name in files:
+            total += os.path.getsize(os.path.join(root, name))
+    return total
+
+
+def record_render(r, key: str, job_id: str, output_dir: str):
+    """
+    Mark a finished render as cached and evict past the size bounds
+    (sync client, called by the worker)
+    """
+    size = _dir_size(os.path.join(output_dir, job_id))
+
+    pipe = r.pipeline()
+    pipe.hset(entry_key(key), mapping={"job_id": job_id, "state": "ready", "bytes": size})
+    pipe.zadd(LRU_KEY, {key: time.time()})
+    pipe.incrby(BYTES_KEY, size)
+    pipe.execute()
+
+    # The job just finished is never its own victim, even if it alone exceeds the bounds
+    evict(r, output_dir, keep=key)
+
+
+def release_render(r, key: str, job_id: str):
+    """Drop a claim whose job failed so the next request renders again"""
+    if r.hget(entry_key(key), "job_id") == job_id:
+        r.delete(entry_key(key))
+
+
+def evict(r, output_dir: str, keep: Optional[str] = None) -> int:
+    """Delete least recently used renders until within bounds (or down to keep)"""
+    evicted = 0
+
+    while (int(r.get(BYTES_KEY) or 0) > RENDER_CACHE_MAX_BYTES
+           or r.zcard(LRU_KEY) > RENDER_CACHE_MAX_ENTRIES):
+        oldest = r.zpopmin(LRU_KEY)
+        if not oldest:
+            break
+        key, score = oldest[0]
+        if key == keep:
+            r.zadd(LRU_KEY, {key: score})
+            break
+
+        entry = r.hgetall(entry_key(key))
+        job_id = entry.get("job_id")
+        if job_id:
+            shutil.rmtree(os.path.join(output_dir, job_id), ignore_errors=True)
+
+        pipe = r.pipeline()
+        pipe.delete(entry_key(key))
+        pipe.decrby(BYTES_KEY, int(entry.get("bytes") or 0))
+        pipe.hincrby(STATS_KEY, "evictions", 1)
+        if job_id:
+            pipe.hset(job_key(job_id), "status", "evicted")
+        pipe.execute()
+        evicted += 1
+
+    return evicted
+
+
+def cache_stats(stats: Dict[str, str], entries: int, size: Optional[str]) -> Dict:
+    """Report for /health from the stats hash, LRU size and byte total"""
+    hits = int(stats.get("hits") or 0)
+    coalesced = int(stats.get("coalesced") or 0)
+    misses = int(stats.get("misses") or 0)
+    lookups = hits + coalesced + misses
+    return {
+        "enabled": RENDER_CACHE_ENABLED,
+        "entries": entries,
+        "bytes": int(size or 0),
+        "hits": hits,
+        "coalesced": coalesced,
+        "misses": misses,
+        "evictions": int(stats.get("evictions") or 0),
+        "hit_rate": round((hits + coalesced) / lookups, 4) if lookups else 0.0
+    }
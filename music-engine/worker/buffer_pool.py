@@ -0,0 +1,175 @@
+"""
+Scratch buffer pool - DSP temporaries reused across worker jobs
+
+Full-length buffers (band-filtered stems, effect outputs, the mix) are
+checked out of per-size-class free lists instead of being allocated
+fresh for every job, so a long-running worker keeps reusing the same
+few large blocks rather than fragmenting the heap with new ones.
+
+    with pool.job():
+        mix = pool.zeros(frames, np.float32)
+        ...
+
+Buffers are numpy views over pooled uint8 storage. Everything checked
+out during a job goes back to the pool when the job ends; release()
+returns a buffer early. Outside a job, requests fall through to plain
+numpy allocation. Nothing checked out may outlive its job.
+"""
+
+import os
+import threading
+from contextlib import contextmanager
+from typing import Dict, List, Tuple
+
+import numpy as np
+
+
+BUFFER_POOL_ENABLED = os.getenv("BUFFER_POOL", "true").lower() == "true"
+
+# Idle bytes kept between jobs (largest classes are dropped first)
+BUFFER_POOL_MAX_MB = int(os.getenv("BUFFER_POOL_MAX_MB", "1024"))
+
+# Smaller requests are left to numpy's allocator
+MIN_POOLED_BYTES = 64 * 1024
+
+
+def size_class(nbytes: int) -> int:
+    """Pooled size for a request: quarter-octave steps, so at most 25% waste"""
+    if nbytes <= MIN_POOLED_BYTES:
+        return MIN_POOLED_BYTES
+    step = (1 << (nbytes - 1).bit_length()) // 8
+    return -(-nbytes // step) * step
+
+
+class BufferPool:
+    """Free lists of raw storage keyed by size class"""
+
+    def __init__(self, max_idle_bytes: int, enabled: bool = True):
+        self.max_idle_bytes = max_idle_bytes
+        self.enabled = enabled
+        self._lock = threading.Lock()
+        self._free: Dict[int, List[np.ndarray]] = {}
+        self._out: Dict[int, Tuple[np.ndarray, np.ndarray]] = {}  # id(view) -> (view, storage)
+        self._jobs = 0
+
+        self.hits = 0
+        self.misses = 0
+        self.in_use_bytes = 0
+        self.idle_bytes = 0
+        self.high_water_bytes = 0
+        self.job_high_water_bytes = 0
+
+    def empty(self, shape, dtype=np.float32) -> np.ndarray:
+        """Uninitialized buffer, from the pool while a job is running"""
+        dtype = np.dtype(dtype)
+        count = int(np.prod(shape))
+        nbytes = count * dtype.itemsize
+        if not self._jobs or nbytes < MIN_POOLED_BYTES:
+            return np.empty(shape, dtype)
+
+        size = size_class(nbytes)
+        with self._lock:
+            free = self._free.get(size)
+            if free:
+                storage = free.pop()
+                self.idle_bytes -= size
+                self.hits += 1
+            else:
+                storage = None
+                self.misses += 1
+            self.in_use_bytes += size
+            self.high_water_bytes = max(self.high_water_bytes, self.in_use_bytes)
+            self.job_high_water_bytes = max(self.job_high_water_bytes, self.in_use_bytes)
+
+        if storage is None:
+            storage = np.empty(size, np.uint8)
+        view = np.frombuffer(storage, dtype=dtype, count=count).reshape(shape)
+        with self._lock:
+            self._out[id(view)] = (view, storage)
+        return view
+
+    def zeros(self, shape, dtype=np.float32) -> np.ndarray:
+        buffer = self.empty(shape, dtype)
+        buffer.fill(0)
+        return buffer
+
+    def empty_like(self, audio: np.ndarray) -> np.ndarray:
+        return self.empty(audio.shape, audio.dtype)
+
+    def copy(self, audio: np.ndarray) -> np.ndarray:
+        buffer = self.empty_like(audio)
+        buffer[...] = audio
+        return buffer
+
+    def release(self, view: np.ndarray):
+        """Return a buffer before the job ends (no-op if it isn't pooled)"""
+        with self._lock:
+            entry = self._out.pop(id(view), None)
+            if entry is not None:
+                self._put(entry[1])
+
+    def release_all(self):
+        """Return every checked-out buffer, then trim idle storage to the cap"""
+        with self._lock:
+            for _, storage in self._out.values():
+                self._put(storage)
+            self._out.clear()
+
+            for size in sorted(self._free, reverse=True):
+                free = self._free[size]
+                while free and self.idle_bytes > self.max_idle_bytes:
+                    free.pop()
+                    self.idle_bytes -= size
+
+    def _put(self, storage: np.ndarray):
+        self._free.setdefault(storage.nbytes, []).append(storage)
+        self.in_use_bytes -= storage.nbytes
+        self.idle_bytes += storage.nbytes
+
+    @contextmanager
+    def job(self):
+        """Scope whose checkouts are all returned when it exits"""
+        if not self.enabled:
+            yield self
+            return
+
+        with self._lock:
+            if not self._jobs:
+                self.job_high_water_bytes = self.in_use_bytes
+            self._jobs += 1
+        try:
+            yield self
+        finally:
+            with self._lock:
+                self._jobs -= 1
+                last = not self._jobs
+            if last:
+                self.release_all()
+
+    def stats(self) -> Dict:
+        """Hit rate and memory high-water marks"""
+        checkouts = self.hits + self.misses
+        mb = 1024 * 1024
+        return {
+            "hits": self.hits,
+            "misses": self.misses,
+            "hit_rate": round(self.hits / checkouts, 3) if checkouts else None,
+            "in_use_mb": round(self.in_use_bytes / mb, 1),
+            "idle_mb": round(self.idle_bytes / mb, 1),
+            "high_water_mb": round(self.high_water_bytes / mb, 1),
+            "job_high_water_mb": round(self.job_high_water_bytes / mb, 1)
+        }
+
+
+pool = BufferPool(BUFFER_POOL_MAX_MB * 1024 * 1024, enabled=BUFFER_POOL_ENABLED)
+
+
+def pool_stats_key(consumer_name: str) -> str:
+    """Hash holding one worker's buffer pool stats"""
+    return f"worker:buffer_pool:{consumer_name}"
+
+
+def publish_pool_stats(r, consumer_name: str):
+    """Publish the pool's hit rate and high-water marks (sync Redis client)"""
+    stats = {name: "" if value is None else value for name, value in pool.stats().items()}
+    r.hset(pool_stats_key(consumer_name), mapping=stats)
@@ -0,0 +1,246 @@
+"""
+Redis Streams consumer for the music worker
+
+Reads jobs through the shared consumer group, keeps pending entries alive
+while they run, claims entries abandoned by crashed workers and moves
+entries that keep failing delivery to the dead-letter stream.
+"""
+
+import redis
+import json
+import os
+import socket
+import threading
+import time
+from typing import Callable, Dict, List, NamedTuple, Optional, Tuple
+
+from shared.job_queue import GROUP, LANES, DEAD_LETTER, LEGACY_QUEUE, job_lane
+
+
+# A pending entry idle this long (no heartbeat) is claimed by another worker
+CLAIM_IDLE_MS = int(os.getenv("CLAIM_IDLE_MS", "60000"))
+
+# How often running entries are touched, and abandoned ones looked for
+HEARTBEAT_SECONDS = float(os.getenv("HEARTBEAT_SECONDS", "15"))
+RECLAIM_INTERVAL = float(os.getenv("RECLAIM_INTERVAL", "30"))
+
+# Deliveries before an entry is dead-lettered
+MAX_DELIVERIES = int(os.getenv("MAX_DELIVERIES", "3"))
+
+
+class QueuedJob(NamedTuple):
+    """A job read from a lane and not yet acknowledged"""
+    stream: str
+    entry_id: str
+    data: Dict
+    lane: int
+
+
+def consumer_name() -> str:
+    """Stable per worker slot (WORKER_ID), so a restart resumes its entries"""
+    return os.getenv("WORKER_ID") or f"{socket.gethostname()}-{os.getpid()}"
+
+
+class JobConsumer:
+    """
+    One worker's view of the job lanes (the GPU lanes unless given)
+
+    Jobs read but not yet run wait in a small local backlog (they are
+    already pending under this consumer, so a crash loses nothing). Each
+    batch starts with the highest-priority job available.
+    """
+
+    def __init__(
+        self,
+        r: redis.Redis,
+        name: Optional[str] = None,
+        on_dead_letter: Optional[Callable[[Dict], None]] = None,
+        lanes: Tuple[str, ...] = LANES
+    ):
+        self.r = r
+        self.name = name or consumer_name()
+        self.lanes = lanes
+        self.on_dead_letter = on_dead_letter
+        self.backlog: List[QueuedJob] = []
+        self._held = {}  # (stream, entry_id) -> QueuedJob, backlog and running
+        self._held_lock = threading.Lock()
+        self._last_reclaim = 0.0
+        self._stopped = threading.Event()
+        self._heartbeat = threading.Thread(target=self._touch_loop, name="queue-heartbeat", daemon=True)
+
+    def start(self):
+        """Create the group, recover this consumer's own entries, start heartbeats"""
+        for stream in self.lanes:
+            try:
+                self.r.xgroup_create(stream, GROUP, id="0", mkstream=True)
+            except redis.ResponseError as e:
+                if "BUSYGROUP" not in str(e):
+                    raise
+
+        self._migrate_legacy()
+
+        # Entries this consumer read before a restart (id "0" = own pending)
+        for stream in self.lanes:
+            self.backlog.extend(self._track(self.r.xreadgroup(GROUP, self.name, {stream: "0"})))
+        if self.backlog:
+            print(f"Recovered {len(self.backlog)} pending jobs for {self.name}")
+
+        self._heartbeat.start()
+
+    def stop(self):
+        """Leave the group cleanly if nothing is still held"""
+        self._stopped.set()
+        if not self._held:
+            for stream in self.lanes:
+                self.r.xgroup_delconsumer(stream, GROUP, self.name)
+
+    def collect_batch(self, key: Callable[[Dict], tuple], size: int, wait_ms: int, timeout: int = 5) -> List[QueuedJob]:
+        """
+        Next batch of jobs with equal key(spec)
+
+        Blocks up to timeout seconds for the first job, then gathers
+        matching jobs for up to wait_ms. Jobs that don't match stay in the
+        backlog for a later batch.
+        """
+        if time.monotonic() - self._last_reclaim > RECLAIM_INTERVAL:
+            self.reclaim()
+
+        # Make sure a waiting priority job is considered before the backlog
+        if not any(job.lane == 0 for job in self.backlog):
+            self.backlog.extend(self._read(1, block_ms=None if self.backlog else timeout * 1000))
+        if not self.backlog:
+            return []
+
+        first = min(self.backlog, key=lambda job: job.lane)
+        self.backlog.remove(first)
+        batch_key = key(first.data["spec"])
+        batch = [first]
+        deadline = time.monotonic() + wait_ms / 1000
+
+        while len(batch) < size:
+            match = next((job for job in self.backlog if key(job.data["spec"]) == batch_key), None)
+            if match:
+                self.backlog.remove(match)
+                batch.append(match)
+                continue
+
+            # Don't hoard jobs other workers could run
+            if time.monotonic() >= deadline or len(self.backlog) >= size:
+                break
+
+            fresh = self._read(size - len(batch))
+            if not fresh:
+                time.sleep(0.01)
+            self.backlog.extend(fresh)
+
+        return batch
+
+    def ack(self, job: QueuedJob):
+        """Acknowledge and delete a finished job's entry"""
+        pipe = self.r.pipeline()
+        pipe.xack(job.stream, GROUP, job.entry_id)
+        pipe.xdel(job.stream, job.entry_id)
+        pipe.execute()
+        with self._held_lock:
+            self._held.pop((job.stream, job.entry_id), None)
+
+    def reclaim(self) -> int:
+        """
+        Claim entries other consumers left idle past CLAIM_IDLE_MS
+
+        Entries already delivered MAX_DELIVERIES times are dead-lettered
+        instead. Returns the number of entries claimed.
+        """
+        self._last_reclaim = time.monotonic()
+        claimed = 0
+
+        for stream in self.lanes:
+            for pending in self.r.xpending_range(stream, GROUP, "-", "+", 100, idle=CLAIM_IDLE_MS):
+                entry_id = pending["message_id"]
+                if (stream, entry_id) in self._held:
+                    continue
+
+                if pending["times_delivered"] >= MAX_DELIVERIES:
+                    self._dead_letter(stream, entry_id, pending["times_delivered"])
+                    continue
+
+                entries = self.r.xclaim(stream, GROUP, self.name, CLAIM_IDLE_MS, [entry_id])
+                jobs = self._track([[stream, entries]])
+                if jobs:
+                    print(f"Claimed job {jobs[0].data['job_id']} from {pending['consumer']}")
+                self.backlog.extend(jobs)
+                claimed += len(jobs)
+
+        return claimed
+
+    def _read(self, count: int, block_ms: Optional[int] = None) -> List[QueuedJob]:
+        """New entries, strictly from the highest lane that has any"""
+        for stream in self.lanes:
+            entries = self.r.xreadgroup(GROUP, self.name, {stream: ">"}, count=count)
+            if entries:
+                return self._track(entries)
+
+        if block_ms is None:
+            return []
+        return self._track(self.r.xreadgroup(
+            GROUP, self.name, {stream: ">" for stream in self.lanes}, count=count, block=block_ms
+        ))
+
+    def _track(self, results) -> List[QueuedJob]:
+        jobs = []
+        for stream, entries in results or []:
+            for entry_id, fields in entries:
+                if not fields:
+                    # Deleted while pending
+                    self.r.xack(stream, GROUP, entry_id)
+                    continue
+                job = QueuedJob(stream, entry_id, json.loads(fields["job"]), self.lanes.index(stream))
+                with self._held_lock:
+                    self._held[(stream, entry_id)] = job
+                jobs.append(job)
+        return jobs
+
+    def _dead_letter(self, stream: str, entry_id: str, deliveries: int):
+        entries = self.r.xrange(stream, entry_id, entry_id)
+        fields = entries[0][1] if entries else {}
+
+        pipe = self.r.pipeline()
+        if fields:
+            pipe.xadd(DEAD_LETTER, {**fields, "stream": stream, "entry_id": entry_id, "deliveries": deliveries})
+        pipe.xack(stream, GROUP, entry_id)
+        pipe.xdel(stream, entry_id)
+        pipe.execute()
+
+        if fields:
+            job_data = json.loads(fields["job"])
+            print(f"Dead-lettered job {job_data['job_id']} after {deliveries} deliveries")
+            if self.on_dead_letter:
+                self.on_dead_letter(job_data)
+
+    def _touch_loop(self):
+        """Reset idle time on held entries so they aren't claimed away"""
+        while not self._stopped.wait(HEARTBEAT_SECONDS):
+            with self._held_lock:
+                held = list(self._held)
+
+            by_stream = {}
+            for stream, entry_id in held:
+                by_stream.setdefault(stream, []).append(entry_id)
+
+            for stream, entry_ids in by_stream.items():
+                try:
+                    self.r.xclaim(stream, GROUP, self.name, 0, entry_ids, justid=True)
+                except redis.RedisError as e:
+                    print(f"Queue heartbeat failed: {e}")
+
+    def _migrate_legacy(self):
+        """Move jobs left on the pre-Streams list queue onto the lanes"""
+        moved = 0
+        while True:
+            raw = self.r.rpop(LEGACY_QUEUE)
+            if raw is None:
+                break
+            self.r.xadd(job_lane(json.loads(raw)), {"job": raw})
+            moved += 1
+        if moved:
+            print(f"Moved {moved} jobs from the legacy {LEGACY_QUEUE} list")
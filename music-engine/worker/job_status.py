@@ -0,0 +1,34 @@
+"""
+Job status updates shared by the generation and re-mix workers
+"""
+
+import json
+
+import redis
+
+from shared.jobs import job_key, job_channel, status_fields
+from shared.render_cache import release_render
+
+
+def update_status(r: redis.Redis, job_id: str, status: str, progress: float = None, **extra):
+    """
+    Update job status in Redis
+
+    The hash write and the event publish go out as one MULTI, so
+    subscribers never see an update that a status read would not.
+    Extra fields (outputs, error) are stored alongside the status.
+    """
+    fields = status_fields(status, progress, **extra)
+    pipe = r.pipeline()
+    pipe.hset(job_key(job_id), mapping=fields)
+    pipe.publish(job_channel(job_id), json.dumps(fields))
+    pipe.execute()
+    print(f"[{job_id}] Status: {status} ({progress}%)" if progress else f"[{job_id}] Status: {status}")
+
+
+def fail_job(r: redis.Redis, job_id: str, error: Exception, render_key: str = None):
+    """Mark a job as failed and release its render cache claim"""
+    print(f"[{job_id}] ❌ Error: {str(error)}")
+    update_status(r, job_id, "failed", 0, error=str(error))
+    if render_key:
+        release_render(r, render_key, job_id)
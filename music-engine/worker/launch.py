@@ -0,0 +1,85 @@
+"""
+StaticWaves Worker Launcher - one music worker per GPU
+
+Starts worker.py once per GPU with CUDA_VISIBLE_DEVICES pinned to that
+device, so each process keeps its own resident MusicGen model and reads
+from the shared consumer group. Each slot gets a stable WORKER_ID, so a
+restarted worker resumes the jobs it held. Crashed workers are restarted.
+"""
+
+import os
+import signal
+import socket
+import subprocess
+import sys
+import time
+
+# Explicit device list ("0,1,2"), otherwise every GPU nvidia-smi reports
+GPU_IDS = os.getenv("GPU_IDS", "")
+
+# Seconds before restarting a worker that exited
+RESTART_DELAY = float(os.getenv("WORKER_RESTART_DELAY", "5"))
+
+WORKER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "worker.py")
+
+
+def gpu_ids() -> list:
+    """Devices to run workers on (one CPU worker if none are found)"""
+    if GPU_IDS:
+        return [gpu.strip() for gpu in GPU_IDS.split(",") if gpu.strip()]
+
+    try:
+        listing = subprocess.run(["nvidia-smi", "-L"], capture_output=True, text=True, check=True).stdout
+        count = sum(1 for line in listing.splitlines() if line.startswith("GPU "))
+    except (OSError, subprocess.CalledProcessError):
+        count = 0
+
+    return [str(i) for i in range(count)] or [""]
+
+
+def spawn(gpu: str) -> subprocess.Popen:
+    """Start a worker pinned to one GPU"""
+    env = dict(os.environ, CUDA_VISIBLE_DEVICES=gpu)
+    env.setdefault("WORKER_ID", socket.gethostname())
+    env["WORKER_ID"] += f"-gpu{gpu}" if gpu else "-cpu"
+    print(f"Starting worker {env['WORKER_ID']}")
+    return subprocess.Popen([sys.executable, WORKER], env=env)
+
+
+def main():
+    """Run and supervise one worker per GPU"""
+    gpus = gpu_ids()
+    print(f"🚀 Launching {len(gpus)} music worker(s): GPUs {', '.join(gpus) or 'none'}")
+
+    workers = {gpu: spawn(gpu) for gpu in gpus}
+    exited_at = {}
+    stopping = False
+
+    def shutdown(signum, frame):
+        nonlocal stopping
+        stopping = True
+        for process in workers.values():
+            if process.poll() is None:
+                process.send_signal(signal.SIGINT)
+
+    signal.signal(signal.SIGTERM, shutdown)
+    signal.signal(signal.SIGINT, shutdown)
+
+    while not stopping:
+        time.sleep(1)
+        for gpu, process in workers.items():
+            if process.poll() is None:
+                continue
+            if gpu not in exited_at:
+                print(f"⚠️  Worker on GPU {gpu or 'cpu'} exited with {process.returncode}")
+                exited_at[gpu] = time.monotonic()
+            elif time.monotonic() - exited_at[gpu] >= RESTART_DELAY:
+                del exited_at[gpu]
+                workers[gpu] = spawn(gpu)
+
+    for process in workers.values():
+        process.wait()
+
+
+if __name__ == "__main__":
+    main()
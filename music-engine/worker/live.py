@@ -0,0 +1,168 @@
+"""
+StaticWaves Live Worker - streaming generation for the /live websocket
+
+This worker:
+1. Picks up live sessions queued by the API
+2. Generates audio chunk by chunk, each continuing the previous one
+3. Applies the session's latest vibe to each chunk just before sending it
+4. Pushes PCM frames to Redis for the API to relay
+"""
+
+import redis
+import json
+import os
+import sys
+import time
+import queue
+import threading
+import numpy as np
+
+sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+from musicgen_engine import get_model
+from mixer import VibeStream
+from shared.utils import spec_to_prompt
+from shared.live import LIVE_QUEUE, SAMPLE_RATE, CHUNK_SECONDS, SESSION_TTL, live_keys
+
+
+# Configuration
+REDIS_HOST = os.getenv("REDIS_HOST", "localhost")
+REDIS_PORT = int(os.getenv("REDIS_PORT", "6379"))
+
+# Seconds of previous audio each chunk is conditioned on
+LIVE_CONTEXT_SECONDS = float(os.getenv("LIVE_CONTEXT_SECONDS", "6"))
+
+# Jitter buffer: raw chunks generated ahead of playback
+LIVE_LOOKAHEAD = int(os.getenv("LIVE_LOOKAHEAD", "2"))
+
+# Backpressure: processed frames waiting for the API. Vibe is applied as a
+# frame is queued, so a slider change is heard within this many chunks.
+LIVE_MAX_BUFFERED = int(os.getenv("LIVE_MAX_BUFFERED", "1"))
+
+# End a session whose frames have not been consumed for this long
+LIVE_IDLE_TIMEOUT = float(os.getenv("LIVE_IDLE_TIMEOUT", "30"))
+
+
+def encode_pcm16(audio: np.ndarray) -> bytes:
+    """Encode float audio in [-1, 1] as little-endian 16-bit PCM"""
+    return (np.clip(audio, -1.0, 1.0) * 32767).astype('<i2').tobytes()
+
+
+class LiveSession:
+    """
+    One live stream
+
+    A generator thread keeps up to LIVE_LOOKAHEAD raw chunks ready, which
+    absorbs variation in generation time. The main loop sends one frame
+    whenever the API has drained the previous ones, applying the vibe as of
+    that moment.
+    """
+
+    def __init__(self, r: redis.Redis, session_id: str):
+        self.r = r
+        self.session_id = session_id
+        self.keys = live_keys(session_id)
+        self.raw = queue.Queue(maxsize=LIVE_LOOKAHEAD)
+        self.stopped = threading.Event()
+
+    def spec(self) -> dict:
+        """Latest session spec from the API (empty once the session is gone)"""
+        data = self.r.get(self.keys["spec"])
+        return json.loads(data) if data else {}
+
+    def run(self):
+        """Stream until the client leaves or stops consuming"""
+        print(f"[live:{self.session_id}] Session started")
+        generator = threading.Thread(target=self._generate, name="live-generate", daemon=True)
+        generator.start()
+
+        vibe_stream = VibeStream(SAMPLE_RATE)
+        last_progress = time.monotonic()
+        frames = 0
+
+        try:
+            while not self.stopped.is_set():
+                if self.r.exists(self.keys["stop"]) or not self.r.exists(self.keys["spec"]):
+                    break
+
+                if self.r.llen(self.keys["frames"]) >= LIVE_MAX_BUFFERED:
+                    if time.monotonic() - last_progress > LIVE_IDLE_TIMEOUT:
+                        print(f"[live:{self.session_id}] Client stopped consuming, ending session")
+                        break
+                    time.sleep(0.02)
+                    continue
+
+                try:
+                    audio = self.raw.get(timeout=0.1)
+                except queue.Empty:
+                    continue
+
+                chunk = vibe_stream.process(audio, self.spec().get("vibe", {}))
+                pipe = self.r.pipeline()
+                pipe.rpush(self.keys["frames"], encode_pcm16(chunk))
+                pipe.expire(self.keys["frames"], SESSION_TTL)
+                pipe.execute()
+
+                frames += 1
+                last_progress = time.monotonic()
+        finally:
+            self.stopped.set()
+            generator.join()
+            print(f"[live:{self.session_id}] Session ended after {frames} frames")
+
+    def _generate(self):
+        """Generator thread: extend the stream one chunk at a time"""
+        model = get_model()
+        context = np.zeros(0)
+        position = 0.0
+        context_len = int(LIVE_CONTEXT_SECONDS * SAMPLE_RATE)
+
+        try:
+            while not self.stopped.is_set():
+                spec = self.spec()
+                audio = model.generate_continuation(
+                    spec_to_prompt(spec),
+                    context,
+                    CHUNK_SECONDS,
+                    temperature=spec.get("temperature", 1.0),
+                    cfg_coef=spec.get("cfg_coef", 3.0),
+                    position=position
+                )
+                position += len(audio) / SAMPLE_RATE
+                context = np.concatenate([context, audio])[-context_len:]
+
+                while not self.stopped.is_set():
+                    try:
+                        self.raw.put(audio, timeout=0.1)
+                        break
+                    except queue.Full:
+                        continue
+        except Exception as e:
+            print(f"[live:{self.session_id}] Generation failed: {e}")
+            self.stopped.set()
+
+
+def main():
+    """Main live worker loop"""
+    print("🎧 StaticWaves Live Worker starting...")
+    print(f"Redis: {REDIS_HOST}:{REDIS_PORT}")
+
+    # Binary-safe connection: frames are raw PCM
+    r = redis.Redis(host=REDIS_HOST, port=REDIS_PORT)
+
+    # Load and warm the model before the first session arrives
+    get_model().warm_up()
+    print("✅ Live worker ready, waiting for sessions...")
+
+    while True:
+        try:
+            item = r.brpop(LIVE_QUEUE, timeout=5)
+            if not item:
+                continue
+            LiveSession(r, item[1].decode()).run()
+        except Exception as e:
+            print(f"❌ Live worker error: {e}")
+            time.sleep(1)
+
+
+if __name__ == "__main__":
+    main()
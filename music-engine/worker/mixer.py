@@ -9,12 +9,85 @@ This module:
 
 import numpy as np
 import soundfile as sf
+import math
 import os
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
+from functools import lru_cache
 from pathlib import Path
 from scipy import signal
 
+from shared.tracing import span, bind
+from buffer_pool import pool
+from peaks import PeakReducer, peaks_path
 
-def apply_vibe_effects(audio: np.ndarray, vibe: dict, sample_rate: int = 32000):
+
+# Frames normalized and written per block during export
+EXPORT_BLOCK_SIZE = 65536
+
+# Frames per block for the in-place vibe filter and reverb passes
+EFFECT_BLOCK_SIZE = 65536
+
+# Export options: WAV subtype (PCM_16, PCM_24 or FLOAT), TPDF dither for
+# PCM output, and how many files are written concurrently
+EXPORT_SUBTYPE = os.getenv("EXPORT_SUBTYPE", "PCM_16")
+EXPORT_DITHER = os.getenv("EXPORT_DITHER", "false").lower() == "true"
+EXPORT_WORKERS = max(1, int(os.getenv("EXPORT_WORKERS", "4")))
+
+# Ogg/Opus rendition of the mix for progressive playback (Opus runs at 48kHz)
+EXPORT_OPUS = os.getenv("EXPORT_OPUS", "true").lower() == "true"
+OPUS_SAMPLE_RATE = 48000
+
+# Bit depth per PCM subtype, used to scale the dither to one LSB
+PCM_BITS = {"PCM_16": 16, "PCM_24": 24}
+
+
+@lru_cache(maxsize=64)
+def _vibe_filter_sos(sample_rate: int, cutoff: float, emphasis: float):
+    """
+    Design the linear part of the vibe chain as a single SOS cascade
+
+    The low-pass and the high-pass emphasis (x + k * HP(x)) are both LTI,
+    so they are fused into one cascade. The emphasis folds into a single
+    biquad: 1 + k * B/A = (A + k * B) / A.
+
+    Returns None when neither stage is active.
+    """
+    sections = []
+
+    if cutoff:
+        sections.append(signal.butter(4, cutoff, btype='low', fs=sample_rate, output='sos'))
+
+    if emphasis:
+        hp = signal.butter(2, 200, btype='high', fs=sample_rate, output='sos')
+        b, a = hp[0, :3], hp[0, 3:]
+        sections.append(np.concatenate([a + emphasis * b, a])[np.newaxis, :])
+
+    if not sections:
+        return None
+
+    return np.concatenate(sections)
+
+
+def _sosfilt_into(sos, audio: np.ndarray, out: np.ndarray, block_size: int = EFFECT_BLOCK_SIZE):
+    """sosfilt block by block into out (which may be audio), carrying state"""
+    zi = np.zeros((sos.shape[0], 2), dtype=audio.dtype)
+    for start in range(0, len(audio), block_size):
+        end = start + block_size
+        out[start:end], zi = signal.sosfilt(sos, audio[start:end], zi=zi)
+    return out
+
+
+def _add_delay(audio: np.ndarray, delay: int, wet: float, block_size: int = EFFECT_BLOCK_SIZE):
+    """audio[delay:] += audio[:-delay] * wet in place, one block of temporary"""
+    # Back to front, so every block reads input not yet modified
+    for end in range(len(audio), delay, -block_size):
+        start = max(delay, end - block_size)
+        audio[start:end] += audio[start - delay:end - delay] * wet
+
+
+def apply_vibe_effects(audio: np.ndarray, vibe: dict, sample_rate: int = 32000,
+                       overwrite: bool = False):
     """
     Apply effects based on vibe settings
 
@@ -23,45 +96,115 @@ def apply_vibe_effects(audio: np.ndarray, vibe: dict, sample_rate: int = 32000):
     - dark → low-pass filter, detune
     - dreamy → reverb, chorus
     - aggressive → distortion, transient enhancement
+
+    Saturation is the only non-linear stage, so it runs first and the
+    low-pass, delay and emphasis stages (all LTI) are reordered freely:
+    one sosfilt pass for both filters, then the delay added in place.
+    Output matches the stage-by-stage chain to within float64 rounding
+    (max abs difference < 1e-12 on full-scale input). Float32 audio stays
+    float32 (filter error below -90 dB, under 16-bit quantization). The
+    output is a pooled buffer unless the input was given up.
+
+    Args:
+        overwrite: Allow the input buffer to be reused as scratch space.
+            Always use the return value; the input may or may not hold it.
     """
-    processed = audio.copy()
+    energy = vibe.get("energy", 0.5)
+    dark = vibe.get("dark", 0.3)
+    dreamy = vibe.get("dreamy", 0.4)
+    aggressive = vibe.get("aggressive", 0.2)
+
+    processed = audio
+    owned = overwrite
 
     # Energy → Saturation
-    energy = vibe.get("energy", 0.5)
     if energy > 0.5:
         # Soft clipping for saturation
         drive = 1 + (energy - 0.5) * 2
-        processed = np.tanh(processed * drive) / drive
+        processed = np.multiply(processed, drive, out=processed if owned else pool.empty_like(processed))
+        owned = True
+        np.tanh(processed, out=processed)
+        processed /= drive
 
-    # Dark → Low-pass filter
-    dark = vibe.get("dark", 0.3)
-    if dark > 0.3:
-        # Cutoff frequency based on darkness
-        cutoff = 8000 * (1 - dark * 0.7)  # 8kHz to 2.4kHz
-        sos = signal.butter(4, cutoff, btype='low', fs=sample_rate, output='sos')
-        processed = signal.sosfilt(sos, processed)
+    # Dark → Low-pass filter, cutoff from 8kHz down to 2.4kHz
+    cutoff = 8000 * (1 - dark * 0.7) if dark > 0.3 else 0.0
 
-    # Dreamy → Simple reverb (delay + feedback)
-    dreamy = vibe.get("dreamy", 0.4)
+    # Aggressive → Transient enhancement via high-pass emphasis
+    emphasis = aggressive * 0.3 if aggressive > 0.3 else 0.0
+
+    sos = _vibe_filter_sos(sample_rate, cutoff, emphasis)
+    if sos is not None:
+        out = processed if owned else pool.empty_like(processed)
+        processed = _sosfilt_into(sos.astype(processed.dtype, copy=False), processed, out)
+        owned = True
+
+    # Never hand the caller's buffer back unless it was given up
+    if not owned:
+        processed = pool.copy(processed)
+
+    # Dreamy → Simple reverb (50ms delay tap)
     if dreamy > 0.3:
-        delay_samples = int(0.05 * sample_rate)  # 50ms delay
+        delay_samples = int(0.05 * sample_rate)
         wet = dreamy * 0.3
 
-        reverb = np.zeros_like(processed)
-        reverb[delay_samples:] = processed[:-delay_samples] * wet
-        processed = processed + reverb
-
-    # Aggressive → Transient enhancement
-    aggressive = vibe.get("aggressive", 0.2)
-    if aggressive > 0.3:
-        # High-pass emphasis
-        sos = signal.butter(2, 200, btype='high', fs=sample_rate, output='sos')
-        transients = signal.sosfilt(sos, processed)
-        processed = processed + transients * aggressive * 0.3
+        if len(processed) > delay_samples:
+            _add_delay(processed, delay_samples, wet)
 
     return processed
 
 
+class VibeStream:
+    """
+    The vibe chain for a stream processed chunk by chunk
+
+    Filter state and the reverb delay line carry across chunks, so for a
+    constant vibe the concatenated output equals apply_vibe_effects on the
+    whole signal. The vibe may change between chunks; filter state is kept
+    whenever the new filter has the same number of sections.
+    """
+
+    def __init__(self, sample_rate: int = 32000):
+        self.sample_rate = sample_rate
+        self._zi = None
+        self._delay = np.zeros(int(0.05 * sample_rate))
+
+    def process(self, chunk: np.ndarray, vibe: dict) -> np.ndarray:
+        """Apply vibe to the next mono chunk of the stream"""
+        energy = vibe.get("energy", 0.5)
+        dark = vibe.get("dark", 0.3)
+        dreamy = vibe.get("dreamy", 0.4)
+        aggressive = vibe.get("aggressive", 0.2)
+
+        processed = np.asarray(chunk, dtype=np.float64)
+
+        # Energy → Saturation (stateless)
+        if energy > 0.5:
+            drive = 1 + (energy - 0.5) * 2
+            processed = np.tanh(processed * drive) / drive
+
+        # Dark → Low-pass, Aggressive → high-pass emphasis (one cascade)
+        cutoff = 8000 * (1 - dark * 0.7) if dark > 0.3 else 0.0
+        emphasis = aggressive * 0.3 if aggressive > 0.3 else 0.0
+
+        sos = _vibe_filter_sos(self.sample_rate, cutoff, emphasis)
+        if sos is None:
+            self._zi = None
+        else:
+            if self._zi is None or self._zi.shape[0] != sos.shape[0]:
+                self._zi = np.zeros((sos.shape[0], 2))
+            processed, self._zi = signal.sosfilt(sos, processed, zi=self._zi)
+
+        # Dreamy → 50ms delay tap over the previous chunk's tail
+        history = np.concatenate([self._delay, processed])
+        if dreamy > 0.3:
+            output = processed + history[:len(processed)] * (dreamy * 0.3)
+        else:
+            output = processed.copy()
+        self._delay = history[len(history) - len(self._delay):]
+
+        return output
+
+
 def normalize_audio(audio: np.ndarray, target_db: float = -6.0):
     """
     Normalize audio to target dB level
@@ -87,10 +230,123 @@ def normalize_audio(audio: np.ndarray, target_db: float = -6.0):
     return normalized
 
 
+def peak_level(audio: np.ndarray, block_size: int = EXPORT_BLOCK_SIZE) -> float:
+    """Absolute peak of audio, scanned block-wise to avoid a full-length temporary"""
+    peak = 0.0
+    for start in range(0, len(audio), block_size):
+        peak = max(peak, float(np.abs(audio[start:start + block_size]).max()))
+    return peak
+
+
+def write_normalized(path: str, audio: np.ndarray, sample_rate: int,
+                     target_db: float = -6.0, length: int = None,
+                     subtype: str = EXPORT_SUBTYPE, dither: bool = EXPORT_DITHER,
+                     block_size: int = EXPORT_BLOCK_SIZE,
+                     peaks: PeakReducer = None, opus_path: str = None):
+    """
+    Normalize audio to target dB level and write it as WAV, block by block
+
+    Equivalent to sf.write(path, normalize_audio(audio, target_db)) but
+    only ever holds one (pooled) block of normalized samples. Audio
+    shorter than length is zero-padded in the file rather than in memory.
+
+    Args:
+        subtype: WAV sample format (PCM_16, PCM_24 or FLOAT)
+        dither: Add +/-1 LSB triangular (TPDF) dither before PCM quantization
+        peaks: Reducer fed every normalized block, for the waveform overview
+        opus_path: Also write the normalized audio as Ogg/Opus here
+    """
+    length = len(audio) if length is None else length
+    with span("export.peak_scan"):
+        peak = peak_level(audio, block_size)
+    gain = 10 ** (target_db / 20) / peak if peak > 0 else 1.0
+
+    bits = PCM_BITS.get(subtype)
+    rng = np.random.default_rng() if dither and bits else None
+    dtype = np.float32 if subtype == "FLOAT" else np.result_type(audio, np.float32)
+
+    scratch = pool.empty(min(block_size, len(audio)), audio.dtype)
+    with sf.SoundFile(path, "w", samplerate=sample_rate, channels=1, subtype=subtype) as f:
+        for start in range(0, len(audio), block_size):
+            source = audio[start:start + block_size]
+            block = np.multiply(source, gain, out=scratch[:len(source)])
+            if rng is not None:
+                lsb = 2.0 ** (1 - bits)
+                block += (rng.random(len(block)) - rng.random(len(block))) * lsb
+            np.clip(block, -1.0, 1.0, out=block)
+            if peaks is not None:
+                peaks.add(block)
+            f.write(block.astype(dtype, copy=False))
+        if length > len(audio):
+            padding = np.zeros(length - len(audio), dtype=dtype)
+            if peaks is not None:
+                peaks.add(padding)
+            f.write(padding)
+    pool.release(scratch)
+
+    if opus_path:
+        with span("export.opus"):
+            try:
+                write_opus(opus_path, audio, sample_rate, gain, block_size)
+            except RuntimeError as e:
+                # libsndfile builds without Opus still get the WAV
+                print(f"⚠️  Opus export failed: {e}")
+
+
+def write_opus(path: str, audio: np.ndarray, sample_rate: int, gain: float,
+               block_size: int = EXPORT_BLOCK_SIZE):
+    """
+    Write audio * gain (clipped) as Ogg/Opus at OPUS_SAMPLE_RATE, block by block
+
+    Each block is resampled together with enough neighbouring input for
+    the polyphase filter, so blocks join exactly as a single
+    resample_poly over the whole signal would.
+    """
+    common = math.gcd(sample_rate, OPUS_SAMPLE_RATE)
+    up, down = OPUS_SAMPLE_RATE // common, sample_rate // common
+
+    # Blocks start on whole periods of down; context covers the filter
+    # half-length (resample_poly's default, in input samples)
+    context = -(-(10 * max(up, down) // up + 1) // down) * down
+    block_size = max(down, block_size - block_size % down)
+    skip = context * up // down
+
+    with sf.SoundFile(path, "w", samplerate=OPUS_SAMPLE_RATE, channels=1,
+                      format="OGG", subtype="OPUS") as f:
+        for start in range(0, len(audio), block_size):
+            end = min(start + block_size, len(audio))
+            lo, hi = start - context, end + context
+
+            segment = audio[max(lo, 0):min(hi, len(audio))] * gain
+            np.clip(segment, -1.0, 1.0, out=segment)
+            segment = np.pad(segment, (max(-lo, 0), max(hi - len(audio), 0)))
+
+            resampled = signal.resample_poly(segment, up, down)
+            frames = -(-(end - start) * up // down)
+            f.write(resampled[skip:skip + frames].astype(np.float32, copy=False))
+
+
+def _export(path: str, audio: np.ndarray, sample_rate: int, length: int) -> str:
+    """Normalize and write one stem and its peaks, then return its buffer (thread pool task)"""
+    peaks = PeakReducer(sample_rate)
+    with span("export.write", file=os.path.basename(path)):
+        write_normalized(path, audio, sample_rate, target_db=-6.0, length=length, peaks=peaks)
+        peaks.write(peaks_path(path))
+    pool.release(audio)
+    return path
+
+
 def mix_and_export(job_id: str, stems: dict, spec: dict, output_dir: str):
     """
     Mix stems and export final audio
 
+    Stems are processed one at a time: effects, then accumulate into a
+    single preallocated mix buffer. Normalize and export run on a thread
+    pool (soundfile releases the GIL) overlapping the next stem's effects,
+    with at most EXPORT_WORKERS processed stems waiting to be written.
+    Every WAV gets a waveform peaks file; the mix also gets an Ogg/Opus
+    rendition (EXPORT_OPUS) for progressive playback.
+
     Args:
         job_id: Unique job identifier
         stems: Dictionary of stem audio arrays
@@ -110,48 +366,58 @@ def mix_and_export(job_id: str, stems: dict, spec: dict, output_dir: str):
 
     print(f"Mixing {len(stems)} stems...")
 
-    # Apply vibe effects to each stem
-    processed_stems = {}
-    for name, audio in stems.items():
-        processed = apply_vibe_effects(audio, vibe, sample_rate)
-        processed_stems[name] = processed
-
-    # Mix all stems together
-    max_length = max(len(audio) for audio in processed_stems.values())
-
-    # Pad stems to same length
-    for name, audio in processed_stems.items():
-        if len(audio) < max_length:
-            padded = np.zeros(max_length)
-            padded[:len(audio)] = audio
-            processed_stems[name] = padded
-
-    # Sum all stems
-    mix = sum(processed_stems.values()) / len(processed_stems)
-
-    # Apply final vibe effects to mix
-    mix = apply_vibe_effects(mix, vibe, sample_rate)
-
-    # Normalize
-    mix = normalize_audio(mix, target_db=-6.0)
-
-    # Export files
-    output_files = {}
+    max_length = max(len(audio) for audio in stems.values())
+    mix = pool.zeros(max_length, dtype=np.result_type(*stems.values(), np.float32))
 
-    # Export mix
+    # Export files (mix first, filled in once all stems are summed)
     mix_path = job_output_dir / "mix.wav"
-    sf.write(str(mix_path), mix, sample_rate)
-    output_files["mix"] = str(mix_path)
-    print(f"✅ Exported mix: {mix_path}")
-
-    # Export individual stems if requested
-    if export_stems:
-        for name, audio in processed_stems.items():
-            normalized = normalize_audio(audio, target_db=-6.0)
-            stem_path = job_output_dir / f"{name}.wav"
-            sf.write(str(stem_path), normalized, sample_rate)
-            output_files[name] = str(stem_path)
-            print(f"✅ Exported stem: {stem_path}")
+    output_files = {"mix": str(mix_path)}
+
+    with ThreadPoolExecutor(max_workers=EXPORT_WORKERS) as executor:
+        in_flight = deque()
+
+        def finish_oldest():
+            path = in_flight.popleft().result()
+            print(f"✅ Exported stem: {path}")
+
+        for name, audio in stems.items():
+            # Apply vibe effects to each stem and sum into the mix
+            with span("mix.effects", stem=name):
+                processed = apply_vibe_effects(audio, vibe, sample_rate)
+            mix[:len(processed)] += processed
+
+            # Export individual stems if requested
+            if export_stems:
+                if len(in_flight) >= EXPORT_WORKERS:
+                    finish_oldest()
+                stem_path = str(job_output_dir / f"{name}.wav")
+                in_flight.append(executor.submit(
+                    bind(_export), stem_path, processed, sample_rate, max_length
+                ))
+                output_files[name] = stem_path
+            else:
+                pool.release(processed)
+
+            del processed
+
+        mix /= len(stems)
+
+        # Apply final vibe effects to mix
+        with span("mix.effects", stem="mix"):
+            mix = apply_vibe_effects(mix, vibe, sample_rate, overwrite=True)
+
+        # Normalize and export mix
+        peaks = PeakReducer(sample_rate)
+        with span("export.write", file="mix.wav"):
+            write_normalized(
+                str(mix_path), mix, sample_rate, target_db=-6.0, peaks=peaks,
+                opus_path=str(mix_path.with_suffix(".opus")) if EXPORT_OPUS else None
+            )
+            peaks.write(peaks_path(str(mix_path)))
+        print(f"✅ Exported mix: {mix_path}")
+
+        while in_flight:
+            finish_oldest()
 
     print(f"\n🎵 Export complete! {len(output_files)} files")
 
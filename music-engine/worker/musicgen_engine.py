@@ -2,11 +2,40 @@
 MusicGen Engine - Base music generation using Meta's MusicGen
 
 This module handles text-to-music generation using MusicGen
+
+Weights converted once with
+
+    python worker/musicgen_engine.py --convert
+
+are memory-mapped from MUSICGEN_WEIGHTS_DIR at startup instead of being
+downloaded and unpickled, so a cold worker starts in seconds.
 """
 
 import torch
 import numpy as np
+import itertools
 import os
+import sys
+import time
+
+
+# Pre-converted weights (<dir>/<model>/{compression,lm}.{yaml,safetensors});
+# models without a converted copy load with get_pretrained
+MUSICGEN_WEIGHTS_DIR = os.getenv("MUSICGEN_WEIGHTS_DIR", "/data/models")
+
+# Seconds generated by the warm-up pass before a worker takes jobs (0 = skip)
+MUSICGEN_WARMUP_SECONDS = float(os.getenv("MUSICGEN_WARMUP_SECONDS", "1"))
+
+# Compile the LM transformer with CUDA graphs (captured during warm-up)
+MUSICGEN_CUDA_GRAPHS = os.getenv("MUSICGEN_CUDA_GRAPHS", "false").lower() == "true"
+
+# Load testing: generate mock audio even when audiocraft is installed, and
+# hold each mock generation for this many seconds per second of audio (a
+# batch costs the same as one prompt, as it roughly does on the GPU)
+MUSICGEN_MOCK = os.getenv("MUSICGEN_MOCK", "false").lower() == "true"
+MUSICGEN_MOCK_LATENCY = float(os.getenv("MUSICGEN_MOCK_LATENCY", "0"))
+
+MODEL_PARTS = ("compression", "lm")
 
 
 # Check if audiocraft is available
@@ -30,13 +59,48 @@ class MusicGenEngine:
         - facebook/musicgen-medium (1.5B params, better quality)
         - facebook/musicgen-large (3.3B params, best quality)
         """
-        if not MUSICGEN_AVAILABLE:
+        self.model_name = model_name
+        self.load_seconds = 0.0
+        self.weights = "mock"
+        if not MUSICGEN_AVAILABLE or MUSICGEN_MOCK:
             self.model = None
             return
 
-        print(f"Loading MusicGen model: {model_name}...")
-        self.model = MusicGen.get_pretrained(model_name)
-        print("✅ MusicGen model loaded")
+        started = time.perf_counter()
+        path = mapped_weights_path(model_name)
+        if is_converted(path):
+            print(f"Mapping MusicGen weights: {path}...")
+            self.model = load_mapped(model_name, path)
+            self.weights = "mmap"
+        else:
+            print(f"Loading MusicGen model: {model_name}...")
+            self.model = MusicGen.get_pretrained(model_name)
+            self.weights = "pretrained"
+        self.load_seconds = time.perf_counter() - started
+        print(f"✅ MusicGen model loaded in {self.load_seconds:.1f}s ({self.weights})")
+
+    def warm_up(self, batch_size: int = 1, seconds: float = MUSICGEN_WARMUP_SECONDS) -> float:
+        """
+        Run one short batched generation so the first job doesn't pay for
+        kernel selection, allocator growth or CUDA graph capture
+
+        Returns the seconds spent.
+        """
+        if seconds <= 0 or self.model is None:
+            return 0.0
+
+        started = time.perf_counter()
+        if MUSICGEN_CUDA_GRAPHS and self.model is not None and torch.cuda.is_available():
+            # reduce-overhead records CUDA graphs on the first calls
+            lm = self.model.lm
+            lm.transformer = torch.compile(lm.transformer, mode="reduce-overhead", dynamic=False)
+
+        self.generate_batch(["warm-up"] * batch_size, seconds)
+        if torch.cuda.is_available():
+            torch.cuda.synchronize()
+        elapsed = time.perf_counter() - started
+        print(f"✅ MusicGen warm-up done in {elapsed:.1f}s (batch of {batch_size})")
+        return elapsed
 
     def generate(self, prompt: str, duration: int, temperature: float = 1.0, cfg_coef: float = 3.0):
         """
@@ -51,11 +115,24 @@ class MusicGenEngine:
         Returns:
             numpy array of audio (mono, 32kHz)
         """
+        return self.generate_batch([prompt], duration, temperature, cfg_coef)[0]
+
+    def generate_batch(self, prompts: list, duration: int, temperature: float = 1.0, cfg_coef: float = 3.0):
+        """
+        Generate music for several prompts in one model call
+
+        All prompts share the generation parameters and duration.
+
+        Returns:
+            List of numpy arrays of audio (mono, 32kHz), one per prompt
+        """
         if not MUSICGEN_AVAILABLE or self.model is None:
             # Return mock audio for testing
-            print(f"[MOCK] Generating {duration}s of audio for: {prompt}")
             sample_rate = 32000
-            return self._generate_mock_audio(duration, sample_rate)
+            for prompt in prompts:
+                print(f"[MOCK] Generating {duration}s of audio for: {prompt}")
+            time.sleep(MUSICGEN_MOCK_LATENCY * duration)
+            return [self._generate_mock_audio(duration, sample_rate) for _ in prompts]
 
         # Set generation parameters
         self.model.set_generation_params(
@@ -65,22 +142,71 @@ class MusicGenEngine:
         )
 
         # Generate
-        print(f"Generating: {prompt}")
+        print(f"Generating batch of {len(prompts)}: {prompts}")
         with torch.no_grad():
-            wav = self.model.generate([prompt])
+            wav = self.model.generate(list(prompts))
+
+        audios = []
+        for item in wav:
+            # Convert to numpy (mono)
+            audio = item.cpu().numpy()
+
+            # If stereo, convert to mono
+            if len(audio.shape) > 1:
+                audio = audio.mean(axis=0)
+
+            audios.append(audio)
+
+        return audios
+
+    def generate_continuation(
+        self,
+        prompt: str,
+        context: np.ndarray,
+        duration: float,
+        temperature: float = 1.0,
+        cfg_coef: float = 3.0,
+        position: float = 0.0
+    ):
+        """
+        Generate audio that continues context (used by live mode)
 
-        # Convert to numpy (mono)
-        audio = wav[0].cpu().numpy()
+        Args:
+            prompt: Text description of music
+            context: Preceding mono audio (32kHz) to continue, may be empty
+            duration: Seconds of new audio
+            position: Stream time of the new audio (keeps mock output continuous)
+
+        Returns:
+            numpy array of only the new audio (mono, 32kHz)
+        """
+        sample_rate = 32000
+        if not MUSICGEN_AVAILABLE or self.model is None:
+            time.sleep(MUSICGEN_MOCK_LATENCY * duration)
+            return self._generate_mock_audio(duration, sample_rate, start=position)
+
+        if len(context) == 0:
+            return self.generate(prompt, duration, temperature, cfg_coef)
+
+        self.model.set_generation_params(
+            duration=len(context) / sample_rate + duration,
+            temperature=temperature,
+            cfg_coef=cfg_coef
+        )
+
+        with torch.no_grad():
+            prompt_audio = torch.from_numpy(context.astype(np.float32))[None, None]
+            wav = self.model.generate_continuation(prompt_audio, sample_rate, [prompt])
 
-        # If stereo, convert to mono
+        audio = wav[0].cpu().numpy()
         if len(audio.shape) > 1:
             audio = audio.mean(axis=0)
 
-        return audio
+        return audio[len(context):]
 
-    def _generate_mock_audio(self, duration: int, sample_rate: int = 32000):
+    def _generate_mock_audio(self, duration: float, sample_rate: int = 32000, start: float = 0.0):
         """Generate mock audio for testing (simple sine wave)"""
-        t = np.linspace(0, duration, duration * sample_rate)
+        t = start + np.arange(int(duration * sample_rate)) / sample_rate
 
         # Create a simple musical pattern
         freq_bass = 110  # A2
@@ -94,10 +220,101 @@ class MusicGenEngine:
         )
 
         # Add some variation
-        envelope = np.exp(-t / duration)
+        envelope = np.exp(-(t - start) / duration)
         audio = audio * (0.3 + 0.7 * envelope)
 
-        return audio
+        return audio.astype(np.float32)
+
+
+def mapped_weights_path(model_name: str, root: str = MUSICGEN_WEIGHTS_DIR) -> str:
+    """Directory holding a model's converted weights"""
+    return os.path.join(root, model_name.replace("/", "--"))
+
+
+def is_converted(path: str) -> bool:
+    return all(
+        os.path.isfile(os.path.join(path, f"{part}.{ext}"))
+        for part in MODEL_PARTS for ext in ("yaml", "safetensors")
+    )
+
+
+def convert_weights(model_name: str, root: str = MUSICGEN_WEIGHTS_DIR) -> str:
+    """
+    Write a model's checkpoints as safetensors plus their configs
+
+    Each part's .safetensors is renamed into place last, so a partial
+    conversion is never picked up.
+    """
+    from audiocraft.models import loaders
+    from omegaconf import OmegaConf
+    from safetensors.torch import save_file
+
+    path = mapped_weights_path(model_name, root)
+    os.makedirs(path, exist_ok=True)
+    checkpoints = {"compression": loaders.load_compression_model_ckpt, "lm": loaders.load_lm_model_ckpt}
+
+    for part in MODEL_PARTS:
+        pkg = checkpoints[part](model_name)
+        if "pretrained" in pkg:
+            raise ValueError(f"{model_name} {part} model points at {pkg['pretrained']}; convert that instead")
+
+        OmegaConf.save(OmegaConf.create(pkg["xp.cfg"]), os.path.join(path, f"{part}.yaml"))
+        tmp = os.path.join(path, f"{part}.safetensors.tmp")
+        save_file({name: tensor.contiguous() for name, tensor in pkg["best_state"].items()}, tmp)
+        os.replace(tmp, os.path.join(path, f"{part}.safetensors"))
+        print(f"Converted {model_name} {part} -> {path}")
+
+    return path
+
+
+def load_mapped(model_name: str, path: str):
+    """
+    Build MusicGen from converted weights without copying them
+
+    Mirrors audiocraft's loaders: modules are built on the meta device
+    and their parameters assigned straight from the memory-mapped
+    tensors, falling back to a normal build if some module can't be
+    built that way.
+    """
+    from audiocraft.models import builders
+    from omegaconf import OmegaConf
+    from safetensors.torch import load_file
+
+    device = "cuda" if torch.cuda.is_available() else "cpu"
+    builds = {"compression": builders.get_compression_model, "lm": builders.get_lm_model}
+    models = {}
+
+    for part in MODEL_PARTS:
+        cfg = OmegaConf.load(os.path.join(path, f"{part}.yaml"))
+        cfg.device = device
+        if part == "lm":
+            cfg.dtype = "float32" if device == "cpu" else "float16"
+
+        state = load_file(os.path.join(path, f"{part}.safetensors"), device=device)
+        model = _build_assigned(builds[part], cfg, state).to(device)
+        model.eval()
+        if part == "lm":
+            model.cfg = cfg
+        models[part] = model
+
+    return MusicGen(model_name, models["compression"], models["lm"])
+
+
+def _build_assigned(build, cfg, state: dict):
+    """Module from build(cfg) holding state's tensors themselves"""
+    try:
+        with torch.device("meta"):
+            model = build(cfg)
+        model.load_state_dict(state, assign=True)
+        # Non-persistent buffers aren't in the checkpoint
+        if not any(t.is_meta for t in itertools.chain(model.parameters(), model.buffers())):
+            return model
+    except (RuntimeError, NotImplementedError):
+        pass
+
+    model = build(cfg)
+    model.load_state_dict(state)
+    return model
 
 
 # Global model instance (loaded once)
@@ -113,20 +330,59 @@ def get_model():
     return _model_instance
 
 
+def generation_params(spec: dict) -> dict:
+    """Generation parameters for a spec (jobs with equal params can be batched)"""
+    return {
+        "duration": spec.get("duration", 30),
+        "temperature": spec.get("temperature", 1.0),
+        "cfg_coef": spec.get("cfg_coef", 3.0)
+    }
+
+
 def generate_base_audio(spec: dict):
     """
     Generate base audio from MusicSpec
 
     This is the entry point called by the worker
     """
+    return generate_base_audio_batch([spec])[0]
+
+
+def generate_base_audio_batch(specs: list):
+    """
+    Generate base audio for several MusicSpecs in one batched model call
+
+    Specs must share temperature and cfg_coef. Durations may differ: the
+    batch is generated at the longest one and each result trimmed to its
+    own duration.
+    """
     from shared.utils import spec_to_prompt
 
-    # Convert spec to prompt
-    prompt = spec_to_prompt(spec)
-    duration = spec.get("duration", 30)
+    params = [generation_params(spec) for spec in specs]
+    duration = max(p["duration"] for p in params)
+
+    # Convert specs to prompts
+    prompts = [spec_to_prompt(spec) for spec in specs]
 
     # Get model and generate
     model = get_model()
-    audio = model.generate(prompt, duration)
-
-    return audio
+    audios = model.generate_batch(
+        prompts,
+        duration,
+        temperature=params[0]["temperature"],
+        cfg_coef=params[0]["cfg_coef"]
+    )
+
+    # The DSP stages keep whatever dtype they are given: float32 here
+    sample_rate = 32000
+    return [
+        audio[:int(p["duration"] * sample_rate)].astype(np.float32, copy=False)
+        for audio, p in zip(audios, params)
+    ]
+
+
+if __name__ == "__main__":
+    if sys.argv[1:2] != ["--convert"]:
+        sys.exit("Usage: python worker/musicgen_engine.py --convert [model ...]")
+    for name in sys.argv[2:] or [os.getenv("MUSICGEN_MODEL", "facebook/musicgen-medium")]:
+        convert_weights(name)
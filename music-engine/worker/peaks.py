@@ -0,0 +1,98 @@
+"""
+Waveform peaks - compact min/max overviews written beside each export
+
+Players draw the waveform from this file instead of downloading and
+decoding the WAV. The reducer is fed the same normalized blocks the
+export writes, so peaks cost one extra reduction per block.
+
+File layout (little-endian): one audiowaveform v1 block per level,
+finest first, each
+
+    int32   version (1)
+    uint32  flags (1 = 8-bit values)
+    int32   sample rate
+    int32   samples per pixel
+    uint32  length (pixels)
+    int8[2 * length]  min, max per pixel
+
+Readers pick the coarsest level with at least as many pixels as they
+draw.
+"""
+
+import os
+import struct
+from typing import List, Tuple
+
+import numpy as np
+
+
+# Samples per pixel at each level; each is a multiple of the previous one
+PEAK_LEVELS = (256, 1024, 4096, 16384)
+
+PEAKS_SUFFIX = ".peaks"
+
+_HEADER = struct.Struct("<iIiiI")
+
+
+def peaks_path(audio_path: str) -> str:
+    """Peaks file for an exported audio file (mix.wav -> mix.peaks)"""
+    return os.path.splitext(audio_path)[0] + PEAKS_SUFFIX
+
+
+class PeakReducer:
+    """Per-pixel min/max of a signal that arrives in blocks"""
+
+    def __init__(self, sample_rate: int, samples_per_pixel: int = PEAK_LEVELS[0]):
+        self.sample_rate = sample_rate
+        self.samples_per_pixel = samples_per_pixel
+        self._tail = np.zeros(0, dtype=np.float32)  # Samples of the unfinished pixel
+        self._mins: List[np.ndarray] = []
+        self._maxs: List[np.ndarray] = []
+
+    def add(self, block: np.ndarray):
+        """Reduce the next block of samples"""
+        if len(self._tail):
+            block = np.concatenate([self._tail, block])
+        full = len(block) - len(block) % self.samples_per_pixel
+        if full:
+            pixels = block[:full].reshape(-1, self.samples_per_pixel)
+            self._mins.append(pixels.min(axis=1))
+            self._maxs.append(pixels.max(axis=1))
+        self._tail = block[full:].copy()
+
+    def finish(self) -> Tuple[np.ndarray, np.ndarray]:
+        """(mins, maxs) of the finest level, including a final partial pixel"""
+        mins, maxs = list(self._mins), list(self._maxs)
+        if len(self._tail):
+            mins.append(self._tail.min(keepdims=True))
+            maxs.append(self._tail.max(keepdims=True))
+        if not mins:
+            return np.zeros(0), np.zeros(0)
+        return np.concatenate(mins), np.concatenate(maxs)
+
+    def write(self, path: str, levels=PEAK_LEVELS) -> str:
+        """Write every level, derived from the finest, as one peaks file"""
+        mins, maxs = self.finish()
+        base = self.samples_per_pixel
+
+        with open(path, "wb") as f:
+            for samples_per_pixel in levels:
+                factor = samples_per_pixel // base
+                pad = -len(mins) % factor
+                level_mins = np.pad(mins, (0, pad), mode="edge") if pad and len(mins) else mins
+                level_maxs = np.pad(maxs, (0, pad), mode="edge") if pad and len(maxs) else maxs
+                level_mins = level_mins.reshape(-1, factor).min(axis=1)
+                level_maxs = level_maxs.reshape(-1, factor).max(axis=1)
+
+                pairs = np.empty(2 * len(level_mins), dtype=np.int8)
+                pairs[0::2] = _to_int8(level_mins)
+                pairs[1::2] = _to_int8(level_maxs)
+
+                f.write(_HEADER.pack(1, 1, self.sample_rate, samples_per_pixel, len(level_mins)))
+                f.write(pairs.tobytes())
+        return path
+
+
+def _to_int8(values: np.ndarray) -> np.ndarray:
+    # Symmetric so full scale is ±127; fetchPeaks divides by the same 127
+    return np.clip(np.round(values * 127), -127, 127).astype(np.int8)
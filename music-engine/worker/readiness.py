@@ -0,0 +1,79 @@
+"""
+Worker readiness - load progress and warm state published to Redis
+
+Each worker keeps one hash (worker:state:<name>) current while it runs:
+its state (loading, warming, ready), model and weight source, and how
+long loading and warm-up took, and its resident memory (rss_mb, updated
+on every refresh, so soak runs can watch for creep). The hash expires WORKER_STATE_TTL seconds
+after the worker stops refreshing it, so a crashed worker drops out on
+its own.
+"""
+
+import os
+import resource
+import sys
+import threading
+import time
+
+import redis
+
+from shared.job_queue import WORKER_STATES_KEY, WORKER_STATE_TTL, worker_state_key
+
+
+def rss_mb() -> float:
+    """Current resident set size of this process"""
+    try:
+        with open("/proc/self/statm") as f:
+            pages = int(f.read().split()[1])
+        return round(pages * os.sysconf("SC_PAGE_SIZE") / (1024 * 1024), 1)
+    except OSError:
+        # No procfs (macOS): fall back to the peak, in bytes there
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        return round(peak / (1024 * 1024 if sys.platform == "darwin" else 1024), 1)
+
+
+class Readiness:
+    """One worker's published state, refreshed by a background thread"""
+
+    def __init__(self, r: redis.Redis, name: str):
+        self.r = r
+        self.name = name
+        self.key = worker_state_key(name)
+        self.started_at = time.time()
+        self._stopped = threading.Event()
+        self._refresh = threading.Thread(target=self._refresh_loop, name="readiness", daemon=True)
+
+    def set(self, state: str, **fields):
+        """Publish a new state, with any extra fields (kept until overwritten)"""
+        pipe = self.r.pipeline()
+        pipe.hset(self.key, mapping={
+            "state": state,
+            "since": time.time(),
+            "started_at": self.started_at,
+            "rss_mb": rss_mb(),
+            **fields
+        })
+        pipe.expire(self.key, WORKER_STATE_TTL)
+        pipe.sadd(WORKER_STATES_KEY, self.name)
+        pipe.execute()
+        print(f"Worker {self.name}: {state}")
+
+        if not self._refresh.is_alive() and not self._stopped.is_set():
+            self._refresh.start()
+
+    def clear(self):
+        """Withdraw this worker (clean shutdown)"""
+        self._stopped.set()
+        pipe = self.r.pipeline()
+        pipe.delete(self.key)
+        pipe.srem(WORKER_STATES_KEY, self.name)
+        pipe.execute()
+
+    def _refresh_loop(self):
+        while not self._stopped.wait(WORKER_STATE_TTL / 3):
+            try:
+                # Only a live hash is updated (hset would revive an expired one)
+                if self.r.expire(self.key, WORKER_STATE_TTL):
+                    self.r.hset(self.key, "rss_mb", rss_mb())
+            except redis.RedisError as e:
+                print(f"Readiness refresh failed: {e}")
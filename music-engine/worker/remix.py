@@ -0,0 +1,136 @@
+"""
+StaticWaves Re-mix Worker - vibe-only variations from cached stems
+
+This worker:
+1. Pulls re-mix jobs from the remix lane
+2. Loads the stems cached for the job they vary
+3. Applies the variation's vibe, mixes and exports
+
+No model is loaded, so it runs on CPU beside the GPU workers; a
+variation takes the vibe DSP and export time only.
+"""
+
+import redis
+import json
+import os
+import sys
+import time
+from pathlib import Path
+
+sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+from mixer import mix_and_export
+from stem_cache import load_stems
+from buffer_pool import pool, publish_pool_stats
+from job_status import update_status, fail_job
+from shared.job_queue import REMIX_LANES
+from shared.render_cache import record_render
+from shared.tracing import span, trace_spans, export_spans, push_histograms
+from consumer import JobConsumer
+
+
+# Configuration
+REDIS_HOST = os.getenv("REDIS_HOST", "localhost")
+REDIS_PORT = int(os.getenv("REDIS_PORT", "6379"))
+OUTPUT_DIR = os.getenv("OUTPUT_DIR", "/data/output")
+
+# Ensure output directory exists
+Path(OUTPUT_DIR).mkdir(parents=True, exist_ok=True)
+
+
+def process_remix(r: redis.Redis, job_data: dict):
+    """
+    Re-mix a finished job's cached stems with this job's vibe
+
+    Fails the job if the stems are gone (evicted with their job, or
+    never cached).
+    """
+    job_id = job_data["job_id"]
+    source_id = job_data["remix_of"]
+    spec = job_data["spec"]
+
+    print(f"\n[{job_id}] Re-mixing {source_id} with vibe {json.dumps(spec.get('vibe', {}))}")
+
+    root = span("remix", job_id=job_id, remix_of=source_id)
+    try:
+        with root, pool.job():
+            update_status(r, job_id, "running", 10)
+
+            with span("stem_cache.load"):
+                stems = load_stems(OUTPUT_DIR, source_id)
+            if stems is None:
+                raise RuntimeError(f"Stems for {source_id} are no longer cached")
+            update_status(r, job_id, "running", 40)
+
+            with span("mix.export", stems=len(stems)):
+                output_files = mix_and_export(job_id, stems, spec, OUTPUT_DIR)
+
+            output_urls = {
+                name: f"/download/{job_id}/{name}"
+                for name in output_files.keys()
+            }
+            update_status(r, job_id, "completed", 100, outputs=json.dumps(output_urls))
+            if job_data.get("render_key"):
+                # Counted against the render cache bounds like any render
+                record_render(r, job_data["render_key"], job_id, OUTPUT_DIR)
+            print(f"[{job_id}] ✅ Re-mix completed")
+
+    except Exception as e:
+        fail_job(r, job_id, e, job_data.get("render_key"))
+    finally:
+        export_spans(job_id, trace_spans(root.trace_id))
+
+
+def main():
+    """Re-mix worker loop"""
+    print("🎚️  StaticWaves Re-mix Worker Starting...")
+    print(f"Redis: {REDIS_HOST}:{REDIS_PORT}")
+    print(f"Output: {OUTPUT_DIR}")
+    print("Waiting for re-mix jobs...\n")
+
+    r = redis.Redis(
+        host=REDIS_HOST,
+        port=REDIS_PORT,
+        decode_responses=True
+    )
+
+    try:
+        r.ping()
+        print("✅ Redis connection successful\n")
+    except Exception as e:
+        print(f"❌ Redis connection failed: {e}")
+        return
+
+    consumer = JobConsumer(
+        r,
+        lanes=REMIX_LANES,
+        on_dead_letter=lambda job_data: fail_job(
+            r, job_data["job_id"], RuntimeError("Re-mix abandoned by workers too many times")
+        )
+    )
+    consumer.start()
+    print(f"Consumer: {consumer.name}")
+
+    while True:
+        try:
+            # Re-mixes don't share any work, so they run one at a time
+            batch = consumer.collect_batch(lambda spec: (), 1, 0, timeout=5)
+
+            for job in batch:
+                process_remix(r, job.data)
+                consumer.ack(job)
+
+            if batch:
+                push_histograms(r)
+                publish_pool_stats(r, consumer.name)
+
+        except KeyboardInterrupt:
+            print("\n⚠️  Re-mix worker shutting down...")
+            consumer.stop()
+            break
+        except Exception as e:
+            print(f"❌ Re-mix worker error: {e}")
+            time.sleep(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,49 @@
+"""
+Compact stem cache - DDSP stems kept beside a render for later re-mixes
+
+Stems are stored as float16 (half the size of the float32 pipeline
+buffers, a quarter of float64) in one uncompressed .npz per job. Half
+precision keeps an 11-bit mantissa, so the round trip adds noise around
+-66 dB relative to each sample: fine as re-mix input, not a master.
+The file lives in the job's output directory, so render cache eviction
+removes it with the rest of the job.
+"""
+
+import os
+from pathlib import Path
+from typing import Dict, Optional
+
+import numpy as np
+
+from shared.job_queue import STEM_CACHE_FILE
+
+
+# Cache every job's stems; otherwise only jobs queued with retain_stems
+STEM_CACHE_ENABLED = os.getenv("STEM_CACHE", "false").lower() == "true"
+
+
+def stem_cache_path(output_dir: str, job_id: str) -> Path:
+    return Path(output_dir) / job_id / STEM_CACHE_FILE
+
+
+def save_stems(output_dir: str, job_id: str, stems: Dict[str, np.ndarray]) -> Path:
+    """Write a job's stems as float16"""
+    path = stem_cache_path(output_dir, job_id)
+    path.parent.mkdir(parents=True, exist_ok=True)
+
+    # Written under a temporary name so readers never see a partial file
+    partial = path.with_name(path.name + ".partial")
+    with open(partial, "wb") as f:
+        np.savez(f, **{name: audio.astype(np.float16) for name, audio in stems.items()})
+    os.replace(partial, path)
+    return path
+
+
+def load_stems(output_dir: str, job_id: str) -> Optional[Dict[str, np.ndarray]]:
+    """A job's cached stems as float32, or None if it has none"""
+    path = stem_cache_path(output_dir, job_id)
+    if not path.exists():
+        return None
+
+    with np.load(path) as cached:
+        return {name: cached[name].astype(np.float32) for name in cached.files}
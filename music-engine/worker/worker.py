@@ -6,6 +6,8 @@ This worker:
 2. Generates music using MusicGen
 3. Re-synthesizes stems with DDSP
 4. Mixes and exports final audio
+
+Run one process per GPU (see launch.py); all of them share the job lanes.
 """
 
 import redis
@@ -13,12 +15,20 @@ import json
 import os
 import sys
 import time
+import math
 from pathlib import Path
 
 sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
-from musicgen_engine import generate_base_audio
+from musicgen_engine import generate_base_audio_batch, generation_params, get_model
 from ddsp_synth import resynthesize_stems
 from mixer import mix_and_export
+from stem_cache import STEM_CACHE_ENABLED, save_stems
+from buffer_pool import pool, publish_pool_stats
+from job_status import update_status, fail_job
+from shared.render_cache import record_render
+from shared.tracing import span, trace_spans, export_spans, push_histograms
+from consumer import JobConsumer, consumer_name
+from readiness import Readiness
 
 
 # Configuration
@@ -26,26 +36,82 @@ REDIS_HOST = os.getenv("REDIS_HOST", "localhost")
 REDIS_PORT = int(os.getenv("REDIS_PORT", "6379"))
 OUTPUT_DIR = os.getenv("OUTPUT_DIR", "/data/output")
 
+# Batching: drain up to BATCH_SIZE compatible jobs, waiting at most
+# BATCH_WAIT_MS after the first one, and generate them in one model call
+BATCH_SIZE = int(os.getenv("BATCH_SIZE", "4"))
+BATCH_WAIT_MS = int(os.getenv("BATCH_WAIT_MS", "250"))
+BATCH_DURATION_BUCKET = int(os.getenv("BATCH_DURATION_BUCKET", "15"))
+BATCH_STATS_KEY = "worker:batch_stats"
+
 # Ensure output directory exists
 Path(OUTPUT_DIR).mkdir(parents=True, exist_ok=True)
 
 
-def update_status(r: redis.Redis, job_id: str, status: str, progress: float = None):
-    """Update job status in Redis"""
-    r.set(f"job:{job_id}:status", status)
-    if progress is not None:
-        r.set(f"job:{job_id}:progress", str(progress))
-    print(f"[{job_id}] Status: {status} ({progress}%)" if progress else f"[{job_id}] Status: {status}")
+def batch_key(spec: dict) -> tuple:
+    """Jobs with equal keys can share one MusicGen call"""
+    params = generation_params(spec)
+    bucket = math.ceil(params["duration"] / BATCH_DURATION_BUCKET)
+    return (bucket, params["temperature"], params["cfg_coef"])
+
+
+def record_batch_stats(r: redis.Redis, size: int):
+    """Accumulate batch-fill metrics (batches, jobs, size histogram)"""
+    pipe = r.pipeline(transaction=False)
+    pipe.hincrby(BATCH_STATS_KEY, "batches", 1)
+    pipe.hincrby(BATCH_STATS_KEY, "jobs", size)
+    pipe.hincrby(BATCH_STATS_KEY, f"size:{size}", 1)
+    pipe.hset(BATCH_STATS_KEY, "batch_size", BATCH_SIZE)
+    pipe.execute()
+
+
+def process_batch(r: redis.Redis, consumer: JobConsumer, jobs: list):
+    """
+    Generate base audio for a batch of jobs in one call, then run each
+    job's DSP stages
+
+    Each job is acknowledged once it completes or fails, so a crash only
+    re-delivers the jobs that had not finished.
+    """
+    batch = [job.data for job in jobs]
+    job_ids = [job_data["job_id"] for job_data in batch]
+    print(f"\n🎛️  Batch of {len(batch)}/{BATCH_SIZE}: {job_ids}")
+    record_batch_stats(r, len(batch))
+    generation_span = span("musicgen.generate", batch=len(batch))
+
+    try:
+        for job_id in job_ids:
+            update_status(r, job_id, "running", 10)
+        print(f"Step 1/3: Generating base audio with MusicGen ({len(batch)} prompts)...")
+
+        with generation_span:
+            base_audios = generate_base_audio_batch([job_data["spec"] for job_data in batch])
+
+    except Exception as e:
+        for job in jobs:
+            fail_job(r, job.data["job_id"], e, job.data.get("render_key"))
+            consumer.ack(job)
+        return
+
+    # The shared generation span goes into every job's trace
+    generation = trace_spans(generation_span.trace_id)
+    for job, base_audio in zip(jobs, base_audios):
+        process_job(r, job.data, base_audio, generation)
+        consumer.ack(job)
 
 
-def process_job(r: redis.Redis, job_data: dict):
+def process_job(r: redis.Redis, job_data: dict, base_audio=None, batch_spans: list = ()):
     """
     Process a single music generation job
 
     Pipeline:
-    1. Generate base audio with MusicGen
+    1. Generate base audio with MusicGen (skipped if base_audio is given)
     2. Re-synthesize stems with DDSP
     3. Mix and export
+
+    The job's spans (plus batch_spans, from work shared with other jobs)
+    are exported as one trace when TRACE_DIR or OTLP_ENDPOINT is set.
+    DSP scratch buffers come from the buffer pool and all go back to it
+    when the job ends.
     """
     job_id = job_data["job_id"]
     spec = job_data["spec"]
@@ -55,22 +121,48 @@ def process_job(r: redis.Redis, job_data: dict):
     print(f"Spec: {json.dumps(spec, indent=2)}")
     print(f"{'='*60}\n")
 
+    job_span = span("job", job_id=job_id, duration=spec.get("duration", 30))
     try:
-        # Step 1: Generate base audio with MusicGen
-        update_status(r, job_id, "running", 10)
-        print(f"[{job_id}] Step 1/3: Generating base audio with MusicGen...")
+        with job_span:
+            with pool.job():
+                _run_job(r, job_data, base_audio)
+            stats = pool.stats()
+            job_span.set(pool_hit_rate=stats["hit_rate"], pool_high_water_mb=stats["job_high_water_mb"])
+    finally:
+        export_spans(job_id, list(batch_spans) + trace_spans(job_span.trace_id))
+
+    print(f"[{job_id}] Buffer pool: hit rate {stats['hit_rate']}, "
+          f"high-water {stats['job_high_water_mb']} MB (job) / {stats['high_water_mb']} MB")
+
+
+def _run_job(r: redis.Redis, job_data: dict, base_audio):
+    """process_job's stages, inside the job's trace span"""
+    job_id = job_data["job_id"]
+    spec = job_data["spec"]
 
-        base_audio = generate_base_audio(spec)
+    try:
+        # Step 1: Generate base audio with MusicGen
+        if base_audio is None:
+            update_status(r, job_id, "running", 10)
+            print(f"[{job_id}] Step 1/3: Generating base audio with MusicGen...")
+            with span("musicgen.generate", batch=1):
+                base_audio = generate_base_audio_batch([spec])[0]
         update_status(r, job_id, "running", 40)
 
         # Step 2: Re-synthesize stems with DDSP
         print(f"[{job_id}] Step 2/3: Re-synthesizing stems with DDSP...")
-        stems = resynthesize_stems(base_audio, spec)
+        with span("ddsp.resynthesize"):
+            stems = resynthesize_stems(base_audio, spec)
         update_status(r, job_id, "running", 70)
 
         # Step 3: Mix and export
         print(f"[{job_id}] Step 3/3: Mixing and exporting...")
-        output_files = mix_and_export(job_id, stems, spec, OUTPUT_DIR)
+        with span("mix.export", stems=len(stems)):
+            output_files = mix_and_export(job_id, stems, spec, OUTPUT_DIR)
+        # Kept for vibe-only re-mixes (worker/remix.py)
+        if STEM_CACHE_ENABLED or job_data.get("retain_stems"):
+            with span("stem_cache.save"):
+                save_stems(OUTPUT_DIR, job_id, stems)
         update_status(r, job_id, "running", 90)
 
         # Store output URLs
@@ -78,17 +170,16 @@ def process_job(r: redis.Redis, job_data: dict):
             name: f"/download/{job_id}/{name}"
             for name in output_files.keys()
         }
-        r.set(f"job:{job_id}:outputs", json.dumps(output_urls))
 
-        # Mark complete
-        update_status(r, job_id, "completed", 100)
+        # Mark complete (outputs land with the status)
+        update_status(r, job_id, "completed", 100, outputs=json.dumps(output_urls))
+        if job_data.get("render_key"):
+            record_render(r, job_data["render_key"], job_id, OUTPUT_DIR)
         print(f"[{job_id}] ✅ Job completed successfully!")
         print(f"[{job_id}] Outputs: {list(output_files.keys())}")
 
     except Exception as e:
-        print(f"[{job_id}] ❌ Error: {str(e)}")
-        update_status(r, job_id, "failed", 0)
-        r.set(f"job:{job_id}:error", str(e))
+        fail_job(r, job_id, e, job_data.get("render_key"))
 
 
 def main():
@@ -96,6 +187,7 @@ def main():
     print("🎵 StaticWaves Music Worker Starting...")
     print(f"Redis: {REDIS_HOST}:{REDIS_PORT}")
     print(f"Output: {OUTPUT_DIR}")
+    print(f"Batching: up to {BATCH_SIZE} jobs, {BATCH_WAIT_MS}ms window")
     print("Waiting for jobs...\n")
 
     r = redis.Redis(
@@ -112,23 +204,44 @@ def main():
         print(f"❌ Redis connection failed: {e}")
         return
 
+    # Load and warm this GPU's model before joining the consumer group, so
+    # no job is read (or recovered) by a worker that can't run it yet
+    readiness = Readiness(r, consumer_name())
+    readiness.set("loading", model=os.getenv("MUSICGEN_MODEL", "facebook/musicgen-medium"))
+    model = get_model()
+    readiness.set("warming", load_seconds=round(model.load_seconds, 2), weights=model.weights)
+    warmup_seconds = model.warm_up(BATCH_SIZE)
+    readiness.set("ready", warmup_seconds=round(warmup_seconds, 2), batch_size=BATCH_SIZE)
+
+    consumer = JobConsumer(
+        r,
+        name=readiness.name,
+        on_dead_letter=lambda job_data: fail_job(
+            r, job_data["job_id"], RuntimeError("Job abandoned by workers too many times"),
+            job_data.get("render_key")
+        )
+    )
+    consumer.start()
+    print(f"Consumer: {consumer.name}")
+
     # Main loop
     while True:
         try:
-            # Block until job available (5s timeout)
-            job = r.brpop("music_jobs", timeout=5)
+            # Block until a job is available (5s timeout), then batch
+            batch = consumer.collect_batch(batch_key, BATCH_SIZE, BATCH_WAIT_MS, timeout=5)
 
-            if not job:
+            if not batch:
                 continue
 
-            # Parse job data
-            job_data = json.loads(job[1])
-
-            # Process the job
-            process_job(r, job_data)
+            # Process the batch
+            process_batch(r, consumer, batch)
+            push_histograms(r)
+            publish_pool_stats(r, consumer.name)
 
         except KeyboardInterrupt:
             print("\n⚠️  Worker shutting down...")
+            consumer.stop()
+            readiness.clear()
             break
         except Exception as e:
             print(f"❌ Worker error: {e}")
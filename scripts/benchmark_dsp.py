@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+"""
+Benchmark the audio DSP hot paths and fail on regressions
+Usage: python scripts/benchmark_dsp.py [--quick] [--save-baseline]
+
+Sweeps track length, sample rate and (where it applies) stem count over
+the music-engine mixer/DDSP stages and the MashDeck mastering,
+arrangement and pitch-shift paths. Each case reports throughput in
+seconds of audio processed per second and peak RSS, measured in a fresh
+child process so cases don't inherit each other's allocations.
+
+Results are compared against a stored baseline; a case slower or larger
+than the tolerance allows makes the run exit non-zero. Baselines are
+machine-specific, so save one per host (--save-baseline) before gating.
+"""
+import os
+import sys
+import json
+import time
+import shutil
+import argparse
+import resource
+import tempfile
+import platform
+import multiprocessing
+from queue import Empty
+from typing import Callable, Dict, List, Optional, Tuple
+
+import numpy as np
+import soundfile as sf
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, os.path.join(ROOT, "music-engine"))
+sys.path.insert(0, os.path.join(ROOT, "music-engine", "worker"))
+sys.path.insert(0, os.path.join(ROOT, "mashdeck"))
+
+DEFAULT_BASELINE = os.path.join(ROOT, "scripts", "dsp-benchmark-baseline.json")
+
+LENGTHS = [10, 60, 300, 600]            # Seconds of audio
+SAMPLE_RATES = [22050, 32000, 44100, 48000]
+STEM_COUNTS = [1, 4, 8]
+QUICK_LENGTHS = [10, 60]
+CASE_TIMEOUT = 600                      # Seconds before a hung case is killed
+
+# A vibe that enables every stage of the mixer chain
+VIBE = {"energy": 0.8, "dark": 0.6, "dreamy": 0.6, "aggressive": 0.5}
+
+# Arrangements are split into this many crossfaded sections
+SECTIONS = 4
+CROSSFADE_MS = 2000
+
+
+def test_signal(seconds: float, sample_rate: int, channels: int = 1, seed: int = 0) -> np.ndarray:
+    """Deterministic music-like input: a few partials plus low-level noise"""
+    rng = np.random.default_rng(seed)
+    t = np.arange(int(seconds * sample_rate)) / sample_rate
+    audio = sum(0.2 * np.sin(2 * np.pi * f * t) for f in (110, 440, 1760, 5000))
+    audio = audio + 0.05 * rng.standard_normal(len(t))
+    if channels == 1:
+        return audio
+    return np.stack([np.roll(audio, c * 37) for c in range(channels)], axis=1)
+
+
+# Each setup returns (run, audio seconds processed per run). Setups get a
+# scratch directory for any files the benchmarked code reads or writes.
+
+def setup_vibe_effects(seconds, sample_rate, stems, scratch):
+    from mixer import apply_vibe_effects
+
+    # The worker pipeline is float32 end to end
+    tracks = [test_signal(seconds, sample_rate, seed=i).astype(np.float32) for i in range(stems)]
+
+    def run():
+        for track in tracks:
+            apply_vibe_effects(track, VIBE, sample_rate)
+
+    return run, seconds * stems
+
+
+def setup_frequency_band(seconds, sample_rate, stems, scratch):
+    from ddsp_synth import extract_frequency_band, STEM_BANDS
+
+    audio = test_signal(seconds, sample_rate).astype(np.float32)
+    # Past the four defined bands, stems reuse them in order
+    defined = [band[:2] for band in STEM_BANDS.values()]
+    bands = [defined[i % len(defined)] for i in range(stems)]
+
+    def run():
+        for low, high in bands:
+            extract_frequency_band(audio, sample_rate, low, high)
+
+    return run, seconds * len(bands)
+
+
+def setup_master(seconds, sample_rate, stems, scratch):
+    from song_engine.master import master
+
+    source = os.path.join(scratch, "mix.wav")
+    sf.write(source, test_signal(seconds, sample_rate, channels=2), sample_rate, subtype="PCM_16")
+    output = os.path.join(scratch, "mastered.wav")
+
+    def run():
+        master(source, output)
+
+    return run, seconds
+
+
+def setup_arrange(seconds, sample_rate, stems, scratch):
+    from song_engine.arranger import arrange
+
+    section_seconds = seconds / SECTIONS + CROSSFADE_MS / 1000
+    sections = []
+    for i in range(SECTIONS):
+        path = os.path.join(scratch, f"section_{i}.wav")
+        sf.write(path, test_signal(section_seconds, sample_rate, channels=2, seed=i), sample_rate)
+        sections.append(path)
+    output = os.path.join(scratch, "song.wav")
+
+    def run():
+        arrange(sections, output, crossfade_ms=CROSSFADE_MS, fade_in_ms=1000, fade_out_ms=3000)
+
+    return run, seconds
+
+
+def setup_pitch_shift(seconds, sample_rate, stems, scratch):
+    # The harmony engine converts pydub segments to arrays around this call
+    from dsp.pitch import pitch_shift_samples
+
+    samples = test_signal(seconds, sample_rate)[:, np.newaxis]
+
+    def run():
+        pitch_shift_samples(samples, [4])
+
+    return run, seconds
+
+
+# name -> (setup, sweeps stem count)
+BENCHMARKS: Dict[str, Tuple[Callable, bool]] = {
+    "mixer.apply_vibe_effects": (setup_vibe_effects, True),
+    "ddsp_synth.extract_frequency_band": (setup_frequency_band, True),
+    "master.master": (setup_master, False),
+    "arranger.arrange": (setup_arrange, False),
+    "harmony.engine.pitch_shift": (setup_pitch_shift, False),
+}
+
+
+def case_id(name: str, seconds: int, sample_rate: int, stems: Optional[int]) -> str:
+    case = f"{name}/{seconds}s/{sample_rate}Hz"
+    return f"{case}/{stems}stems" if stems else case
+
+
+def _measure(name, seconds, sample_rate, stems, repeats, results):
+    """Child process: time one case and report its peak RSS"""
+    # Silence the progress prints of the code under test
+    sys.stdout = open(os.devnull, "w")
+
+    setup, _ = BENCHMARKS[name]
+    scratch = tempfile.mkdtemp(prefix="dsp-bench-")
+    try:
+        run, audio_seconds = setup(seconds, sample_rate, stems or 1, scratch)
+        run()  # Warm-up: filter design caches, imports, page faults
+
+        best = float("inf")
+        for _ in range(repeats):
+            start = time.perf_counter()
+            run()
+            best = min(best, time.perf_counter() - start)
+
+        # ru_maxrss is KiB on Linux, bytes on macOS
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        peak_mb = peak / (1024 * 1024 if sys.platform == "darwin" else 1024)
+
+        results.put({
+            "seconds": best,
+            "throughput": audio_seconds / best,
+            "peak_rss_mb": round(peak_mb, 1)
+        })
+    except Exception as e:
+        results.put({"error": f"{type(e).__name__}: {e}"})
+    finally:
+        shutil.rmtree(scratch, ignore_errors=True)
+
+
+def run_case(name, seconds, sample_rate, stems, repeats, timeout=CASE_TIMEOUT) -> Dict:
+    """Run one case in a fresh process, killing it after timeout seconds"""
+    ctx = multiprocessing.get_context("spawn")
+    results = ctx.Queue()
+    process = ctx.Process(target=_measure, args=(name, seconds, sample_rate, stems, repeats, results))
+    process.start()
+    try:
+        result = results.get(timeout=timeout)
+    except Empty:
+        # Hung, or died without reporting (e.g. killed for memory)
+        result = {"error": f"no result after {timeout}s (exit code {process.exitcode})"}
+        process.kill()
+    process.join()
+    return result
+
+
+def compare(results: Dict, baseline: Dict, tolerance: float, rss_tolerance: float) -> List[str]:
+    """Regression messages for cases that fell outside the tolerances"""
+    regressions = []
+    for case, result in results.items():
+        base = baseline.get(case)
+        if not base or "error" in result or "error" in base:
+            continue
+
+        floor = base["throughput"] * (1 - tolerance)
+        if result["throughput"] < floor:
+            regressions.append(
+                f"{case}: {result['throughput']:.1f}x realtime, baseline {base['throughput']:.1f}x "
+                f"(-{(1 - result['throughput'] / base['throughput']) * 100:.0f}%)"
+            )
+
+        ceiling = base["peak_rss_mb"] * (1 + rss_tolerance)
+        if result["peak_rss_mb"] > ceiling:
+            regressions.append(
+                f"{case}: peak RSS {result['peak_rss_mb']:.0f} MB, baseline {base['peak_rss_mb']:.0f} MB"
+            )
+    return regressions
+
+
+def parse_list(value: str) -> List[int]:
+    return [int(item) for item in value.split(",") if item.strip()]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark audio DSP hot paths")
+    parser.add_argument("--only", action="append", help="Benchmark name prefix to run (repeatable)")
+    parser.add_argument("--lengths", type=parse_list, help="Track lengths in seconds (comma-separated)")
+    parser.add_argument("--sample-rates", type=parse_list, default=SAMPLE_RATES, help="Sample rates in Hz")
+    parser.add_argument("--stems", type=parse_list, default=STEM_COUNTS, help="Stem counts")
+    parser.add_argument("--quick", action="store_true", help=f"Only lengths {QUICK_LENGTHS}")
+    parser.add_argument("--repeats", type=int, default=3, help="Timed runs per case (best is kept)")
+    parser.add_argument("--timeout", type=float, default=CASE_TIMEOUT, help="Seconds before a case is killed")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="Baseline JSON path")
+    parser.add_argument("--save-baseline", action="store_true", help="Write results as the new baseline")
+    parser.add_argument("--tolerance", type=float, default=0.15, help="Allowed throughput drop (fraction)")
+    parser.add_argument("--rss-tolerance", type=float, default=0.25, help="Allowed peak RSS growth (fraction)")
+    parser.add_argument("--json", help="Also write results to this path")
+    args = parser.parse_args()
+
+    lengths = args.lengths or (QUICK_LENGTHS if args.quick else LENGTHS)
+    names = [
+        name for name in BENCHMARKS
+        if not args.only or any(name.startswith(prefix) for prefix in args.only)
+    ]
+
+    cases = []
+    for name in names:
+        stem_counts = args.stems if BENCHMARKS[name][1] else [None]
+        for seconds in lengths:
+            for sample_rate in args.sample_rates:
+                for stems in stem_counts:
+                    cases.append((name, seconds, sample_rate, stems))
+
+    print(f"Running {len(cases)} cases ({platform.processor() or platform.machine()}, "
+          f"{os.cpu_count()} CPUs, Python {platform.python_version()})\n")
+    print(f"{'case':<58} {'x realtime':>11} {'peak RSS':>10}")
+
+    results = {}
+    for name, seconds, sample_rate, stems in cases:
+        case = case_id(name, seconds, sample_rate, stems)
+        result = run_case(name, seconds, sample_rate, stems, args.repeats, args.timeout)
+        results[case] = result
+        if "error" in result:
+            print(f"{case:<58} {'failed':>11}  {result['error']}")
+        else:
+            print(f"{case:<58} {result['throughput']:>10.1f}x {result['peak_rss_mb']:>7.0f} MB")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+    failed = [case for case, result in results.items() if "error" in result]
+
+    if args.save_baseline:
+        baseline = {}
+        if os.path.exists(args.baseline):
+            with open(args.baseline, "r") as f:
+                baseline = json.load(f)
+        baseline.update({case: result for case, result in results.items() if "error" not in result})
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+        print(f"\n✓ Saved {len(results) - len(failed)} cases to {args.baseline}")
+        return 1 if failed else 0
+
+    if not os.path.exists(args.baseline):
+        print(f"\nNo baseline at {args.baseline}; run with --save-baseline to create one")
+        return 1 if failed else 0
+
+    with open(args.baseline, "r") as f:
+        baseline = json.load(f)
+
+    regressions = compare(results, baseline, args.tolerance, args.rss_tolerance)
+    missing = [case for case in results if case not in baseline]
+
+    if missing:
+        print(f"\n{len(missing)} cases have no baseline yet (not gated)")
+    if failed:
+        print(f"\n❌ {len(failed)} cases failed to run")
+    if regressions:
+        print(f"\n❌ {len(regressions)} regressions against {args.baseline}:")
+        for message in regressions:
+            print(f"  {message}")
+    if failed or regressions:
+        return 1
+
+    print(f"\n✓ No regressions against {args.baseline}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
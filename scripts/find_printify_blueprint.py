@@ -5,6 +5,8 @@ Usage: python scripts/find_printify_blueprint.py --search "gildan 18500"
 """
 import os
 import sys
+import json
+import time
 import argparse
 import requests
 from dotenv import load_dotenv
@@ -14,6 +16,14 @@ from typing import List, Dict, Optional
 load_dotenv()
 
 PRINTIFY_API = "https://api.printify.com/v1"
+CACHE_DIR = os.getenv(
+    "PRINTIFY_CATALOG_CACHE_DIR",
+    os.path.join(os.path.expanduser("~"), ".cache", "printify-catalog")
+)
+
+# Set from command line flags
+CACHE_MAX_AGE_SECONDS = 24 * 3600
+CACHE_REFRESH = False
 
 
 def get_api_key() -> Optional[str]:
@@ -25,6 +35,47 @@ def get_api_key() -> Optional[str]:
     return api_key
 
 
+def cached_get_json(api_key: str, endpoint: str):
+    """
+    GET a catalog endpoint, reusing a cached response younger than CACHE_MAX_AGE_SECONDS
+
+    Catalog data rarely changes, so repeated searches don't re-download it.
+
+    Raises:
+        requests.exceptions.RequestException: On network/API errors
+    """
+    cache_path = os.path.join(CACHE_DIR, endpoint.strip("/").replace("/", "_"))
+
+    if not CACHE_REFRESH:
+        try:
+            if time.time() - os.path.getmtime(cache_path) < CACHE_MAX_AGE_SECONDS:
+                with open(cache_path, "r") as f:
+                    return json.load(f)
+        except (OSError, ValueError):
+            pass
+
+    response = requests.get(
+        f"{PRINTIFY_API}{endpoint}",
+        headers={
+            "Authorization": f"Bearer {api_key}",
+            "Content-Type": "application/json"
+        },
+        timeout=30
+    )
+    response.raise_for_status()
+    data = response.json()
+
+    try:
+        os.makedirs(CACHE_DIR, exist_ok=True)
+        with open(f"{cache_path}.tmp", "w") as f:
+            json.dump(data, f)
+        os.replace(f"{cache_path}.tmp", cache_path)
+    except OSError as e:
+        print(f"⚠️  Could not cache {endpoint}: {e}", file=sys.stderr)
+
+    return data
+
+
 def search_blueprints(api_key: str, search_term: str = "") -> List[Dict]:
     """
     Search Printify catalog for blueprints
@@ -36,21 +87,9 @@ def search_blueprints(api_key: str, search_term: str = "") -> List[Dict]:
     Returns:
         List of matching blueprint dictionaries
     """
-    headers = {
-        "Authorization": f"Bearer {api_key}",
-        "Content-Type": "application/json"
-    }
-
     try:
         print(f"🔍 Searching Printify catalog{f' for: {search_term}' if search_term else ''}...")
-        response = requests.get(
-            f"{PRINTIFY_API}/catalog/blueprints.json",
-            headers=headers,
-            timeout=30
-        )
-        response.raise_for_status()
-
-        blueprints = response.json()
+        blueprints = cached_get_json(api_key, "/catalog/blueprints.json")
 
         if search_term:
             search_lower = search_term.lower()
@@ -79,19 +118,8 @@ def get_blueprint_providers(api_key: str, blueprint_id: int) -> List[Dict]:
     Returns:
         List of provider dictionaries
     """
-    headers = {
-        "Authorization": f"Bearer {api_key}",
-        "Content-Type": "application/json"
-    }
-
     try:
-        response = requests.get(
-            f"{PRINTIFY_API}/catalog/blueprints/{blueprint_id}/print_providers.json",
-            headers=headers,
-            timeout=30
-        )
-        response.raise_for_status()
-        return response.json()
+        return cached_get_json(api_key, f"/catalog/blueprints/{blueprint_id}/print_providers.json")
 
     except requests.exceptions.RequestException as e:
         print(f"❌ Error fetching providers for blueprint {blueprint_id}: {e}", file=sys.stderr)
@@ -136,6 +164,9 @@ Examples:
 
   # Show specific blueprint with providers
   python scripts/find_printify_blueprint.py --id 165 --providers
+
+  # Ignore the local catalog cache (~/.cache/printify-catalog)
+  python scripts/find_printify_blueprint.py --search "hoodie" --refresh
         """
     )
 
@@ -170,8 +201,25 @@ Examples:
         help="Limit number of results (default: 10)"
     )
 
+    parser.add_argument(
+        "--refresh",
+        action="store_true",
+        help="Re-download catalog data instead of using the local cache"
+    )
+
+    parser.add_argument(
+        "--max-age",
+        type=float,
+        default=24,
+        help="Max age of cached catalog data in hours (default: 24)"
+    )
+
     args = parser.parse_args()
 
+    global CACHE_MAX_AGE_SECONDS, CACHE_REFRESH
+    CACHE_MAX_AGE_SECONDS = args.max_age * 3600
+    CACHE_REFRESH = args.refresh
+
     # Get API key
     api_key = get_api_key()
     if not api_key:
@@ -0,0 +1,751 @@
+#!/usr/bin/env python3
+"""
+Load and soak test the music pipeline and the POD gateway on mock engines
+Usage: python scripts/load_test.py [--music URL] [--gateway URL] [--duration SECONDS]
+
+Music: replays a job mix open-loop (Poisson arrivals at --rate jobs/s)
+through the API -> Redis -> workers. Start the workers with
+MUSICGEN_MOCK=true and MUSICGEN_MOCK_LATENCY=<GPU seconds per audio
+second> so they stand in for a GPU fleet of that speed.
+
+Gateway: serves a mock ComfyUI and a mock Printify from this process,
+each with its own injected latency, and drives generate -> approve ->
+bulk publish at --gateway-rate designs/s. Start the gateway with the
+environment printed at startup so it talks to the mocks.
+
+Every --sample-interval the harness appends a sample to --out (JSON
+lines): queue depths, worker stage quantiles and worker RSS from the
+API's /health, the gateway's publish queue, and the RSS of any --pid.
+The summary reports throughput, client-side p50/p95/p99 per stage and
+RSS growth per hour (the memory-creep number), and exits non-zero when
+--max-failure-rate or --max-rss-growth is exceeded.
+"""
+import os
+import sys
+import json
+import time
+import uuid
+import zlib
+import random
+import struct
+import argparse
+import resource
+import threading
+import urllib.error
+import urllib.parse
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+# Client-side polling of outstanding jobs
+POLL_INTERVAL = 0.5
+
+# Samples before this fraction of the run are skipped for RSS growth
+# (caches, pools and allocators fill up first)
+RSS_WARMUP_FRACTION = 0.1
+
+GENRES = ["synthwave", "lofi", "techno", "ambient", "house", "trap"]
+
+
+# ===== HTTP =====
+
+def http_json(method: str, url: str, body: Any = None, timeout: float = 30) -> Tuple[int, Any]:
+    """(status, decoded JSON or None); connection errors are status 0"""
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method)
+    if data is not None:
+        req.add_header("Content-Type", "application/json")
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as response:
+            payload = response.read()
+            return response.status, json.loads(payload) if payload else None
+    except urllib.error.HTTPError as e:
+        try:
+            return e.code, json.loads(e.read() or b"null")
+        except ValueError:
+            return e.code, None
+    except (OSError, ValueError):
+        return 0, None
+
+
+def process_rss_mb(pid: int) -> Optional[float]:
+    """Resident memory of a local process (Linux procfs)"""
+    try:
+        with open(f"/proc/{pid}/status") as f:
+            for line in f:
+                if line.startswith("VmRSS:"):
+                    return round(int(line.split()[1]) / 1024, 1)
+    except OSError:
+        pass
+    return None
+
+
+# ===== Statistics =====
+
+class Recorder:
+    """Counters and per-stage latencies, shared by the load threads"""
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self.counts: Dict[str, int] = {}
+        self.latencies: Dict[str, List[float]] = {}
+
+    def count(self, name: str, n: int = 1):
+        with self._lock:
+            self.counts[name] = self.counts.get(name, 0) + n
+
+    def observe(self, stage: str, seconds: float):
+        with self._lock:
+            self.latencies.setdefault(stage, []).append(seconds)
+
+    def snapshot(self) -> Tuple[Dict[str, int], Dict[str, List[float]]]:
+        with self._lock:
+            return dict(self.counts), {k: list(v) for k, v in self.latencies.items()}
+
+
+def quantiles(values: List[float]) -> Dict[str, float]:
+    """count, mean and nearest-rank p50/p95/p99"""
+    ordered = sorted(values)
+    n = len(ordered)
+
+    def rank(q):
+        return ordered[min(n - 1, max(0, int(q * n + 0.5) - 1))]
+
+    return {
+        "count": n,
+        "mean": sum(ordered) / n,
+        "p50": rank(0.50),
+        "p95": rank(0.95),
+        "p99": rank(0.99)
+    }
+
+
+def growth_per_hour(points: List[Tuple[float, float]]) -> Optional[float]:
+    """Least-squares slope of (seconds, MB) points, in MB per hour"""
+    if len(points) < 3:
+        return None
+    mean_t = sum(t for t, _ in points) / len(points)
+    mean_v = sum(v for _, v in points) / len(points)
+    var = sum((t - mean_t) ** 2 for t, _ in points)
+    if not var:
+        return None
+    slope = sum((t - mean_t) * (v - mean_v) for t, v in points) / var
+    return slope * 3600
+
+
+def active(stop: threading.Event) -> bool:
+    """Load running, or stopped but still inside its drain window"""
+    return not stop.is_set() or time.time() < getattr(stop, "drain_until", 0)
+
+
+def poisson_arrivals(rate: float, stop: threading.Event, submit: Callable[[], None]):
+    """Call submit at exponentially spaced intervals until stop is set"""
+    while not stop.wait(random.expovariate(rate)):
+        submit()
+
+
+# ===== Music pipeline =====
+
+def parse_mix(value: str) -> Dict[str, float]:
+    """'generate=8,stems=1,variation=1' -> weights"""
+    mix = {}
+    for item in value.split(","):
+        name, _, weight = item.partition("=")
+        if name.strip() not in MusicLoad.KINDS:
+            raise argparse.ArgumentTypeError(f"Unknown job kind {name!r} (one of {', '.join(MusicLoad.KINDS)})")
+        mix[name.strip()] = float(weight or 1)
+    return mix
+
+
+class MusicLoad:
+    """
+    Open-loop job submission against the music API
+
+    Kinds: generate (plain /generate), stems (/generate?retain_stems=true)
+    and variation (/generate/variations of a finished stems job, a CPU
+    re-mix; a plain generate until one has finished).
+    """
+
+    KINDS = ("generate", "stems", "variation")
+
+    def __init__(self, url: str, rate: float, mix: Dict[str, float], durations: List[int],
+                 repeat: float, max_outstanding: int, recorder: Recorder):
+        self.url = url.rstrip("/")
+        self.rate = rate
+        self.kinds, self.weights = zip(*mix.items())
+        self.durations = durations
+        self.repeat = repeat
+        self.max_outstanding = max_outstanding
+        self.recorder = recorder
+        self._lock = threading.Lock()
+        self._outstanding: Dict[str, Dict[str, Any]] = {}  # job ID -> submitted, running, kind
+        self._specs: List[Dict[str, Any]] = []
+        self._stem_jobs: List[str] = []
+        self._submitter = ThreadPoolExecutor(max_workers=8, thread_name_prefix="music-submit")
+
+    def run(self, stop: threading.Event) -> List[threading.Thread]:
+        threads = [
+            threading.Thread(target=poisson_arrivals, args=(self.rate, stop, self._arrive), daemon=True),
+            threading.Thread(target=self._poll_loop, args=(stop,), daemon=True)
+        ]
+        for thread in threads:
+            thread.start()
+        return threads
+
+    @property
+    def outstanding(self) -> int:
+        with self._lock:
+            return len(self._outstanding)
+
+    def _arrive(self):
+        if self.outstanding >= self.max_outstanding:
+            self.recorder.count("music.shed")
+            return
+        kind = random.choices(self.kinds, self.weights)[0]
+        self._submitter.submit(self._submit, kind)
+
+    def _spec(self) -> Dict[str, Any]:
+        with self._lock:
+            if self._specs and random.random() < self.repeat:
+                return random.choice(self._specs)  # Identical spec: a render cache hit
+        genres = random.sample(GENRES, 2)
+        spec = {
+            "bpm": random.randint(80, 160),
+            "duration": random.choice(self.durations),
+            "vibe": {name: round(random.random(), 2) for name in ("energy", "dark", "dreamy", "aggressive")},
+            "genre_mix": {genres[0]: 0.7, genres[1]: 0.3},
+            "seed": random.randint(0, 2 ** 31)
+        }
+        with self._lock:
+            self._specs = (self._specs + [spec])[-100:]
+        return spec
+
+    def _submit(self, kind: str):
+        with self._lock:
+            base = random.choice(self._stem_jobs) if self._stem_jobs else None
+        started = time.time()
+
+        if kind == "variation" and base:
+            query = urllib.parse.urlencode({"base_job_id": base, "count": 1, "mode": "auto"})
+            status, body = http_json("POST", f"{self.url}/generate/variations?{query}", {})
+            job_ids = list((body or {}).get("variation_ids", [])) if status == 200 else []
+        else:
+            kind = "generate" if kind == "variation" else kind
+            query = "?retain_stems=true" if kind == "stems" else ""
+            status, body = http_json("POST", f"{self.url}/generate{query}", self._spec())
+            job_ids = [body["job_id"]] if status == 200 and body else []
+
+        self.recorder.observe("music.submit", time.time() - started)
+        if not job_ids:
+            self.recorder.count("music.rejected")
+            return
+        self.recorder.count("music.submitted", len(job_ids))
+        with self._lock:
+            for job_id in job_ids:
+                self._outstanding[job_id] = {"submitted": started, "running": None, "kind": kind}
+
+    def _poll_loop(self, stop: threading.Event):
+        # Keeps polling through the drain so in-flight jobs still count
+        while active(stop):
+            with self._lock:
+                jobs = list(self._outstanding.items())
+            for job_id, job in jobs:
+                status, body = http_json("GET", f"{self.url}/status/{job_id}", timeout=10)
+                if status != 200 or not body:
+                    continue
+                now = time.time()
+                if body["status"] == "running" and job["running"] is None:
+                    job["running"] = now
+                    self.recorder.observe("music.queue_wait", now - job["submitted"])
+                elif body["status"] in ("completed", "failed"):
+                    self._finish(job_id, job, body["status"], now)
+            time.sleep(POLL_INTERVAL)
+
+    def _finish(self, job_id: str, job: Dict[str, Any], status: str, now: float):
+        with self._lock:
+            self._outstanding.pop(job_id, None)
+            if status == "completed" and job["kind"] == "stems":
+                self._stem_jobs = (self._stem_jobs + [job_id])[-100:]
+        self.recorder.count(f"music.{status}")
+        if status == "completed":
+            if job["running"] is not None:
+                self.recorder.observe("music.run", now - job["running"])
+            self.recorder.observe(f"music.total.{job['kind']}", now - job["submitted"])
+
+
+# ===== Gateway (mock ComfyUI + Printify) =====
+
+def mock_png(kilobytes: int) -> bytes:
+    """Valid 64x64 PNG padded with an ancillary chunk to roughly this size"""
+    def chunk(kind: bytes, data: bytes) -> bytes:
+        return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data))
+
+    raw = b"".join(b"\x00" + bytes(range(64)) * 3 for _ in range(64))
+    padding = os.urandom(max(0, kilobytes * 1024 - 200))
+    return (b"\x89PNG\r\n\x1a\n"
+            + chunk(b"IHDR", struct.pack(">IIBBBBB", 64, 64, 8, 2, 0, 0, 0))
+            + chunk(b"prVt", padding)
+            + chunk(b"IDAT", zlib.compress(raw))
+            + chunk(b"IEND", b""))
+
+
+class MockBackends:
+    """
+    ComfyUI (/prompt, /history, /view) and Printify (/printify/v1/...) stand-ins
+
+    A ComfyUI prompt completes comfy_latency seconds per image after it was
+    queued; Printify calls each take printify_latency seconds.
+    """
+
+    def __init__(self, port: int, comfy_latency: float, printify_latency: float, image_kb: int):
+        self.comfy_latency = comfy_latency
+        self.printify_latency = printify_latency
+        self.image = mock_png(image_kb)
+        self._prompts: Dict[str, Tuple[float, int]] = {}  # prompt ID -> (ready at, images)
+        self._lock = threading.Lock()
+
+        mocks = self
+
+        class Handler(BaseHTTPRequestHandler):
+            def log_message(self, *args):
+                pass
+
+            def do_GET(self):
+                mocks.handle(self, "GET")
+
+            def do_POST(self):
+                mocks.handle(self, "POST")
+
+        self.server = ThreadingHTTPServer(("127.0.0.1", port), Handler)
+        self.server.daemon_threads = True
+        self.url = f"http://127.0.0.1:{self.server.server_address[1]}"
+        threading.Thread(target=self.server.serve_forever, name="mocks", daemon=True).start()
+
+    def environment(self) -> Dict[str, str]:
+        """Gateway settings that route it to the mocks"""
+        return {
+            "COMFYUI_API_URL": self.url,
+            "PRINTIFY_API_URL": f"{self.url}/printify/v1",
+            "PRINTIFY_API_KEY": "load-test-key",
+            "PRINTIFY_SHOP_ID": "1"
+        }
+
+    def handle(self, request: BaseHTTPRequestHandler, method: str):
+        path = urllib.parse.urlparse(request.path).path
+        length = int(request.headers.get("Content-Length") or 0)
+        body = request.rfile.read(length) if length else b""
+
+        if path.startswith("/printify/"):
+            time.sleep(self.printify_latency)
+            if path.endswith("/variants.json"):
+                reply = {"variants": [{"id": i, "title": f"Variant {i}", "is_available": True} for i in range(1, 6)]}
+            elif method == "POST" and not path.endswith("/publish.json"):
+                reply = {"id": uuid.uuid4().hex}  # Uploaded image or created product
+            else:
+                reply = {}
+            return self._send_json(request, reply)
+
+        if path == "/prompt" and method == "POST":
+            workflow = json.loads(body or b"{}").get("prompt", {})
+            images = sum(int(node.get("inputs", {}).get("batch_size", 1))
+                         for node in workflow.values() if node.get("class_type") == "EmptyLatentImage")
+            images *= max(1, sum(1 for node in workflow.values() if node.get("class_type") == "SaveImage"))
+            prompt_id = uuid.uuid4().hex
+            with self._lock:
+                self._prompts[prompt_id] = (time.time() + self.comfy_latency * images, images)
+            return self._send_json(request, {"prompt_id": prompt_id})
+
+        if path.startswith("/history/"):
+            prompt_id = path.rsplit("/", 1)[-1]
+            with self._lock:
+                ready_at, images = self._prompts.get(prompt_id, (None, 0))
+            if ready_at is None or time.time() < ready_at:
+                return self._send_json(request, {})
+            outputs = {"9": {"images": [
+                {"filename": f"loadtest_{prompt_id}_{i:05d}_.png", "subfolder": "", "type": "output"}
+                for i in range(images)
+            ]}}
+            return self._send_json(request, {prompt_id: {"status": {"completed": True}, "outputs": outputs}})
+
+        if path == "/view":
+            request.send_response(200)
+            request.send_header("Content-Type", "image/png")
+            request.send_header("Content-Length", str(len(self.image)))
+            request.end_headers()
+            request.wfile.write(self.image)
+            return
+
+        self._send_json(request, {"error": "not found"}, 404)
+
+    @staticmethod
+    def _send_json(request: BaseHTTPRequestHandler, reply: Any, status: int = 200):
+        payload = json.dumps(reply).encode()
+        request.send_response(status)
+        request.send_header("Content-Type", "application/json")
+        request.send_header("Content-Length", str(len(payload)))
+        request.end_headers()
+        request.wfile.write(payload)
+
+
+class GatewayLoad:
+    """
+    Designs through the gateway: generate, approve each image, then bulk
+    publish every --publish-batch approved images; publish outcomes are
+    read from /api/publish/events.
+    """
+
+    def __init__(self, url: str, rate: float, batch_size: int, publish_batch: int, recorder: Recorder):
+        self.url = url.rstrip("/")
+        self.rate = rate
+        self.batch_size = batch_size
+        self.publish_batch = publish_batch
+        self.recorder = recorder
+        self._lock = threading.Lock()
+        self._approved: List[str] = []
+        self._publishing: Dict[str, float] = {}  # image ID -> queued at
+        self._designs = ThreadPoolExecutor(max_workers=32, thread_name_prefix="gateway-design")
+        self._in_flight = 0
+
+    def run(self, stop: threading.Event) -> List[threading.Thread]:
+        threads = [
+            threading.Thread(target=poisson_arrivals, args=(self.rate, stop, self._arrive), daemon=True),
+            threading.Thread(target=self._events_loop, args=(stop,), daemon=True)
+        ]
+        for thread in threads:
+            thread.start()
+        return threads
+
+    @property
+    def outstanding(self) -> int:
+        with self._lock:
+            return self._in_flight + len(self._publishing) + len(self._approved)
+
+    def flush(self):
+        """Publish whatever is approved (end of run)"""
+        with self._lock:
+            batch, self._approved = self._approved, []
+        if batch:
+            self._publish(batch)
+
+    def _arrive(self):
+        with self._lock:
+            self._in_flight += 1
+        self._designs.submit(self._design)
+
+    def _design(self):
+        try:
+            started = time.time()
+            status, body = http_json("POST", f"{self.url}/api/generate", {
+                "prompt": f"load test design {uuid.uuid4().hex[:6]}",
+                "batch_size": self.batch_size
+            })
+            if status != 200 or not body or not body.get("prompt_id"):
+                self.recorder.count("gateway.generate_failed")
+                return
+
+            images = []
+            query = urllib.parse.urlencode({"prompt_id": body["prompt_id"]})
+            while not images and time.time() - started < 600:
+                time.sleep(POLL_INTERVAL)
+                status, body = http_json("GET", f"{self.url}/api/generation_status?{query}")
+                if status == 200 and body:
+                    images = [image["id"] for image in body.get("downloaded", [])]
+            if not images:
+                self.recorder.count("gateway.generate_failed")
+                return
+            self.recorder.observe("gateway.generate", time.time() - started)
+            self.recorder.count("gateway.images", len(images))
+
+            for image_id in images:
+                approved = time.time()
+                status, _ = http_json("POST", f"{self.url}/api/approve/{image_id}")
+                self.recorder.observe("gateway.approve", time.time() - approved)
+                if status == 200:
+                    with self._lock:
+                        self._approved.append(image_id)
+
+            with self._lock:
+                batch = None
+                if len(self._approved) >= self.publish_batch:
+                    batch, self._approved = self._approved, []
+            if batch:
+                self._publish(batch)
+        finally:
+            with self._lock:
+                self._in_flight -= 1
+
+    def _publish(self, image_ids: List[str]):
+        started = time.time()
+        status, body = http_json("POST", f"{self.url}/api/publish/bulk", {"image_ids": image_ids})
+        self.recorder.observe("gateway.publish_request", time.time() - started)
+        if status != 202 or not body:
+            self.recorder.count("gateway.publish_rejected", len(image_ids))
+            return
+        with self._lock:
+            for job in body.get("queued", []):
+                self._publishing[job["image_id"]] = started
+        self.recorder.count("gateway.publish_rejected", len(body.get("skipped", [])))
+
+    def _events_loop(self, stop: threading.Event):
+        since = None
+        while active(stop):
+            url = f"{self.url}/api/publish/events" + (f"?since={since}" if since is not None else "")
+            try:
+                with urllib.request.urlopen(url, timeout=60) as stream:
+                    for raw in stream:
+                        line = raw.decode().strip()
+                        if line.startswith("id:"):
+                            since = int(line[3:])
+                        elif line.startswith("data:"):
+                            self._publish_event(json.loads(line[5:]))
+                        if not active(stop):
+                            return
+            except (OSError, ValueError):
+                time.sleep(1)
+
+    def _publish_event(self, event: Dict[str, Any]):
+        if event["status"] not in ("published", "failed"):
+            return
+        with self._lock:
+            queued = self._publishing.pop(event["image_id"], None)
+        if queued is None:
+            return  # Not ours (UI or an earlier run)
+        self.recorder.count(f"gateway.{event['status']}")
+        if event["status"] == "published":
+            self.recorder.observe("gateway.publish", time.time() - queued)
+
+
+# ===== Sampling =====
+
+class Sampler:
+    """Periodic queue depth, stage and RSS samples"""
+
+    def __init__(self, music_url: Optional[str], gateway_url: Optional[str], pids: List[int],
+                 recorder: Recorder, out: Optional[str]):
+        self.music_url = music_url.rstrip("/") if music_url else None
+        self.gateway_url = gateway_url.rstrip("/") if gateway_url else None
+        self.pids = pids
+        self.recorder = recorder
+        self.out = open(out, "a") if out else None
+        self.started = time.time()
+        self.samples: List[Dict[str, Any]] = []
+        self.last_stages: Dict[str, Any] = {}
+
+    def sample(self) -> Dict[str, Any]:
+        now = time.time()
+        counts, _ = self.recorder.snapshot()
+        sample: Dict[str, Any] = {"t": round(now - self.started, 1), "counts": counts, "rss_mb": {}}
+
+        if self.music_url:
+            status, health = http_json("GET", f"{self.music_url}/health", timeout=10)
+            if status == 200 and health:
+                sample["queue"] = health.get("queue")
+                self.last_stages = health.get("stages") or self.last_stages
+                for name, fields in ((health.get("workers") or {}).get("workers") or {}).items():
+                    if fields.get("rss_mb"):
+                        sample["rss_mb"][f"worker:{name}"] = float(fields["rss_mb"])
+
+        if self.gateway_url:
+            status, publish = http_json("GET", f"{self.gateway_url}/api/publish/queue", timeout=10)
+            if status == 200:
+                sample["publish_queue"] = publish
+
+        for pid in self.pids:
+            rss = process_rss_mb(pid)
+            if rss is not None:
+                sample["rss_mb"][f"pid:{pid}"] = rss
+        sample["rss_mb"]["harness"] = process_rss_mb(os.getpid()) or round(
+            resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024, 1)
+
+        self.samples.append(sample)
+        if self.out:
+            self.out.write(json.dumps(sample) + "\n")
+            self.out.flush()
+        return sample
+
+    def rss_growth(self) -> Dict[str, Dict[str, Optional[float]]]:
+        """Per source: first, last and peak RSS, and growth per hour after warm-up"""
+        if not self.samples:
+            return {}
+        skip = self.samples[-1]["t"] * RSS_WARMUP_FRACTION
+        report = {}
+        for source in sorted({name for sample in self.samples for name in sample["rss_mb"]}):
+            points = [(s["t"], s["rss_mb"][source]) for s in self.samples if source in s["rss_mb"]]
+            steady = [(t, v) for t, v in points if t >= skip]
+            report[source] = {
+                "first_mb": points[0][1],
+                "last_mb": points[-1][1],
+                "peak_mb": max(v for _, v in points),
+                "growth_mb_per_hour": growth_per_hour(steady)
+            }
+        return report
+
+
+def progress_line(sample: Dict[str, Any], music: Optional[MusicLoad], gateway: Optional[GatewayLoad]) -> str:
+    counts = sample["counts"]
+    parts = []
+    if music:
+        depth = sum((sample.get("queue") or {}).values())
+        parts.append(f"music {counts.get('music.completed', 0)} done/{counts.get('music.failed', 0)} failed, "
+                     f"{music.outstanding} in flight, streams {depth}")
+    if gateway:
+        queued = (sample.get("publish_queue") or {}).get("queued", "-")
+        parts.append(f"gateway {counts.get('gateway.published', 0)} published/{counts.get('gateway.failed', 0)} failed, "
+                     f"publish queue {queued}")
+    rss = sample["rss_mb"]
+    if rss:
+        parts.append("RSS " + ", ".join(f"{name} {mb:.0f}MB" for name, mb in sorted(rss.items())))
+    return f"[{sample['t']:>7.0f}s] " + " | ".join(parts)
+
+
+def parse_list(value: str) -> List[int]:
+    return [int(item) for item in value.split(",") if item.strip()]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load and soak test on mock engines")
+    parser.add_argument("--music", help="Music API URL, e.g. http://localhost:8000")
+    parser.add_argument("--gateway", help="POD gateway URL, e.g. http://localhost:5000")
+    parser.add_argument("--duration", type=float, default=300, help="Seconds of load (hours for a soak)")
+    parser.add_argument("--drain", type=float, default=300, help="Max seconds to wait for in-flight work after")
+
+    music = parser.add_argument_group("music")
+    music.add_argument("--rate", type=float, default=0.5, help="Music jobs per second")
+    music.add_argument("--mix", type=parse_mix, default=parse_mix("generate=8,stems=1,variation=1"),
+                       help="Job mix weights (generate, stems, variation)")
+    music.add_argument("--durations", type=parse_list, default=[15, 30, 60], help="Track lengths to draw from")
+    music.add_argument("--repeat", type=float, default=0.0, help="Fraction of jobs reusing an earlier spec")
+    music.add_argument("--max-outstanding", type=int, default=1000, help="Shed arrivals beyond this many in flight")
+
+    gateway = parser.add_argument_group("gateway")
+    gateway.add_argument("--gateway-rate", type=float, default=0.2, help="Designs per second")
+    gateway.add_argument("--batch-size", type=int, default=1, help="Images per design")
+    gateway.add_argument("--publish-batch", type=int, default=4, help="Approved images per bulk publish")
+    gateway.add_argument("--mock-port", type=int, default=0, help="Port for the mock ComfyUI/Printify (default: any)")
+    gateway.add_argument("--comfy-latency", type=float, default=2.0, help="Mock ComfyUI seconds per image")
+    gateway.add_argument("--printify-latency", type=float, default=0.2, help="Mock Printify seconds per call")
+    gateway.add_argument("--image-kb", type=int, default=2048, help="Size of each mock image")
+    gateway.add_argument("--wait-for-gateway", type=float, default=0,
+                         help="Seconds to wait for the gateway to come up (start it after the mocks)")
+
+    report = parser.add_argument_group("reporting")
+    report.add_argument("--sample-interval", type=float, default=10, help="Seconds between samples")
+    report.add_argument("--pid", type=int, action="append", default=[], help="Also sample this process's RSS")
+    report.add_argument("--out", help="Append samples here (JSON lines)")
+    report.add_argument("--json", help="Write the summary here")
+    report.add_argument("--max-failure-rate", type=float, help="Fail the run above this fraction of failed jobs")
+    report.add_argument("--max-rss-growth", type=float, help="Fail the run above this MB/hour for any process")
+    args = parser.parse_args()
+
+    if not args.music and not args.gateway:
+        parser.error("give --music and/or --gateway")
+
+    recorder = Recorder()
+    stop = threading.Event()
+    music_load = gateway_load = None
+
+    if args.gateway:
+        mocks = MockBackends(args.mock_port, args.comfy_latency, args.printify_latency, args.image_kb)
+        print(f"Mock ComfyUI/Printify on {mocks.url}; start the gateway with:")
+        print("  " + " ".join(f"{k}={v}" for k, v in mocks.environment().items()) + "\n")
+        deadline = time.time() + args.wait_for_gateway
+        while http_json("GET", f"{args.gateway.rstrip('/')}/health", timeout=5)[0] != 200:
+            if time.time() >= deadline:
+                print(f"❌ Gateway not reachable at {args.gateway}")
+                return 1
+            time.sleep(2)
+        gateway_load = GatewayLoad(args.gateway, args.gateway_rate, args.batch_size, args.publish_batch, recorder)
+
+    if args.music:
+        if http_json("GET", f"{args.music.rstrip('/')}/health", timeout=5)[0] != 200:
+            print(f"❌ Music API not reachable at {args.music}")
+            return 1
+        music_load = MusicLoad(args.music, args.rate, args.mix, args.durations, args.repeat,
+                               args.max_outstanding, recorder)
+
+    sampler = Sampler(args.music, args.gateway, args.pid, recorder, args.out)
+    print(f"Running {args.duration:.0f}s of load"
+          + (f", music {args.rate}/s {dict(args.mix)}" if music_load else "")
+          + (f", gateway {args.gateway_rate} designs/s x {args.batch_size}" if gateway_load else "") + "\n")
+
+    threads = []
+    for load in (music_load, gateway_load):
+        if load:
+            threads += load.run(stop)
+
+    started = time.time()
+    try:
+        while time.time() - started < args.duration:
+            time.sleep(min(args.sample_interval, max(0.0, args.duration - (time.time() - started))))
+            print(progress_line(sampler.sample(), music_load, gateway_load))
+    except KeyboardInterrupt:
+        print("\nInterrupted, draining...")
+    load_seconds = time.time() - started
+
+    # Stop arrivals, then let in-flight work finish (counted, not timed out)
+    stop.drain_until = time.time() + args.drain
+    stop.set()
+    if gateway_load:
+        gateway_load.flush()
+    while time.time() < stop.drain_until and any(
+            load and load.outstanding for load in (music_load, gateway_load)):
+        time.sleep(min(args.sample_interval, 2))
+    print(progress_line(sampler.sample(), music_load, gateway_load))
+
+    counts, latencies = recorder.snapshot()
+    summary = {
+        "load_seconds": round(load_seconds, 1),
+        "counts": counts,
+        "throughput_per_minute": {
+            name: round(counts.get(name, 0) / load_seconds * 60, 2)
+            for name in ("music.completed", "gateway.images", "gateway.published") if name in counts
+        },
+        "stages": {stage: quantiles(values) for stage, values in sorted(latencies.items())},
+        "worker_stages": sampler.last_stages,
+        "rss": sampler.rss_growth()
+    }
+
+    print(f"\n{'stage':<28} {'count':>7} {'mean':>8} {'p50':>8} {'p95':>8} {'p99':>8}")
+    for stage, q in summary["stages"].items():
+        print(f"{stage:<28} {q['count']:>7} {q['mean']:>7.2f}s {q['p50']:>7.2f}s {q['p95']:>7.2f}s {q['p99']:>7.2f}s")
+    if sampler.last_stages:
+        print(f"\n{'worker stage':<28} {'count':>7} {'mean':>8} {'p50':>8} {'p95':>8} {'p99':>8}  (ms)")
+        for stage, q in sampler.last_stages.items():
+            print(f"{stage:<28} {q['count']:>7} {q['mean_ms']:>8} {q['p50_ms']!s:>8} {q['p95_ms']!s:>8} {q['p99_ms']!s:>8}")
+    print("\nThroughput: " + ", ".join(f"{name} {rate}/min" for name, rate in summary["throughput_per_minute"].items()))
+    print(f"\n{'RSS':<28} {'first':>8} {'last':>8} {'peak':>8} {'MB/hour':>9}")
+    for source, rss in summary["rss"].items():
+        growth = rss["growth_mb_per_hour"]
+        print(f"{source:<28} {rss['first_mb']:>8.0f} {rss['last_mb']:>8.0f} {rss['peak_mb']:>8.0f} "
+              f"{'-' if growth is None else f'{growth:+.1f}':>9}")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(summary, f, indent=2)
+
+    problems = []
+    if args.max_failure_rate is not None:
+        for pipeline, ok, bad in (("music", "music.completed", "music.failed"),
+                                  ("gateway", "gateway.published", "gateway.failed")):
+            done = counts.get(ok, 0) + counts.get(bad, 0)
+            if done and counts.get(bad, 0) / done > args.max_failure_rate:
+                problems.append(f"{pipeline}: {counts.get(bad, 0)}/{done} failed")
+    if args.max_rss_growth is not None:
+        for source, rss in summary["rss"].items():
+            growth = rss["growth_mb_per_hour"]
+            if source != "harness" and growth is not None and growth > args.max_rss_growth:
+                problems.append(f"{source}: RSS growing {growth:+.1f} MB/hour")
+    unfinished = sum(load.outstanding for load in (music_load, gateway_load) if load)
+    if unfinished:
+        print(f"\n⚠️  {unfinished} jobs still in flight after the {args.drain:.0f}s drain")
+
+    if problems:
+        print("\n❌ " + "\n❌ ".join(problems))
+        return 1
+    print("\n✓ Load test finished")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
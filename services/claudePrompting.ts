@@ -1,11 +1,20 @@
 /**
  * Claude Prompting Service
  * Generates creative prompts for POD designs using Claude API
+ *
+ * Identical requests (case and spacing aside) within cacheTtlMs are
+ * answered from memory or share the call already in flight, and at most
+ * maxConcurrentRequests calls reach the API at once.
  */
 
+import { Cache } from '../utils/cache'
+
 interface ClaudeConfig {
   apiKey: string
   model?: string
+  cacheTtlMs?: number // How long generated prompts are reused (0 disables)
+  cacheMaxEntries?: number
+  maxConcurrentRequests?: number // API calls in flight at once
 }
 
 interface PromptGenerationRequest {
@@ -24,14 +33,24 @@ interface GeneratedPrompt {
 }
 
 export class ClaudePromptingService {
-  private config: ClaudeConfig
+  private config: Required<ClaudeConfig>
   private baseUrl = 'https://api.anthropic.com/v1/messages'
+  private promptCache: Cache<string, GeneratedPrompt[]>
+  private active = 0
+  private waiters: Array<() => void> = []
 
   constructor(config: ClaudeConfig) {
     this.config = {
       model: 'claude-3-5-sonnet-20241022',
+      cacheTtlMs: 900000, // 15 minutes
+      cacheMaxEntries: 200,
+      maxConcurrentRequests: 2,
       ...config
     }
+    this.promptCache = new Cache({
+      ttl: this.config.cacheTtlMs,
+      maxSize: this.config.cacheMaxEntries
+    })
   }
 
   /**
@@ -49,6 +68,34 @@ export class ClaudePromptingService {
     const systemPrompt = this.buildSystemPrompt(productType)
     const userPrompt = this.buildUserPrompt(theme, style, niche, count)
 
+    try {
+      const generate = async () => this.parsePromptsFromResponse(
+        await this.callClaude(systemPrompt, userPrompt, 4000, 1.0)
+      )
+      if (this.config.cacheTtlMs <= 0) {
+        return await generate()
+      }
+
+      const key = JSON.stringify([productType, theme, style, niche, count].map(normalize))
+      const prompts = await this.promptCache.getOrSet(key, generate)
+      // Copies, so callers editing results don't change the cached ones
+      return prompts.map(prompt => ({ ...prompt, tags: Array.isArray(prompt.tags) ? [...prompt.tags] : prompt.tags }))
+    } catch (error) {
+      console.error('Error generating prompts:', error)
+      throw error
+    }
+  }
+
+  /**
+   * One Messages API call, waiting for a free request slot
+   */
+  private async callClaude(
+    systemPrompt: string,
+    userPrompt: string,
+    maxTokens: number,
+    temperature: number
+  ): Promise<string> {
+    await this.acquireSlot()
     try {
       const response = await fetch(this.baseUrl, {
         method: 'POST',
@@ -59,8 +106,8 @@ export class ClaudePromptingService {
         },
         body: JSON.stringify({
           model: this.config.model,
-          max_tokens: 4000,
-          temperature: 1.0,
+          max_tokens: maxTokens,
+          temperature,
           system: systemPrompt,
           messages: [
             {
@@ -77,15 +124,27 @@ export class ClaudePromptingService {
       }
 
       const data = await response.json()
-      const content = data.content[0].text
+      return data.content[0].text
+    } finally {
+      this.releaseSlot()
+    }
+  }
 
-      // Parse JSON response
-      const prompts = this.parsePromptsFromResponse(content)
+  private async acquireSlot(): Promise<void> {
+    if (this.active < this.config.maxConcurrentRequests) {
+      this.active++
+      return
+    }
+    // The releasing call hands its slot straight to the next waiter
+    await new Promise<void>(resolve => this.waiters.push(resolve))
+  }
 
-      return prompts
-    } catch (error) {
-      console.error('Error generating prompts:', error)
-      throw error
+  private releaseSlot(): void {
+    const next = this.waiters.shift()
+    if (next) {
+      next()
+    } else {
+      this.active--
     }
   }
 
@@ -197,29 +256,7 @@ Return a single improved prompt in the same JSON format as before.`
     const systemPrompt = this.buildSystemPrompt('tshirt')
 
     try {
-      const response = await fetch(this.baseUrl, {
-        method: 'POST',
-        headers: {
-          'Content-Type': 'application/json',
-          'x-api-key': this.config.apiKey,
-          'anthropic-version': '2023-06-01'
-        },
-        body: JSON.stringify({
-          model: this.config.model,
-          max_tokens: 2000,
-          temperature: 0.8,
-          system: systemPrompt,
-          messages: [
-            {
-              role: 'user',
-              content: userPrompt
-            }
-          ]
-        })
-      })
-
-      const data = await response.json()
-      const content = data.content[0].text
+      const content = await this.callClaude(systemPrompt, userPrompt, 2000, 0.8)
       const prompts = this.parsePromptsFromResponse(content)
 
       return prompts[0] || {
@@ -246,3 +283,7 @@ Return a single improved prompt in the same JSON format as before.`
     })
   }
 }
+
+function normalize(value: string | number): string {
+  return String(value).trim().toLowerCase().replace(/\s+/g, ' ')
+}
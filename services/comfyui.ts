@@ -20,6 +20,7 @@ interface ComfyUIConfig {
   maxRetries?: number
   pollInterval?: number
   enableCircuitBreaker?: boolean
+  maxBatchSize?: number // Images per submitted workflow (prompts x batch_size)
 }
 
 interface ComfyUIWorkflow {
@@ -30,6 +31,7 @@ interface ComfyUIWorkflow {
   height?: number
   steps?: number
   cfg_scale?: number
+  batch_size?: number // Images sampled from one batched latent
 }
 
 interface GenerationResult {
@@ -47,18 +49,54 @@ interface HistoryResponse {
       status_str?: string
     }
     outputs?: Record<string, {
-      images?: Array<{
-        filename: string
-        subfolder?: string
-        type: string
-      }>
+      images?: HistoryImage[]
     }>
   }
 }
 
+interface PendingPrompt {
+  images: string[]
+  resolve: (result: GenerationResult) => void
+  timer?: ReturnType<typeof setTimeout>
+}
+
+/** Socket messages we act on (see ComfyUI server.py send_sync) */
+interface SocketMessage {
+  type: string
+  data?: {
+    prompt_id?: string
+    node?: string | null
+    output?: { images?: HistoryImage[] }
+    exception_message?: string
+  }
+}
+
+interface HistoryImage {
+  filename: string
+  subfolder?: string
+  type: string
+}
+
+// SaveImage prefix; multi-prompt workflows tag each prompt's outputs with
+// _p<index> so the shared result can be split per prompt
+const SAVE_PREFIX = 'ComfyUI'
+const PROMPT_TAG = new RegExp(`^${SAVE_PREFIX}_p(\\d+)_`)
+// Node IDs of each extra prompt's chain start here (one block of 4 per prompt)
+const EXTRA_PROMPT_NODE_BASE = 10
+
+// Completions seen before anyone awaited them (prompt finished between
+// submit returning and waitForCompletion registering)
+const MAX_EARLY_COMPLETIONS = 256
+const SOCKET_CONNECT_TIMEOUT = 5000
+
 export class ComfyUIService {
   private config: ComfyUIConfig
   private ws: WebSocket | null = null
+  private wsReady: Promise<boolean> | null = null
+  private readonly clientId: string
+  private readonly pending = new Map<string, PendingPrompt>()
+  private readonly early = new Map<string, GenerationResult>()
+  private readonly collected = new Map<string, string[]>()
   private circuitBreaker?: CircuitBreaker
   private readonly maxRetries: number
   private readonly pollInterval: number
@@ -69,11 +107,15 @@ export class ComfyUIService {
       maxRetries: 3,
       pollInterval: 2000, // 2 seconds initial
       enableCircuitBreaker: true,
+      maxBatchSize: 4,
       ...config
     }
 
     this.maxRetries = this.config.maxRetries!;
     this.pollInterval = this.config.pollInterval!;
+    // One client ID per service: the socket only receives events for prompts
+    // submitted with the same ID
+    this.clientId = this.getClientId();
 
     if (this.config.enableCircuitBreaker) {
       this.circuitBreaker = new CircuitBreaker('ComfyUI', {
@@ -96,7 +138,10 @@ export class ComfyUIService {
     try {
       const operation = async () => {
         // Build workflow JSON for ComfyUI
-        const workflowData = this.buildWorkflow(workflow);
+        const workflowData = this.buildWorkflow([workflow]);
+
+        // Listen before submitting so no completion event is missed
+        await this.ensureSocket();
 
         // Submit to queue with retry
         const response = await this.submitPrompt(workflowData);
@@ -141,7 +186,7 @@ export class ComfyUIService {
           headers: { 'Content-Type': 'application/json' },
           body: JSON.stringify({
             prompt: workflowData,
-            client_id: this.getClientId()
+            client_id: this.clientId
           })
         });
 
@@ -171,48 +216,119 @@ export class ComfyUIService {
 
   /**
    * Generate multiple images in batch
+   *
+   * Workflows that share sampler settings are packed into one submission
+   * (up to maxBatchSize images), so the model runs once per pack. Packs
+   * are queued up front (in order) so ComfyUI never idles between them;
+   * completions then arrive over the shared socket. Returns one result
+   * per workflow, with the pack's images split back out by prompt.
    */
   async generateBatch(workflows: ComfyUIWorkflow[]): Promise<GenerationResult[]> {
-    const results: GenerationResult[] = []
+    const startTime = Date.now();
+    await this.ensureSocket();
 
-    for (const workflow of workflows) {
-      const result = await this.generate(workflow)
-      results.push(result)
+    const packs = this.packWorkflows(workflows);
+    const submissions: Array<{ promptId?: string; error?: string }> = [];
+    for (const pack of packs) {
+      try {
+        const submit = () => this.submitPrompt(this.buildWorkflow(pack.map((i) => workflows[i])));
+        const { prompt_id } = this.circuitBreaker
+          ? await this.circuitBreaker.execute(submit)
+          : await submit();
+        submissions.push({ promptId: prompt_id });
+      } catch (error) {
+        console.error('[ComfyUI] Batch submission failed:', error);
+        submissions.push({ error: error instanceof Error ? error.message : 'Unknown error' });
+      }
     }
 
-    return results
+    const results: GenerationResult[] = new Array(workflows.length);
+    await Promise.all(submissions.map(async ({ promptId, error }, p) => {
+      const pack = packs[p];
+      if (!promptId) {
+        for (const i of pack) {
+          results[i] = { images: [], promptId: '', status: 'failed', error, duration: Date.now() - startTime };
+        }
+        return;
+      }
+      try {
+        const result = await this.waitForCompletion(promptId);
+        const perPrompt = this.splitImagesByPrompt(result.images, pack.length);
+        pack.forEach((i, index) => {
+          results[i] = { ...result, images: perPrompt[index], duration: Date.now() - startTime };
+        });
+      } catch (waitError) {
+        for (const i of pack) {
+          results[i] = {
+            images: [],
+            promptId,
+            status: 'failed',
+            error: waitError instanceof Error ? waitError.message : 'Unknown error',
+            duration: Date.now() - startTime
+          };
+        }
+      }
+    }));
+    return results;
+  }
+
+  /**
+   * Group workflow indices that can share one submission
+   *
+   * Packs hold workflows with identical sampler settings, in input order,
+   * and at most maxBatchSize images each.
+   */
+  private packWorkflows(workflows: ComfyUIWorkflow[]): number[][] {
+    const maxImages = this.config.maxBatchSize!;
+    const open = new Map<string, number[]>();
+    const packs: number[][] = [];
+
+    workflows.forEach((workflow, i) => {
+      const { width = 1024, height = 1024, steps = 20, cfg_scale = 7, batch_size = 1 } = workflow;
+      const key = [workflow.workflow ?? '', width, height, steps, cfg_scale, batch_size].join('|');
+      let pack = open.get(key);
+      if (!pack || (pack.length + 1) * batch_size > maxImages) {
+        pack = [];
+        packs.push(pack);
+        open.set(key, pack);
+      }
+      pack.push(i);
+    });
+
+    return packs;
+  }
+
+  /**
+   * Split a multi-prompt result's images by the prompt that produced them
+   */
+  private splitImagesByPrompt(images: string[], prompts: number): string[][] {
+    const perPrompt: string[][] = Array.from({ length: prompts }, () => []);
+    for (const image of images) {
+      const filename = /[?&]filename=([^&]*)/.exec(image)?.[1] ?? '';
+      const match = PROMPT_TAG.exec(decodeURIComponent(filename));
+      perPrompt[match ? Number(match[1]) : 0]?.push(image);
+    }
+    return perPrompt;
   }
 
   /**
    * Build ComfyUI workflow JSON
+   *
+   * Sampler settings come from the first workflow. Every workflow's
+   * prompt gets its own encode/sample/decode/save chain (with its own
+   * seed) over one shared checkpoint and batched latent.
    */
-  private buildWorkflow(workflow: ComfyUIWorkflow): any {
+  private buildWorkflow(workflows: ComfyUIWorkflow[]): any {
     const {
-      prompt,
-      seed = Math.floor(Math.random() * 1000000),
       width = 1024,
       height = 1024,
       steps = 20,
-      cfg_scale = 7
-    } = workflow
+      cfg_scale = 7,
+      batch_size = 1
+    } = workflows[0]
 
     // Basic SDXL workflow structure
-    return {
-      "3": {
-        "inputs": {
-          "seed": seed,
-          "steps": steps,
-          "cfg": cfg_scale,
-          "sampler_name": "euler",
-          "scheduler": "normal",
-          "denoise": 1,
-          "model": ["4", 0],
-          "positive": ["6", 0],
-          "negative": ["7", 0],
-          "latent_image": ["5", 0]
-        },
-        "class_type": "KSampler"
-      },
+    const graph: Record<string, any> = {
       "4": {
         "inputs": {
           "ckpt_name": "sd_xl_base_1.0.safetensors"
@@ -223,45 +339,276 @@ export class ComfyUIService {
         "inputs": {
           "width": width,
           "height": height,
-          "batch_size": 1
+          "batch_size": batch_size
         },
         "class_type": "EmptyLatentImage"
       },
-      "6": {
+      "7": {
         "inputs": {
-          "text": prompt,
+          "text": "text, watermark, low quality, worst quality",
           "clip": ["4", 1]
         },
         "class_type": "CLIPTextEncode"
-      },
-      "7": {
+      }
+    }
+
+    workflows.forEach(({ prompt, seed = Math.floor(Math.random() * 1000000) }, i) => {
+      // The first prompt keeps the single-prompt graph's node IDs
+      const base = EXTRA_PROMPT_NODE_BASE + 4 * (i - 1)
+      const [sampler, encode, decode, save] = i === 0
+        ? ["3", "6", "8", "9"]
+        : [0, 1, 2, 3].map((n) => String(base + n))
+
+      graph[sampler] = {
         "inputs": {
-          "text": "text, watermark, low quality, worst quality",
+          "seed": seed,
+          "steps": steps,
+          "cfg": cfg_scale,
+          "sampler_name": "euler",
+          "scheduler": "normal",
+          "denoise": 1,
+          "model": ["4", 0],
+          "positive": [encode, 0],
+          "negative": ["7", 0],
+          "latent_image": ["5", 0]
+        },
+        "class_type": "KSampler"
+      }
+      graph[encode] = {
+        "inputs": {
+          "text": prompt,
           "clip": ["4", 1]
         },
         "class_type": "CLIPTextEncode"
-      },
-      "8": {
+      }
+      graph[decode] = {
         "inputs": {
-          "samples": ["3", 0],
+          "samples": [sampler, 0],
           "vae": ["4", 2]
         },
         "class_type": "VAEDecode"
-      },
-      "9": {
+      }
+      graph[save] = {
         "inputs": {
-          "filename_prefix": "ComfyUI",
-          "images": ["8", 0]
+          "filename_prefix": workflows.length === 1 ? SAVE_PREFIX : `${SAVE_PREFIX}_p${i}`,
+          "images": [decode, 0]
         },
         "class_type": "SaveImage"
       }
+    })
+
+    return graph
+  }
+
+  /**
+   * Wait for generation to complete
+   *
+   * Uses the shared websocket when it is open; otherwise (or if the socket
+   * drops while waiting) falls back to polling the history endpoint.
+   */
+  private async waitForCompletion(promptId: string): Promise<GenerationResult> {
+    const early = this.early.get(promptId);
+    if (early) {
+      this.early.delete(promptId);
+      return early;
+    }
+
+    if (!this.ws || this.ws.readyState !== WebSocket.OPEN) {
+      return this.pollForCompletion(promptId);
+    }
+
+    return new Promise<GenerationResult>((resolve, reject) => {
+      const entry: PendingPrompt = {
+        images: this.collected.get(promptId) ?? [],
+        resolve
+      };
+      this.collected.delete(promptId);
+      entry.timer = setTimeout(() => {
+        this.pending.delete(promptId);
+        reject(new TimeoutError(
+          `Generation timeout after ${this.config.timeout}ms`,
+          'ComfyUI',
+          this.config.timeout!
+        ));
+      }, this.config.timeout!);
+      this.pending.set(promptId, entry);
+    });
+  }
+
+  /**
+   * Open the shared websocket (once) for this client ID
+   *
+   * Resolves false when websockets are unavailable, in which case callers
+   * poll instead.
+   */
+  private ensureSocket(): Promise<boolean> {
+    if (this.ws && this.ws.readyState === WebSocket.OPEN) {
+      return Promise.resolve(true);
+    }
+    if (this.wsReady) {
+      return this.wsReady;
+    }
+    if (typeof WebSocket === 'undefined') {
+      return Promise.resolve(false);
+    }
+
+    const wsUrl = `${this.config.apiUrl.replace('http', 'ws')}/ws?clientId=${encodeURIComponent(this.clientId)}`;
+
+    this.wsReady = new Promise<boolean>((resolve) => {
+      let ws: WebSocket;
+      try {
+        ws = new WebSocket(wsUrl);
+      } catch (error) {
+        console.error('[ComfyUI] WebSocket unavailable, polling instead:', error);
+        this.wsReady = null;
+        resolve(false);
+        return;
+      }
+
+      const connectTimer = setTimeout(() => {
+        console.warn('[ComfyUI] WebSocket connect timed out, polling instead');
+        ws.close();
+      }, SOCKET_CONNECT_TIMEOUT);
+
+      ws.onopen = () => {
+        clearTimeout(connectTimer);
+        this.ws = ws;
+        this.wsReady = null;
+        resolve(true);
+      };
+
+      ws.onmessage = (event) => {
+        // Binary frames are preview images
+        if (typeof event.data === 'string') {
+          this.handleSocketMessage(JSON.parse(event.data));
+        }
+      };
+
+      ws.onerror = (error) => {
+        console.error('[ComfyUI] WebSocket error:', error);
+      };
+
+      ws.onclose = () => {
+        clearTimeout(connectTimer);
+        const wasOpen = this.ws === ws;
+        if (wasOpen) {
+          this.ws = null;
+        }
+        this.wsReady = null;
+        resolve(false);
+        if (wasOpen) {
+          this.failOverToPolling();
+        }
+      };
+    });
+
+    return this.wsReady;
+  }
+
+  /**
+   * Route one socket event to the prompt it belongs to
+   */
+  private handleSocketMessage(message: SocketMessage): void {
+    const promptId = message.data?.prompt_id;
+    if (!promptId) {
+      return;
+    }
+
+    switch (message.type) {
+      case 'executed': {
+        const images = (message.data?.output?.images ?? []).map((img) => this.imageUrl(img));
+        const entry = this.pending.get(promptId);
+        if (entry) {
+          entry.images.push(...images);
+        } else {
+          this.collected.set(promptId, [...(this.collected.get(promptId) ?? []), ...images]);
+        }
+        break;
+      }
+      case 'executing':
+        // node === null marks the end of the prompt
+        if (message.data?.node === null) {
+          void this.completeFromSocket(promptId);
+        }
+        break;
+      case 'execution_error':
+        this.settle(promptId, {
+          images: [],
+          promptId,
+          status: 'failed',
+          error: message.data?.exception_message || 'Generation failed in ComfyUI'
+        });
+        break;
+    }
+  }
+
+  /**
+   * Finish a prompt whose end event arrived
+   */
+  private async completeFromSocket(promptId: string): Promise<void> {
+    const images = this.pending.get(promptId)?.images ?? this.collected.get(promptId) ?? [];
+    this.collected.delete(promptId);
+
+    if (images.length === 0) {
+      // Fully cached prompts emit no executed events; read outputs once
+      try {
+        const response = await fetch(`${this.config.apiUrl}/history/${promptId}`);
+        const history: HistoryResponse = await response.json();
+        if (history[promptId]) {
+          images.push(...this.extractImagesFromHistory(history[promptId]));
+        }
+      } catch (error) {
+        console.error('[ComfyUI] Failed to read outputs for cached prompt:', error);
+      }
+    }
+
+    this.settle(promptId, { images, promptId, status: 'completed' });
+  }
+
+  /**
+   * Resolve a waiting prompt, or stash the result until someone waits
+   */
+  private settle(promptId: string, result: GenerationResult): void {
+    const entry = this.pending.get(promptId);
+    if (entry) {
+      clearTimeout(entry.timer);
+      this.pending.delete(promptId);
+      entry.resolve(result);
+      return;
+    }
+
+    this.early.set(promptId, result);
+    if (this.early.size > MAX_EARLY_COMPLETIONS) {
+      this.early.delete(this.early.keys().next().value!);
+    }
+  }
+
+  /**
+   * Socket lost: hand every waiting prompt over to history polling
+   */
+  private failOverToPolling(): void {
+    if (this.pending.size > 0) {
+      console.warn(`[ComfyUI] WebSocket closed, polling ${this.pending.size} pending prompt(s)`);
+    }
+
+    for (const [promptId, entry] of this.pending) {
+      clearTimeout(entry.timer);
+      this.pending.delete(promptId);
+      this.pollForCompletion(promptId)
+        .then(entry.resolve)
+        .catch((error) => entry.resolve({
+          images: [],
+          promptId,
+          status: 'failed',
+          error: error instanceof Error ? error.message : 'Unknown error'
+        }));
     }
   }
 
   /**
    * Wait for generation to complete via polling with exponential backoff
    */
-  private async waitForCompletion(promptId: string): Promise<GenerationResult> {
+  private async pollForCompletion(promptId: string): Promise<GenerationResult> {
     const startTime = Date.now();
     let pollDelay = this.pollInterval;
     const maxPollDelay = 10000; // Max 10 seconds between polls
@@ -351,10 +698,7 @@ export class ComfyUIService {
       const nodeOutputs = outputs[nodeId];
       if (nodeOutputs.images) {
         for (const img of nodeOutputs.images) {
-          const subfolder = img.subfolder || '';
-          images.push(
-            `${this.config.apiUrl}/view?filename=${img.filename}&subfolder=${subfolder}&type=${img.type}`
-          );
+          images.push(this.imageUrl(img));
         }
       }
     }
@@ -362,33 +706,39 @@ export class ComfyUIService {
     return images;
   }
 
+  /**
+   * Build the /view URL for an output image
+   */
+  private imageUrl(img: HistoryImage): string {
+    const subfolder = img.subfolder || '';
+    return `${this.config.apiUrl}/view?filename=${img.filename}&subfolder=${subfolder}&type=${img.type}`;
+  }
+
   /**
    * Connect to ComfyUI WebSocket for real-time updates
    */
   connectWebSocket(onProgress?: (data: any) => void): void {
-    const wsUrl = this.config.apiUrl.replace('http', 'ws') + '/ws'
-
-    this.ws = new WebSocket(wsUrl)
-
-    this.ws.onmessage = (event) => {
-      const data = JSON.parse(event.data)
-      if (onProgress) {
-        onProgress(data)
+    void this.ensureSocket().then((open) => {
+      if (!open || !this.ws || !onProgress) {
+        return
       }
-    }
-
-    this.ws.onerror = (error) => {
-      console.error('WebSocket error:', error)
-    }
+      this.ws.addEventListener('message', (event) => {
+        if (typeof event.data === 'string') {
+          onProgress(JSON.parse(event.data))
+        }
+      })
+    })
   }
 
   /**
-   * Disconnect WebSocket
+   * Disconnect WebSocket (pending prompts fall back to polling)
    */
   disconnectWebSocket(): void {
     if (this.ws) {
-      this.ws.close()
+      const ws = this.ws
       this.ws = null
+      ws.close()
+      this.failOverToPolling()
     }
   }
 
@@ -39,6 +39,14 @@ interface GenerateResponse {
   estimated_time: string;
 }
 
+/** One zoom level of a track's waveform overview */
+export interface WaveformPeaks {
+  sampleRate: number;
+  samplesPerPixel: number;
+  /** Interleaved min, max per pixel, in [-1, 1] */
+  data: Float32Array;
+}
+
 
 const API_BASE = import.meta.env.VITE_MUSIC_API_URL || 'http://localhost:8000';
 
@@ -77,6 +85,56 @@ export function getDownloadUrl(jobId: string, fileType: string = 'mix'): string
 }
 
 
+/**
+ * Compact Ogg/Opus rendition of the mix, for playback that starts before
+ * the whole file has arrived
+ */
+export function getStreamUrl(jobId: string): string {
+  return `${getDownloadUrl(jobId, 'mix')}?format=opus`;
+}
+
+
+/**
+ * Fetch a track's waveform peaks, every zoom level, finest first
+ *
+ * The file is a run of audiowaveform v1 blocks: a 20-byte little-endian
+ * header (version, flags, sample rate, samples per pixel, length) then
+ * min/max pairs, 8-bit (scaled by 127) when flags bit 0 is set, else 16-bit.
+ */
+export async function fetchPeaks(jobId: string, fileType: string = 'mix'): Promise<WaveformPeaks[]> {
+  const response = await fetch(`${API_BASE}/peaks/${jobId}/${fileType}`);
+
+  if (!response.ok) {
+    throw new Error('Failed to get waveform peaks');
+  }
+
+  const buffer = await response.arrayBuffer();
+  const view = new DataView(buffer);
+  const levels: WaveformPeaks[] = [];
+  let offset = 0;
+
+  while (offset + 20 <= buffer.byteLength) {
+    const eightBit = (view.getUint32(offset + 4, true) & 1) === 1;
+    const sampleRate = view.getInt32(offset + 8, true);
+    const samplesPerPixel = view.getInt32(offset + 12, true);
+    const length = view.getUint32(offset + 16, true);
+    offset += 20;
+
+    const data = new Float32Array(2 * length);
+    for (let i = 0; i < data.length; i++) {
+      data[i] = eightBit
+        ? view.getInt8(offset + i) / 127
+        : view.getInt16(offset + 2 * i, true) / 32768;
+    }
+    offset += data.length * (eightBit ? 1 : 2);
+
+    levels.push({ sampleRate, samplesPerPixel, data });
+  }
+
+  return levels;
+}
+
+
 /**
  * Poll job status until completion
  */
@@ -14,6 +14,7 @@ import { EtsyService } from './platforms/etsy';
 import { InstagramService } from './platforms/instagram';
 import { FacebookShopService } from './platforms/facebook';
 import { CircuitBreakerManager } from '../utils/circuitBreaker';
+import { PublishScheduler, PlatformLimits } from '../utils/publishScheduler';
 import { getErrorMessage, formatErrorForLogging } from '../utils/errors';
 
 interface OrchestratorConfig {
@@ -61,9 +62,14 @@ interface OrchestratorConfig {
     autoPublish?: boolean
     tshirtPrice?: number
     hoodiePrice?: number
+    maxConcurrentGenerations?: number // ComfyUI generations kept in flight (default 3)
+    platformLimits?: Record<string, PlatformLimits> // Per-platform publish concurrency/rate
   }
 }
 
+// How often the generation window re-reads the ComfyUI queue (ms)
+const QUEUE_PROBE_INTERVAL = 2000
+
 interface PipelineRequest {
   prompt?: string
   theme?: string
@@ -104,6 +110,7 @@ export class Orchestrator {
   private config: OrchestratorConfig
   private logCallback?: (message: string, type: string) => void
   private circuitBreakerManager: CircuitBreakerManager
+  private publishScheduler: PublishScheduler
   private stats = {
     totalRuns: 0,
     successfulRuns: 0,
@@ -112,10 +119,15 @@ export class Orchestrator {
     totalProducts: 0,
     totalErrors: 0
   }
+  private queueProbe = { at: 0, foreign: 0 }
 
   constructor(config: OrchestratorConfig) {
     this.config = config
     this.circuitBreakerManager = new CircuitBreakerManager()
+    this.publishScheduler = new PublishScheduler(
+      this.circuitBreakerManager,
+      config.options?.platformLimits
+    )
 
     // Initialize core services
     this.comfyui = new ComfyUIService(config.comfyui)
@@ -185,9 +197,20 @@ export class Orchestrator {
       const prompts = await this.generatePrompts(request)
       this.log(`✓ Generated ${prompts.length} creative prompts`, 'SUCCESS')
 
-      // Step 2: Generate images with ComfyUI (can be parallelized)
+      // Steps 2-4: Generate images with ComfyUI; each image moves on to
+      // storage and product creation as soon as it is rendered
       this.log('🎨 Generating AI images with ComfyUI...', 'INFO')
-      const images = await this.generateImagesParallel(prompts)
+      const autoPublish = request.autoPublish ?? this.config.options?.autoPublish ?? true
+      const savedImages: (SavedImageData | undefined)[] = new Array(prompts.length)
+      const images = await this.generateImagesParallel(prompts, async (imageUrl, index) => {
+        savedImages[index] = await this.saveAndCreateProducts(
+          imageUrl,
+          prompts[index],
+          request.productTypes,
+          autoPublish,
+          result
+        )
+      })
       const successfulImages = images.filter(img => img !== null) as string[]
 
       if (successfulImages.length === 0) {
@@ -197,42 +220,8 @@ export class Orchestrator {
       this.log(`✓ Generated ${successfulImages.length}/${prompts.length} images`, 'SUCCESS')
       this.stats.totalImages += successfulImages.length
 
-      // Step 3: Save images to storage
-      this.log('💾 Saving images to storage...', 'INFO')
-      const savedImages = await this.saveImages(successfulImages, prompts)
-      result.generatedImages = savedImages.map((img, i) => ({
-        id: img.id,
-        url: img.url,
-        prompt: prompts[i]?.prompt || 'Unknown'
-      }))
-      this.log(`✓ Saved ${savedImages.length} images`, 'SUCCESS')
-
-      // Step 4: Create products on enabled platforms (parallelize per image)
-      this.log('📦 Creating products on platforms...', 'INFO')
-      const productCreationPromises = savedImages.flatMap((savedImage, index) => {
-        const promptData = prompts[index]
-        return request.productTypes.map(productType =>
-          this.createProductsSafe(
-            savedImage,
-            promptData,
-            productType,
-            request.autoPublish ?? this.config.options?.autoPublish ?? true
-          )
-        )
-      })
-
-      const productResults = await Promise.allSettled(productCreationPromises)
-
-      productResults.forEach((productResult, index) => {
-        if (productResult.status === 'fulfilled') {
-          result.products.push(...productResult.value)
-        } else {
-          const errorMsg = getErrorMessage(productResult.reason)
-          this.log(`⚠️  Product creation failed: ${errorMsg}`, 'WARNING')
-          result.errors.push(errorMsg)
-          this.stats.totalErrors++
-        }
-      })
+      result.generatedImages = savedImages.filter((img): img is SavedImageData => !!img)
+      this.log(`✓ Saved ${result.generatedImages.length} images`, 'SUCCESS')
 
       this.stats.totalProducts += result.products.length
 
@@ -293,21 +282,23 @@ export class Orchestrator {
   }
 
   /**
-   * Generate images with ComfyUI (sequential)
+   * Generate images with ComfyUI (batched)
+   *
+   * Prompts share sampler settings, so ComfyUI renders them in packs of
+   * up to maxBatchSize per submission.
    */
   private async generateImages(prompts: PromptData[]): Promise<string[]> {
     const allImages: string[] = []
+    this.log(`Generating ${prompts.length} image(s): ${prompts.map((p) => p.title).join(', ')}`, 'INFO')
 
-    for (const promptData of prompts) {
-      this.log(`Generating image for: ${promptData.title}`, 'INFO')
-
-      const result = await this.comfyui.generate({
-        prompt: promptData.prompt,
-        width: 1024,
-        height: 1024,
-        steps: 20
-      })
+    const results = await this.comfyui.generateBatch(prompts.map((promptData) => ({
+      prompt: promptData.prompt,
+      width: 1024,
+      height: 1024,
+      steps: 20
+    })))
 
+    for (const result of results) {
       if (result.status === 'completed' && result.images.length > 0) {
         allImages.push(...result.images)
       } else {
@@ -320,10 +311,15 @@ export class Orchestrator {
 
   /**
    * Generate images with ComfyUI in parallel (with rate limiting)
+   *
+   * A sliding window keeps up to generationWindow() generations in flight,
+   * starting the next prompt as soon as any one finishes. onImage runs for
+   * each image when it completes, without holding a generation slot.
    */
-  private async generateImagesParallel(prompts: PromptData[]): Promise<(string | null)[]> {
-    const maxConcurrent = 3 // Limit concurrent generations to avoid overwhelming ComfyUI
-
+  private async generateImagesParallel(
+    prompts: PromptData[],
+    onImage?: (imageUrl: string, index: number) => Promise<void>
+  ): Promise<(string | null)[]> {
     const generateWithTimeout = async (promptData: PromptData): Promise<string | null> => {
       try {
         this.log(`Generating image for: ${promptData.title}`, 'INFO')
@@ -347,38 +343,100 @@ export class Orchestrator {
       }
     }
 
-    // Process in batches to avoid overwhelming the system
-    const results: (string | null)[] = []
-    for (let i = 0; i < prompts.length; i += maxConcurrent) {
-      const batch = prompts.slice(i, i + maxConcurrent)
-      const batchResults = await Promise.all(batch.map(generateWithTimeout))
-      results.push(...batchResults)
+    const results: (string | null)[] = new Array(prompts.length).fill(null)
+    const inFlight = new Set<Promise<void>>()
+    const downstream: Promise<void>[] = []
+
+    for (let i = 0; i < prompts.length; i++) {
+      while (inFlight.size >= await this.generationWindow(inFlight.size)) {
+        await Promise.race(inFlight)
+      }
+
+      const generation: Promise<void> = generateWithTimeout(prompts[i]).then(imageUrl => {
+        results[i] = imageUrl
+        if (imageUrl && onImage) {
+          downstream.push(onImage(imageUrl, i))
+        }
+      }).finally(() => {
+        inFlight.delete(generation)
+      })
+      inFlight.add(generation)
     }
 
+    await Promise.all(inFlight)
+    await Promise.all(downstream)
+
     return results
   }
 
   /**
-   * Save images to storage
+   * Number of generations to keep in flight
+   *
+   * Starts from maxConcurrentGenerations and gives up one slot per job other
+   * clients have queued on ComfyUI (never below one).
    */
-  private async saveImages(imageUrls: string[], prompts: PromptData[]): Promise<SavedImageData[]> {
-    const saved = []
+  private async generationWindow(active: number): Promise<number> {
+    const max = Math.max(1, this.config.options?.maxConcurrentGenerations ?? 3)
+
+    const now = Date.now()
+    if (now - this.queueProbe.at >= QUEUE_PROBE_INTERVAL) {
+      this.queueProbe.at = now
+      const status = await this.comfyui.getQueueStatus()
+      if (status) {
+        const queued = (status.queue_running?.length ?? 0) + (status.queue_pending?.length ?? 0)
+        this.queueProbe.foreign = Math.max(0, queued - active)
+      }
+    }
 
-    for (let i = 0; i < imageUrls.length; i++) {
-      const imageUrl = imageUrls[i]
-      const prompt = prompts[i]
+    return Math.max(1, max - this.queueProbe.foreign)
+  }
 
+  /**
+   * Save one generated image and create its products, recording into result
+   */
+  private async saveAndCreateProducts(
+    imageUrl: string,
+    promptData: PromptData,
+    productTypes: ('tshirt' | 'hoodie')[],
+    autoPublish: boolean,
+    result: PipelineResult
+  ): Promise<SavedImageData | undefined> {
+    let image: SavedImageData
+    try {
       const savedImage = await this.storage.saveImage(imageUrl, {
-        prompt: prompt.prompt,
-        title: prompt.title,
-        tags: prompt.tags,
-        description: prompt.description
+        prompt: promptData.prompt,
+        title: promptData.title,
+        tags: promptData.tags,
+        description: promptData.description
       })
-
-      saved.push(savedImage)
+      image = { id: savedImage.id, url: savedImage.url, prompt: promptData.prompt }
+    } catch (error) {
+      const errorMsg = getErrorMessage(error)
+      this.log(`⚠️  Failed to save image: ${errorMsg}`, 'WARNING')
+      result.errors.push(errorMsg)
+      this.stats.totalErrors++
+      return undefined
     }
 
-    return saved
+    // Create products on enabled platforms (parallelize per product type)
+    const productResults = await Promise.allSettled(
+      productTypes.map(productType =>
+        this.createProductsSafe(image, promptData, productType, autoPublish)
+      )
+    )
+
+    productResults.forEach(productResult => {
+      if (productResult.status === 'fulfilled') {
+        result.products.push(...productResult.value)
+      } else {
+        const errorMsg = getErrorMessage(productResult.reason)
+        this.log(`⚠️  Product creation failed: ${errorMsg}`, 'WARNING')
+        result.errors.push(errorMsg)
+        this.stats.totalErrors++
+      }
+    })
+
+    return image
   }
 
   /**
@@ -424,16 +482,19 @@ export class Orchestrator {
         (async () => {
           try {
             const method = productType === 'tshirt' ? 'createTShirt' : 'createHoodie'
-            const product = await this.printify![method](
-              image.url,
-              promptData.title,
-              promptData.description,
-              { price, tags: promptData.tags }
-            )
-
-            if (autoPublish && product.id) {
-              await this.printify!.publishProduct(product.id)
-            }
+            const product = await this.publishScheduler.run('printify', async () => {
+              const created = await this.printify![method](
+                image.url,
+                promptData.title,
+                promptData.description,
+                { price, tags: promptData.tags }
+              )
+
+              if (autoPublish && created.id) {
+                await this.printify!.publishProduct(created.id)
+              }
+              return created
+            })
 
             return {
               platform: 'printify',
@@ -454,13 +515,15 @@ export class Orchestrator {
       platformPromises.push(
         (async () => {
           try {
-            const product = await this.shopify!.createFromPrintify(
-              promptData.title,
-              promptData.description,
-              image.url,
-              price,
-              promptData.tags,
-              productType === 'tshirt' ? 'T-Shirt' : 'Hoodie'
+            const product = await this.publishScheduler.run('shopify', () =>
+              this.shopify!.createFromPrintify(
+                promptData.title,
+                promptData.description,
+                image.url,
+                price,
+                promptData.tags,
+                productType === 'tshirt' ? 'T-Shirt' : 'Hoodie'
+              )
             )
 
             return {
@@ -478,17 +541,18 @@ export class Orchestrator {
     }
 
     // TikTok, Etsy, Instagram, Facebook - similar pattern
-    // Note: These platforms can also be parallelized but may need rate limiting
     if (enabledPlatforms.includes('tiktok') && this.tiktok) {
       platformPromises.push(
         (async () => {
           try {
-            const productId = await this.tiktok!.createFromPOD(
-              promptData.title,
-              promptData.description,
-              image.url,
-              price,
-              productType
+            const productId = await this.publishScheduler.run('tiktok', () =>
+              this.tiktok!.createFromPOD(
+                promptData.title,
+                promptData.description,
+                image.url,
+                price,
+                productType
+              )
             )
 
             if (productId) {
@@ -512,18 +576,21 @@ export class Orchestrator {
       platformPromises.push(
         (async () => {
           try {
-            const listingId = await this.etsy!.createFromPOD(
-              promptData.title,
-              promptData.description,
-              image.url,
-              price,
-              promptData.tags,
-              productType
-            )
-
-            if (listingId && autoPublish) {
-              await this.etsy!.publishListing(listingId)
-            }
+            const listingId = await this.publishScheduler.run('etsy', async () => {
+              const created = await this.etsy!.createFromPOD(
+                promptData.title,
+                promptData.description,
+                image.url,
+                price,
+                promptData.tags,
+                productType
+              )
+
+              if (created && autoPublish) {
+                await this.etsy!.publishListing(created)
+              }
+              return created
+            })
 
             if (listingId) {
               return {
@@ -546,13 +613,15 @@ export class Orchestrator {
       platformPromises.push(
         (async () => {
           try {
-            const productId = await this.instagram!.createFromPOD(
-              this.config.instagram!.businessAccountId,
-              promptData.title,
-              promptData.description,
-              image.url,
-              price,
-              `https://yourstore.com/products/${promptData.title.toLowerCase().replace(/\s+/g, '-')}`
+            const productId = await this.publishScheduler.run('instagram', () =>
+              this.instagram!.createFromPOD(
+                this.config.instagram!.businessAccountId,
+                promptData.title,
+                promptData.description,
+                image.url,
+                price,
+                `https://yourstore.com/products/${promptData.title.toLowerCase().replace(/\s+/g, '-')}`
+              )
             )
 
             if (productId) {
@@ -576,12 +645,14 @@ export class Orchestrator {
       platformPromises.push(
         (async () => {
           try {
-            const productId = await this.facebook!.createFromPOD(
-              promptData.title,
-              promptData.description,
-              image.url,
-              price,
-              `https://yourstore.com/products/${promptData.title.toLowerCase().replace(/\s+/g, '-')}`
+            const productId = await this.publishScheduler.run('facebook', () =>
+              this.facebook!.createFromPOD(
+                promptData.title,
+                promptData.description,
+                image.url,
+                price,
+                `https://yourstore.com/products/${promptData.title.toLowerCase().replace(/\s+/g, '-')}`
+              )
             )
 
             if (productId) {
@@ -652,6 +723,7 @@ export class Orchestrator {
         instagram: { enabled: !!this.instagram },
         facebook: { enabled: !!this.facebook }
       },
+      publishing: this.publishScheduler.getStats(),
       circuitBreakers: this.circuitBreakerManager.getHealthStatus(),
       enabledPlatforms: this.config.options?.enabledPlatforms || ['printify', 'shopify']
     }
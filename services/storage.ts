@@ -6,10 +6,13 @@
 import * as fs from 'fs'
 import * as path from 'path'
 import * as crypto from 'crypto'
+import { Readable, Transform } from 'stream'
+import { pipeline } from 'stream/promises'
 
 interface StorageConfig {
   type: 'local' | 's3' | 'gcs'
   basePath: string
+  concurrency?: number // Max saves in flight in saveBatch (default 8)
   s3Config?: {
     bucket: string
     region: string
@@ -37,6 +40,8 @@ interface SavedImage {
 export class StorageService {
   private config: StorageConfig
   private imageIndex: Map<string, SavedImage> = new Map()
+  private hashIndex: Map<string, string> = new Map() // content hash -> image id
+  private pendingHashes: Map<string, Promise<SavedImage>> = new Map()
 
   constructor(config: StorageConfig) {
     this.config = config
@@ -50,72 +55,163 @@ export class StorageService {
     source: string | Buffer,
     metadata?: any
   ): Promise<SavedImage> {
-    let imageBuffer: Buffer
+    // Local storage streams downloads straight to disk
+    if (typeof source === 'string' && this.config.type === 'local') {
+      return this.streamLocal(source, metadata)
+    }
 
     // Get image data
-    if (typeof source === 'string') {
-      imageBuffer = await this.fetchImage(source)
-    } else {
-      imageBuffer = source
-    }
+    const imageBuffer = typeof source === 'string'
+      ? await this.fetchImage(source)
+      : source
 
     // Generate hash to detect duplicates
     const hash = this.generateHash(imageBuffer)
 
-    // Check if already exists
-    const existing = Array.from(this.imageIndex.values()).find(
-      img => img.hash === hash
+    return this.saveUnique(hash, () => {
+      // Generate filename
+      const id = this.generateId()
+      const ext = this.detectExtension(imageBuffer)
+      const filename = `${id}.${ext}`
+
+      // Save based on storage type
+      switch (this.config.type) {
+        case 'local':
+          return this.saveLocal(filename, imageBuffer, hash, metadata)
+        case 's3':
+          return this.saveToS3(filename, imageBuffer, hash, metadata)
+        case 'gcs':
+          return this.saveToGCS(filename, imageBuffer, hash, metadata)
+        default:
+          throw new Error(`Unsupported storage type: ${this.config.type}`)
+      }
+    })
+  }
+
+  /**
+   * Save multiple images in batch
+   *
+   * Up to `concurrency` saves run at once; results keep the order of sources.
+   */
+  async saveBatch(sources: Array<string | Buffer>, metadata?: any[]): Promise<SavedImage[]> {
+    const results: SavedImage[] = new Array(sources.length)
+    const concurrency = Math.max(1, this.config.concurrency ?? 8)
+    let next = 0
+
+    const worker = async () => {
+      while (next < sources.length) {
+        const i = next++
+        results[i] = await this.saveImage(sources[i], metadata?.[i] || {})
+      }
+    }
+
+    await Promise.all(
+      Array.from({ length: Math.min(concurrency, sources.length) }, worker)
     )
+
+    return results
+  }
+
+  /**
+   * Return the existing image for hash, or run write() and index its result
+   *
+   * Concurrent saves of identical content share a single write.
+   */
+  private saveUnique(hash: string, write: () => Promise<SavedImage>): Promise<SavedImage> {
+    const existingId = this.hashIndex.get(hash)
+    const existing = existingId ? this.imageIndex.get(existingId) : undefined
     if (existing) {
       console.log('Duplicate image detected, returning existing:', existing.id)
-      return existing
+      return Promise.resolve(existing)
     }
 
-    // Generate filename
-    const id = this.generateId()
-    const ext = this.detectExtension(imageBuffer)
-    const filename = `${id}.${ext}`
-
-    // Save based on storage type
-    let savedImage: SavedImage
-
-    switch (this.config.type) {
-      case 'local':
-        savedImage = await this.saveLocal(filename, imageBuffer, hash, metadata)
-        break
-      case 's3':
-        savedImage = await this.saveToS3(filename, imageBuffer, hash, metadata)
-        break
-      case 'gcs':
-        savedImage = await this.saveToGCS(filename, imageBuffer, hash, metadata)
-        break
-      default:
-        throw new Error(`Unsupported storage type: ${this.config.type}`)
+    const pending = this.pendingHashes.get(hash)
+    if (pending) {
+      return pending
     }
 
-    // Add to index
-    this.imageIndex.set(id, savedImage)
+    const saving = (async () => {
+      const savedImage = await write()
+
+      // Add to index
+      this.imageIndex.set(savedImage.id, savedImage)
+      this.hashIndex.set(hash, savedImage.id)
 
-    // Save metadata
-    await this.saveMetadata(id, savedImage)
+      // Save metadata
+      await this.saveMetadata(savedImage.id, savedImage)
 
-    return savedImage
+      return savedImage
+    })().finally(() => {
+      this.pendingHashes.delete(hash)
+    })
+
+    this.pendingHashes.set(hash, saving)
+    return saving
   }
 
   /**
-   * Save multiple images in batch
+   * Download to local storage without buffering the whole image,
+   * hashing while the bytes are written
    */
-  async saveBatch(sources: Array<string | Buffer>, metadata?: any[]): Promise<SavedImage[]> {
-    const results: SavedImage[] = []
+  private async streamLocal(url: string, metadata?: any): Promise<SavedImage> {
+    const response = await fetch(url)
+    if (!response.ok || !response.body) {
+      throw new Error(`Failed to fetch image: ${response.statusText}`)
+    }
 
-    for (let i = 0; i < sources.length; i++) {
-      const source = sources[i]
-      const meta = metadata?.[i] || {}
-      const saved = await this.saveImage(source, meta)
-      results.push(saved)
+    const id = this.generateId()
+    const tempPath = path.join(this.config.basePath, `${id}.part`)
+    const hasher = crypto.createHash('sha256')
+    let head: Buffer | undefined
+    let size = 0
+
+    const tap = new Transform({
+      transform(chunk: Buffer, _encoding, callback) {
+        head ??= chunk
+        hasher.update(chunk)
+        size += chunk.length
+        callback(null, chunk)
+      }
+    })
+
+    try {
+      await pipeline(
+        Readable.fromWeb(response.body as any),
+        tap,
+        fs.createWriteStream(tempPath)
+      )
+    } catch (error) {
+      await fs.promises.rm(tempPath, { force: true })
+      throw error
     }
 
-    return results
+    const hash = hasher.digest('hex')
+    let written = false
+
+    try {
+      return await this.saveUnique(hash, async () => {
+        const filename = `${id}.${this.detectExtension(head ?? Buffer.alloc(0))}`
+        const filepath = path.join(this.config.basePath, filename)
+        await fs.promises.rename(tempPath, filepath)
+        written = true
+
+        return {
+          id,
+          filename,
+          path: filepath,
+          url: `file://${filepath}`,
+          hash,
+          size,
+          timestamp: new Date(),
+          metadata
+        }
+      })
+    } finally {
+      if (!written) {
+        // Duplicate (or failed rename): drop the downloaded copy
+        await fs.promises.rm(tempPath, { force: true })
+      }
+    }
   }
 
   /**
@@ -286,6 +382,9 @@ export class StorageService {
     }
 
     this.imageIndex.delete(id)
+    if (this.hashIndex.get(image.hash) === id) {
+      this.hashIndex.delete(image.hash)
+    }
     return true
   }
 
@@ -1,29 +1,79 @@
 /**
- * Simple in-memory cache with TTL support
+ * In-memory LRU cache with TTL support
  * Useful for caching API responses and reducing external calls
  */
 
 export interface CacheOptions {
   ttl?: number; // Time to live in milliseconds
   maxSize?: number; // Maximum number of entries
+  maxBytes?: number; // Maximum total size of entries (see sizeOf)
+  sizeOf?: (value: any) => number; // Byte size of a value (default: binary/string length)
+  staleWhileRevalidate?: number; // How long past expiry getOrSet may serve stale values (ms)
+}
+
+export interface CacheStats {
+  size: number;
+  maxSize: number;
+  bytes: number;
+  maxBytes: number;
+  ttl: number;
+  hits: number;
+  misses: number;
+  staleHits: number;
+  coalesced: number;
+  evictions: number;
+  expirations: number;
+  hitRate: number;
 }
 
 interface CacheEntry<T> {
   value: T;
   expiresAt: number;
+  bytes: number;
 }
 
 /**
- * Simple LRU cache with TTL
+ * Default size estimate: exact for binary data and strings, 0 for other
+ * values (pass sizeOf to budget those)
+ */
+function defaultSizeOf(value: any): number {
+  if (typeof value === 'string') return value.length * 2;
+  if (value instanceof ArrayBuffer) return value.byteLength;
+  if (ArrayBuffer.isView(value)) return value.byteLength;
+  return 0;
+}
+
+/**
+ * LRU cache with TTL
+ *
+ * Map iteration order is insertion order, so re-inserting on every hit
+ * keeps the least recently used entry first: lookups, updates and
+ * evictions are all O(1).
  */
 export class Cache<K = string, V = any> {
   private cache = new Map<K, CacheEntry<V>>();
+  private inflight = new Map<K, Promise<V>>();
   private readonly ttl: number;
   private readonly maxSize: number;
+  private readonly maxBytes: number;
+  private readonly sizeOf: (value: V) => number;
+  private readonly staleWhileRevalidate: number;
+  private bytes = 0;
+  private counters = {
+    hits: 0,
+    misses: 0,
+    staleHits: 0,
+    coalesced: 0,
+    evictions: 0,
+    expirations: 0
+  };
 
   constructor(options: CacheOptions = {}) {
     this.ttl = options.ttl ?? 300000; // Default 5 minutes
     this.maxSize = options.maxSize ?? 1000;
+    this.maxBytes = options.maxBytes ?? Infinity;
+    this.sizeOf = options.sizeOf ?? defaultSizeOf;
+    this.staleWhileRevalidate = options.staleWhileRevalidate ?? 0;
   }
 
   /**
@@ -33,15 +83,19 @@ export class Cache<K = string, V = any> {
     const entry = this.cache.get(key);
 
     if (!entry) {
+      this.counters.misses++;
       return undefined;
     }
 
     // Check if expired
     if (Date.now() > entry.expiresAt) {
-      this.cache.delete(key);
+      this.expire(key, entry);
+      this.counters.misses++;
       return undefined;
     }
 
+    this.touch(key, entry);
+    this.counters.hits++;
     return entry.value;
   }
 
@@ -49,14 +103,27 @@ export class Cache<K = string, V = any> {
    * Set value in cache
    */
   set(key: K, value: V, ttl?: number): void {
-    // Enforce max size (simple LRU: remove oldest)
-    if (this.cache.size >= this.maxSize && !this.cache.has(key)) {
-      const firstKey = this.cache.keys().next().value;
-      this.cache.delete(firstKey);
+    const existing = this.cache.get(key);
+    if (existing) {
+      this.remove(key, existing);
+    }
+
+    const bytes = this.sizeOf(value);
+    if (bytes > this.maxBytes) {
+      // Would evict everything and still not fit
+      return;
     }
 
     const expiresAt = Date.now() + (ttl ?? this.ttl);
-    this.cache.set(key, { value, expiresAt });
+    this.cache.set(key, { value, expiresAt, bytes });
+    this.bytes += bytes;
+
+    // Evict least recently used entries until within both budgets
+    while (this.cache.size > this.maxSize || this.bytes > this.maxBytes) {
+      const [oldestKey, oldest] = this.cache.entries().next().value!;
+      this.remove(oldestKey, oldest);
+      this.counters.evictions++;
+    }
   }
 
   /**
@@ -67,7 +134,7 @@ export class Cache<K = string, V = any> {
     if (!entry) return false;
 
     if (Date.now() > entry.expiresAt) {
-      this.cache.delete(key);
+      this.expire(key, entry);
       return false;
     }
 
@@ -78,7 +145,10 @@ export class Cache<K = string, V = any> {
    * Delete key from cache
    */
   delete(key: K): boolean {
-    return this.cache.delete(key);
+    const entry = this.cache.get(key);
+    if (!entry) return false;
+    this.remove(key, entry);
+    return true;
   }
 
   /**
@@ -86,6 +156,7 @@ export class Cache<K = string, V = any> {
    */
   clear(): void {
     this.cache.clear();
+    this.bytes = 0;
   }
 
   /**
@@ -98,46 +169,68 @@ export class Cache<K = string, V = any> {
   /**
    * Get cache statistics
    */
-  getStats() {
+  getStats(): CacheStats {
+    const lookups = this.counters.hits + this.counters.misses;
     return {
       size: this.cache.size,
       maxSize: this.maxSize,
-      ttl: this.ttl
+      bytes: this.bytes,
+      maxBytes: this.maxBytes,
+      ttl: this.ttl,
+      ...this.counters,
+      hitRate: lookups > 0 ? this.counters.hits / lookups : 0
     };
   }
 
   /**
    * Get or set pattern (fetch if not cached)
+   *
+   * Concurrent misses for the same key share one fetcher call. Within the
+   * staleWhileRevalidate window an expired value is returned immediately
+   * and refreshed in the background.
    */
   async getOrSet(
     key: K,
     fetcher: () => Promise<V>,
     ttl?: number
   ): Promise<V> {
-    const cached = this.get(key);
-    if (cached !== undefined) {
-      return cached;
+    const entry = this.cache.get(key);
+    const now = Date.now();
+
+    if (entry && now <= entry.expiresAt) {
+      this.touch(key, entry);
+      this.counters.hits++;
+      return entry.value;
     }
 
-    const value = await fetcher();
-    this.set(key, value, ttl);
-    return value;
+    if (entry && now <= entry.expiresAt + this.staleWhileRevalidate) {
+      this.counters.staleHits++;
+      this.fetchOnce(key, fetcher, ttl).catch((error) => {
+        console.warn('[Cache] Background revalidation failed, keeping stale value:', error);
+      });
+      return entry.value;
+    }
+
+    if (this.inflight.has(key)) {
+      this.counters.coalesced++;
+    } else {
+      this.counters.misses++;
+    }
+    return this.fetchOnce(key, fetcher, ttl);
   }
 
   /**
-   * Clean expired entries
+   * Clean expired entries (keeping those still servable as stale)
    */
   cleanup(): void {
-    const now = Date.now();
-    const keysToDelete: K[] = [];
+    const cutoff = Date.now() - this.staleWhileRevalidate;
 
     this.cache.forEach((entry, key) => {
-      if (now > entry.expiresAt) {
-        keysToDelete.push(key);
+      if (cutoff > entry.expiresAt) {
+        this.remove(key, entry);
+        this.counters.expirations++;
       }
     });
-
-    keysToDelete.forEach(key => this.cache.delete(key));
   }
 
   /**
@@ -147,6 +240,43 @@ export class Cache<K = string, V = any> {
     const interval = setInterval(() => this.cleanup(), intervalMs);
     return () => clearInterval(interval);
   }
+
+  /**
+   * Run fetcher for key unless a call is already in flight (single-flight)
+   */
+  private fetchOnce(key: K, fetcher: () => Promise<V>, ttl?: number): Promise<V> {
+    let pending = this.inflight.get(key);
+    if (!pending) {
+      pending = fetcher()
+        .then((value) => {
+          this.set(key, value, ttl);
+          return value;
+        })
+        .finally(() => {
+          this.inflight.delete(key);
+        });
+      this.inflight.set(key, pending);
+    }
+    return pending;
+  }
+
+  private touch(key: K, entry: CacheEntry<V>): void {
+    this.cache.delete(key);
+    this.cache.set(key, entry);
+  }
+
+  private expire(key: K, entry: CacheEntry<V>): void {
+    // Keep entries getOrSet may still serve stale
+    if (Date.now() > entry.expiresAt + this.staleWhileRevalidate) {
+      this.remove(key, entry);
+      this.counters.expirations++;
+    }
+  }
+
+  private remove(key: K, entry: CacheEntry<V>): void {
+    this.cache.delete(key);
+    this.bytes -= entry.bytes;
+  }
 }
 
 /**
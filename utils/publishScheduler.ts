@@ -0,0 +1,176 @@
+/**
+ * Per-platform publish scheduler
+ * Bounds concurrency and request rate for each marketplace independently
+ */
+
+import { CircuitBreakerManager } from './circuitBreaker';
+import { sleep } from './delay';
+
+export interface PlatformLimits {
+  concurrency?: number;   // Tasks in flight at once
+  ratePerSecond?: number; // Sustained task starts per second
+  burst?: number;         // Task starts allowed back-to-back (default: concurrency)
+}
+
+export interface PlatformThroughput {
+  inFlight: number;
+  queued: number;
+  completed: number;
+  failed: number;
+  averageLatencyMs: number;
+  perMinute: number;
+}
+
+/**
+ * Defaults per platform. One task is a whole create (+ publish) flow, which
+ * is several API requests, so rates sit well under each API's request limit.
+ */
+const DEFAULT_LIMITS: Record<string, Required<PlatformLimits>> = {
+  printify: { concurrency: 4, ratePerSecond: 2, burst: 4 },
+  shopify: { concurrency: 2, ratePerSecond: 1, burst: 2 },
+  tiktok: { concurrency: 2, ratePerSecond: 1, burst: 2 },
+  etsy: { concurrency: 4, ratePerSecond: 2, burst: 4 },
+  instagram: { concurrency: 2, ratePerSecond: 0.5, burst: 2 },
+  facebook: { concurrency: 2, ratePerSecond: 0.5, burst: 2 }
+};
+
+const FALLBACK_LIMITS: Required<PlatformLimits> = { concurrency: 2, ratePerSecond: 1, burst: 2 };
+
+interface Lane {
+  limits: Required<PlatformLimits>;
+  active: number;
+  waiters: Array<() => void>;
+  tokens: number;
+  refilledAt: number;
+  completed: number;
+  failed: number;
+  totalLatencyMs: number;
+  firstStartedAt?: number;
+}
+
+/**
+ * Scheduler with one lane per platform
+ *
+ * Each lane has its own semaphore and token bucket, and runs tasks through
+ * the platform's circuit breaker so an outage fails fast instead of
+ * occupying slots.
+ */
+export class PublishScheduler {
+  private lanes = new Map<string, Lane>();
+
+  constructor(
+    private readonly breakers: CircuitBreakerManager,
+    private readonly overrides: Record<string, PlatformLimits> = {}
+  ) {}
+
+  /**
+   * Run task in platform's lane, waiting for a slot and a rate token
+   */
+  async run<T>(platform: string, task: () => Promise<T>): Promise<T> {
+    const lane = this.lane(platform);
+
+    await this.acquireSlot(lane);
+    try {
+      await this.takeToken(lane);
+
+      const startedAt = Date.now();
+      lane.firstStartedAt ??= startedAt;
+      try {
+        const result = await this.breakers.getBreaker(platform).execute(task);
+        lane.completed++;
+        return result;
+      } catch (error) {
+        lane.failed++;
+        throw error;
+      } finally {
+        lane.totalLatencyMs += Date.now() - startedAt;
+      }
+    } finally {
+      this.releaseSlot(lane);
+    }
+  }
+
+  /**
+   * Get per-platform throughput
+   */
+  getStats(): Record<string, PlatformThroughput> {
+    const stats: Record<string, PlatformThroughput> = {};
+    const now = Date.now();
+
+    this.lanes.forEach((lane, platform) => {
+      const finished = lane.completed + lane.failed;
+      const elapsedMinutes = lane.firstStartedAt ? (now - lane.firstStartedAt) / 60000 : 0;
+      stats[platform] = {
+        inFlight: lane.active,
+        queued: lane.waiters.length,
+        completed: lane.completed,
+        failed: lane.failed,
+        averageLatencyMs: finished > 0 ? Math.round(lane.totalLatencyMs / finished) : 0,
+        perMinute: elapsedMinutes > 0 ? Number((lane.completed / elapsedMinutes).toFixed(2)) : 0
+      };
+    });
+
+    return stats;
+  }
+
+  private lane(platform: string): Lane {
+    let lane = this.lanes.get(platform);
+    if (!lane) {
+      const base = DEFAULT_LIMITS[platform] ?? FALLBACK_LIMITS;
+      const override = this.overrides[platform] ?? {};
+      const concurrency = Math.max(1, override.concurrency ?? base.concurrency);
+      const limits = {
+        concurrency,
+        ratePerSecond: override.ratePerSecond ?? base.ratePerSecond,
+        burst: Math.max(1, override.burst ?? (override.concurrency ? concurrency : base.burst))
+      };
+      lane = {
+        limits,
+        active: 0,
+        waiters: [],
+        tokens: limits.burst,
+        refilledAt: Date.now(),
+        completed: 0,
+        failed: 0,
+        totalLatencyMs: 0
+      };
+      this.lanes.set(platform, lane);
+    }
+    return lane;
+  }
+
+  private async acquireSlot(lane: Lane): Promise<void> {
+    if (lane.active < lane.limits.concurrency) {
+      lane.active++;
+      return;
+    }
+    // releaseSlot hands its slot straight to the next waiter
+    await new Promise<void>(resolve => lane.waiters.push(resolve));
+  }
+
+  private releaseSlot(lane: Lane): void {
+    const next = lane.waiters.shift();
+    if (next) {
+      next();
+    } else {
+      lane.active--;
+    }
+  }
+
+  private async takeToken(lane: Lane): Promise<void> {
+    const { ratePerSecond, burst } = lane.limits;
+    if (ratePerSecond <= 0) return;
+
+    for (;;) {
+      const now = Date.now();
+      lane.tokens = Math.min(burst, lane.tokens + ((now - lane.refilledAt) / 1000) * ratePerSecond);
+      lane.refilledAt = now;
+
+      if (lane.tokens >= 1) {
+        lane.tokens -= 1;
+        return;
+      }
+      await sleep(((1 - lane.tokens) / ratePerSecond) * 1000);
+    }
+  }
+}